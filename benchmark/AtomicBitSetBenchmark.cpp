@@ -0,0 +1,126 @@
+// Runs a level-synchronous parallel BFS over a random graph with 4M nodes,
+// keeping the visited set in an AtomicBitSet, with and without cache-line
+// padding, and compares it against a sequential BFS over a DynamicBitSet.
+
+#include "DataStructure/AtomicBitSet.h"
+#include "DataStructure/Parallel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+const uint32_t NumNodes = 1 << 22;
+const unsigned Degree = 8;
+
+// Adjacency lists in CSR form.
+struct Graph {
+    std::vector<uint32_t> offsets, targets;
+};
+
+Graph makeGraph(std::mt19937& rng) {
+    Graph g;
+    g.offsets.reserve(NumNodes + 1);
+    g.targets.reserve(size_t(NumNodes) * Degree);
+    for (uint32_t node = 0; node < NumNodes; ++node) {
+        g.offsets.push_back(static_cast<uint32_t>(g.targets.size()));
+        for (unsigned i = 0; i < Degree; ++i)
+            g.targets.push_back(rng() % NumNodes);
+    }
+    g.offsets.push_back(static_cast<uint32_t>(g.targets.size()));
+    return g;
+}
+
+template <typename Fn>
+double measure(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+size_t bfsSequential(const Graph& g) {
+    DynamicBitSet<> visited(NumNodes);
+    std::vector<uint32_t> frontier = {0}, next;
+    visited.set(0);
+    size_t reached = 1;
+    while (!frontier.empty()) {
+        next.clear();
+        for (auto node : frontier)
+            for (auto i = g.offsets[node]; i != g.offsets[node + 1]; ++i)
+                if (!visited.test_set(g.targets[i], true))
+                    next.push_back(g.targets[i]);
+        reached += next.size();
+        frontier.swap(next);
+    }
+    return reached;
+}
+
+template <typename BitSet>
+size_t bfsParallel(const Graph& g, ThreadPool& pool) {
+    BitSet visited(NumNodes);
+    std::vector<uint32_t> frontier = {0};
+    visited.set(0);
+    size_t reached = 1;
+    const size_t numChunks = 4 * pool.getNumThreads();
+    std::vector<std::vector<uint32_t>> next(numChunks);
+    while (!frontier.empty()) {
+        pool.run(numChunks, [&](size_t chunk) {
+            auto& out = next[chunk];
+            out.clear();
+            size_t begin = frontier.size() * chunk / numChunks;
+            size_t end = frontier.size() * (chunk + 1) / numChunks;
+            for (size_t j = begin; j != end; ++j) {
+                auto node = frontier[j];
+                for (auto i = g.offsets[node]; i != g.offsets[node + 1]; ++i)
+                    if (visited.test_and_set(g.targets[i],
+                                             std::memory_order_relaxed))
+                        out.push_back(g.targets[i]);
+            }
+        });
+        frontier.clear();
+        for (auto& out : next)
+            frontier.insert(frontier.end(), out.begin(), out.end());
+        reached += frontier.size();
+    }
+    return reached;
+}
+}
+
+int main() {
+    std::mt19937 rng(42);
+    auto g = makeGraph(rng);
+    size_t sink = 0;
+
+    std::printf("BFS over %u nodes, degree %u\n", NumNodes, Degree);
+    double sequential = measure([&] { sink += bfsSequential(g); });
+    std::printf("  sequential DynamicBitSet  %8.2f ms\n", sequential);
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        ThreadPool pool(threads);
+        double packed =
+            measure([&] { sink += bfsParallel<AtomicBitSet<>>(g, pool); });
+        double padded = measure([&] {
+            sink += bfsParallel<AtomicBitSet<unsigned long, true>>(g, pool);
+        });
+        std::printf("  %u threads  packed %8.2f ms  padded %8.2f ms\n",
+                    threads, packed, padded);
+    }
+
+    AtomicBitSet<> visited(NumNodes);
+    for (uint32_t i = 0; i < NumNodes; i += 3)
+        visited.set(i, std::memory_order_relaxed);
+    DynamicBitSet<> copy;
+    double toDense = measure([&] { copy = visited.to_dynamic_bitset(); });
+    double fromDense = measure([&] { AtomicBitSet<> back(copy); });
+    double merge = measure([&] { sink += visited.merge_from(copy); });
+    std::printf("  to_dynamic_bitset %.2f ms, from DynamicBitSet %.2f ms, "
+                "merge_from %.2f ms\n",
+                toDense, fromDense, merge);
+    std::printf("(%zu)\n", sink);
+    return 0;
+}
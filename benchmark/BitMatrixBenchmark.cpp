@@ -0,0 +1,110 @@
+// Computes the reachability relation of random graphs with BitMatrix, up to
+// 50K nodes, and compares it with Warshall's algorithm over a
+// std::vector<DynamicBitSet> on graphs small enough for it to finish. Also
+// times the boolean product of two random matrices.
+
+#include "DataStructure/BitMatrix.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+template <typename Fn>
+double measure(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+// A graph with the given number of edges per node. A DAG only has edges to
+// higher-numbered nodes; otherwise most nodes end up in one big cycle.
+BitMatrix makeGraph(std::mt19937& rng, size_t n, unsigned degree, bool dag) {
+    BitMatrix m(n, n);
+    for (size_t v = 0; v < n; ++v)
+        for (unsigned i = 0; i < degree; ++i) {
+            if (!dag) {
+                m.set(v, rng() % n);
+            } else if (v + 1 < n) {
+                // Mostly short edges, so that the DAG is deep.
+                auto span = std::min<size_t>(n - v - 1, 1 + rng() % 1000);
+                m.set(v, v + 1 + rng() % span);
+            }
+        }
+    return m;
+}
+
+size_t warshall(const BitMatrix& m) {
+    size_t n = m.rows();
+    std::vector<DynamicBitSet<>> rows;
+    for (size_t i = 0; i < n; ++i)
+        rows.push_back(m[i].to_dynamic_bitset());
+    for (size_t k = 0; k < n; ++k)
+        for (size_t i = 0; i < n; ++i)
+            if (rows[i].test(k))
+                rows[i] |= rows[k];
+    size_t ret = 0;
+    for (auto& row : rows)
+        ret += row.count();
+    return ret;
+}
+}
+
+int main() {
+    std::mt19937 rng(42);
+    size_t sink = 0;
+
+    std::printf("closure            nodes    Warshall      BitMatrix\n");
+    for (bool dag : {false, true}) {
+        for (size_t n : {size_t(4000), size_t(50000)}) {
+            auto m = makeGraph(rng, n, 4, dag);
+            double naive = 0;
+            if (n <= 4000)
+                naive = measure([&] { sink += warshall(m); });
+            double closure = measure([&] {
+                m.transitive_closure();
+                sink += m.count();
+            });
+            if (naive != 0)
+                std::printf("  %-12s %9zu %9.1f ms %11.1f ms\n",
+                            dag ? "DAG" : "cyclic", n, naive, closure);
+            else
+                std::printf("  %-12s %9zu           -   %11.1f ms\n",
+                            dag ? "DAG" : "cyclic", n, closure);
+        }
+    }
+
+    std::printf("multiply           size   row loops      BitMatrix\n");
+    for (auto shape : {std::make_pair(2000, 20), std::make_pair(8000, 20),
+                       std::make_pair(4000, 400)}) {
+        size_t n = shape.first;
+        BitMatrix a(n, n), b(n, n);
+        for (size_t i = 0; i < n; ++i)
+            for (int j = 0; j < shape.second; ++j) {
+                a.set(i, rng() % n);
+                b.set(i, rng() % n);
+            }
+        std::vector<DynamicBitSet<>> rowsB;
+        for (size_t i = 0; i < n; ++i)
+            rowsB.push_back(b[i].to_dynamic_bitset());
+        double naive = measure([&] {
+            std::vector<DynamicBitSet<>> rows(n, DynamicBitSet<>(n));
+            for (size_t i = 0; i < n; ++i) {
+                a[i].for_each_set_bit([&](size_t k) { rows[i] |= rowsB[k]; });
+                sink += rows[i].count();
+            }
+        });
+        double blocked = measure([&] { sink += multiply(a, b).count(); });
+        std::printf("  %3d per row  %9zu %9.1f ms %11.1f ms\n", shape.second,
+                    n, naive, blocked);
+    }
+    std::printf("(%zu)\n", sink);
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Measures the bulk operations of DynamicBitSet on 1M-bit sets, the size of
+// the sets in a bit-vector dataflow analysis, against the one-block-at-a-time
+// loops they used to be, and the fused dataflow updates against separate
+// passes. Also compares the ways to enumerate the set bits.
+
+#include "DataStructure/DynamicBitSet.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace ds;
+
+namespace {
+
+using BitSet = DynamicBitSet<>;
+using Block = BitSet::block_type;
+
+const size_t NumBits = size_t(1) << 20;
+
+template <typename Fn>
+double measure(Fn fn) {
+    const int reps = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i)
+        fn();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e6 / reps;
+}
+
+// The reference loops work on copies of the raw blocks.
+std::vector<Block> blocksOf(const BitSet& set) {
+    std::vector<Block> ret(set.num_blocks());
+    for (size_t i = 0; i < set.size(); ++i)
+        if (set.test(i))
+            ret[i / BitSet::bits_per_block] |= Block(1)
+                                               << (i % BitSet::bits_per_block);
+    return ret;
+}
+
+BitSet makeSparse(std::mt19937& rng, unsigned percent) {
+    BitSet ret(NumBits);
+    for (size_t i = 0; i < NumBits; ++i)
+        if (rng() % 100 < percent)
+            ret.set(i);
+    return ret;
+}
+
+void report(const char* name, double oldUs, double newUs) {
+    std::printf("  %-14s %9.2f us %9.2f us %7.2fx\n", name, oldUs, newUs,
+                oldUs / newUs);
+}
+}
+
+int main() {
+    std::mt19937 rng(42);
+    BitSet a(NumBits), b(NumBits);
+    for (size_t i = 0; i < NumBits; ++i) {
+        if (rng() % 2)
+            a.set(i);
+        if (rng() % 2)
+            b.set(i);
+    }
+    // A subset of b, and a set disjoint from it, so that is_subset_of and
+    // intersects have to scan all blocks.
+    auto sub = b;
+    sub &= a;
+    auto disjoint = a;
+    disjoint -= b;
+    auto ra = blocksOf(a), rb = blocksOf(b), rsub = blocksOf(sub),
+         rdisjoint = blocksOf(disjoint);
+    size_t sink = 0;
+
+    std::printf("%zu bits          block loop    bulk       speedup\n",
+                NumBits);
+    report("operator|=", measure([&] {
+               for (size_t i = 0; i < ra.size(); ++i)
+                   ra[i] |= rb[i];
+           }),
+           measure([&] { a |= b; }));
+    report("operator-=", measure([&] {
+               for (size_t i = 0; i < ra.size(); ++i)
+                   ra[i] &= ~rb[i];
+           }),
+           measure([&] { a -= b; }));
+    report("count", measure([&] {
+               for (auto block : rb)
+                   sink += __builtin_popcountl(block);
+           }),
+           measure([&] { sink += b.count(); }));
+    report("intersects", measure([&] {
+               for (size_t i = 0; i < rb.size(); ++i)
+                   if (rdisjoint[i] & rb[i]) {
+                       ++sink;
+                       break;
+                   }
+           }),
+           measure([&] { sink += disjoint.intersects(b); }));
+    report("is_subset_of", measure([&] {
+               for (size_t i = 0; i < rb.size(); ++i)
+                   if (rsub[i] & ~rb[i]) {
+                       ++sink;
+                       break;
+                   }
+           }),
+           measure([&] { sink += sub.is_subset_of(b); }));
+    BitSet empty(NumBits);
+    std::vector<Block> rempty(empty.num_blocks());
+    report("any", measure([&] {
+               for (auto block : rempty)
+                   if (block != 0) {
+                       ++sink;
+                       break;
+                   }
+           }),
+           measure([&] { sink += empty.any(); }));
+
+    // The transfer function of a gen/kill dataflow problem, and the meet,
+    // which have to report whether they changed anything.
+    auto gen = makeSparse(rng, 5), kill = makeSparse(rng, 10), out = a;
+    std::printf("dataflow         separate    fused      speedup\n");
+    report("gen|(in&~kill)", measure([&] {
+               auto next = b;
+               next -= kill;
+               next |= gen;
+               sink += next != out;
+               out = next;
+           }),
+           measure([&] { sink += out.assign_or_andnot(gen, b, kill); }));
+    report("|= and compare", measure([&] {
+               auto old = out;
+               out |= a;
+               sink += old != out;
+           }),
+           measure([&] { sink += out.or_with_changed(a); }));
+
+    std::printf("enumerating      find_next   set_bits  for_each_set_bit\n");
+    for (unsigned percent : {1u, 10u, 50u}) {
+        BitSet s(NumBits);
+        for (size_t i = 0; i < NumBits; ++i)
+            if (rng() % 100 < percent)
+                s.set(i);
+        double findNext = measure([&] {
+            for (auto pos = s.find_first(); pos != BitSet::npos;
+                 pos = s.find_next(pos))
+                sink += pos;
+        });
+        double range = measure([&] {
+            for (auto pos : s.set_bits())
+                sink += pos;
+        });
+        double forEach = measure(
+            [&] { s.for_each_set_bit([&](size_t pos) { sink += pos; }); });
+        std::printf("  %2u%% set      %9.2f us %9.2f us %9.2f us\n", percent,
+                    findNext, range, forEach);
+    }
+    std::printf("(%zu)\n", sink);
+    return 0;
+}
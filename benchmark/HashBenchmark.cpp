@@ -0,0 +1,88 @@
+// Compares the bulk byte hash behind std::hash<StringView> and
+// std::hash<ArrayRef<T>> with the loops they replaced: byte-at-a-time FNV-1a
+// for strings and a per-element hash_combine for arrays of integers.
+
+#include "DataStructure/ArrayRef.h"
+#include "DataStructure/StringView.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+size_t fnv1a(StringView s) {
+    size_t hash = 14695981039346656037UL;
+    for (size_t i = 0ul, e = s.size(); i != e; ++i) {
+        hash ^= s[i];
+        hash *= 1099511628211UL;
+    }
+    return hash;
+}
+
+size_t combineElements(ArrayRef<uint32_t> a) {
+    size_t seed = 0;
+    for (auto elem : a)
+        seed ^= std::hash<uint32_t>()(elem) + 0x9e3779b9 + (seed << 6) +
+                (seed >> 2);
+    return seed;
+}
+
+// Returns the average time in nanoseconds to hash one of the keys, which start
+// at different offsets so that unaligned loads are measured as well. Every run
+// hashes about the same number of bytes.
+template <typename Key, typename Fn>
+double measure(const std::vector<Key>& keys, Fn fn) {
+    size_t keyBytes = keys.front().size() * sizeof(keys.front()[0]);
+    const size_t reps = std::max<size_t>(
+        1, (size_t(1) << 26) / (keys.size() * (keyBytes + 16)));
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; ++r)
+        for (auto& key : keys)
+            sink += fn(key);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (sink == 42)
+        std::printf(" ");
+    return elapsed.count() * 1e9 / double(reps * keys.size());
+}
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::vector<char> bytes(1 << 16);
+    for (auto& b : bytes)
+        b = static_cast<char>(rng());
+    std::vector<uint32_t> words(1 << 14);
+    for (auto& w : words)
+        w = rng();
+
+    std::printf("StringView        length  fnv1a ns  bulk ns  speedup\n");
+    for (size_t len : {4, 8, 16, 24, 32, 64, 128, 256, 1024, 4096}) {
+        std::vector<StringView> keys;
+        for (size_t i = 0; i < 256; ++i)
+            keys.emplace_back(&bytes[i * 13 % (bytes.size() - len)], len);
+        double oldNs = measure(keys, fnv1a);
+        double newNs = measure(keys, std::hash<StringView>());
+        std::printf("                  %6zu  %8.2f  %7.2f  %6.2fx\n", len,
+                    oldNs, newNs, oldNs / newNs);
+    }
+
+    std::printf("ArrayRef<uint32_t> elems  combine ns  bulk ns  speedup\n");
+    for (size_t len : {1, 4, 16, 64, 256, 1024}) {
+        std::vector<ArrayRef<uint32_t>> keys;
+        for (size_t i = 0; i < 256; ++i)
+            keys.emplace_back(&words[i * 7 % (words.size() - len)], len);
+        double oldNs = measure(keys, combineElements);
+        double newNs = measure(keys, std::hash<ArrayRef<uint32_t>>());
+        std::printf("                  %6zu  %10.2f  %7.2f  %6.2fx\n", len,
+                    oldNs, newNs, oldNs / newNs);
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Measures materializing the transpose of a row-major matrix through
+// MatrixRef: element by element along the rows of the destination, which
+// walks the source down its columns, against copy_into(), which goes through
+// the matrix in cache-sized tiles.
+
+#include "DataStructure/MatrixRef.h"
+
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+template <typename Fn>
+double measure(Fn fn) {
+    double best = 1e30;
+    for (int i = 0; i < 5; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void naiveCopy(MatrixRef<float> src, MutableMatrixRef<float> dst) {
+    for (size_t i = 0; i != dst.rows(); ++i)
+        for (size_t j = 0; j != dst.cols(); ++j)
+            dst(i, j) = src(i, j);
+}
+}
+
+int main() {
+    for (size_t n : {256, 1024, 2048, 4096}) {
+        std::vector<float> src(n * n), dst(n * n);
+        std::iota(src.begin(), src.end(), 0.0f);
+        MatrixRef<float> in(src, n, n);
+        MutableMatrixRef<float> out(dst, n, n);
+
+        double naive = measure([&] { naiveCopy(in.transpose(), out); });
+        double tiled = measure([&] { copy_into(in.transpose(), out); });
+        std::printf("%4zu x %-4zu naive %8.2f ms  tiled %8.2f ms  %5.2fx\n", n,
+                    n, naive * 1e3, tiled * 1e3, naive / tiled);
+    }
+    return 0;
+}
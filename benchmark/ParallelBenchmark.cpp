@@ -0,0 +1,93 @@
+// Measures how the parallel algorithms scale with the number of threads in the
+// pool. Every algorithm runs on the same input with pools of 1 to 32 threads;
+// the speedup column is relative to the single-threaded pool.
+
+#include "DataStructure/Parallel.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+const size_t NumElems = size_t(1) << 23;
+
+template <typename Fn>
+double measure(Fn fn) {
+    const int reps = 5;
+    double best = 1e30;
+    for (int i = 0; i < reps; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void report(const char* name, unsigned threads, double secs, double base) {
+    std::printf("  %-12s %2u threads %8.2f ms  %5.2fx\n", name, threads,
+                secs * 1e3, base / secs);
+}
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::vector<double> input(NumElems);
+    for (auto& x : input)
+        x = rng() / double(rng.max());
+    std::vector<double> output(NumElems);
+
+    double baseReduce = 0, baseTransform = 0, baseSort = 0, basePrefix = 0;
+    double sink = 0;
+    for (unsigned threads : {1u, 2u, 4u, 8u, 16u, 32u}) {
+        ThreadPool pool(threads);
+        ParallelOptions opts;
+        opts.pool = &pool;
+        std::printf("%u threads\n", threads);
+
+        double secs = measure([&] {
+            sink += parallel_reduce(ArrayRef<double>(input), 0.0,
+                                    std::plus<double>(), opts);
+        });
+        if (threads == 1)
+            baseReduce = secs;
+        report("reduce", threads, secs, baseReduce);
+
+        secs = measure([&] {
+            parallel_transform(ArrayRef<double>(input),
+                               MutableArrayRef<double>(output),
+                               [](double x) { return std::sqrt(x) * 2 + 1; },
+                               opts);
+        });
+        if (threads == 1)
+            baseTransform = secs;
+        report("transform", threads, secs, baseTransform);
+
+        secs = measure([&] {
+            output = input;
+            parallel_sort(MutableArrayRef<double>(output), std::less<double>(),
+                          opts);
+        });
+        if (threads == 1)
+            baseSort = secs;
+        report("sort", threads, secs, baseSort);
+
+        secs = measure([&] {
+            parallel_prefix_sum(ArrayRef<double>(input),
+                                MutableArrayRef<double>(output),
+                                std::plus<double>(), opts);
+        });
+        if (threads == 1)
+            basePrefix = secs;
+        report("prefix_sum", threads, secs, basePrefix);
+        sink += output.back();
+    }
+    std::printf("(%g)\n", sink);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Uses a DynamicBitSet of 64M bits as the presence mask of a compacted array,
+// and compares rank() and select() through a RankSelectIndex with a linear
+// scan over the blocks, at a few densities. Also reports the size of the index
+// relative to the bit set.
+
+#include "DataStructure/RankSelect.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+const size_t NumBits = size_t(1) << 26;
+const size_t NumQueries = 1 << 20;
+const size_t NumScanQueries = 256;
+
+template <typename Fn>
+double measure(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e9;
+}
+
+// The linear scans count the blocks with popcount, which is the best they can
+// do without an index.
+size_t scanRank(const std::vector<unsigned long>& blocks, size_t pos) {
+    size_t ret = 0;
+    for (size_t i = 0; i < pos / 64; ++i)
+        ret += static_cast<size_t>(__builtin_popcountl(blocks[i]));
+    if (pos % 64 != 0)
+        ret += static_cast<size_t>(__builtin_popcountl(
+            blocks[pos / 64] & ((1ul << (pos % 64)) - 1)));
+    return ret;
+}
+
+size_t scanSelect(const std::vector<unsigned long>& blocks, size_t k) {
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        auto count = static_cast<size_t>(__builtin_popcountl(blocks[i]));
+        if (k < count) {
+            auto block = blocks[i];
+            for (; k != 0; --k)
+                block &= block - 1;
+            return i * 64 + detail::findFirstSet(block);
+        }
+        k -= count;
+    }
+    return DynamicBitSet<>::npos;
+}
+}
+
+int main() {
+    std::mt19937_64 rng(42);
+    size_t sink = 0;
+
+    std::printf("%zu bits, ns per query      rank   scan rank     select  "
+                "scan select  index size\n",
+                NumBits);
+    for (double density : {0.01, 0.1, 0.5, 0.9}) {
+        DynamicBitSet<> bits(NumBits);
+        std::bernoulli_distribution hit(density);
+        for (size_t i = 0; i < NumBits; ++i)
+            if (hit(rng))
+                bits.set(i);
+
+        std::vector<unsigned long> blocks;
+        to_block_range(bits, std::back_inserter(blocks));
+
+        std::unique_ptr<RankSelectIndex> index;
+        double buildNs =
+            measure([&] { index.reset(new RankSelectIndex(bits)); });
+
+        std::vector<size_t> positions(NumQueries), ranks(NumQueries);
+        for (size_t i = 0; i < NumQueries; ++i) {
+            positions[i] = rng() % NumBits;
+            ranks[i] = rng() % index->count();
+        }
+
+        double rankNs = measure([&] {
+            for (auto pos : positions)
+                sink += index->rank(pos);
+        });
+        double selectNs = measure([&] {
+            for (auto k : ranks)
+                sink += index->select(k);
+        });
+        double scanRankNs = measure([&] {
+            for (size_t i = 0; i < NumScanQueries; ++i)
+                sink += scanRank(blocks, positions[i]);
+        });
+        double scanSelectNs = measure([&] {
+            for (size_t i = 0; i < NumScanQueries; ++i)
+                sink += scanSelect(blocks, ranks[i]);
+        });
+
+        std::printf("  density %.2f            %9.1f %11.0f %10.1f %12.0f"
+                    "      %.2f%%\n",
+                    density, rankNs / NumQueries, scanRankNs / NumScanQueries,
+                    selectNs / NumQueries, scanSelectNs / NumScanQueries,
+                    100.0 * index->getMemorySize() / (NumBits / 8));
+        std::printf("    build %.2f ms\n", buildNs / 1e6);
+    }
+    std::printf("(%zu)\n", sink);
+    return 0;
+}
@@ -0,0 +1,57 @@
+// Measures how fast a SmallVector of unique_ptr grows when its elements are
+// relocated with realloc, compared with a wrapper type that does not opt into
+// trivial relocation and therefore goes through the move-and-destroy loop.
+
+#include "DataStructure/SmallVector.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+using namespace ds;
+
+namespace {
+
+// The pointees are not heap allocated, so that only the vector's growth is
+// measured.
+struct NoDelete {
+    void operator()(int*) const {}
+};
+using Ptr = std::unique_ptr<int, NoDelete>;
+
+// Same layout as Ptr, but not known to be trivially relocatable.
+struct Opaque {
+    Ptr ptr;
+
+    Opaque(int* p) : ptr(p) {}
+    Opaque(Opaque&&) = default;
+    ~Opaque() {}
+};
+
+template <typename T>
+void run(const char* name, size_t size) {
+    const int reps = 20;
+    int dummy = 0;
+    size_t sink = 0;
+    std::chrono::duration<double> elapsed(0);
+    for (int i = 0; i < reps; ++i) {
+        SmallVector<T, 4> vec;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t j = 0; j < size; ++j)
+            vec.emplace_back(&dummy);
+        elapsed += std::chrono::steady_clock::now() - start;
+        sink += vec.size();
+    }
+    double ns = elapsed.count() * 1e9 / (size * double(reps));
+    std::printf("  %-22s %8.2f ns/push_back  (%zu)\n", name, ns, sink);
+}
+}
+
+int main() {
+    for (size_t size : {size_t(1000), size_t(1) << 20}) {
+        std::printf("%zu elements\n", size);
+        run<Ptr>("unique_ptr (realloc)", size);
+        run<Opaque>("wrapper (move loop)", size);
+    }
+    return 0;
+}
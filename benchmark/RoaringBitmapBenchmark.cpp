@@ -0,0 +1,178 @@
+// Compares RoaringBitmap with DenseSet<unsigned> and DynamicBitSet as the
+// posting lists of an inverted index over 4M documents: a few common terms
+// that hit half of the documents, terms whose documents are clustered into
+// ranges, and rare terms. Reports the memory of every representation and the
+// time to intersect and unite every pair of lists.
+
+#include "DataStructure/DenseSet.h"
+#include "DataStructure/DynamicBitSet.h"
+#include "DataStructure/RoaringBitmap.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+const uint32_t NumDocs = 1 << 22;
+
+template <typename Fn>
+double measure(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+std::vector<std::vector<uint32_t>> makePostings(std::mt19937& rng) {
+    std::vector<std::vector<uint32_t>> ret;
+    auto add = [&](double density, unsigned numRanges) {
+        std::vector<uint32_t> docs;
+        if (numRanges == 0) {
+            std::bernoulli_distribution hit(density);
+            for (uint32_t doc = 0; doc < NumDocs; ++doc)
+                if (hit(rng))
+                    docs.push_back(doc);
+        } else {
+            // Ranges of consecutive documents, like the pages of one site.
+            std::vector<uint32_t> starts(numRanges);
+            for (auto& start : starts)
+                start = rng() % NumDocs;
+            std::sort(starts.begin(), starts.end());
+            uint32_t next = 0;
+            for (auto start : starts) {
+                start = std::max(start, next);
+                auto length = 500 + uint32_t(rng() % 5000);
+                auto last = std::min(start + length, NumDocs);
+                for (auto doc = start; doc < last; ++doc)
+                    docs.push_back(doc);
+                next = last;
+            }
+        }
+        ret.push_back(std::move(docs));
+    };
+    for (int i = 0; i < 2; ++i)
+        add(0.5, 0);
+    for (int i = 0; i < 4; ++i)
+        add(0, 50 + rng() % 200);
+    for (int i = 0; i < 6; ++i)
+        add(0.0005, 0);
+    return ret;
+}
+
+void report(const char* name, double denseSetMs, double bitSetMs,
+            double roaringMs) {
+    std::printf("  %-12s %9.2f ms %9.2f ms %9.2f ms\n", name, denseSetMs,
+                bitSetMs, roaringMs);
+}
+}
+
+int main() {
+    std::mt19937 rng(42);
+    auto postings = makePostings(rng);
+    size_t n = postings.size(), members = 0;
+
+    std::vector<DenseSet<unsigned>> denseSets(n);
+    std::vector<DynamicBitSet<>> bitSets(n, DynamicBitSet<>(NumDocs));
+    std::vector<RoaringBitmap> roarings(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (auto doc : postings[i]) {
+            denseSets[i].insert(doc);
+            bitSets[i].set(doc);
+            roarings[i].set(doc);
+        }
+        members += postings[i].size();
+    }
+
+    size_t denseBytes = 0, bitSetBytes = 0, roaringBytes = 0, runBytes = 0,
+           serializedBytes = 0;
+    for (size_t i = 0; i < n; ++i) {
+        denseBytes += denseSets[i].getMemorySize();
+        bitSetBytes += bitSets[i].num_blocks() * sizeof(unsigned long);
+        roaringBytes += roarings[i].getMemorySize();
+    }
+    auto optimized = roarings;
+    for (auto& r : optimized) {
+        r.run_optimize();
+        runBytes += r.getMemorySize();
+        serializedBytes += r.getSerializedSize();
+    }
+    std::printf("%zu posting lists, %zu postings\n", n, members);
+    std::printf("  DenseSet            %8zu KB\n", denseBytes / 1024);
+    std::printf("  DynamicBitSet       %8zu KB\n", bitSetBytes / 1024);
+    std::printf("  RoaringBitmap       %8zu KB\n", roaringBytes / 1024);
+    std::printf("  after run_optimize  %8zu KB\n", runBytes / 1024);
+    std::printf("  serialized          %8zu KB\n", serializedBytes / 1024);
+
+    std::printf("all pairs        DenseSet     DynamicBitSet  RoaringBitmap\n");
+    size_t sink = 0;
+    report("intersect", measure([&] {
+               for (size_t i = 0; i < n; ++i)
+                   for (size_t j = i + 1; j < n; ++j) {
+                       auto& small = denseSets[i].size() < denseSets[j].size()
+                                         ? denseSets[i]
+                                         : denseSets[j];
+                       auto& large = &small == &denseSets[i] ? denseSets[j]
+                                                             : denseSets[i];
+                       DenseSet<unsigned> result;
+                       for (auto doc : small)
+                           if (large.count(doc))
+                               result.insert(doc);
+                       sink += result.size();
+                   }
+           }),
+           measure([&] {
+               for (size_t i = 0; i < n; ++i)
+                   for (size_t j = i + 1; j < n; ++j) {
+                       auto result = bitSets[i];
+                       result &= bitSets[j];
+                       sink += result.count();
+                   }
+           }),
+           measure([&] {
+               for (size_t i = 0; i < n; ++i)
+                   for (size_t j = i + 1; j < n; ++j)
+                       sink += (optimized[i] & optimized[j]).count();
+           }));
+    report("unite", measure([&] {
+               for (size_t i = 0; i < n; ++i)
+                   for (size_t j = i + 1; j < n; ++j) {
+                       auto result = denseSets[i];
+                       for (auto doc : denseSets[j])
+                           result.insert(doc);
+                       sink += result.size();
+                   }
+           }),
+           measure([&] {
+               for (size_t i = 0; i < n; ++i)
+                   for (size_t j = i + 1; j < n; ++j) {
+                       auto result = bitSets[i];
+                       result |= bitSets[j];
+                       sink += result.count();
+                   }
+           }),
+           measure([&] {
+               for (size_t i = 0; i < n; ++i)
+                   for (size_t j = i + 1; j < n; ++j)
+                       sink += (optimized[i] | optimized[j]).count();
+           }));
+    report("iterate", measure([&] {
+               for (auto& set : denseSets)
+                   for (auto doc : set)
+                       sink += doc;
+           }),
+           measure([&] {
+               for (auto& set : bitSets)
+                   set.for_each_set_bit([&](size_t doc) { sink += doc; });
+           }),
+           measure([&] {
+               for (auto& r : optimized)
+                   r.for_each_set_bit([&](uint32_t doc) { sink += doc; });
+           }));
+    std::printf("(%zu)\n", sink);
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Measures the memory taken by AST-like nodes that embed SmallVectors. Each
+// node is compared against the same node laid out with a three-pointer vector
+// header, which is what std::vector (and SmallVector before its header was
+// compacted) costs.
+
+#include "DataStructure/SmallVector.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+struct Node {
+    uint32_t kind;
+    uint32_t line;
+    Node* parent;
+    SmallVector<Node*, 0> children;
+    SmallVector<uint32_t, 2> attributes;
+};
+
+struct StdNode {
+    uint32_t kind;
+    uint32_t line;
+    StdNode* parent;
+    std::vector<StdNode*> children;
+    std::vector<uint32_t> attributes;
+};
+
+// Builds a tree of 'numNodes' nodes where every node has 'fanout' children and
+// one attribute, and returns the time taken.
+template <typename NodeT>
+double build(size_t numNodes, size_t fanout) {
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<NodeT[]> nodes(new NodeT[numNodes]);
+    for (size_t i = 0; i < numNodes; ++i) {
+        nodes[i].kind = uint32_t(i % 7);
+        nodes[i].line = uint32_t(i);
+        nodes[i].attributes.push_back(uint32_t(i));
+        if (i != 0) {
+            NodeT* parent = &nodes[(i - 1) / fanout];
+            nodes[i].parent = parent;
+            parent->children.push_back(&nodes[i]);
+        }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+template <typename NodeT>
+void report(const char* name, size_t numNodes, size_t fanout) {
+    double seconds = build<NodeT>(numNodes, fanout);
+    std::printf("  %-28s %3zu bytes/node  %8.1f MB inline  %6.1f ms\n", name,
+                sizeof(NodeT), sizeof(NodeT) * double(numNodes) / 1e6,
+                seconds * 1e3);
+}
+}
+
+int main() {
+    const size_t numNodes = 4 << 20;
+    std::printf("sizeof(SmallVector<Node*, 0>) = %zu, "
+                "sizeof(std::vector<Node*>) = %zu\n",
+                sizeof(SmallVector<Node*, 0>), sizeof(std::vector<Node*>));
+    std::printf("%zu nodes\n", numNodes);
+    report<Node>("SmallVector (compact header)", numNodes, 4);
+    report<StdNode>("std::vector (three pointers)", numNodes, 4);
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Compares SparseBitVector against DenseSet<unsigned> on the sets a points-to
+// analysis keeps: thousands of sets, each holding a few dozen IDs out of a
+// universe of 100M, with IDs allocated close together more often than not.
+
+#include "DataStructure/DenseSet.h"
+#include "DataStructure/SparseBitVector.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+const unsigned Universe = 100000000;
+const size_t NumSets = 2000;
+
+template <typename Fn>
+double measure(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() * 1e3;
+}
+
+void report(const char* name, double denseMs, double sparseMs) {
+    std::printf("  %-10s %9.2f ms %9.2f ms %7.2fx\n", name, denseMs, sparseMs,
+                denseMs / sparseMs);
+}
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::vector<std::vector<unsigned>> ids(NumSets);
+    for (auto& set : ids) {
+        // A few clusters of nearby IDs per set.
+        for (int i = 0, e = 2 + rng() % 6; i < e; ++i) {
+            unsigned base = rng() % Universe;
+            for (int j = 0, f = 1 + rng() % 12; j < f; ++j)
+                set.push_back(base + rng() % 256);
+        }
+    }
+
+    std::vector<DenseSet<unsigned>> dense(NumSets);
+    std::vector<SparseBitVector<>> sparse(NumSets);
+    double denseInsert = measure([&] {
+        for (size_t i = 0; i < NumSets; ++i)
+            for (auto id : ids[i])
+                dense[i].insert(id);
+    });
+    double sparseInsert = measure([&] {
+        for (size_t i = 0; i < NumSets; ++i)
+            for (auto id : ids[i])
+                sparse[i].set(id);
+    });
+
+    size_t denseBytes = 0, sparseBytes = 0, members = 0;
+    for (size_t i = 0; i < NumSets; ++i) {
+        denseBytes += sizeof(dense[i]) + dense[i].getMemorySize();
+        sparseBytes += sizeof(sparse[i]) + sparse[i].getMemorySize();
+        members += sparse[i].count();
+    }
+    std::printf("%zu sets, %zu members   DenseSet   SparseBitVector\n",
+                NumSets, members);
+    std::printf("  memory     %9zu KB %9zu KB %7.2fx\n", denseBytes / 1024,
+                sparseBytes / 1024, double(denseBytes) / sparseBytes);
+    report("insert", denseInsert, sparseInsert);
+
+    // Propagate each set into the next few, like a worklist solver does.
+    auto denseCopy = dense;
+    auto sparseCopy = sparse;
+    size_t sink = 0;
+    report("union", measure([&] {
+               for (size_t i = 0; i + 4 < NumSets; ++i)
+                   for (size_t j = 1; j <= 4; ++j)
+                       for (auto id : dense[i])
+                           sink += denseCopy[i + j].insert(id).second;
+           }),
+           measure([&] {
+               for (size_t i = 0; i + 4 < NumSets; ++i)
+                   for (size_t j = 1; j <= 4; ++j)
+                       sink += sparseCopy[i + j].union_with(sparse[i]);
+           }));
+
+    report("lookup", measure([&] {
+               for (int rep = 0; rep < 10; ++rep)
+                   for (size_t i = 0; i < NumSets; ++i)
+                       for (auto id : ids[(i + rep) % NumSets])
+                           sink += dense[i].count(id);
+           }),
+           measure([&] {
+               for (int rep = 0; rep < 10; ++rep)
+                   for (size_t i = 0; i < NumSets; ++i)
+                       for (auto id : ids[(i + rep) % NumSets])
+                           sink += sparse[i].test(id);
+           }));
+
+    report("iterate", measure([&] {
+               for (int rep = 0; rep < 10; ++rep)
+                   for (auto& set : denseCopy)
+                       for (auto id : set)
+                           sink += id;
+           }),
+           measure([&] {
+               for (int rep = 0; rep < 10; ++rep)
+                   for (auto& set : sparseCopy)
+                       for (auto id : set)
+                           sink += id;
+           }));
+    std::printf("(%zu)\n", sink);
+    return 0;
+}
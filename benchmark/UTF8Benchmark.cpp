@@ -0,0 +1,68 @@
+// Measures the throughput of the UTF-8 routines of StringView on an ASCII-heavy
+// and a CJK-heavy corpus. The code-point iterator serves as the byte-at-a-time
+// baseline.
+
+#include "DataStructure/StringView.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace ds;
+
+namespace {
+
+// Builds about 'size' bytes of text in which a fraction 'cjkRatio' of the
+// characters are 3-byte CJK ideographs and the rest are ASCII letters.
+std::string makeCorpus(size_t size, double cjkRatio) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> coin(0, 1);
+    std::string ret;
+    ret.reserve(size + 4);
+    while (ret.size() < size) {
+        if (coin(rng) < cjkRatio) {
+            char32_t cp = 0x4E00 + rng() % 0x5000;
+            ret += static_cast<char>(0xE0 | (cp >> 12));
+            ret += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            ret += static_cast<char>(0x80 | (cp & 0x3F));
+        } else
+            ret += static_cast<char>('a' + rng() % 26);
+    }
+    return ret;
+}
+
+template <typename Fn>
+void run(const char* name, const std::string& corpus, Fn fn) {
+    const int reps = 20;
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i)
+        sink += fn(StringView(corpus));
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double gbps = corpus.size() * double(reps) / elapsed.count() / 1e9;
+    std::printf("  %-18s %8.2f GB/s  (%zu)\n", name, gbps, sink);
+}
+
+void runAll(const char* title, const std::string& corpus) {
+    std::printf("%s, %zu bytes\n", title, corpus.size());
+    run("isValidUTF8", corpus,
+        [](StringView s) { return size_t(s.isValidUTF8()); });
+    run("countCodePoints", corpus,
+        [](StringView s) { return s.countCodePoints(); });
+    run("codePoints()", corpus, [](StringView s) {
+        size_t n = 0;
+        for (char32_t cp : s.codePoints())
+            n += cp != CodePointRange::ReplacementCharacter;
+        return n;
+    });
+}
+}
+
+int main() {
+    const size_t size = 16 << 20;
+    runAll("ASCII-heavy (1% CJK)", makeCorpus(size, 0.01));
+    runAll("CJK-heavy (90% CJK)", makeCorpus(size, 0.9));
+    return 0;
+}
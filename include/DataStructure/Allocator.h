@@ -0,0 +1,318 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Growing containers can use the slack malloc leaves at the end of a block.
+// _FORTIFY_SOURCE=3 checks accesses against the requested size, though, so the
+// slack is left alone there.
+#if defined(__GLIBC__) &&                                                      \
+    !(defined(_FORTIFY_SOURCE) && _FORTIFY_SOURCE > 2)
+#include <malloc.h>
+#define DS_MALLOC_USABLE_SIZE(ptr) ::malloc_usable_size(ptr)
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#define DS_MALLOC_USABLE_SIZE(ptr) ::malloc_size(ptr)
+#endif
+
+namespace ds {
+
+// Allocation policies for containers that manage raw storage themselves, such
+// as SmallVector. A policy is a copyable object with the members
+//
+//   void* allocate(size_t size, size_t alignment);
+//   void* reallocate(void* ptr, size_t oldSize, size_t newSize,
+//                    size_t alignment);
+//   void deallocate(void* ptr, size_t size);
+//
+// where reallocate() keeps the first oldSize bytes and may move the block.
+// Containers store their policy by value (as an empty base where possible), so
+// a stateless policy costs nothing.
+//
+// A policy may also provide
+//
+//   size_t getUsableSize(void* ptr, size_t size) const;
+//
+// which returns how many bytes of the block at ptr, allocated with the given
+// size, may actually be used. Containers then treat the block as being that
+// large, including when they reallocate or deallocate it. A policy may ask
+// containers to grow by a factor other than 2 by defining the static constants
+// GrowthNumerator and GrowthDenominator; see GrowthFactor below. Finally, a
+// policy that defines the static constant MinAlignment aligns every block to at
+// least that many bytes, and containers align their inline storage to it as
+// well; see AlignedAllocator below.
+
+// The default policy: the C heap. Alignments beyond what malloc guarantees are
+// served by posix_memalign.
+class MallocAllocator {
+private:
+    static bool isOverAligned(size_t alignment) {
+        return alignment > alignof(std::max_align_t);
+    }
+    static void* allocateAligned(size_t size, size_t alignment);
+    static void* reallocateAligned(void* ptr, size_t oldSize, size_t newSize,
+                                   size_t alignment);
+
+public:
+    void* allocate(size_t size, size_t alignment) {
+        if (isOverAligned(alignment))
+            return allocateAligned(size, alignment);
+        void* ret = std::malloc(size);
+        assert(ret && "Out of memory");
+        return ret;
+    }
+
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize,
+                     size_t alignment) {
+        if (isOverAligned(alignment))
+            return reallocateAligned(ptr, oldSize, newSize, alignment);
+        void* ret = std::realloc(ptr, newSize);
+        assert(ret && "Out of memory");
+        return ret;
+    }
+
+    void deallocate(void* ptr, size_t) { std::free(ptr); }
+
+    // malloc rounds requests up to its size classes, so a block is often
+    // somewhat larger than asked for.
+    size_t getUsableSize(void* ptr, size_t size) const {
+#ifdef DS_MALLOC_USABLE_SIZE
+        (void)size;
+        return DS_MALLOC_USABLE_SIZE(ptr);
+#else
+        (void)ptr;
+        return size;
+#endif
+    }
+};
+
+// An arena that hands out memory by bumping a pointer through large slabs
+// obtained from malloc. Individual deallocations are free (only the most recent
+// allocation is actually given back), and all memory is released at once when
+// the arena is reset or destroyed. This makes it a good fit for data whose
+// lifetime is tied to one unit of work, such as a request.
+//
+// The arena is not thread-safe and cannot be copied. Containers refer to it
+// through an ArenaAllocator.
+class BumpPtrAllocator {
+private:
+    // Slabs start at SlabSize bytes and double every few slabs, so the number
+    // of slabs grows logarithmically with the total allocated size.
+    // Allocations larger than a slab get a slab of their own.
+    static constexpr size_t SlabSize = 4096;
+    static constexpr size_t MaxSlabSize = size_t(1) << 20;
+
+    // Each slab starts with a pointer to the previous one.
+    struct Slab {
+        Slab* prev;
+    };
+
+    char* cur;
+    char* end;
+    Slab* slabs;
+    size_t numSlabs;
+    size_t bytesAllocated;
+
+    void* allocateSlow(size_t size, size_t alignment);
+
+public:
+    BumpPtrAllocator()
+        : cur(nullptr), end(nullptr), slabs(nullptr), numSlabs(0),
+          bytesAllocated(0) {}
+    BumpPtrAllocator(const BumpPtrAllocator&) = delete;
+    BumpPtrAllocator& operator=(const BumpPtrAllocator&) = delete;
+    ~BumpPtrAllocator() { reset(); }
+
+    void* allocate(size_t size, size_t alignment) {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0 &&
+               "Alignment is not a power of two!");
+        auto addr = reinterpret_cast<uintptr_t>(cur);
+        auto aligned = (addr + alignment - 1) & ~uintptr_t(alignment - 1);
+        if (cur != nullptr && aligned - addr + size <= size_t(end - cur)) {
+            char* ret = cur + (aligned - addr);
+            cur = ret + size;
+            bytesAllocated += size;
+            return ret;
+        }
+        return allocateSlow(size, alignment);
+    }
+
+    // Grows the most recent allocation in place when it is at the end of the
+    // current slab, and copies it to a new block otherwise.
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize,
+                     size_t alignment) {
+        auto p = static_cast<char*>(ptr);
+        if (p + oldSize == cur && newSize <= size_t(end - p)) {
+            cur = p + newSize;
+            bytesAllocated += newSize - oldSize;
+            return ptr;
+        }
+        void* ret = allocate(newSize, alignment);
+        std::memcpy(ret, ptr, oldSize < newSize ? oldSize : newSize);
+        return ret;
+    }
+
+    // Only the most recent allocation can be given back; anything else stays
+    // allocated until reset().
+    void deallocate(void* ptr, size_t size) {
+        auto p = static_cast<char*>(ptr);
+        if (p + size == cur) {
+            cur = p;
+            bytesAllocated -= size;
+        }
+    }
+
+    // Releases all memory. Everything allocated from the arena is invalidated.
+    void reset();
+
+    size_t getBytesAllocated() const { return bytesAllocated; }
+    size_t getNumSlabs() const { return numSlabs; }
+};
+
+// An allocation policy that forwards to a BumpPtrAllocator. The arena has to
+// outlive every container using it. Destroying a container that spilled into
+// the arena only runs the element destructors; the memory itself is reclaimed
+// together with the arena.
+class ArenaAllocator {
+private:
+    BumpPtrAllocator* arena;
+
+public:
+    ArenaAllocator(BumpPtrAllocator& arena) : arena(&arena) {}
+
+    void* allocate(size_t size, size_t alignment) {
+        return arena->allocate(size, alignment);
+    }
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize,
+                     size_t alignment) {
+        return arena->reallocate(ptr, oldSize, newSize, alignment);
+    }
+    void deallocate(void* ptr, size_t size) { arena->deallocate(ptr, size); }
+
+    BumpPtrAllocator& getArena() const { return *arena; }
+};
+
+// An allocation policy that forwards to AllocT, but has containers grow their
+// capacity by a factor of Num / Den instead of doubling it. A smaller factor
+// such as 3 / 2 wastes less memory in long-lived containers, at the cost of
+// reallocating more often:
+//
+//   SmallVector<Node*, 0, GrowthFactor<3, 2>> children;
+template <unsigned Num, unsigned Den, typename AllocT = MallocAllocator>
+class GrowthFactor : public AllocT {
+    static_assert(Den > 0 && Num > Den, "Containers have to grow");
+
+public:
+    static constexpr unsigned GrowthNumerator = Num;
+    static constexpr unsigned GrowthDenominator = Den;
+
+    using AllocT::AllocT;
+    GrowthFactor() = default;
+    GrowthFactor(const AllocT& alloc) : AllocT(alloc) {}
+};
+
+template <unsigned Num, unsigned Den, typename AllocT>
+constexpr unsigned GrowthFactor<Num, Den, AllocT>::GrowthNumerator;
+template <unsigned Num, unsigned Den, typename AllocT>
+constexpr unsigned GrowthFactor<Num, Den, AllocT>::GrowthDenominator;
+
+// An allocation policy that forwards to AllocT, but aligns every block to at
+// least Alignment bytes. Containers also align their inline storage to it, so
+// that e.g. the data of an
+//
+//   SmallVector<float, 16, AlignedAllocator<64>> values;
+//
+// is always suitable for aligned 512-bit loads.
+template <size_t Alignment, typename AllocT = MallocAllocator>
+class AlignedAllocator : public AllocT {
+    static_assert(Alignment != 0 && (Alignment & (Alignment - 1)) == 0,
+                  "Alignment is not a power of two!");
+
+    static size_t adjust(size_t alignment) {
+        return alignment < Alignment ? Alignment : alignment;
+    }
+
+public:
+    static constexpr size_t MinAlignment = Alignment;
+
+    using AllocT::AllocT;
+    AlignedAllocator() = default;
+    AlignedAllocator(const AllocT& alloc) : AllocT(alloc) {}
+
+    void* allocate(size_t size, size_t alignment) {
+        return AllocT::allocate(size, adjust(alignment));
+    }
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize,
+                     size_t alignment) {
+        return AllocT::reallocate(ptr, oldSize, newSize, adjust(alignment));
+    }
+};
+
+template <size_t Alignment, typename AllocT>
+constexpr size_t AlignedAllocator<Alignment, AllocT>::MinAlignment;
+
+namespace detail {
+
+template <typename AllocT>
+auto getUsableSizeImpl(const AllocT& alloc, void* ptr, size_t size, int)
+    -> decltype(alloc.getUsableSize(ptr, size)) {
+    return alloc.getUsableSize(ptr, size);
+}
+template <typename AllocT>
+size_t getUsableSizeImpl(const AllocT&, void*, size_t size, long) {
+    return size;
+}
+
+// Calls alloc.getUsableSize() if the policy has one, and returns size
+// otherwise.
+template <typename AllocT>
+size_t getUsableSize(const AllocT& alloc, void* ptr, size_t size) {
+    return getUsableSizeImpl(alloc, ptr, size, 0);
+}
+
+// The growth factor a policy asks for, 2 by default.
+template <typename AllocT, typename = void>
+struct GrowthFactorOf {
+    static constexpr unsigned Numerator = 2;
+    static constexpr unsigned Denominator = 1;
+};
+template <typename AllocT>
+struct GrowthFactorOf<AllocT, decltype(void(AllocT::GrowthNumerator),
+                                       void(AllocT::GrowthDenominator))> {
+    static constexpr unsigned Numerator = AllocT::GrowthNumerator;
+    static constexpr unsigned Denominator = AllocT::GrowthDenominator;
+};
+
+template <typename AllocT, typename V>
+constexpr unsigned GrowthFactorOf<AllocT, V>::Numerator;
+template <typename AllocT, typename V>
+constexpr unsigned GrowthFactorOf<AllocT, V>::Denominator;
+template <typename AllocT>
+constexpr unsigned GrowthFactorOf<
+    AllocT, decltype(void(AllocT::GrowthNumerator),
+                     void(AllocT::GrowthDenominator))>::Numerator;
+template <typename AllocT>
+constexpr unsigned GrowthFactorOf<
+    AllocT, decltype(void(AllocT::GrowthNumerator),
+                     void(AllocT::GrowthDenominator))>::Denominator;
+
+// The alignment a policy guarantees beyond what is asked for, 1 by default.
+template <typename AllocT, typename = void>
+struct MinAlignmentOf {
+    static constexpr size_t value = 1;
+};
+template <typename AllocT>
+struct MinAlignmentOf<AllocT, decltype(void(AllocT::MinAlignment))> {
+    static constexpr size_t value = AllocT::MinAlignment;
+};
+
+template <typename AllocT, typename V>
+constexpr size_t MinAlignmentOf<AllocT, V>::value;
+template <typename AllocT>
+constexpr size_t
+    MinAlignmentOf<AllocT, decltype(void(AllocT::MinAlignment))>::value;
+}
+}
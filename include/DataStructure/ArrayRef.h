@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <vector>
 
 namespace ds {
@@ -41,8 +42,8 @@ public:
     ArrayRef(const std::initializer_list<T>& vec)
         : array(vec.begin() == vec.end() ? nullptr : vec.begin()),
           length(vec.size()) {}
-    template <typename U>
-    ArrayRef(const SmallVectorTemplateCommon<T, U>& vec)
+    template <typename A, typename U>
+    ArrayRef(const SmallVectorTemplateCommon<T, A, U>& vec)
         : array(vec.data()), length(vec.size()) {}
 
     // Construct an ArrayRef<const T*> from ArrayRef<T*>. This uses SFInAE to
@@ -57,9 +58,9 @@ public:
     // Construct an ArrayRef<const T*> from a SmallVector<T*>. This is
     // templated in order to avoid instantiating SmallVectorTemplateCommon<T>
     // whenever we copy-construct an ArrayRef.
-    template <typename U, typename DummyT>
+    template <typename U, typename A, typename DummyT>
     ArrayRef(
-        const SmallVectorTemplateCommon<U*, DummyT>& vec,
+        const SmallVectorTemplateCommon<U*, A, DummyT>& vec,
         typename std::enable_if<
             std::is_convertible<U* const*, T const*>::value>::type* = nullptr)
         : array(vec.data()), length(vec.size()) {}
@@ -90,6 +91,24 @@ public:
         return array[length - 1];
     }
 
+    // Check whether the data is aligned to 'alignment' bytes.
+    bool isAligned(size_t alignment) const {
+        return reinterpret_cast<uintptr_t>(array) % alignment == 0;
+    }
+
+    // Return data(), asserting that it is aligned to Alignment bytes and
+    // telling the compiler so, which lets kernels use aligned loads on it.
+    template <size_t Alignment>
+    const T* alignedData() const {
+        assert(isAligned(Alignment) && "ArrayRef is not sufficiently aligned");
+#ifdef __GNUC__
+        return static_cast<const T*>(
+            __builtin_assume_aligned(array, Alignment));
+#else
+        return array;
+#endif
+    }
+
     bool equals(ArrayRef rhs) const {
         if (length != rhs.length)
             return false;
@@ -156,7 +175,8 @@ public:
     MutableArrayRef() : ArrayRef<T>() {}
     MutableArrayRef(T* data, size_type length) : ArrayRef<T>(data, length) {}
     MutableArrayRef(T* begin, T* end) : ArrayRef<T>(begin, end) {}
-    MutableArrayRef(SmallVectorImpl<T>& vec) : ArrayRef<T>(vec) {}
+    template <typename A>
+    MutableArrayRef(SmallVectorImpl<T, A>& vec) : ArrayRef<T>(vec) {}
     MutableArrayRef(std::vector<T>& vec) : ArrayRef<T>(vec) {}
     template <size_t N>
     constexpr MutableArrayRef(std::array<T, N>& arr) : ArrayRef<T>(arr) {}
@@ -165,6 +185,11 @@ public:
 
     T* data() const { return const_cast<T*>(ArrayRef<T>::data()); }
 
+    template <size_t Alignment>
+    T* alignedData() const {
+        return const_cast<T*>(ArrayRef<T>::template alignedData<Alignment>());
+    }
+
     iterator begin() const { return data(); }
     iterator end() const { return data() + this->size(); }
 
@@ -242,13 +267,13 @@ ArrayRef<T> make_array_ref(const T* begin, const T* end) {
     return ArrayRef<T>(begin, end);
 }
 
-template <typename T>
-ArrayRef<T> make_array_ref(const SmallVectorImpl<T>& vec) {
+template <typename T, typename A>
+ArrayRef<T> make_array_ref(const SmallVectorImpl<T, A>& vec) {
     return vec;
 }
 
-template <typename T, unsigned N>
-ArrayRef<T> make_array_ref(const SmallVector<T, N>& vec) {
+template <typename T, unsigned N, typename A>
+ArrayRef<T> make_array_ref(const SmallVector<T, N, A>& vec) {
     return vec;
 }
 
@@ -312,17 +337,33 @@ struct isPodLike<ArrayRef<T>> {
 }
 
 namespace std {
+// Arrays of integers, enums and pointers are hashed as one block of bytes
+// (see ds::detail::isContiguouslyHashable); other element types combine the
+// std::hash of every element.
 template <typename T>
 struct hash<ds::ArrayRef<T>> {
-    void hash_combine(std::size_t& seed, const T& v) const {
-        seed ^= std::hash<T>()(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+private:
+    static size_t hashImpl(const ds::ArrayRef<T>& a, std::true_type) {
+        return static_cast<size_t>(
+            ds::detail::hashBytes(a.data(), a.size() * sizeof(T)));
     }
 
-    size_t operator()(const ds::ArrayRef<T>& a) const {
+    static size_t hashImpl(const ds::ArrayRef<T>& a, std::false_type) {
         std::size_t seed = 0;
         for (auto const& elem : a)
             hash_combine(seed, elem);
         return seed;
     }
+
+public:
+    static void hash_combine(std::size_t& seed, const T& v) {
+        seed ^= std::hash<T>()(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    size_t operator()(const ds::ArrayRef<T>& a) const {
+        return hashImpl(
+            a, std::integral_constant<
+                   bool, ds::detail::isContiguouslyHashable<T>::value>());
+    }
 };
 }
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "DataStructure/Allocator.h"
+#include "DataStructure/Detail.h"
+#include "DataStructure/DynamicBitSet.h"
+
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <limits>
+#include <new>
+
+namespace ds {
+
+// A fixed-size bit set that many threads can update at once, e.g. the visited
+// set of a parallel graph traversal. Every block is a std::atomic<Block>, and
+// the single-bit operations are one atomic instruction on it.
+//
+// With PadToCacheLine, every block sits on a cache line of its own. That costs
+// a cache line per block, but threads that set nearby bits no longer fight over
+// the same line.
+//
+// The bulk operations (reset(), count(), merge_from() and the conversions to
+// and from DynamicBitSet) go block by block with relaxed atomics. They are
+// safe to run concurrently with the single-bit operations, but are not atomic
+// as a whole; they are meant for the phases between parallel sections, which
+// the joining of the threads orders anyway.
+template <typename Block = unsigned long, bool PadToCacheLine = false>
+class AtomicBitSet {
+    static_assert(std::is_unsigned<Block>::value,
+                  "Blocks have to be unsigned integers");
+
+public:
+    using block_type = Block;
+    using size_type = std::size_t;
+
+    static constexpr unsigned bits_per_block =
+        std::numeric_limits<Block>::digits;
+
+private:
+    struct alignas(PadToCacheLine ? detail::CacheLineSize
+                                  : alignof(std::atomic<Block>)) Slot {
+        std::atomic<Block> block;
+    };
+
+    Slot* slots;
+    size_type numBits;
+    size_type numBlocks;
+
+    static size_type blockIndex(size_type pos) { return pos / bits_per_block; }
+    static Block bitMask(size_type pos) {
+        return static_cast<Block>(Block(1) << (pos % bits_per_block));
+    }
+    static size_type calcNumBlocks(size_type numBits) {
+        return (numBits + bits_per_block - 1) / bits_per_block;
+    }
+
+    void allocate() {
+        slots = nullptr;
+        if (numBlocks == 0)
+            return;
+        slots = static_cast<Slot*>(MallocAllocator().allocate(
+            numBlocks * sizeof(Slot), alignof(Slot)));
+        for (size_type i = 0; i != numBlocks; ++i)
+            new (&slots[i]) Slot{{0}};
+    }
+    void deallocate() {
+        if (slots != nullptr)
+            MallocAllocator().deallocate(slots, numBlocks * sizeof(Slot));
+    }
+
+    // Adapters that let the block range functions of DynamicBitSet read and
+    // write the slots.
+    class LoadIterator {
+        const Slot* slot;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Block;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Block*;
+        using reference = Block;
+
+        explicit LoadIterator(const Slot* slot) : slot(slot) {}
+        Block operator*() const {
+            return slot->block.load(std::memory_order_relaxed);
+        }
+        LoadIterator& operator++() {
+            ++slot;
+            return *this;
+        }
+        LoadIterator operator++(int) {
+            auto ret = *this;
+            ++slot;
+            return ret;
+        }
+        bool operator==(const LoadIterator& rhs) const {
+            return slot == rhs.slot;
+        }
+        bool operator!=(const LoadIterator& rhs) const {
+            return slot != rhs.slot;
+        }
+    };
+
+    class StoreIterator {
+        Slot* slot;
+
+    public:
+        using iterator_category = std::output_iterator_tag;
+        using value_type = void;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = void;
+
+        explicit StoreIterator(Slot* slot) : slot(slot) {}
+        StoreIterator& operator*() { return *this; }
+        StoreIterator& operator=(Block value) {
+            slot->block.store(value, std::memory_order_relaxed);
+            return *this;
+        }
+        StoreIterator& operator++() {
+            ++slot;
+            return *this;
+        }
+        StoreIterator operator++(int) {
+            auto ret = *this;
+            ++slot;
+            return ret;
+        }
+    };
+
+    // Fetch-ors every block it is assigned into the slots, and records whether
+    // that set any new bits.
+    class MergeIterator {
+        Slot* slot;
+        std::memory_order order;
+        bool* changed;
+
+    public:
+        using iterator_category = std::output_iterator_tag;
+        using value_type = void;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = void;
+
+        MergeIterator(Slot* slot, std::memory_order order, bool& changed)
+            : slot(slot), order(order), changed(&changed) {}
+        MergeIterator& operator*() { return *this; }
+        MergeIterator& operator=(Block value) {
+            if (value != 0) {
+                Block old = slot->block.fetch_or(value, order);
+                *changed |= (value & ~old) != 0;
+            }
+            return *this;
+        }
+        MergeIterator& operator++() {
+            ++slot;
+            return *this;
+        }
+        MergeIterator operator++(int) {
+            auto ret = *this;
+            ++slot;
+            return ret;
+        }
+    };
+
+public:
+    explicit AtomicBitSet(size_type numBits = 0)
+        : numBits(numBits), numBlocks(calcNumBlocks(numBits)) {
+        allocate();
+    }
+
+    // Copies a DynamicBitSet, e.g. the result of a sequential phase.
+    template <typename Allocator>
+    explicit AtomicBitSet(const DynamicBitSet<Block, Allocator>& bits)
+        : AtomicBitSet(bits.size()) {
+        to_block_range(bits, StoreIterator(slots));
+    }
+
+    AtomicBitSet(const AtomicBitSet&) = delete;
+    AtomicBitSet& operator=(const AtomicBitSet&) = delete;
+    AtomicBitSet(AtomicBitSet&& rhs) noexcept
+        : slots(rhs.slots), numBits(rhs.numBits), numBlocks(rhs.numBlocks) {
+        rhs.slots = nullptr;
+        rhs.numBits = rhs.numBlocks = 0;
+    }
+    AtomicBitSet& operator=(AtomicBitSet&& rhs) noexcept {
+        if (this != &rhs) {
+            deallocate();
+            slots = rhs.slots;
+            numBits = rhs.numBits;
+            numBlocks = rhs.numBlocks;
+            rhs.slots = nullptr;
+            rhs.numBits = rhs.numBlocks = 0;
+        }
+        return *this;
+    }
+    ~AtomicBitSet() { deallocate(); }
+
+    size_type size() const { return numBits; }
+    size_type num_blocks() const { return numBlocks; }
+    bool empty() const { return numBits == 0; }
+
+    bool test(size_type pos,
+              std::memory_order order = std::memory_order_seq_cst) const {
+        assert(pos < numBits);
+        return (slots[blockIndex(pos)].block.load(order) & bitMask(pos)) != 0;
+    }
+
+    void set(size_type pos,
+             std::memory_order order = std::memory_order_seq_cst) {
+        assert(pos < numBits);
+        slots[blockIndex(pos)].block.fetch_or(bitMask(pos), order);
+    }
+    void reset(size_type pos,
+               std::memory_order order = std::memory_order_seq_cst) {
+        assert(pos < numBits);
+        auto mask = static_cast<Block>(~bitMask(pos));
+        slots[blockIndex(pos)].block.fetch_and(mask, order);
+    }
+
+    // Sets pos and returns true if this call changed it, i.e. exactly one of
+    // the threads racing to set a bit gets true. A bit that is already set is
+    // seen with a plain load, which keeps the cache line shared instead of
+    // taking it exclusive for a read-modify-write that would change nothing.
+    bool test_and_set(size_type pos,
+                      std::memory_order order = std::memory_order_seq_cst) {
+        assert(pos < numBits);
+        auto& block = slots[blockIndex(pos)].block;
+        auto mask = bitMask(pos);
+        if (block.load(std::memory_order_relaxed) & mask)
+            return false;
+        return (block.fetch_or(mask, order) & mask) == 0;
+    }
+
+    // Clears all bits.
+    void reset() {
+        for (size_type i = 0; i != numBlocks; ++i)
+            slots[i].block.store(0, std::memory_order_relaxed);
+    }
+
+    size_type count() const {
+        size_type ret = 0;
+        for (size_type i = 0; i != numBlocks; ++i)
+            ret += static_cast<size_type>(detail::popcount(
+                slots[i].block.load(std::memory_order_relaxed)));
+        return ret;
+    }
+    bool any() const {
+        for (size_type i = 0; i != numBlocks; ++i)
+            if (slots[i].block.load(std::memory_order_relaxed) != 0)
+                return true;
+        return false;
+    }
+    bool none() const { return !any(); }
+
+    // Sets the bits that are set in rhs, which has to be of the same size, with
+    // one fetch-or per non-zero block. Several threads can merge their local
+    // results at once. Returns whether any bit changed.
+    template <typename Allocator>
+    bool merge_from(const DynamicBitSet<Block, Allocator>& rhs,
+                    std::memory_order order = std::memory_order_relaxed) {
+        assert(rhs.size() == numBits && "Size mismatch");
+        bool changed = false;
+        to_block_range(rhs, MergeIterator(slots, order, changed));
+        return changed;
+    }
+
+    // Copies the bits into a DynamicBitSet, for the sequential phases.
+    template <typename Allocator = std::allocator<Block>>
+    DynamicBitSet<Block, Allocator> to_dynamic_bitset() const {
+        DynamicBitSet<Block, Allocator> ret(numBits);
+        from_block_range(LoadIterator(slots), LoadIterator(slots + numBlocks),
+                         ret);
+        return ret;
+    }
+
+    // Calls fn(pos) for the position of every set bit, in increasing order.
+    template <typename Fn>
+    void for_each_set_bit(Fn fn) const {
+        for (size_type i = 0; i != numBlocks; ++i) {
+            Block block = slots[i].block.load(std::memory_order_relaxed);
+            while (block != 0) {
+                fn(i * bits_per_block +
+                   static_cast<size_type>(detail::findFirstSet(block)));
+                block = static_cast<Block>(block & (block - 1));
+            }
+        }
+    }
+};
+
+template <typename Block, bool PadToCacheLine>
+constexpr unsigned AtomicBitSet<Block, PadToCacheLine>::bits_per_block;
+}
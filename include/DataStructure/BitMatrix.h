@@ -0,0 +1,405 @@
+#pragma once
+
+#include "DataStructure/Allocator.h"
+#include "DataStructure/Detail.h"
+#include "DataStructure/DynamicBitSet.h"
+#include "DataStructure/Parallel.h"
+
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace ds {
+
+// A view of one row of a BitMatrix with the interface of DynamicBitSet. Word
+// is the block type for a mutable row and the const block type for a
+// read-only one, which a mutable row converts to. Like the rows of the matrix,
+// rows keep their unused high bits cleared, so the bulk operations can use the
+// DynamicBitSet kernels.
+template <typename Word>
+class BitMatrixRow {
+public:
+    using block_type = typename std::remove_const<Word>::type;
+    using size_type = std::size_t;
+    using const_row = BitMatrixRow<const block_type>;
+
+    static constexpr unsigned bits_per_block =
+        std::numeric_limits<block_type>::digits;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+private:
+    Word* words;
+    size_type numBits;
+
+    static size_type blockIndex(size_type pos) { return pos / bits_per_block; }
+    static block_type bitMask(size_type pos) {
+        return block_type(1) << (pos % bits_per_block);
+    }
+
+    size_type numBytes() const { return num_blocks() * sizeof(block_type); }
+    bool useKernels() const { return numBytes() >= detail::BitKernelMinBytes; }
+
+    template <typename Fn>
+    BitMatrixRow& applyBlocks(const_row rhs, detail::BitOp op, Fn fn) {
+        assert(size() == rhs.size());
+        if (useKernels()) {
+            detail::bitsApply(op, words, rhs.data(), numBytes());
+        } else {
+            for (size_type i = 0; i < num_blocks(); ++i)
+                words[i] = fn(words[i], rhs.data()[i]);
+        }
+        return *this;
+    }
+
+    size_type findFrom(size_type firstBlock) const {
+        for (auto i = firstBlock; i < num_blocks(); ++i)
+            if (words[i] != 0)
+                return i * bits_per_block +
+                       static_cast<size_type>(detail::findFirstSet(words[i]));
+        return npos;
+    }
+
+public:
+    BitMatrixRow(Word* words, size_type numBits)
+        : words(words), numBits(numBits) {}
+    operator const_row() const { return const_row(words, numBits); }
+
+    size_type size() const { return numBits; }
+    size_type num_blocks() const {
+        return (numBits + bits_per_block - 1) / bits_per_block;
+    }
+    bool empty() const { return numBits == 0; }
+    Word* data() const { return words; }
+
+    bool test(size_type pos) const {
+        assert(pos < numBits);
+        return (words[blockIndex(pos)] & bitMask(pos)) != 0;
+    }
+    bool operator[](size_type pos) const { return test(pos); }
+
+    size_type count() const {
+        if (useKernels())
+            return detail::bitsCount(words, numBytes());
+        size_type ret = 0;
+        for (size_type i = 0; i < num_blocks(); ++i)
+            ret += static_cast<size_type>(detail::popcount(words[i]));
+        return ret;
+    }
+    bool any() const {
+        if (useKernels())
+            return detail::bitsAny(words, numBytes());
+        for (size_type i = 0; i < num_blocks(); ++i)
+            if (words[i] != 0)
+                return true;
+        return false;
+    }
+    bool none() const { return !any(); }
+    bool all() const { return count() == numBits; }
+
+    size_type find_first() const { return findFrom(0); }
+    size_type find_next(size_type pos) const {
+        ++pos;
+        if (pos >= numBits)
+            return npos;
+        auto i = blockIndex(pos);
+        block_type rest = words[i] & ~(bitMask(pos) - 1);
+        if (rest != 0)
+            return i * bits_per_block +
+                   static_cast<size_type>(detail::findFirstSet(rest));
+        return findFrom(i + 1);
+    }
+    template <typename Fn>
+    void for_each_set_bit(Fn fn) const {
+        for (size_type i = 0; i < num_blocks(); ++i) {
+            for (auto block = words[i]; block != 0; block &= block - 1)
+                fn(i * bits_per_block +
+                   static_cast<size_type>(detail::findFirstSet(block)));
+        }
+    }
+
+    bool intersects(const_row rhs) const {
+        assert(size() == rhs.size());
+        if (useKernels())
+            return detail::bitsIntersect(words, rhs.data(), numBytes());
+        for (size_type i = 0; i < num_blocks(); ++i)
+            if ((words[i] & rhs.data()[i]) != 0)
+                return true;
+        return false;
+    }
+    bool is_subset_of(const_row rhs) const {
+        assert(size() == rhs.size());
+        if (useKernels())
+            return detail::bitsSubset(words, rhs.data(), numBytes());
+        for (size_type i = 0; i < num_blocks(); ++i)
+            if ((words[i] & ~rhs.data()[i]) != 0)
+                return false;
+        return true;
+    }
+    bool operator==(const_row rhs) const {
+        return numBits == rhs.size() &&
+               std::equal(words, words + num_blocks(), rhs.data());
+    }
+    bool operator!=(const_row rhs) const { return !(*this == rhs); }
+
+    // The mutators below only compile for mutable rows.
+
+    BitMatrixRow& set(size_type pos, bool val = true) {
+        assert(pos < numBits);
+        if (val)
+            words[blockIndex(pos)] |= bitMask(pos);
+        else
+            reset(pos);
+        return *this;
+    }
+    BitMatrixRow& reset(size_type pos) {
+        assert(pos < numBits);
+        words[blockIndex(pos)] &= ~bitMask(pos);
+        return *this;
+    }
+    BitMatrixRow& flip(size_type pos) {
+        assert(pos < numBits);
+        words[blockIndex(pos)] ^= bitMask(pos);
+        return *this;
+    }
+    BitMatrixRow& set() {
+        std::fill(words, words + num_blocks(), ~block_type(0));
+        if (numBits % bits_per_block != 0)
+            words[num_blocks() - 1] &= bitMask(numBits) - 1;
+        return *this;
+    }
+    BitMatrixRow& reset() {
+        std::fill(words, words + num_blocks(), block_type(0));
+        return *this;
+    }
+
+    BitMatrixRow& operator&=(const_row rhs) {
+        return applyBlocks(rhs, detail::BitOp::And,
+                           [](block_type a, block_type b) { return a & b; });
+    }
+    BitMatrixRow& operator|=(const_row rhs) {
+        return applyBlocks(rhs, detail::BitOp::Or,
+                           [](block_type a, block_type b) { return a | b; });
+    }
+    BitMatrixRow& operator^=(const_row rhs) {
+        return applyBlocks(rhs, detail::BitOp::Xor,
+                           [](block_type a, block_type b) { return a ^ b; });
+    }
+    BitMatrixRow& operator-=(const_row rhs) {
+        return applyBlocks(rhs, detail::BitOp::AndNot,
+                           [](block_type a, block_type b) { return a & ~b; });
+    }
+    // Unites rhs into the row and returns whether that set any new bit.
+    bool or_with_changed(const_row rhs) {
+        assert(size() == rhs.size());
+        if (useKernels())
+            return detail::bitsApplyChanged(detail::BitOp::Or, words,
+                                            rhs.data(), numBytes());
+        block_type diff = 0;
+        for (size_type i = 0; i < num_blocks(); ++i) {
+            diff |= rhs.data()[i] & ~words[i];
+            words[i] |= rhs.data()[i];
+        }
+        return diff != 0;
+    }
+
+    // Copies the bits of another row or of a bit set of the same size.
+    BitMatrixRow& assign(const_row rhs) {
+        assert(size() == rhs.size());
+        std::copy(rhs.data(), rhs.data() + num_blocks(), words);
+        return *this;
+    }
+    template <typename Allocator>
+    BitMatrixRow& assign(const DynamicBitSet<block_type, Allocator>& bits) {
+        assert(size() == bits.size());
+        to_block_range(bits, words);
+        return *this;
+    }
+    template <typename Allocator = std::allocator<block_type>>
+    DynamicBitSet<block_type, Allocator> to_dynamic_bitset() const {
+        DynamicBitSet<block_type, Allocator> ret(numBits);
+        from_block_range(words, words + num_blocks(), ret);
+        return ret;
+    }
+};
+
+template <typename Word>
+constexpr unsigned BitMatrixRow<Word>::bits_per_block;
+template <typename Word>
+constexpr typename BitMatrixRow<Word>::size_type BitMatrixRow<Word>::npos;
+
+// A dense matrix of bits, e.g. the adjacency or reachability relation of a
+// graph. The rows lie one after another in a single buffer, each padded to
+// whole cache lines and starting on one, so that row-wise operations run over
+// contiguous, aligned memory with the DynamicBitSet kernels.
+//
+// multiply() and transitive_closure() split their work over a ThreadPool. They
+// treat the words of the rows they process as the elements that
+// ParallelOptions::serialCutoff is compared with.
+class BitMatrix {
+public:
+    using block_type = unsigned long;
+    using size_type = std::size_t;
+    using row_reference = BitMatrixRow<block_type>;
+    using const_row_reference = BitMatrixRow<const block_type>;
+
+    static_assert(std::numeric_limits<block_type>::digits == 64,
+                  "BitMatrix assumes 64-bit blocks");
+
+private:
+    block_type* blocks;
+    size_type numRows;
+    size_type numCols;
+    size_type rowStride;
+
+    static size_type calcRowStride(size_type numCols) {
+        const size_type perLine = detail::CacheLineSize / sizeof(block_type);
+        size_type words = (numCols + 63) / 64;
+        return (words + perLine - 1) / perLine * perLine;
+    }
+
+    void allocate() {
+        blocks = nullptr;
+        size_type numBlocks = numRows * rowStride;
+        if (numBlocks == 0)
+            return;
+        blocks = static_cast<block_type*>(MallocAllocator().allocate(
+            numBlocks * sizeof(block_type), detail::CacheLineSize));
+        std::memset(blocks, 0, numBlocks * sizeof(block_type));
+    }
+    void deallocate() {
+        if (blocks != nullptr)
+            MallocAllocator().deallocate(blocks, numRows * rowStride *
+                                                     sizeof(block_type));
+    }
+
+    block_type* rowData(size_type r) { return blocks + r * rowStride; }
+    const block_type* rowData(size_type r) const {
+        return blocks + r * rowStride;
+    }
+
+public:
+    BitMatrix() : blocks(nullptr), numRows(0), numCols(0), rowStride(0) {}
+    BitMatrix(size_type numRows, size_type numCols)
+        : numRows(numRows), numCols(numCols),
+          rowStride(calcRowStride(numCols)) {
+        allocate();
+    }
+    BitMatrix(const BitMatrix& rhs)
+        : numRows(rhs.numRows), numCols(rhs.numCols),
+          rowStride(rhs.rowStride) {
+        allocate();
+        if (blocks != nullptr)
+            std::memcpy(blocks, rhs.blocks,
+                        numRows * rowStride * sizeof(block_type));
+    }
+    BitMatrix(BitMatrix&& rhs) noexcept
+        : blocks(rhs.blocks), numRows(rhs.numRows), numCols(rhs.numCols),
+          rowStride(rhs.rowStride) {
+        rhs.blocks = nullptr;
+        rhs.numRows = rhs.numCols = rhs.rowStride = 0;
+    }
+    BitMatrix& operator=(const BitMatrix& rhs) {
+        if (this != &rhs) {
+            BitMatrix copy(rhs);
+            swap(copy);
+        }
+        return *this;
+    }
+    BitMatrix& operator=(BitMatrix&& rhs) noexcept {
+        if (this != &rhs) {
+            deallocate();
+            blocks = rhs.blocks;
+            numRows = rhs.numRows;
+            numCols = rhs.numCols;
+            rowStride = rhs.rowStride;
+            rhs.blocks = nullptr;
+            rhs.numRows = rhs.numCols = rhs.rowStride = 0;
+        }
+        return *this;
+    }
+    ~BitMatrix() { deallocate(); }
+
+    void swap(BitMatrix& rhs) noexcept {
+        std::swap(blocks, rhs.blocks);
+        std::swap(numRows, rhs.numRows);
+        std::swap(numCols, rhs.numCols);
+        std::swap(rowStride, rhs.rowStride);
+    }
+
+    size_type rows() const { return numRows; }
+    size_type cols() const { return numCols; }
+    bool empty() const { return numRows == 0 || numCols == 0; }
+
+    row_reference row(size_type r) {
+        assert(r < numRows);
+        return row_reference(rowData(r), numCols);
+    }
+    const_row_reference row(size_type r) const {
+        assert(r < numRows);
+        return const_row_reference(rowData(r), numCols);
+    }
+    row_reference operator[](size_type r) { return row(r); }
+    const_row_reference operator[](size_type r) const { return row(r); }
+
+    bool test(size_type r, size_type c) const { return row(r).test(c); }
+    BitMatrix& set(size_type r, size_type c, bool val = true) {
+        row(r).set(c, val);
+        return *this;
+    }
+    BitMatrix& reset(size_type r, size_type c) {
+        row(r).reset(c);
+        return *this;
+    }
+    // Clears all bits.
+    BitMatrix& reset() {
+        if (blocks != nullptr)
+            std::memset(blocks, 0, numRows * rowStride * sizeof(block_type));
+        return *this;
+    }
+
+    size_type count() const {
+        return blocks == nullptr
+                   ? 0
+                   : detail::bitsCount(blocks, numRows * rowStride *
+                                                   sizeof(block_type));
+    }
+
+    bool operator==(const BitMatrix& rhs) const {
+        if (numRows != rhs.numRows || numCols != rhs.numCols)
+            return false;
+        return blocks == nullptr ||
+               std::memcmp(blocks, rhs.blocks,
+                           numRows * rowStride * sizeof(block_type)) == 0;
+    }
+    bool operator!=(const BitMatrix& rhs) const { return !(*this == rhs); }
+
+    size_type getMemorySize() const {
+        return numRows * rowStride * sizeof(block_type);
+    }
+
+    // Replaces the adjacency relation of a graph, which has to be square, by
+    // its transitive closure: afterwards bit (u, v) is set if there is a path
+    // of at least one edge from u to v.
+    //
+    // Warshall's algorithm takes n^3 / 64 word operations however it is
+    // blocked. Instead, this condenses the strongly connected components,
+    // whose nodes all reach the same set, and computes the set of every
+    // component from those of its successors in topological order, as in
+    // Nuutila's algorithm. The components on one level of the condensation
+    // run in parallel. A successor that an earlier one already reaches is
+    // skipped, so most components take a handful of row unions.
+    void transitive_closure(const ParallelOptions& opts = ParallelOptions());
+
+    // The boolean product: bit (i, j) of the result is set if some k has both
+    // (i, k) set in a and (k, j) set in b. Every row of the result is the
+    // union of the rows of b selected by the row of a. The rows of b are read
+    // in tiles of 64 rows and 32K columns, which stay in cache
+    // while a block of 64 rows of a uses them.
+    friend BitMatrix multiply(const BitMatrix& a, const BitMatrix& b,
+                              const ParallelOptions& opts);
+};
+
+BitMatrix multiply(const BitMatrix& a, const BitMatrix& b,
+                   const ParallelOptions& opts = ParallelOptions());
+}
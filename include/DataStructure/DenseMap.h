@@ -75,6 +75,9 @@ private:
     void moveFromOldBuckets(BucketT* oldBegin, BucketT* oldEnd) {
         initEmpty();
 
+        constexpr bool isRelocatable =
+            detail::isTriviallyRelocatable<KeyT>::value &&
+            detail::isTriviallyRelocatable<ValueT>::value;
         auto emptyKey = KeyInfoT::getEmptyKey(),
              tombKey = KeyInfoT::getTombstoneKey();
         for (auto b = oldBegin, e = oldEnd; b != e; ++b) {
@@ -84,10 +87,20 @@ private:
                 bool found = lookupBucketFor(b->getFirst(), dstBucket);
                 (void)found; // silence warning
                 assert(!found && "Key already in new map?");
+                ++numEntries;
+                if (isRelocatable) {
+                    // Take over the bytes of the old bucket. It must not be
+                    // destroyed afterwards.
+                    dstBucket->getFirst().~KeyT();
+                    std::memcpy(static_cast<void*>(&dstBucket->getFirst()),
+                                &b->getFirst(), sizeof(KeyT));
+                    std::memcpy(static_cast<void*>(&dstBucket->getSecond()),
+                                &b->getSecond(), sizeof(ValueT));
+                    continue;
+                }
                 dstBucket->getFirst() = std::move(b->getFirst());
                 ::new (&dstBucket->getSecond())
                     ValueT(std::move(b->getSecond()));
-                ++numEntries;
 
                 b->getSecond().~ValueT();
             }
@@ -2,7 +2,9 @@
 
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <limits>
+#include <memory>
 #include <type_traits>
 #include <utility>
 
@@ -12,9 +14,46 @@
 // that all functions are put into a "detail" namespace. Include it at your own
 // risk.
 
+// DS_X86_DISPATCH is defined when the compiler can build per-function SIMD
+// variants with __attribute__((target)). Those variants are only ever called
+// after checking hostSIMDLevel(), so the library itself does not need to be
+// compiled with -mavx2 or similar flags.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define DS_X86_DISPATCH 1
+#define DS_TARGET(isa) __attribute__((target(isa)))
+#endif
+
 namespace ds {
 namespace detail {
 
+// The size of a cache line on the targets we care about. Data written by
+// different threads is kept this far apart to avoid false sharing.
+constexpr size_t CacheLineSize = 64;
+
+// AVX512 stands for the F and BW subsets, which every AVX-512 CPU has.
+enum class SIMDLevel { Scalar, SSE42, AVX2, AVX512 };
+
+// Returns the widest instruction set the running CPU supports. The result is
+// computed once and cached.
+inline SIMDLevel hostSIMDLevel() {
+#ifdef DS_X86_DISPATCH
+    static const SIMDLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") &&
+            __builtin_cpu_supports("avx512bw"))
+            return SIMDLevel::AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return SIMDLevel::AVX2;
+        if (__builtin_cpu_supports("sse4.2"))
+            return SIMDLevel::SSE42;
+        return SIMDLevel::Scalar;
+    }();
+    return level;
+#else
+    return SIMDLevel::Scalar;
+#endif
+}
+
 inline constexpr uint64_t nextPowerOfTwo(uint64_t a) {
     a |= (a >> 1);
     a |= (a >> 2);
@@ -81,6 +120,137 @@ int lowestBit(T x) {
     return integerLog2<T>(x - (x & (x - 1)));
 }
 
+// The index of the lowest and of the highest set bit of x, which must not be
+// zero. With GCC and Clang these are single tzcnt/bsf and lzcnt/bsr
+// instructions.
+inline unsigned findFirstSet(uint64_t x) {
+    assert(x != 0);
+#ifdef __GNUC__
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+    return static_cast<unsigned>(lowestBit(x));
+#endif
+}
+
+inline unsigned findLastSet(uint64_t x) {
+    assert(x != 0);
+#ifdef __GNUC__
+    return 63 - static_cast<unsigned>(__builtin_clzll(x));
+#else
+    return static_cast<unsigned>(integerLog2(x));
+#endif
+}
+
+// The number of set bits in x. With GCC and Clang this is a popcnt
+// instruction where the target has one.
+inline unsigned popcount(uint64_t x) {
+#ifdef __GNUC__
+    return static_cast<unsigned>(__builtin_popcountll(x));
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<unsigned>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Building blocks of hashBytes() below.
+namespace hashing {
+
+constexpr uint64_t Secret0 = 0xa0761d6478bd642fULL;
+constexpr uint64_t Secret1 = 0xe7037ed1a0b428dbULL;
+constexpr uint64_t Secret2 = 0x8ebc6af09c88c6e3ULL;
+constexpr uint64_t Secret3 = 0x589965cc75374cc3ULL;
+
+// Replaces a and b with the low and high halves of their 128-bit product.
+inline void multiply(uint64_t& a, uint64_t& b) {
+#ifdef __SIZEOF_INT128__
+    auto product = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<uint64_t>(product);
+    b = static_cast<uint64_t>(product >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = uint32_t(a), lb = uint32_t(b);
+    uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+    uint64_t mid = (ll >> 32) + uint32_t(hl) + uint32_t(lh);
+    a = (mid << 32) | uint32_t(ll);
+    b = hh + (hl >> 32) + (lh >> 32) + (mid >> 32);
+#endif
+}
+
+// Folds the 128-bit product of a and b into 64 bits.
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    multiply(a, b);
+    return a ^ b;
+}
+
+inline uint64_t read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Reads 1 to 3 bytes.
+inline uint64_t readSmall(const unsigned char* p, size_t len) {
+    return (uint64_t(p[0]) << 16) | (uint64_t(p[len >> 1]) << 8) | p[len - 1];
+}
+}
+
+// A fast byte hash for keys stored contiguously in memory, such as strings.
+// It reads eight bytes at a time, folds them with 64x64->128-bit
+// multiplications (following wyhash), and has no per-byte loop: inputs of up to
+// 16 bytes are covered by two possibly overlapping loads. All bits of the
+// result, including the low ones that hash tables mask off, depend on every
+// input byte.
+inline uint64_t hashBytes(const void* data, size_t len, uint64_t seed = 0) {
+    using namespace hashing;
+    auto p = static_cast<const unsigned char*>(data);
+    seed ^= mix(seed ^ Secret0, Secret1);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t skip = (len >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + skip);
+            b = (read32(p + len - 4) << 32) | read32(p + len - 4 - skip);
+        } else if (len > 0) {
+            a = readSmall(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            // Three independent lanes keep the multipliers busy.
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = mix(read64(p) ^ Secret1, read64(p + 8) ^ seed);
+                seed1 = mix(read64(p + 16) ^ Secret2, read64(p + 24) ^ seed1);
+                seed2 = mix(read64(p + 32) ^ Secret3, read64(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = mix(read64(p) ^ Secret1, read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    a ^= Secret1;
+    b ^= seed;
+    multiply(a, b);
+    return mix(a ^ Secret0 ^ len, b ^ Secret1);
+}
+
 template <typename T>
 struct isPodLike {
     static constexpr bool value = std::is_trivially_copyable<T>::value;
@@ -90,5 +260,52 @@ template <typename T, typename U>
 struct isPodLike<std::pair<T, U>> {
     static constexpr bool value = isPodLike<T>::value && isPodLike<U>::value;
 };
+
+// isContiguouslyHashable<T> holds if two T's are equal exactly when their
+// bytes are, so that arrays of T can be hashed with hashBytes() in one pass.
+// Integers, enums and pointers qualify. Floating-point types do not (0.0 and
+// -0.0 compare equal), and neither do classes in general, which may contain
+// padding or define their own equality.
+template <typename T>
+struct isContiguouslyHashable {
+    static constexpr bool value = std::is_integral<T>::value ||
+                                  std::is_enum<T>::value ||
+                                  std::is_pointer<T>::value;
+};
+
+// isTriviallyRelocatable<T> holds if moving a T to a new address and then
+// destroying the original is equivalent to copying its bytes with memcpy and
+// forgetting the original. Containers use it to relocate elements in bulk with
+// memcpy or realloc instead of one move constructor and destructor call each.
+//
+// Every POD-like type qualifies. Other types have to opt in by specializing
+// this template, which is only correct if the type never stores a pointer into
+// itself and is not registered by address anywhere. In particular std::string
+// does not qualify: libstdc++ points short strings at an inline buffer.
+template <typename T>
+struct isTriviallyRelocatable {
+    static constexpr bool value = isPodLike<T>::value;
+};
+
+template <typename T, typename D>
+struct isTriviallyRelocatable<std::unique_ptr<T, D>> {
+    static constexpr bool value = isTriviallyRelocatable<D>::value;
+};
+
+template <typename T>
+struct isTriviallyRelocatable<std::shared_ptr<T>> {
+    static constexpr bool value = true;
+};
+
+template <typename T>
+struct isTriviallyRelocatable<std::weak_ptr<T>> {
+    static constexpr bool value = true;
+};
+
+template <typename T, typename U>
+struct isTriviallyRelocatable<std::pair<T, U>> {
+    static constexpr bool value = isTriviallyRelocatable<T>::value &&
+                                  isTriviallyRelocatable<U>::value;
+};
 }
 }
\ No newline at end of file
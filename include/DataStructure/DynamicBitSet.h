@@ -3,17 +3,52 @@
 #include "DataStructure/Detail.h"
 
 #include <algorithm>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <vector>
 
 namespace ds {
 
+namespace detail {
+
+// Kernels for the bulk operations of DynamicBitSet, defined in
+// lib/DynamicBitSet.cpp. They work on the raw bytes of the block buffers, so
+// that every block type shares them, and use the widest SIMD instructions the
+// host supports. Bit sets keep their unused high bits cleared, which lets the
+// kernels treat the whole buffer alike.
+enum class BitOp { And, Or, Xor, AndNot };
+
+// Sets dst[i] = dst[i] op src[i] for every byte.
+void bitsApply(BitOp op, void* dst, const void* src, size_t numBytes);
+// The same, returning whether any byte of dst changed.
+bool bitsApplyChanged(BitOp op, void* dst, const void* src, size_t numBytes);
+// Sets dst[i] = gen[i] | (in[i] & ~kill[i]) for every byte, returning whether
+// any byte of dst changed. in may be dst.
+bool bitsOrAndNot(void* dst, const void* gen, const void* in, const void* kill,
+                  size_t numBytes);
+size_t bitsCount(const void* data, size_t numBytes);
+bool bitsAny(const void* data, size_t numBytes);
+bool bitsAllOnes(const void* data, size_t numBytes);
+// Whether lhs & rhs is non-zero, and whether lhs & ~rhs is zero.
+bool bitsIntersect(const void* lhs, const void* rhs, size_t numBytes);
+bool bitsSubset(const void* lhs, const void* rhs, size_t numBytes);
+
+// Buffers smaller than this are processed inline, where a call into the
+// kernels would cost more than it saves.
+constexpr size_t BitKernelMinBytes = 64;
+}
+
+class RankSelectIndex;
+
 // This is basically a stripped-down version of boost::dynamic_bitset
 
 template <typename Block = unsigned long,
           typename Allocator = std::allocator<Block>>
 class DynamicBitSet {
+    static_assert(std::numeric_limits<Block>::digits <= 64,
+                  "Blocks wider than 64 bits are not supported");
+
 private:
     using BufferType = std::vector<Block, Allocator>;
 
@@ -57,14 +92,51 @@ private:
         // if != 0 this is the number of bits used in the last block
         auto extraBits = countExtraBits();
 
+        // The mask is built in an unsigned type at least as wide as int: a
+        // narrower Block would be promoted to int, making ~Block(0) -1.
+        using Wide = decltype(Block(0) + 0u);
         if (extraBits != 0)
-            bits.back() &= ~(~static_cast<Block>(0) << extraBits);
+            bits.back() &= static_cast<Block>(~(~Wide(0) << extraBits));
     }
 
     static size_type shiftRight(size_type v, int amount, int width) noexcept {
         return amount >= width ? 0 : (v >>= amount);
     }
 
+    size_type numBytes() const { return bits.size() * sizeof(Block); }
+    bool useKernels() const { return numBytes() >= detail::BitKernelMinBytes; }
+
+    template <typename Fn>
+    DynamicBitSet<Block, Allocator>&
+    applyBlocks(const DynamicBitSet<Block, Allocator>& rhs, detail::BitOp op,
+                Fn fn) {
+        assert(size() == rhs.size());
+        if (useKernels()) {
+            detail::bitsApply(op, bits.data(), rhs.bits.data(), numBytes());
+        } else {
+            for (size_type i = 0; i < num_blocks(); ++i)
+                bits[i] = fn(bits[i], rhs.bits[i]);
+        }
+        return *this;
+    }
+
+    template <typename Fn>
+    bool applyBlocksChanged(const DynamicBitSet<Block, Allocator>& rhs,
+                            detail::BitOp op, Fn fn) {
+        assert(size() == rhs.size());
+        if (useKernels())
+            return detail::bitsApplyChanged(op, bits.data(), rhs.bits.data(),
+                                            numBytes());
+        Block diff = 0;
+        for (size_type i = 0; i < num_blocks(); ++i) {
+            Block r = fn(bits[i], rhs.bits[i]);
+            diff |= r ^ bits[i];
+            bits[i] = r;
+        }
+        return diff != 0;
+    }
+
+    // The first set bit in the blocks from firstBlock on.
     size_type findFrom(size_type firstBlock) const {
         auto i = firstBlock;
         while (i < num_blocks() && bits[i] == 0)
@@ -73,7 +145,18 @@ private:
             return npos;
         else
             return i * bits_per_block +
-                   static_cast<size_type>(detail::lowestBit(bits[i]));
+                   static_cast<size_type>(detail::findFirstSet(bits[i]));
+    }
+
+    // The last set bit in the blocks before endBlock.
+    size_type findBefore(size_type endBlock) const {
+        auto i = endBlock;
+        while (i > 0 && bits[i - 1] == 0)
+            --i;
+        if (i == 0)
+            return npos;
+        return (i - 1) * bits_per_block +
+               static_cast<size_type>(detail::findLastSet(bits[i - 1]));
     }
 
 public:
@@ -161,6 +244,15 @@ public:
         }
     }
 
+    template <typename B, typename A, typename BlockOutputIterator>
+    friend BlockOutputIterator to_block_range(const DynamicBitSet<B, A>& b,
+                                              BlockOutputIterator result);
+    template <typename BlockInputIterator, typename B, typename A>
+    friend void from_block_range(BlockInputIterator first,
+                                 BlockInputIterator last,
+                                 DynamicBitSet<B, A>& result);
+    friend class RankSelectIndex;
+
     void swap(DynamicBitSet<Block, Allocator>& rhs) {
         std::swap(bits, rhs.bits);
         std::swap(numBits, rhs.numBits);
@@ -236,31 +328,63 @@ public:
 
     DynamicBitSet<Block, Allocator>&
     operator&=(const DynamicBitSet<Block, Allocator>& rhs) {
-        assert(size() == rhs.size());
-        for (size_type i = 0; i < num_blocks(); ++i)
-            bits[i] &= rhs.bits[i];
-        return *this;
+        return applyBlocks(rhs, detail::BitOp::And,
+                           [](Block a, Block b) { return a & b; });
     }
     DynamicBitSet<Block, Allocator>&
     operator|=(const DynamicBitSet<Block, Allocator>& rhs) {
-        assert(size() == rhs.size());
-        for (size_type i = 0; i < num_blocks(); ++i)
-            bits[i] |= rhs.bits[i];
-        return *this;
+        return applyBlocks(rhs, detail::BitOp::Or,
+                           [](Block a, Block b) { return a | b; });
     }
     DynamicBitSet<Block, Allocator>&
     operator^=(const DynamicBitSet<Block, Allocator>& rhs) {
-        assert(size() == rhs.size());
-        for (size_type i = 0; i < num_blocks(); ++i)
-            bits[i] ^= rhs.bits[i];
-        return *this;
+        return applyBlocks(rhs, detail::BitOp::Xor,
+                           [](Block a, Block b) { return a ^ b; });
     }
     DynamicBitSet<Block, Allocator>&
     operator-=(const DynamicBitSet<Block, Allocator>& rhs) {
-        assert(size() == rhs.size());
-        for (size_type i = 0; i < num_blocks(); ++i)
-            bits[i] &= ~rhs.bits[i];
-        return *this;
+        return applyBlocks(rhs, detail::BitOp::AndNot,
+                           [](Block a, Block b) { return Block(a & ~b); });
+    }
+
+    // The same as the compound assignments, but they also return whether this
+    // set changed, which they find out in the same pass over the blocks rather
+    // than by comparing against a copy. Dataflow solvers use them to detect
+    // their fixed point.
+    bool or_with_changed(const DynamicBitSet<Block, Allocator>& rhs) {
+        return applyBlocksChanged(rhs, detail::BitOp::Or,
+                                  [](Block a, Block b) { return a | b; });
+    }
+    bool and_with_changed(const DynamicBitSet<Block, Allocator>& rhs) {
+        return applyBlocksChanged(rhs, detail::BitOp::And,
+                                  [](Block a, Block b) { return a & b; });
+    }
+    bool subtract_with_changed(const DynamicBitSet<Block, Allocator>& rhs) {
+        return applyBlocksChanged(
+            rhs, detail::BitOp::AndNot,
+            [](Block a, Block b) { return Block(a & ~b); });
+    }
+
+    // Sets this set to gen | (in & ~kill), the transfer function of a gen/kill
+    // dataflow problem, in one pass without temporaries, and returns whether
+    // it changed. in may be this set itself.
+    bool assign_or_andnot(const DynamicBitSet<Block, Allocator>& gen,
+                          const DynamicBitSet<Block, Allocator>& in,
+                          const DynamicBitSet<Block, Allocator>& kill) {
+        assert(size() == gen.size() && size() == in.size() &&
+               size() == kill.size());
+        if (useKernels())
+            return detail::bitsOrAndNot(bits.data(), gen.bits.data(),
+                                        in.bits.data(), kill.bits.data(),
+                                        numBytes());
+        Block diff = 0;
+        for (size_type i = 0; i < num_blocks(); ++i) {
+            auto r = static_cast<Block>(gen.bits[i] |
+                                        (in.bits[i] & ~kill.bits[i]));
+            diff |= r ^ bits[i];
+            bits[i] = r;
+        }
+        return diff != 0;
     }
 
     DynamicBitSet<Block, Allocator>& reset(size_type pos) {
@@ -309,7 +433,18 @@ public:
         }
         return b;
     }
+    // The number of set bits.
+    size_type count() const {
+        if (useKernels())
+            return detail::bitsCount(bits.data(), numBytes());
+        size_type ret = 0;
+        for (auto elem : bits)
+            ret += static_cast<size_type>(detail::popcount(elem));
+        return ret;
+    }
     bool any() const {
+        if (useKernels())
+            return detail::bitsAny(bits.data(), numBytes());
         return std::any_of(bits.begin(), bits.end(),
                            [](auto elem) { return elem != 0; });
     }
@@ -319,19 +454,21 @@ public:
             return true;
 
         auto extraBits = countExtraBits();
-        auto allOnes = ~static_cast<Block>(0);
+        auto allOnes = static_cast<Block>(~Block(0));
+        auto numFull = extraBits == 0 ? num_blocks() : num_blocks() - 1;
 
-        if (extraBits == 0) {
-            return std::all_of(bits.begin(), bits.end(), [allOnes](auto elem) {
-                return elem == allOnes;
-            });
+        if (numFull * sizeof(Block) >= detail::BitKernelMinBytes) {
+            if (!detail::bitsAllOnes(bits.data(), numFull * sizeof(Block)))
+                return false;
         } else {
-            for (size_type i = 0, e = num_blocks() - 1; i < e; ++i) {
+            for (size_type i = 0; i < numFull; ++i) {
                 if (bits[i] != allOnes) {
                     return false;
                 }
             }
-            auto mask = ~(~static_cast<Block>(0) << extraBits);
+        }
+        if (extraBits != 0) {
+            auto mask = static_cast<Block>(~(allOnes << extraBits));
             if (bits.back() != mask) {
                 return false;
             }
@@ -339,6 +476,32 @@ public:
         return true;
     }
 
+    // Whether this set and rhs have a bit in common.
+    bool intersects(const DynamicBitSet<Block, Allocator>& rhs) const {
+        assert(size() == rhs.size());
+        if (useKernels())
+            return detail::bitsIntersect(bits.data(), rhs.bits.data(),
+                                         numBytes());
+        for (size_type i = 0; i < num_blocks(); ++i)
+            if ((bits[i] & rhs.bits[i]) != 0)
+                return true;
+        return false;
+    }
+    // Whether every bit of this set is also set in rhs.
+    bool is_subset_of(const DynamicBitSet<Block, Allocator>& rhs) const {
+        assert(size() == rhs.size());
+        if (useKernels())
+            return detail::bitsSubset(bits.data(), rhs.bits.data(),
+                                      numBytes());
+        for (size_type i = 0; i < num_blocks(); ++i)
+            if ((bits[i] & ~rhs.bits[i]) != 0)
+                return false;
+        return true;
+    }
+    bool is_proper_subset_of(const DynamicBitSet<Block, Allocator>& rhs) const {
+        return is_subset_of(rhs) && *this != rhs;
+    }
+
     size_type find_first() const { return findFrom(0); }
     size_type find_next(size_type pos) const {
         size_type sz = size();
@@ -348,11 +511,128 @@ public:
         ++pos;
         auto blk = blockIndex(pos);
         auto idx = bitIndex(pos);
-        auto fore = bits[blk] >> idx;
-        return fore ? pos + static_cast<size_type>(detail::lowestBit(fore))
+        auto fore = static_cast<Block>(bits[blk] >> idx);
+        return fore ? pos + static_cast<size_type>(detail::findFirstSet(fore))
                     : findFrom(blk + 1);
     }
 
+    // The highest set bit, and the highest set bit below pos.
+    size_type find_last() const { return findBefore(num_blocks()); }
+    size_type find_prev(size_type pos) const {
+        if (pos == 0 || empty())
+            return npos;
+
+        pos = std::min(pos, size()) - 1;
+        auto blk = blockIndex(pos);
+        auto idx = bitIndex(pos);
+        auto allOnes = static_cast<Block>(~Block(0));
+        auto aft = static_cast<Block>(bits[blk] &
+                                      (allOnes >> (bits_per_block - 1 - idx)));
+        return aft ? blk * bits_per_block +
+                         static_cast<size_type>(detail::findLastSet(aft))
+                   : findBefore(blk);
+    }
+
+    // A forward iterator over the positions of the set bits, in increasing
+    // order. It holds a copy of the current block and clears its lowest set
+    // bit on every step, so it does not allocate and costs a few instructions
+    // per set bit plus one test per zero block. The bit set must not be
+    // resized while it is being iterated.
+    class set_bit_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = size_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const size_type*;
+        using reference = size_type;
+
+    private:
+        const Block* blocks;
+        size_type numBlocks;
+        size_type blockIdx;
+        Block current;
+
+        void skipZeroBlocks() {
+            while (current == 0) {
+                if (++blockIdx >= numBlocks) {
+                    blockIdx = numBlocks;
+                    return;
+                }
+                current = blocks[blockIdx];
+            }
+        }
+
+    public:
+        set_bit_iterator(const Block* blocks, size_type numBlocks, bool atEnd)
+            : blocks(blocks), numBlocks(numBlocks),
+              blockIdx(atEnd ? numBlocks : 0),
+              current(atEnd || numBlocks == 0 ? Block(0) : blocks[0]) {
+            if (!atEnd && numBlocks != 0)
+                skipZeroBlocks();
+        }
+
+        size_type operator*() const {
+            return blockIdx * bits_per_block +
+                   static_cast<size_type>(detail::findFirstSet(current));
+        }
+
+        set_bit_iterator& operator++() {
+            current = static_cast<Block>(current & (current - 1));
+            skipZeroBlocks();
+            return *this;
+        }
+        set_bit_iterator operator++(int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const set_bit_iterator& rhs) const {
+            return blockIdx == rhs.blockIdx && current == rhs.current;
+        }
+        bool operator!=(const set_bit_iterator& rhs) const {
+            return !(*this == rhs);
+        }
+    };
+
+    class set_bit_range {
+        const Block* blocks;
+        size_type numBlocks;
+
+    public:
+        set_bit_range(const Block* blocks, size_type numBlocks)
+            : blocks(blocks), numBlocks(numBlocks) {}
+
+        set_bit_iterator begin() const {
+            return set_bit_iterator(blocks, numBlocks, false);
+        }
+        set_bit_iterator end() const {
+            return set_bit_iterator(blocks, numBlocks, true);
+        }
+    };
+
+    // The positions of the set bits, for use in range-based for loops:
+    //
+    //   for (auto pos : live.set_bits())
+    //       ...
+    set_bit_range set_bits() const {
+        return set_bit_range(bits.data(), num_blocks());
+    }
+
+    // Calls fn(pos) for the position of every set bit, in increasing order.
+    // This is the fastest way to enumerate the members of the set.
+    template <typename Fn>
+    void for_each_set_bit(Fn fn) const {
+        for (size_type i = 0, e = num_blocks(); i != e; ++i) {
+            Block block = bits[i];
+            while (block != 0) {
+                fn(i * bits_per_block +
+                   static_cast<size_type>(detail::findFirstSet(block)));
+                block = static_cast<Block>(block & (block - 1));
+            }
+        }
+    }
+
     bool operator==(const DynamicBitSet<Block, Allocator>& rhs) const {
         return numBits == rhs.numBits && bits == rhs.bits;
     }
@@ -384,4 +664,23 @@ public:
         return !(rhs < *this);
     }
 };
+
+// Raw access to the blocks, lowest first, as in Boost. to_block_range copies
+// all blocks of b to result. from_block_range overwrites the lowest blocks of
+// result with [first, last), which must not hold more than num_blocks()
+// blocks; bits past size() are dropped.
+template <typename Block, typename Allocator, typename BlockOutputIterator>
+BlockOutputIterator to_block_range(const DynamicBitSet<Block, Allocator>& b,
+                                   BlockOutputIterator result) {
+    return std::copy(b.bits.begin(), b.bits.end(), result);
+}
+
+template <typename BlockInputIterator, typename Block, typename Allocator>
+void from_block_range(BlockInputIterator first, BlockInputIterator last,
+                      DynamicBitSet<Block, Allocator>& result) {
+    auto end = std::copy(first, last, result.bits.begin());
+    assert(end <= result.bits.end() && "Too many blocks");
+    (void)end;
+    result.zeroUnusedBits();
+}
 }
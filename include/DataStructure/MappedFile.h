@@ -0,0 +1,154 @@
+#pragma once
+
+#include "DataStructure/StringView.h"
+
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace ds {
+
+// A read-only memory mapping of a whole file. The contents are exposed as one
+// StringView that stays valid for the lifetime of the MappedFile; pages are
+// faulted in by the kernel on demand and are never copied onto the heap.
+//
+// Construction throws std::system_error if the file cannot be opened or mapped.
+// An empty file maps to an empty buffer.
+class MappedFile {
+public:
+    // Tells the kernel how the mapping is going to be read.
+    // - Sequential enables aggressive read-ahead and lets the kernel drop pages
+    //   behind the reader, and also asks it to start reading the file now.
+    // - Random disables read-ahead.
+    enum class AccessHint { Normal, Sequential, Random };
+
+private:
+    const char* data;
+    size_t length;
+
+    void unmap();
+
+public:
+    explicit MappedFile(const std::string& path,
+                        AccessHint hint = AccessHint::Sequential);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept
+        : data(other.data), length(other.length) {
+        other.data = nullptr;
+        other.length = 0;
+    }
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            data = other.data;
+            length = other.length;
+            other.data = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+    ~MappedFile() { unmap(); }
+
+    StringView getBuffer() const { return StringView(data, length); }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+};
+
+// Iterates over the records of 'text' that are terminated by 'delimiter'. The
+// delimiter is not part of the record, and a missing delimiter after the last
+// record is tolerated. Unlike SplitRange, a trailing delimiter does not produce
+// an extra empty record, so "a\nb\n" has exactly two lines.
+//
+// If 'delimiter' is '\n', a '\r' right before it is dropped as well, so files
+// with Windows line endings yield the same lines.
+class RecordRange {
+public:
+    class iterator {
+    private:
+        StringView record, rest;
+        char delimiter;
+        bool atEnd;
+
+        void advance() {
+            if (rest.empty()) {
+                atEnd = true;
+                return;
+            }
+            auto idx = rest.find(delimiter);
+            if (idx == StringView::npos) {
+                record = rest;
+                rest = StringView(rest.end(), 0);
+                return;
+            }
+            record = rest.slice(0, idx);
+            rest = rest.slice(idx + 1, StringView::npos);
+            if (delimiter == '\n' && !record.empty() && record.back() == '\r')
+                record = record.dropBack(1);
+        }
+
+    public:
+        using difference_type = std::ptrdiff_t;
+        using value_type = StringView;
+        using pointer = const StringView*;
+        using reference = const StringView&;
+        using iterator_category = std::forward_iterator_tag;
+
+        iterator() : delimiter('\n'), atEnd(true) {}
+        iterator(StringView text, char delimiter)
+            : rest(text), delimiter(delimiter), atEnd(false) {
+            advance();
+        }
+
+        reference operator*() const { return record; }
+        pointer operator->() const { return &record; }
+        iterator& operator++() {
+            advance();
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator ret = *this;
+            advance();
+            return ret;
+        }
+        bool operator==(const iterator& rhs) const {
+            if (atEnd || rhs.atEnd)
+                return atEnd == rhs.atEnd;
+            return rest.data() == rhs.rest.data() &&
+                   rest.size() == rhs.rest.size() &&
+                   record.data() == rhs.record.data();
+        }
+        bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+    };
+    using const_iterator = iterator;
+
+private:
+    StringView text;
+    char delimiter;
+
+public:
+    explicit RecordRange(StringView text, char delimiter = '\n')
+        : text(text), delimiter(delimiter) {}
+
+    iterator begin() const { return iterator(text, delimiter); }
+    iterator end() const { return iterator(); }
+};
+
+// Splits 'text' into at most 'numChunks' consecutive pieces of roughly equal
+// size, moving every cut forward to just after the next 'delimiter' so that no
+// record straddles two chunks. Empty chunks are dropped, and concatenating the
+// result gives back 'text'.
+std::vector<StringView> splitIntoChunks(StringView text, size_t numChunks,
+                                        char delimiter = '\n');
+
+// Splits 'text' with splitIntoChunks() and calls fn(chunkIndex, chunk) for
+// every chunk on 'numThreads' threads (0 means one per hardware thread). Each
+// chunk is handed to exactly one call. Returns after all calls finished; if any
+// of them threw, the first exception is rethrown. If a thread fails to start,
+// the threads already running are joined and the std::system_error is
+// rethrown.
+void forEachChunk(StringView text, unsigned numThreads,
+                  const std::function<void(size_t, StringView)>& fn,
+                  char delimiter = '\n');
+}
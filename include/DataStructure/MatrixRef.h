@@ -0,0 +1,556 @@
+#pragma once
+
+#include "DataStructure/ArrayRef.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+
+namespace ds {
+
+// Non-owning views of elements that are evenly spaced in memory, and of 2-D
+// matrices built from them. Like ArrayRef, they are cheap to copy and do not
+// own their elements, which must outlive the view.
+
+// A random-access iterator that advances by a fixed number of elements. It
+// keeps an index rather than a pointer, so that the end iterator of a view does
+// not point (stride - 1) elements past the end of the underlying array.
+template <typename T>
+class StridedIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = typename std::remove_const<T>::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+private:
+    T* base;
+    difference_type index;
+    difference_type stride;
+
+public:
+    StridedIterator() : base(nullptr), index(0), stride(1) {}
+    StridedIterator(T* base, difference_type index, difference_type stride)
+        : base(base), index(index), stride(stride) {}
+
+    reference operator*() const { return base[index * stride]; }
+    pointer operator->() const { return base + index * stride; }
+    reference operator[](difference_type n) const {
+        return base[(index + n) * stride];
+    }
+
+    StridedIterator& operator++() {
+        ++index;
+        return *this;
+    }
+    StridedIterator operator++(int) {
+        auto ret = *this;
+        ++index;
+        return ret;
+    }
+    StridedIterator& operator--() {
+        --index;
+        return *this;
+    }
+    StridedIterator operator--(int) {
+        auto ret = *this;
+        --index;
+        return ret;
+    }
+    StridedIterator& operator+=(difference_type n) {
+        index += n;
+        return *this;
+    }
+    StridedIterator& operator-=(difference_type n) {
+        index -= n;
+        return *this;
+    }
+    StridedIterator operator+(difference_type n) const {
+        return StridedIterator(base, index + n, stride);
+    }
+    friend StridedIterator operator+(difference_type n, StridedIterator it) {
+        return it + n;
+    }
+    StridedIterator operator-(difference_type n) const {
+        return StridedIterator(base, index - n, stride);
+    }
+    difference_type operator-(const StridedIterator& rhs) const {
+        assert(base == rhs.base && "Iterators of different views");
+        return index - rhs.index;
+    }
+
+    bool operator==(const StridedIterator& rhs) const {
+        return index == rhs.index;
+    }
+    bool operator!=(const StridedIterator& rhs) const {
+        return index != rhs.index;
+    }
+    bool operator<(const StridedIterator& rhs) const {
+        return index < rhs.index;
+    }
+    bool operator>(const StridedIterator& rhs) const { return rhs < *this; }
+    bool operator<=(const StridedIterator& rhs) const {
+        return !(rhs < *this);
+    }
+    bool operator>=(const StridedIterator& rhs) const {
+        return !(*this < rhs);
+    }
+};
+
+// A view of 'length' elements, each 'stride' elements after the previous one:
+// a column of a row-major matrix, every other sample of a signal, and so on.
+// A stride of 1 describes the same elements as an ArrayRef.
+template <typename T>
+class StridedArrayRef {
+public:
+    using iterator = StridedIterator<const T>;
+    using const_iterator = iterator;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using size_type = std::size_t;
+
+private:
+    const T* array;
+    size_type length;
+    size_type step;
+
+public:
+    StridedArrayRef() : array(nullptr), length(0), step(1) {}
+    StridedArrayRef(const T* array, size_type length, size_type stride = 1)
+        : array(array), length(length), step(stride) {
+        assert(stride != 0 && "Zero stride");
+    }
+    StridedArrayRef(ArrayRef<T> arr)
+        : array(arr.data()), length(arr.size()), step(1) {}
+    template <typename A>
+    StridedArrayRef(const std::vector<T, A>& vec)
+        : StridedArrayRef(ArrayRef<T>(vec)) {}
+    template <typename A, typename U>
+    StridedArrayRef(const SmallVectorTemplateCommon<T, A, U>& vec)
+        : StridedArrayRef(ArrayRef<T>(vec)) {}
+
+    iterator begin() const { return iterator(array, 0, step); }
+    iterator end() const { return iterator(array, length, step); }
+
+    reverse_iterator rbegin() const { return reverse_iterator(end()); }
+    reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+    bool empty() const { return length == 0; }
+    const T* data() const { return array; }
+    size_type size() const { return length; }
+    size_type stride() const { return step; }
+    const T& front() const {
+        assert(!empty());
+        return array[0];
+    }
+    const T& back() const {
+        assert(!empty());
+        return array[(length - 1) * step];
+    }
+
+    // Check whether the elements are adjacent in memory, so that the view can
+    // be turned into an ArrayRef.
+    bool isContiguous() const { return step == 1 || length <= 1; }
+    ArrayRef<T> asArrayRef() const {
+        assert(isContiguous() && "Elements are not contiguous");
+        return ArrayRef<T>(array, length);
+    }
+
+    // slice(n, m) - Chop off the first n elements, and keep m elements.
+    StridedArrayRef<T> slice(size_type n, size_type m) const {
+        assert(n + m <= size() && "Invalid specifier");
+        return StridedArrayRef<T>(array + n * step, m, step);
+    }
+    StridedArrayRef<T> slice(size_type n) const {
+        assert(n <= size() && "Invalid specifier");
+        return slice(n, size() - n);
+    }
+    StridedArrayRef<T> drop_front(size_type n = 1) const {
+        assert(size() >= n && "Dropping more elements than exist");
+        return slice(n, size() - n);
+    }
+    StridedArrayRef<T> drop_back(size_type n = 1) const {
+        assert(size() >= n && "Dropping more elements than exist");
+        return slice(0, size() - n);
+    }
+
+    // Keep every n-th element, starting with the first one.
+    StridedArrayRef<T> every(size_type n) const {
+        assert(n != 0 && "Zero stride");
+        return StridedArrayRef<T>(array, (length + n - 1) / n, step * n);
+    }
+
+    bool equals(StridedArrayRef rhs) const {
+        if (length != rhs.length)
+            return false;
+        return std::equal(begin(), end(), rhs.begin());
+    }
+
+    const T& operator[](size_type index) const {
+        assert(index < length && "Invalid index!");
+        return array[index * step];
+    }
+
+    std::vector<T> vec() const { return std::vector<T>(begin(), end()); }
+};
+
+template <typename T>
+class MutableStridedArrayRef : public StridedArrayRef<T> {
+public:
+    using iterator = StridedIterator<T>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using typename StridedArrayRef<T>::size_type;
+
+    MutableStridedArrayRef() : StridedArrayRef<T>() {}
+    MutableStridedArrayRef(T* data, size_type length, size_type stride = 1)
+        : StridedArrayRef<T>(data, length, stride) {}
+    MutableStridedArrayRef(MutableArrayRef<T> arr) : StridedArrayRef<T>(arr) {}
+    template <typename A>
+    MutableStridedArrayRef(SmallVectorImpl<T, A>& vec)
+        : StridedArrayRef<T>(vec) {}
+    MutableStridedArrayRef(std::vector<T>& vec) : StridedArrayRef<T>(vec) {}
+
+    T* data() const { return const_cast<T*>(StridedArrayRef<T>::data()); }
+
+    iterator begin() const { return iterator(data(), 0, this->stride()); }
+    iterator end() const {
+        return iterator(data(), this->size(), this->stride());
+    }
+
+    reverse_iterator rbegin() const { return reverse_iterator(end()); }
+    reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+    T& front() const {
+        assert(!this->empty());
+        return data()[0];
+    }
+    T& back() const {
+        assert(!this->empty());
+        return data()[(this->size() - 1) * this->stride()];
+    }
+
+    MutableArrayRef<T> asArrayRef() const {
+        assert(this->isContiguous() && "Elements are not contiguous");
+        return MutableArrayRef<T>(data(), this->size());
+    }
+
+    MutableStridedArrayRef<T> slice(size_type n, size_type m) const {
+        assert(n + m <= this->size() && "Invalid specifier");
+        return MutableStridedArrayRef<T>(data() + n * this->stride(), m,
+                                         this->stride());
+    }
+    MutableStridedArrayRef<T> slice(size_type n) const {
+        assert(n <= this->size() && "Invalid specifier");
+        return slice(n, this->size() - n);
+    }
+    MutableStridedArrayRef<T> drop_front(size_type n = 1) const {
+        assert(this->size() >= n && "Dropping more elements than exist");
+        return slice(n, this->size() - n);
+    }
+    MutableStridedArrayRef<T> drop_back(size_type n = 1) const {
+        assert(this->size() >= n && "Dropping more elements than exist");
+        return slice(0, this->size() - n);
+    }
+    MutableStridedArrayRef<T> every(size_type n) const {
+        assert(n != 0 && "Zero stride");
+        return MutableStridedArrayRef<T>(data(), (this->size() + n - 1) / n,
+                                         this->stride() * n);
+    }
+
+    T& operator[](size_type index) const {
+        assert(index < this->size() && "Invalid index!");
+        return data()[index * this->stride()];
+    }
+};
+
+template <typename T>
+bool operator==(StridedArrayRef<T> lhs, StridedArrayRef<T> rhs) {
+    return lhs.equals(rhs);
+}
+
+template <typename T>
+bool operator!=(StridedArrayRef<T> lhs, StridedArrayRef<T> rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename MatrixT>
+class TileRange;
+
+// A view of a rows x cols matrix. Element (i, j) lives at
+// data()[i * rowStride() + j * colStride()]. A row-major matrix has a column
+// stride of 1 and a row stride equal to its leading dimension, which may be
+// larger than the number of columns when the matrix is a block of a bigger
+// one. row(), col(), block() and transpose() all return views of the same
+// elements without copying them.
+template <typename T>
+class MatrixRef {
+public:
+    using size_type = std::size_t;
+
+private:
+    const T* array;
+    size_type numRows;
+    size_type numCols;
+    size_type rowStep;
+    size_type colStep;
+
+public:
+    MatrixRef() : array(nullptr), numRows(0), numCols(0), rowStep(0),
+                  colStep(1) {}
+    MatrixRef(const T* data, size_type rows, size_type cols, size_type ld,
+              size_type colStride)
+        : array(data), numRows(rows), numCols(cols), rowStep(ld),
+          colStep(colStride) {}
+    // A row-major matrix whose rows are ld elements apart.
+    MatrixRef(const T* data, size_type rows, size_type cols)
+        : MatrixRef(data, rows, cols, cols, 1) {}
+    MatrixRef(const T* data, size_type rows, size_type cols, size_type ld)
+        : MatrixRef(data, rows, cols, ld, 1) {
+        assert(ld >= cols && "Rows overlap");
+    }
+    // A row-major matrix stored in 'storage', which may be a std::vector or a
+    // SmallVector.
+    MatrixRef(ArrayRef<T> storage, size_type rows, size_type cols)
+        : MatrixRef(storage, rows, cols, cols) {}
+    MatrixRef(ArrayRef<T> storage, size_type rows, size_type cols,
+              size_type ld)
+        : MatrixRef(storage.data(), rows, cols, ld) {
+        assert((rows == 0 || (rows - 1) * ld + cols <= storage.size()) &&
+               "Matrix does not fit into its storage");
+    }
+
+    const T* data() const { return array; }
+    size_type rows() const { return numRows; }
+    size_type cols() const { return numCols; }
+    size_type size() const { return numRows * numCols; }
+    bool empty() const { return numRows == 0 || numCols == 0; }
+    size_type rowStride() const { return rowStep; }
+    size_type colStride() const { return colStep; }
+
+    // Check whether every row is contiguous in memory.
+    bool isRowMajor() const { return colStep == 1 || numCols <= 1; }
+
+    const T& operator()(size_type i, size_type j) const {
+        assert(i < numRows && j < numCols && "Invalid index!");
+        return array[i * rowStep + j * colStep];
+    }
+
+    StridedArrayRef<T> row(size_type i) const {
+        assert(i < numRows && "Invalid row!");
+        return StridedArrayRef<T>(array + i * rowStep, numCols, colStep);
+    }
+    StridedArrayRef<T> col(size_type j) const {
+        assert(j < numCols && "Invalid column!");
+        return StridedArrayRef<T>(array + j * colStep, numRows, rowStep);
+    }
+
+    // The rows x cols sub-matrix whose top-left element is (i, j).
+    MatrixRef<T> block(size_type i, size_type j, size_type rows,
+                       size_type cols) const {
+        assert(i + rows <= numRows && j + cols <= numCols &&
+               "Invalid specifier");
+        return MatrixRef<T>(array + i * rowStep + j * colStep, rows, cols,
+                            rowStep, colStep);
+    }
+
+    MatrixRef<T> transpose() const {
+        return MatrixRef<T>(array, numCols, numRows, colStep, rowStep);
+    }
+
+    // Iterate over the matrix in tiles of at most tileRows x tileCols
+    // elements; see TileRange.
+    TileRange<MatrixRef<T>> tiles(size_type tileRows, size_type tileCols) const;
+};
+
+template <typename T>
+class MutableMatrixRef : public MatrixRef<T> {
+public:
+    using typename MatrixRef<T>::size_type;
+
+    MutableMatrixRef() : MatrixRef<T>() {}
+    MutableMatrixRef(T* data, size_type rows, size_type cols, size_type ld,
+                     size_type colStride)
+        : MatrixRef<T>(data, rows, cols, ld, colStride) {}
+    MutableMatrixRef(T* data, size_type rows, size_type cols)
+        : MatrixRef<T>(data, rows, cols) {}
+    MutableMatrixRef(T* data, size_type rows, size_type cols, size_type ld)
+        : MatrixRef<T>(data, rows, cols, ld) {}
+    MutableMatrixRef(MutableArrayRef<T> storage, size_type rows,
+                     size_type cols)
+        : MatrixRef<T>(storage, rows, cols) {}
+    MutableMatrixRef(MutableArrayRef<T> storage, size_type rows,
+                     size_type cols, size_type ld)
+        : MatrixRef<T>(storage, rows, cols, ld) {}
+
+    T* data() const { return const_cast<T*>(MatrixRef<T>::data()); }
+
+    T& operator()(size_type i, size_type j) const {
+        return const_cast<T&>(MatrixRef<T>::operator()(i, j));
+    }
+
+    MutableStridedArrayRef<T> row(size_type i) const {
+        auto ret = MatrixRef<T>::row(i);
+        return MutableStridedArrayRef<T>(const_cast<T*>(ret.data()),
+                                         ret.size(), ret.stride());
+    }
+    MutableStridedArrayRef<T> col(size_type j) const {
+        auto ret = MatrixRef<T>::col(j);
+        return MutableStridedArrayRef<T>(const_cast<T*>(ret.data()),
+                                         ret.size(), ret.stride());
+    }
+
+    MutableMatrixRef<T> block(size_type i, size_type j, size_type rows,
+                              size_type cols) const {
+        return MutableMatrixRef<T>(MatrixRef<T>::block(i, j, rows, cols));
+    }
+
+    MutableMatrixRef<T> transpose() const {
+        return MutableMatrixRef<T>(MatrixRef<T>::transpose());
+    }
+
+    TileRange<MutableMatrixRef<T>> tiles(size_type tileRows,
+                                         size_type tileCols) const;
+
+    void fill(const T& value) const {
+        for (size_type i = 0; i != this->rows(); ++i)
+            for (auto& elem : row(i))
+                elem = value;
+    }
+
+private:
+    explicit MutableMatrixRef(const MatrixRef<T>& m)
+        : MatrixRef<T>(m.data(), m.rows(), m.cols(), m.rowStride(),
+                       m.colStride()) {}
+};
+
+// Splits a matrix into blocks of at most tileRows x tileCols elements and
+// iterates over them, tile row by tile row. Blocked algorithms run their inner
+// loops on one tile at a time so that the tile stays in cache; the tiles at
+// the right and bottom edges are smaller if the dimensions are not multiples
+// of the tile size.
+//
+//   for (auto tile : m.tiles(64, 64))
+//       for (size_t i = 0; i != tile.rows(); ++i)
+//           ...
+template <typename MatrixT>
+class TileRange {
+public:
+    using size_type = std::size_t;
+
+private:
+    MatrixT matrix;
+    size_type tileRows;
+    size_type tileCols;
+
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = MatrixT;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const MatrixT*;
+        using reference = MatrixT;
+
+    private:
+        MatrixT matrix;
+        size_type tileRows, tileCols;
+        size_type i, j;
+
+    public:
+        iterator(const MatrixT& matrix, size_type tileRows, size_type tileCols,
+                 size_type i, size_type j)
+            : matrix(matrix), tileRows(tileRows), tileCols(tileCols), i(i),
+              j(j) {}
+
+        MatrixT operator*() const {
+            return matrix.block(i, j, std::min(tileRows, matrix.rows() - i),
+                                std::min(tileCols, matrix.cols() - j));
+        }
+
+        // The position of the current tile's top-left element.
+        size_type row() const { return i; }
+        size_type col() const { return j; }
+
+        iterator& operator++() {
+            j += tileCols;
+            if (j >= matrix.cols()) {
+                j = 0;
+                i += tileRows;
+            }
+            return *this;
+        }
+        iterator operator++(int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const iterator& rhs) const {
+            return i == rhs.i && j == rhs.j;
+        }
+        bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+    };
+
+    TileRange(const MatrixT& matrix, size_type tileRows, size_type tileCols)
+        : matrix(matrix), tileRows(tileRows), tileCols(tileCols) {
+        assert(tileRows != 0 && tileCols != 0 && "Empty tiles");
+    }
+
+    iterator begin() const {
+        return matrix.empty() ? end()
+                              : iterator(matrix, tileRows, tileCols, 0, 0);
+    }
+    iterator end() const {
+        size_type numTileRows = (matrix.rows() + tileRows - 1) / tileRows;
+        return iterator(matrix, tileRows, tileCols,
+                        matrix.empty() ? 0 : numTileRows * tileRows, 0);
+    }
+};
+
+template <typename T>
+TileRange<MatrixRef<T>> MatrixRef<T>::tiles(size_type tileRows,
+                                            size_type tileCols) const {
+    return TileRange<MatrixRef<T>>(*this, tileRows, tileCols);
+}
+
+template <typename T>
+TileRange<MutableMatrixRef<T>>
+MutableMatrixRef<T>::tiles(size_type tileRows, size_type tileCols) const {
+    return TileRange<MutableMatrixRef<T>>(*this, tileRows, tileCols);
+}
+
+// The edge of a square tile of T's that, together with a second one, fits into
+// a typical 32KiB L1 data cache. Always a power of two.
+template <typename T>
+constexpr std::size_t defaultTileSize() {
+    std::size_t edge = 1;
+    while (2 * edge * 2 * edge * sizeof(T) <= 16384)
+        edge *= 2;
+    return edge;
+}
+
+// Copies src into dst, which must have the same dimensions. If the two differ
+// in layout, for example because one of them is transposed, the copy proceeds
+// tile by tile so that neither side is walked against its memory order for
+// more than a tile at a time.
+template <typename T>
+void copy_into(MatrixRef<T> src, MutableMatrixRef<T> dst) {
+    assert(src.rows() == dst.rows() && src.cols() == dst.cols() &&
+           "Dimensions differ");
+    if (src.isRowMajor() && dst.isRowMajor()) {
+        for (std::size_t i = 0; i != src.rows(); ++i)
+            std::copy_n(src.row(i).data(), src.cols(), dst.row(i).data());
+        return;
+    }
+    const std::size_t tile = defaultTileSize<T>();
+    auto tiles = dst.tiles(tile, tile);
+    for (auto it = tiles.begin(), e = tiles.end(); it != e; ++it) {
+        auto out = *it;
+        auto in = src.block(it.row(), it.col(), out.rows(), out.cols());
+        for (std::size_t i = 0; i != out.rows(); ++i)
+            for (std::size_t j = 0; j != out.cols(); ++j)
+                out(i, j) = in(i, j);
+    }
+}
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "DataStructure/ArrayRef.h"
+#include "DataStructure/StringView.h"
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ds {
+
+template <typename ValueT>
+class StringMap;
+
+// A multi-pattern string matcher built on the Aho-Corasick automaton. The
+// patterns are compiled once, and every scan afterwards reports all
+// occurrences of all patterns in a single pass over the text, in time linear in
+// the text length plus the number of matches.
+//
+// The automaton comes in two layouts:
+// - Compact: each state stores its outgoing edges as a sorted run of labels in
+//   one shared array, and missing edges are resolved by following failure
+//   links. Memory use is proportional to the total pattern length.
+// - DFA: the failure links are folded into a dense transition table indexed by
+//   state and byte class, where a byte class groups all bytes that no pattern
+//   distinguishes. Each input byte then costs exactly one table lookup. This
+//   layout is only practical when patterns use a small alphabet.
+// Mode::Auto picks the DFA whenever its table stays reasonably small.
+//
+// The matcher owns a copy of its patterns and is immutable after construction,
+// so one instance can be shared by many scanning threads. Empty patterns are
+// accepted (to keep pattern indices stable) but never match.
+class MultiMatcher {
+public:
+    enum class Mode { Auto, Compact, DFA };
+
+    // An occurrence of pattern number 'pattern' at text[begin, end).
+    struct Match {
+        unsigned pattern;
+        size_t begin, end;
+    };
+
+private:
+    using StateID = uint32_t;
+    static constexpr StateID Root = 0;
+    static constexpr StateID NoState = ~StateID(0);
+
+    // All patterns back to back; pattern i is
+    // patternData[patternOffsets[i], patternOffsets[i + 1]).
+    std::string patternData;
+    std::vector<uint32_t> patternOffsets;
+
+    // Compact layout. The edges of state s are
+    // [edgeBegin[s], edgeBegin[s + 1]) of edgeLabels/edgeTargets, sorted by
+    // label. The root's transitions are kept in a full table since the scan
+    // returns to the root very often.
+    std::vector<uint32_t> edgeBegin;
+    std::vector<unsigned char> edgeLabels;
+    std::vector<StateID> edgeTargets;
+    std::vector<StateID> failLinks;
+    StateID rootNext[256];
+
+    // The patterns recognized at state s are
+    // outputs[outputBegin[s], outputBegin[s + 1]). reportFrom[s] is the first
+    // state on the failure chain of s (including s) that recognizes something,
+    // and outputLinks[s] continues that chain.
+    std::vector<uint32_t> outputBegin;
+    std::vector<uint32_t> outputs;
+    std::vector<StateID> reportFrom;
+    std::vector<StateID> outputLinks;
+
+    // DFA layout.
+    bool useDFA;
+    unsigned numClasses;
+    uint16_t byteClass[256];
+    std::vector<StateID> dfaTable;
+
+    void build(ArrayRef<StringView> patterns, Mode mode);
+    void buildDFA();
+
+    StateID stepCompact(StateID s, unsigned char c) const {
+        while (s != Root) {
+            auto first = edgeLabels.data() + edgeBegin[s];
+            auto last = edgeLabels.data() + edgeBegin[s + 1];
+            for (auto it = first; it != last && *it <= c; ++it)
+                if (*it == c)
+                    return edgeTargets[it - edgeLabels.data()];
+            s = failLinks[s];
+        }
+        return rootNext[c];
+    }
+
+    StateID stepDFA(StateID s, unsigned char c) const {
+        return dfaTable[size_t(s) * numClasses + byteClass[c]];
+    }
+
+    template <typename Callback>
+    void report(StateID s, size_t end, Callback& cb) const {
+        for (; s != NoState; s = outputLinks[s]) {
+            for (auto i = outputBegin[s], e = outputBegin[s + 1]; i != e;
+                 ++i) {
+                auto pattern = outputs[i];
+                size_t len =
+                    patternOffsets[pattern + 1] - patternOffsets[pattern];
+                cb(Match{pattern, end - len, end});
+            }
+        }
+    }
+
+    template <bool DFA, typename Callback>
+    void scanImpl(StringView text, Callback& cb) const {
+        auto p = reinterpret_cast<const unsigned char*>(text.data());
+        StateID s = Root;
+        for (size_t i = 0, e = text.size(); i != e; ++i) {
+            s = DFA ? stepDFA(s, p[i]) : stepCompact(s, p[i]);
+            if (reportFrom[s] != NoState)
+                report(reportFrom[s], i + 1, cb);
+        }
+    }
+
+public:
+    explicit MultiMatcher(ArrayRef<StringView> patterns,
+                          Mode mode = Mode::Auto) {
+        build(patterns, mode);
+    }
+
+    // Compiles the keys of 'map'. Pattern indices follow the map's iteration
+    // order; use getPattern() to get back to the key.
+    template <typename ValueT>
+    explicit MultiMatcher(const StringMap<ValueT>& map,
+                          Mode mode = Mode::Auto) {
+        std::vector<StringView> keys;
+        keys.reserve(map.size());
+        for (auto& entry : map)
+            keys.push_back(entry.getKey());
+        build(keys, mode);
+    }
+
+    size_t getNumPatterns() const { return patternOffsets.size() - 1; }
+    StringView getPattern(unsigned idx) const {
+        assert(idx < getNumPatterns() && "Invalid pattern index!");
+        return StringView(patternData.data() + patternOffsets[idx],
+                          patternOffsets[idx + 1] - patternOffsets[idx]);
+    }
+    size_t getNumStates() const { return failLinks.size(); }
+    bool isDFA() const { return useDFA; }
+
+    // Calls cb(const Match&) for every occurrence of every pattern in 'text'.
+    // Matches are reported in order of their end position. Matches sharing
+    // an end position are reported longest first.
+    template <typename Callback>
+    void scan(StringView text, Callback cb) const {
+        if (useDFA)
+            scanImpl<true>(text, cb);
+        else
+            scanImpl<false>(text, cb);
+    }
+
+    std::vector<Match> findAll(StringView text) const;
+
+    // Returns true if any pattern occurs in 'text'. Stops at the first match.
+    bool containsAny(StringView text) const;
+};
+}
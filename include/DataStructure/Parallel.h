@@ -0,0 +1,289 @@
+#pragma once
+
+#include "DataStructure/ArrayRef.h"
+#include "DataStructure/Detail.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ds {
+
+// A fixed set of threads that execute batches of tasks with work stealing.
+//
+// run(n, task) calls task(0), ..., task(n - 1) on the pool and returns once
+// all of them have finished. The batch starts as one range of indices; whoever
+// picks up a range splits it in half, keeps the lower half and pushes the upper
+// half onto its own deque, until a single task is left to run. Threads pop
+// work from the back of their own deque and steal from the front of the
+// others', so idle threads take the largest pending ranges. The thread that
+// calls run() works on the batch as well, which also makes nested calls from
+// inside a task safe.
+//
+// A pool of N threads starts N - 1 workers, the calling thread being the N-th.
+// If a task throws, the remaining tasks still run and run() rethrows the first
+// exception.
+class ThreadPool {
+private:
+    struct Job;
+    struct WorkItem;
+    struct Deque;
+
+    unsigned numThreads;
+    // One deque per worker, plus a shared one for threads outside the pool.
+    std::vector<std::unique_ptr<Deque>> deques;
+    std::vector<std::thread> workers;
+
+    // Number of work items in all deques. Idle workers sleep until it becomes
+    // non-zero.
+    std::atomic<size_t> numPending;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+
+    size_t getOwnDeque() const;
+    void push(size_t dequeIdx, const WorkItem& item);
+    bool pop(size_t dequeIdx, WorkItem& item);
+    void execute(size_t dequeIdx, WorkItem item);
+    void workerLoop(size_t idx);
+
+public:
+    explicit ThreadPool(unsigned numThreads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    unsigned getNumThreads() const { return numThreads; }
+
+    void run(size_t numTasks, const std::function<void(size_t)>& task);
+
+    // A process-wide pool with one thread per hardware thread.
+    static ThreadPool& getDefault();
+};
+
+// Knobs shared by the parallel algorithms below.
+struct ParallelOptions {
+    // The pool to run on. Null means ThreadPool::getDefault().
+    ThreadPool* pool = nullptr;
+    // Inputs with fewer elements than this are processed on the calling thread,
+    // where they are cheaper than the cost of waking up the pool.
+    size_t serialCutoff = 4096;
+};
+
+namespace detail {
+
+// Holds one value per chunk on its own cache line, so that threads writing
+// their results do not invalidate each other's lines.
+template <typename T>
+struct alignas(CacheLineSize) CacheLinePadded {
+    T value;
+};
+
+// How an input of numElems elements of elemSize bytes each is split up. There
+// are a few chunks per thread for load balancing, and chunk boundaries fall on
+// cache line boundaries (relative to the start of the input) so that no two
+// chunks write to the same line. A single chunk means the input should be
+// processed serially.
+struct Chunking {
+    size_t chunkSize;
+    size_t numChunks;
+
+    size_t begin(size_t chunk) const { return chunk * chunkSize; }
+    size_t end(size_t chunk, size_t numElems) const {
+        return std::min(numElems, (chunk + 1) * chunkSize);
+    }
+};
+
+Chunking computeChunking(size_t numElems, size_t elemSize,
+                         const ParallelOptions& opts);
+
+inline ThreadPool& getPool(const ParallelOptions& opts) {
+    return opts.pool != nullptr ? *opts.pool : ThreadPool::getDefault();
+}
+
+// Calls fn(begin, end) on every chunk of [0, numElems).
+template <typename Fn>
+void forEachChunk(size_t numElems, size_t elemSize, const ParallelOptions& opts,
+                  Fn fn) {
+    auto chunking = computeChunking(numElems, elemSize, opts);
+    if (chunking.numChunks <= 1) {
+        if (numElems != 0)
+            fn(size_t(0), numElems);
+        return;
+    }
+    getPool(opts).run(chunking.numChunks, [&](size_t chunk) {
+        fn(chunking.begin(chunk), chunking.end(chunk, numElems));
+    });
+}
+}
+
+// Calls fn(i) for every i in [begin, end), in parallel.
+template <typename Fn>
+void parallel_for(size_t begin, size_t end, Fn fn,
+                  const ParallelOptions& opts = ParallelOptions()) {
+    assert(begin <= end);
+    detail::forEachChunk(end - begin, 1, opts, [&](size_t lo, size_t hi) {
+        for (size_t i = lo; i != hi; ++i)
+            fn(begin + i);
+    });
+}
+
+// Calls fn(elem) for every element, in parallel.
+template <typename T, typename Fn>
+void parallel_for(ArrayRef<T> range, Fn fn,
+                  const ParallelOptions& opts = ParallelOptions()) {
+    detail::forEachChunk(range.size(), sizeof(T), opts,
+                         [&](size_t lo, size_t hi) {
+                             for (size_t i = lo; i != hi; ++i)
+                                 fn(range[i]);
+                         });
+}
+
+// Calls fn(elem) for every element, in parallel. fn may modify the elements.
+template <typename T, typename Fn>
+void parallel_for(MutableArrayRef<T> range, Fn fn,
+                  const ParallelOptions& opts = ParallelOptions()) {
+    detail::forEachChunk(range.size(), sizeof(T), opts,
+                         [&](size_t lo, size_t hi) {
+                             for (size_t i = lo; i != hi; ++i)
+                                 fn(range[i]);
+                         });
+}
+
+// Sets out[i] = fn(in[i]) for every i, in parallel. 'in' and 'out' must have
+// the same size, and may be the same array.
+template <typename T, typename U, typename Fn>
+void parallel_transform(ArrayRef<T> in, MutableArrayRef<U> out, Fn fn,
+                        const ParallelOptions& opts = ParallelOptions()) {
+    assert(in.size() == out.size() && "Input and output sizes differ");
+    detail::forEachChunk(in.size(), sizeof(U), opts,
+                         [&](size_t lo, size_t hi) {
+                             for (size_t i = lo; i != hi; ++i)
+                                 out[i] = fn(in[i]);
+                         });
+}
+
+// Returns init combined with all elements using op, which has to be
+// associative. Every chunk is reduced on its own and the partial results are
+// then combined in order, so op does not need to be commutative.
+template <typename T, typename Op>
+T parallel_reduce(ArrayRef<T> in, T init, Op op,
+                  const ParallelOptions& opts = ParallelOptions()) {
+    auto chunking = detail::computeChunking(in.size(), sizeof(T), opts);
+    if (chunking.numChunks <= 1) {
+        for (auto& elem : in)
+            init = op(init, elem);
+        return init;
+    }
+
+    std::vector<detail::CacheLinePadded<T>> partials(chunking.numChunks);
+    detail::getPool(opts).run(chunking.numChunks, [&](size_t chunk) {
+        size_t lo = chunking.begin(chunk), hi = chunking.end(chunk, in.size());
+        T acc = in[lo];
+        for (size_t i = lo + 1; i != hi; ++i)
+            acc = op(acc, in[i]);
+        partials[chunk].value = std::move(acc);
+    });
+    for (auto& partial : partials)
+        init = op(init, partial.value);
+    return init;
+}
+
+// Returns the sum of all elements plus init.
+template <typename T>
+T parallel_reduce(ArrayRef<T> in, T init = T()) {
+    return parallel_reduce(in, std::move(init), std::plus<T>());
+}
+
+// Sorts the elements with comp, in parallel. The sort is not stable. Each
+// chunk is sorted on its own, and sorted runs are then merged pairwise.
+template <typename T, typename Compare>
+void parallel_sort(MutableArrayRef<T> data, Compare comp,
+                   const ParallelOptions& opts = ParallelOptions()) {
+    auto chunking = detail::computeChunking(data.size(), sizeof(T), opts);
+    if (chunking.numChunks <= 1) {
+        std::sort(data.begin(), data.end(), comp);
+        return;
+    }
+
+    auto& pool = detail::getPool(opts);
+    size_t size = data.size();
+    pool.run(chunking.numChunks, [&](size_t chunk) {
+        std::sort(data.begin() + chunking.begin(chunk),
+                  data.begin() + chunking.end(chunk, size), comp);
+    });
+    for (size_t width = chunking.chunkSize; width < size; width *= 2) {
+        size_t numMerges = (size + 2 * width - 1) / (2 * width);
+        pool.run(numMerges, [&](size_t merge) {
+            size_t lo = merge * 2 * width;
+            size_t mid = std::min(size, lo + width);
+            size_t hi = std::min(size, lo + 2 * width);
+            std::inplace_merge(data.begin() + lo, data.begin() + mid,
+                               data.begin() + hi, comp);
+        });
+    }
+}
+
+template <typename T>
+void parallel_sort(MutableArrayRef<T> data) {
+    parallel_sort(data, std::less<T>());
+}
+
+// Sets out[i] to in[0] op in[1] op ... op in[i] (an inclusive scan), in
+// parallel. op has to be associative. 'in' and 'out' must have the same size,
+// and may be the same array.
+//
+// This makes two passes: the first one reduces every chunk, and after a serial
+// scan over the chunk totals, the second one scans every chunk starting from
+// the total of all chunks before it.
+template <typename T, typename Op>
+void parallel_prefix_sum(ArrayRef<T> in, MutableArrayRef<T> out, Op op,
+                         const ParallelOptions& opts = ParallelOptions()) {
+    assert(in.size() == out.size() && "Input and output sizes differ");
+    auto scan = [&](size_t lo, size_t hi, const T* carry) {
+        if (lo == hi)
+            return;
+        T acc = carry != nullptr ? op(*carry, in[lo]) : in[lo];
+        out[lo] = acc;
+        for (size_t i = lo + 1; i != hi; ++i) {
+            acc = op(acc, in[i]);
+            out[i] = acc;
+        }
+    };
+
+    size_t size = in.size();
+    auto chunking = detail::computeChunking(size, sizeof(T), opts);
+    if (chunking.numChunks <= 1) {
+        scan(0, size, nullptr);
+        return;
+    }
+
+    auto& pool = detail::getPool(opts);
+    std::vector<detail::CacheLinePadded<T>> totals(chunking.numChunks);
+    pool.run(chunking.numChunks, [&](size_t chunk) {
+        size_t lo = chunking.begin(chunk), hi = chunking.end(chunk, size);
+        T acc = in[lo];
+        for (size_t i = lo + 1; i != hi; ++i)
+            acc = op(acc, in[i]);
+        totals[chunk].value = std::move(acc);
+    });
+    for (size_t chunk = 1; chunk != totals.size(); ++chunk)
+        totals[chunk].value = op(totals[chunk - 1].value, totals[chunk].value);
+    pool.run(chunking.numChunks, [&](size_t chunk) {
+        scan(chunking.begin(chunk), chunking.end(chunk, size),
+             chunk == 0 ? nullptr : &totals[chunk - 1].value);
+    });
+}
+
+// The running sum of the elements, computed in place.
+template <typename T>
+void parallel_prefix_sum(MutableArrayRef<T> data) {
+    parallel_prefix_sum(ArrayRef<T>(data), data, std::plus<T>());
+}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "DataStructure/DynamicBitSet.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ds {
+
+// A rank/select index over an immutable DynamicBitSet, laid out like poppy
+// (Zhou, Andersen and Kaminsky, "Space-Efficient, High-Performance Rank &
+// Select Structures on Uncompressed Bit Sequences"):
+//
+// * The bits are split into lower blocks of 2048 bits, and every lower block
+//   has one 64-bit entry. The low 32 bits hold the number of set bits before
+//   the lower block, counted from the start of its upper block of 2^32 bits,
+//   and the next three 10-bit fields the counts of its first three 512-bit
+//   basic blocks. Upper blocks store their absolute counts.
+// * Every 8192nd set bit is sampled with the index of its lower block.
+//
+// rank() reads one entry and counts at most eight words of a basic block, so
+// it is O(1). select() binary searches the lower blocks between two samples,
+// and then works its way down the same way. The index takes about 3.5% of the
+// size of the bit set.
+//
+// The index points into the blocks of the bit set, which must neither change
+// nor go away while the index is in use.
+class RankSelectIndex {
+public:
+    using size_type = std::size_t;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+private:
+    static constexpr size_type LowerBlockBits = 2048;
+    static constexpr size_type BasicBlockWords = 8;
+    static constexpr size_type UpperBlockShift = 32 - 11;
+    static constexpr size_type SelectSampleRate = 8192;
+
+    const unsigned char* blocks;
+    size_type blockSize;
+    size_type numBlocks;
+    size_type numBits;
+    size_type numWords;
+    size_type total;
+
+    std::vector<uint64_t> upper;
+    std::vector<uint64_t> entries;
+    std::vector<uint32_t> samples;
+
+    void build();
+
+    // Bit j of word i is bit 64 * i + j of the set, whatever the block type.
+    template <typename Block>
+    uint64_t loadBlocks(size_type i) const {
+        const size_type perWord = sizeof(uint64_t) / sizeof(Block);
+        size_type first = i * perWord;
+        size_type last = std::min(first + perWord, numBlocks);
+        uint64_t word = 0;
+        for (size_type j = first; j < last; ++j) {
+            Block block;
+            std::memcpy(&block, blocks + j * sizeof(Block), sizeof(Block));
+            word |= uint64_t(block) << ((j - first) * 8 * sizeof(Block));
+        }
+        return word;
+    }
+    uint64_t loadWord(size_type i) const {
+        switch (blockSize) {
+        case 1:
+            return loadBlocks<uint8_t>(i);
+        case 2:
+            return loadBlocks<uint16_t>(i);
+        case 4:
+            return loadBlocks<uint32_t>(i);
+        default:
+            return loadBlocks<uint64_t>(i);
+        }
+    }
+
+    // The number of set bits before the lower block.
+    size_type lowerRank(size_type block) const {
+        return upper[block >> UpperBlockShift] + (entries[block] & 0xFFFFFFFF);
+    }
+
+public:
+    template <typename Block, typename Allocator>
+    explicit RankSelectIndex(const DynamicBitSet<Block, Allocator>& bits)
+        : blocks(reinterpret_cast<const unsigned char*>(bits.bits.data())),
+          blockSize(sizeof(Block)), numBlocks(bits.num_blocks()),
+          numBits(bits.size()), numWords((numBits + 63) / 64), total(0) {
+        build();
+    }
+
+    size_type size() const { return numBits; }
+    size_type count() const { return total; }
+
+    // The number of set bits before pos, which can be anywhere in [0, size()].
+    size_type rank(size_type pos) const {
+        assert(pos <= numBits && "Rank out of range");
+        auto block = pos / LowerBlockBits;
+        auto entry = entries[block];
+        auto ret = lowerRank(block);
+        // Add the counts of the basic blocks before pos within the lower
+        // block, then the words before pos within its basic block.
+        auto basic = pos / 512 % 4;
+        for (size_type i = 0; i != basic; ++i)
+            ret += (entry >> (32 + 10 * i)) & 0x3FF;
+        auto word = pos / 64;
+        for (auto i = word & ~(BasicBlockWords - 1); i != word; ++i)
+            ret += static_cast<size_type>(detail::popcount(loadWord(i)));
+        if (pos % 64 != 0)
+            ret += static_cast<size_type>(detail::popcount(
+                loadWord(word) & ((uint64_t(1) << (pos % 64)) - 1)));
+        return ret;
+    }
+    // The number of clear bits before pos.
+    size_type rank0(size_type pos) const { return pos - rank(pos); }
+
+    // The position of the k-th set bit, counting from 0, or npos if there are
+    // not that many.
+    size_type select(size_type k) const;
+
+    // The number of bytes taken by the index.
+    size_type getMemorySize() const {
+        return upper.capacity() * sizeof(uint64_t) +
+               entries.capacity() * sizeof(uint64_t) +
+               samples.capacity() * sizeof(uint32_t);
+    }
+};
+}
@@ -0,0 +1,382 @@
+#pragma once
+
+#include "DataStructure/Detail.h"
+#include "DataStructure/StringView.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+
+namespace ds {
+
+namespace detail {
+
+// One chunk of a RoaringBitmap: the low 16 bits of the members that share
+// their high 16 bits. It is stored in one of three ways, whichever is smaller:
+// a sorted array of values, a bitmap of all 2^16 values, or a sorted list of
+// runs of consecutive values. The operations are defined in
+// lib/RoaringBitmap.cpp.
+struct RoaringContainer {
+    enum class Kind : uint8_t { Array, Bitmap, Run };
+
+    // Arrays hold at most this many values, which take as much space as a
+    // bitmap. Containers that are not runs are always arrays below the limit
+    // and bitmaps above it.
+    static constexpr uint32_t MaxArraySize = 4096;
+    static constexpr size_t BitmapWords = 1024;
+
+    Kind kind = Kind::Array;
+    uint32_t card = 0;
+    // The sorted values of an array, or (start, length - 1) pairs for runs.
+    std::vector<uint16_t> values;
+    // The bits of a bitmap.
+    std::vector<uint64_t> words;
+
+    size_t numRuns() const { return values.size() / 2; }
+    uint32_t runStart(size_t i) const { return values[2 * i]; }
+    uint32_t runEnd(size_t i) const {
+        return uint32_t(values[2 * i]) + values[2 * i + 1];
+    }
+
+    bool test(uint16_t v) const {
+        switch (kind) {
+        case Kind::Array:
+            return std::binary_search(values.begin(), values.end(), v);
+        case Kind::Bitmap:
+            return (words[v / 64] >> (v % 64)) & 1;
+        case Kind::Run: {
+            // Find the last run that starts at or before v.
+            size_t lo = 0, hi = numRuns();
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (runStart(mid) <= v)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo != 0 && v <= runEnd(lo - 1);
+        }
+        }
+        return false;
+    }
+
+    // Return whether the container changed.
+    bool set(uint16_t v);
+    bool reset(uint16_t v);
+    // Sets [first, last].
+    void setRange(uint32_t first, uint32_t last);
+
+    // The number of values less than or equal to v, and the k-th smallest
+    // value.
+    uint32_t rank(uint16_t v) const;
+    uint16_t select(uint32_t k) const;
+    uint16_t minimum() const;
+    uint16_t maximum() const;
+
+    void unionWith(const RoaringContainer& rhs);
+    void intersectWith(const RoaringContainer& rhs);
+    void subtract(const RoaringContainer& rhs);
+    bool intersects(const RoaringContainer& rhs) const;
+    bool isSubsetOf(const RoaringContainer& rhs) const;
+    bool operator==(const RoaringContainer& rhs) const;
+
+    // Switches to runs, or back from them, whichever is smaller. Returns
+    // whether the kind changed.
+    bool runOptimize();
+    size_t getMemorySize() const {
+        return values.capacity() * sizeof(uint16_t) +
+               words.capacity() * sizeof(uint64_t);
+    }
+
+    // The bitmap representation, filled into buf unless this already is one.
+    const uint64_t* asBitmap(std::vector<uint64_t>& buf) const;
+    void toArray();
+    void toBitmap();
+    void toRuns();
+    // Converts arrays that grew too big to bitmaps and bitmaps that shrank to
+    // arrays.
+    void normalize();
+
+    // Calls fn(high | v) for every value v, in increasing order.
+    template <typename Fn>
+    void forEach(uint32_t high, Fn& fn) const {
+        switch (kind) {
+        case Kind::Array:
+            for (auto v : values)
+                fn(high | v);
+            break;
+        case Kind::Bitmap:
+            for (size_t i = 0; i != BitmapWords; ++i)
+                for (auto word = words[i]; word != 0; word &= word - 1)
+                    fn(high | uint32_t(i * 64 + findFirstSet(word)));
+            break;
+        case Kind::Run:
+            for (size_t i = 0, e = numRuns(); i != e; ++i)
+                for (uint32_t v = runStart(i), last = runEnd(i); v <= last;
+                     ++v)
+                    fn(high | v);
+            break;
+        }
+    }
+};
+}
+
+// A compressed set of 32-bit integers, following the Roaring bitmap format of
+// Lemire et al. The members are split into chunks by their high 16 bits, and
+// every chunk picks its own container: a sorted array when it is sparse, a
+// 2^16-bit bitmap when it is dense, and a list of runs when the members are
+// mostly consecutive. That keeps large ID sets whose density varies from
+// region to region small, where DynamicBitSet would pay for the whole universe
+// and DenseSet for every member.
+//
+// Bitmap containers are combined with the SIMD kernels of DynamicBitSet, and
+// arrays are intersected with SSE4.2 string compares when the host has them.
+// New containers are arrays or bitmaps, except that set_range() creates runs;
+// run_optimize() converts every container to runs where that is smaller.
+//
+// serialize() writes the portable format that the Roaring libraries share, so
+// bitmaps can be exchanged with CRoaring, the Java library and others.
+class RoaringBitmap {
+public:
+    using value_type = uint32_t;
+    using size_type = std::size_t;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+private:
+    using Container = detail::RoaringContainer;
+
+    // The high 16 bits of the members of every container, in increasing
+    // order. Containers are never empty.
+    std::vector<uint16_t> keys;
+    std::vector<Container> containers;
+
+    static uint16_t highBits(uint32_t v) {
+        return static_cast<uint16_t>(v >> 16);
+    }
+    static uint16_t lowBits(uint32_t v) { return static_cast<uint16_t>(v); }
+
+    // The index of the first container whose key is not less than key.
+    size_t lowerBound(uint16_t key) const {
+        // Members are often added in increasing order, so check the last
+        // container before searching.
+        if (keys.empty() || keys.back() < key)
+            return keys.size();
+        return std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+    }
+    // The container for key, created if missing.
+    Container& getOrInsert(uint16_t key);
+    void eraseEmpty();
+
+public:
+    RoaringBitmap() = default;
+    RoaringBitmap(std::initializer_list<uint32_t> ilist) {
+        for (auto v : ilist)
+            set(v);
+    }
+    template <typename InputIt>
+    RoaringBitmap(InputIt first, InputIt last) {
+        for (; first != last; ++first)
+            set(*first);
+    }
+
+    bool empty() const { return keys.empty(); }
+    void clear() {
+        keys.clear();
+        containers.clear();
+    }
+
+    // The number of members.
+    size_type count() const {
+        size_type ret = 0;
+        for (auto& c : containers)
+            ret += c.card;
+        return ret;
+    }
+
+    // The number of bytes allocated on the heap.
+    size_type getMemorySize() const;
+
+    bool test(uint32_t v) const {
+        auto i = lowerBound(highBits(v));
+        return i != keys.size() && keys[i] == highBits(v) &&
+               containers[i].test(lowBits(v));
+    }
+    void set(uint32_t v) { getOrInsert(highBits(v)).set(lowBits(v)); }
+    // Sets every value in [first, last].
+    void set_range(uint32_t first, uint32_t last);
+    void reset(uint32_t v);
+    // Sets v and returns whether it was set before.
+    bool test_set(uint32_t v) {
+        return !getOrInsert(highBits(v)).set(lowBits(v));
+    }
+
+    size_type find_first() const {
+        return empty() ? npos
+                       : (size_type(keys.front()) << 16) |
+                             containers.front().minimum();
+    }
+    size_type find_last() const {
+        return empty() ? npos
+                       : (size_type(keys.back()) << 16) |
+                             containers.back().maximum();
+    }
+
+    // The number of members less than or equal to v.
+    size_type rank(uint32_t v) const;
+    // The k-th smallest member, counting from 0. k has to be less than
+    // count().
+    uint32_t select(size_type k) const;
+
+    RoaringBitmap& operator|=(const RoaringBitmap& rhs);
+    RoaringBitmap& operator&=(const RoaringBitmap& rhs);
+    RoaringBitmap& operator-=(const RoaringBitmap& rhs);
+
+    // Whether this set and rhs have a member in common.
+    bool intersects(const RoaringBitmap& rhs) const;
+    // Whether every member of this set is a member of rhs.
+    bool is_subset_of(const RoaringBitmap& rhs) const;
+
+    bool operator==(const RoaringBitmap& rhs) const {
+        return keys == rhs.keys && containers == rhs.containers;
+    }
+    bool operator!=(const RoaringBitmap& rhs) const { return !(*this == rhs); }
+
+    // Converts every container to runs where that takes less space, and back
+    // where it does not. Returns whether any container changed.
+    bool run_optimize();
+
+    // The size of the serialized form, in bytes.
+    size_type getSerializedSize() const;
+    // Writes getSerializedSize() bytes to out, in the portable Roaring format.
+    void serialize(char* out) const;
+    // Reads a bitmap in the portable Roaring format. Throws
+    // std::invalid_argument if data is not a well-formed bitmap.
+    static RoaringBitmap deserialize(StringView data);
+
+    // Calls fn(v) for every member v, in increasing order. This is faster
+    // than going through the iterators.
+    template <typename Fn>
+    void for_each_set_bit(Fn fn) const {
+        for (size_t i = 0, e = keys.size(); i != e; ++i)
+            containers[i].forEach(uint32_t(keys[i]) << 16, fn);
+    }
+
+    // A forward iterator over the members, in increasing order.
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = uint32_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const uint32_t*;
+        using reference = uint32_t;
+
+    private:
+        const RoaringBitmap* bitmap;
+        size_t chunk;
+        // The position in the container: an array index, a word index or a run
+        // index.
+        size_t pos;
+        // The bits of the current word that are still to be visited.
+        uint64_t word;
+        uint32_t value;
+
+        void enterChunk() {
+            if (chunk == bitmap->keys.size()) {
+                value = 0;
+                return;
+            }
+            auto& c = bitmap->containers[chunk];
+            uint32_t high = uint32_t(bitmap->keys[chunk]) << 16;
+            pos = 0;
+            switch (c.kind) {
+            case Container::Kind::Array:
+                value = high | c.values[0];
+                break;
+            case Container::Kind::Bitmap:
+                while (c.words[pos] == 0)
+                    ++pos;
+                word = c.words[pos];
+                value = high | uint32_t(pos * 64 + detail::findFirstSet(word));
+                break;
+            case Container::Kind::Run:
+                value = high | c.runStart(0);
+                break;
+            }
+        }
+
+    public:
+        iterator(const RoaringBitmap* bitmap, size_t chunk)
+            : bitmap(bitmap), chunk(chunk), pos(0), word(0), value(0) {
+            enterChunk();
+        }
+
+        uint32_t operator*() const { return value; }
+
+        iterator& operator++() {
+            auto& c = bitmap->containers[chunk];
+            uint32_t high = value & 0xFFFF0000u;
+            switch (c.kind) {
+            case Container::Kind::Array:
+                if (++pos != c.card) {
+                    value = high | c.values[pos];
+                    return *this;
+                }
+                break;
+            case Container::Kind::Bitmap:
+                word &= word - 1;
+                while (word == 0 && ++pos != Container::BitmapWords)
+                    word = c.words[pos];
+                if (word != 0) {
+                    value = high |
+                            uint32_t(pos * 64 + detail::findFirstSet(word));
+                    return *this;
+                }
+                break;
+            case Container::Kind::Run:
+                if ((value & 0xFFFF) != c.runEnd(pos)) {
+                    ++value;
+                    return *this;
+                }
+                if (++pos != c.numRuns()) {
+                    value = high | c.runStart(pos);
+                    return *this;
+                }
+                break;
+            }
+            ++chunk;
+            enterChunk();
+            return *this;
+        }
+        iterator operator++(int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const iterator& rhs) const {
+            return chunk == rhs.chunk && value == rhs.value;
+        }
+        bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+    };
+    using const_iterator = iterator;
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, keys.size()); }
+};
+
+inline RoaringBitmap operator|(RoaringBitmap lhs, const RoaringBitmap& rhs) {
+    lhs |= rhs;
+    return lhs;
+}
+inline RoaringBitmap operator&(RoaringBitmap lhs, const RoaringBitmap& rhs) {
+    lhs &= rhs;
+    return lhs;
+}
+inline RoaringBitmap operator-(RoaringBitmap lhs, const RoaringBitmap& rhs) {
+    lhs -= rhs;
+    return lhs;
+}
+}
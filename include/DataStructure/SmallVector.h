@@ -1,79 +1,217 @@
 #pragma once
 
+#include "DataStructure/Allocator.h"
 #include "DataStructure/Detail.h"
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <initializer_list>
 #include <iterator>
+#include <limits>
 #include <memory>
 
 namespace ds {
 
-/// This is all the non-templated stuff common to all SmallVectors.
+template <typename T>
+class MutableArrayRef;
+
+/// This is all the stuff common to all SmallVectors that does not depend on
+/// the element type.
+///
+/// The header is a pointer to the elements plus their number and the capacity
+/// of the buffer, both counted in elements and stored as SizeT. With a 32-bit
+/// SizeT the header takes 16 bytes on 64-bit hosts instead of the 24 needed
+/// for three pointers, which adds up when vectors are embedded in many small
+/// objects.
+template <typename SizeT>
 class SmallVectorBase {
 protected:
-    void *BeginX, *EndX, *CapacityX;
+    void* BeginX;
+    SizeT Size, Capacity;
 
-protected:
-    SmallVectorBase(void* FirstEl, size_t Size)
-        : BeginX(FirstEl), EndX(FirstEl), CapacityX((char*)FirstEl + Size) {}
+    /// The maximum number of elements SizeT can describe.
+    static constexpr size_t SizeTypeMax() {
+        return std::numeric_limits<SizeT>::max();
+    }
 
-    /// This is an implementation of the grow() method which only works
-    /// on POD-like data types and is out of line to reduce code duplication.
-    void grow_pod(void* FirstEl, size_t MinSizeInBytes, size_t TSize);
+    SmallVectorBase(void* FirstEl, size_t TotalCapacity)
+        : BeginX(FirstEl), Size(0), Capacity(SizeT(TotalCapacity)) {}
+
+    /// Return the capacity the buffer should grow to in order to hold at least
+    /// MinSize elements, and at least one more element than it holds now. The
+    /// capacity grows by a factor of GrowthNum / GrowthDen, unless Exact is
+    /// set, in which case MinSize itself is returned. Throws
+    /// std::length_error if the result does not fit in SizeT. This is out of
+    /// line to reduce code duplication.
+    size_t getNewCapacity(size_t MinSize, bool Exact, unsigned GrowthNum,
+                          unsigned GrowthDen) const;
 
 public:
-    /// This returns size()*sizeof(T).
-    size_t size_in_bytes() const { return size_t((char*)EndX - (char*)BeginX); }
+    size_t size() const { return Size; }
+    size_t capacity() const { return Capacity; }
+
+    bool empty() const { return !Size; }
 
-    /// capacity_in_bytes - This returns capacity()*sizeof(T).
-    size_t capacity_in_bytes() const {
-        return size_t((char*)CapacityX - (char*)BeginX);
+    /// Set the array size to \p N, which the current array must have enough
+    /// capacity for.
+    ///
+    /// This does not construct or destroy any elements in the vector.
+    ///
+    /// Clients can use this in conjunction with capacity() to write past the
+    /// end of the buffer when they know that more elements are available, and
+    /// only update the size later. This avoids the cost of value initializing
+    /// elements which will only be overwritten.
+    void set_size(size_t N) {
+        assert(N <= capacity());
+        Size = SizeT(N);
     }
+};
+
+extern template class SmallVectorBase<uint32_t>;
+extern template class SmallVectorBase<uint64_t>;
 
-    bool empty() const { return BeginX == EndX; }
+/// The type SmallVector<T> uses for its size and capacity. It is 32 bits wide
+/// unless T is smaller than 4 bytes, where that would cap the buffer at 4GB or
+/// less (think of a SmallVector<char> holding a file). Specialize this for a
+/// type whose vectors may hold more than 2^32 elements:
+///
+///   template <> struct SmallVectorSizeType<Huge> { using type = uint64_t; };
+template <typename T>
+struct SmallVectorSizeType {
+    using type = typename std::conditional<sizeof(T) < 4 && sizeof(void*) >= 8,
+                                           uint64_t, uint32_t>::type;
 };
 
-template <typename T, unsigned N>
-struct SmallVectorStorage;
+/// The alignment of the inline elements: that of T, or more if the
+/// allocation policy asks for it (see AlignedAllocator).
+template <typename T, typename AllocT>
+struct SmallVectorInlineAlignment {
+    static constexpr size_t value =
+        std::max(alignof(T), detail::MinAlignmentOf<AllocT>::value);
+};
+
+/// Figure out the offset of the first inline element. This mirrors the layout
+/// of SmallVectorTemplateCommon followed by SmallVectorStorage, with the
+/// allocator taking no space if it is empty.
+template <typename T, typename AllocT, bool = std::is_empty<AllocT>::value>
+struct SmallVectorAlignmentAndSize {
+    using Base = SmallVectorBase<typename SmallVectorSizeType<T>::type>;
+    alignas(Base) char Header[sizeof(Base)];
+    alignas(SmallVectorInlineAlignment<T, AllocT>::value) char
+        FirstEl[sizeof(T)];
+};
+template <typename T, typename AllocT>
+struct SmallVectorAlignmentAndSize<T, AllocT, false> {
+    using Base = SmallVectorBase<typename SmallVectorSizeType<T>::type>;
+    alignas(Base) char Header[sizeof(Base)];
+    alignas(AllocT) char Alloc[sizeof(AllocT)];
+    alignas(SmallVectorInlineAlignment<T, AllocT>::value) char
+        FirstEl[sizeof(T)];
+};
 
 /// This is the part of SmallVectorTemplateBase which does not depend on whether
-/// the type T is a POD. The extra dummy template argument is used by ArrayRef
-/// to avoid unnecessarily requiring T to be complete.
-template <typename T, typename = void>
-class SmallVectorTemplateCommon : public SmallVectorBase {
+/// the type T is a POD. AllocT is the allocation policy (see Allocator.h) used
+/// once the elements no longer fit in the inline buffer; it is kept as a base
+/// class so that stateless policies take no space. The extra dummy template
+/// argument is used by ArrayRef to avoid unnecessarily requiring T to be
+/// complete.
+template <typename T, typename AllocT = MallocAllocator, typename = void>
+class SmallVectorTemplateCommon
+    : public SmallVectorBase<typename SmallVectorSizeType<T>::type>,
+      private AllocT {
 private:
-    template <typename, unsigned>
-    friend struct SmallVectorStorage;
-
-    // Allocate raw space for N elements of type T.  If T has a ctor or dtor, we
-    // don't want it to be automatically run, so we need to represent the space
-    // as something else.  Use an array of char of sufficient alignment.
-    using U = std::aligned_storage_t<sizeof(T), alignof(T)>;
-    U FirstEl;
-    // Space after 'FirstEl' is clobbered, do not add any instance vars after
-    // it.
+    using Base = SmallVectorBase<typename SmallVectorSizeType<T>::type>;
+
+    /// Find the address of the first inline element. The inline buffer lives
+    /// in the SmallVector right after this object, see SmallVectorStorage.
+    /// Without inline elements that address lies past the end of the vector,
+    /// so it is computed on integers rather than by indexing off 'this'.
+    void* getFirstEl() const {
+        using Layout = SmallVectorAlignmentAndSize<T, AllocT>;
+        return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(this) +
+                                       offsetof(Layout, FirstEl));
+    }
+    // The inline elements follow right after this object, so none of the
+    // derived classes may add instance vars.
 
 protected:
-    SmallVectorTemplateCommon(size_t Size) : SmallVectorBase(&FirstEl, Size) {}
+    SmallVectorTemplateCommon(size_t Size, const AllocT& A)
+        : Base(getFirstEl(), Size), AllocT(A) {}
+
+    /// Return the capacity to grow to, see SmallVectorBase::getNewCapacity().
+    /// The growth factor comes from the allocation policy.
+    size_t getNewCapacity(size_t MinSize, bool Exact) const {
+        using Factor = detail::GrowthFactorOf<AllocT>;
+        return Base::getNewCapacity(MinSize, Exact, Factor::Numerator,
+                                    Factor::Denominator);
+    }
+
+    /// Install NewElts, a heap buffer of NewCapacity elements, as the
+    /// vector's buffer. Any slack the allocator reports at the end of the
+    /// block becomes usable capacity.
+    void setHeapBuffer(void* NewElts, size_t NewCapacity) {
+        size_t UsableBytes = detail::getUsableSize(
+            getAllocator(), NewElts, NewCapacity * sizeof(T));
+        this->BeginX = NewElts;
+        this->Capacity =
+            std::min(UsableBytes / sizeof(T), this->SizeTypeMax());
+    }
+
+    /// Return NewElts, a heap block of NewBytes bytes whose first UsedBytes
+    /// are in use, or a copy of it if it sits where the inline elements
+    /// would. Without inline elements getFirstEl() points one past the end
+    /// of the vector, and an allocator handing out the memory right after it
+    /// (say, a BumpPtrAllocator the vector itself lives in) can return that
+    /// very address, which isSmall() would take for the inline buffer.
+    /// The addresses are compared as integers, so that the compiler does not
+    /// conclude that the block freed below is the inline buffer.
+    void* avoidFirstEl(void* NewElts, size_t NewBytes, size_t UsedBytes) {
+        if (reinterpret_cast<uintptr_t>(NewElts) !=
+            reinterpret_cast<uintptr_t>(getFirstEl()))
+            return NewElts;
+        // Allocate the replacement before freeing the block, or the
+        // allocator could hand out the same address again.
+        void* Replacement = getAllocator().allocate(NewBytes, alignof(T));
+        memcpy(Replacement, NewElts, UsedBytes);
+        getAllocator().deallocate(NewElts, NewBytes);
+        return Replacement;
+    }
+
+    /// Return where Elt went if insert() just moved [I, end() - 1) up by
+    /// one, and Elt itself otherwise. Elt is usually unrelated to the buffer,
+    /// so the addresses are compared as integers, and the moved element is
+    /// addressed through I rather than by stepping off Elt.
+    template <typename U>
+    U* shiftedIfInRange(U* Elt, T* I) {
+        auto Addr = reinterpret_cast<uintptr_t>(Elt);
+        auto Begin = reinterpret_cast<uintptr_t>(I);
+        if (Addr < Begin || Addr >= reinterpret_cast<uintptr_t>(end()))
+            return Elt;
+        return I + (Addr - Begin) / sizeof(T) + 1;
+    }
 
-    void grow_pod(size_t MinSizeInBytes, size_t TSize) {
-        SmallVectorBase::grow_pod(&FirstEl, MinSizeInBytes, TSize);
+    /// This is an implementation of the grow() method which only works
+    /// on POD-like data types.
+    void grow_pod(size_t MinSize, bool Exact = false);
+
+    /// Release the heap buffer, if any. Does not destroy any elements.
+    void deallocateBuffer() {
+        if (!isSmall())
+            getAllocator().deallocate(this->BeginX, this->capacity_in_bytes());
     }
 
     /// Return true if this is a smallvector which has not had dynamic
     /// memory allocated for it.
-    bool isSmall() const {
-        return BeginX == static_cast<const void*>(&FirstEl);
-    }
+    bool isSmall() const { return this->BeginX == getFirstEl(); }
 
     /// Put this vector in a state of being small.
-    void resetToSmall() { BeginX = EndX = CapacityX = &FirstEl; }
-
-    void setEnd(T* P) { this->EndX = P; }
+    void resetToSmall() {
+        this->BeginX = getFirstEl();
+        this->Size = this->Capacity = 0;
+    }
 
 public:
     typedef size_t size_type;
@@ -90,20 +228,20 @@ public:
     typedef T* pointer;
     typedef const T* const_pointer;
 
+    using Base::capacity;
+    using Base::empty;
+    using Base::size;
+
+    AllocT& getAllocator() { return *this; }
+    const AllocT& getAllocator() const { return *this; }
+
     // forward iterator creation methods.
 
     iterator begin() { return (iterator)this->BeginX; }
     const_iterator begin() const { return (const_iterator)this->BeginX; }
-    iterator end() { return (iterator)this->EndX; }
-    const_iterator end() const { return (const_iterator)this->EndX; }
-
-protected:
-    iterator capacity_ptr() { return (iterator)this->CapacityX; }
-    const_iterator capacity_ptr() const {
-        return (const_iterator)this->CapacityX;
-    }
+    iterator end() { return begin() + size(); }
+    const_iterator end() const { return begin() + size(); }
 
-public:
     // reverse iterator creation methods.
     reverse_iterator rbegin() { return reverse_iterator(end()); }
     const_reverse_iterator rbegin() const {
@@ -114,11 +252,13 @@ public:
         return const_reverse_iterator(begin());
     }
 
-    size_type size() const { return end() - begin(); }
-    size_type max_size() const { return size_type(-1) / sizeof(T); }
+    size_type size_in_bytes() const { return size() * sizeof(T); }
+    size_type max_size() const {
+        return std::min(this->SizeTypeMax(), size_type(-1) / sizeof(T));
+    }
 
-    /// Return the total number of elements in the currently allocated buffer.
-    size_t capacity() const { return capacity_ptr() - begin(); }
+    /// Return the total number of bytes in the currently allocated buffer.
+    size_t capacity_in_bytes() const { return capacity() * sizeof(T); }
 
     /// Return a pointer to the vector's buffer, even if empty().
     pointer data() { return pointer(begin()); }
@@ -153,12 +293,37 @@ public:
     }
 };
 
+template <typename T, typename AllocT, typename Dummy>
+void SmallVectorTemplateCommon<T, AllocT, Dummy>::grow_pod(size_t MinSize,
+                                                           bool Exact) {
+    size_t NewCapacity = this->getNewCapacity(MinSize, Exact);
+
+    void* NewElts;
+    if (isSmall()) {
+        NewElts = avoidFirstEl(
+            getAllocator().allocate(NewCapacity * sizeof(T), alignof(T)),
+            NewCapacity * sizeof(T), 0);
+
+        // Copy the elements over.  No need to run dtors on PODs.
+        memcpy(NewElts, this->BeginX, size_in_bytes());
+    } else {
+        // If this wasn't grown from the inline copy, grow the allocated space.
+        NewElts = avoidFirstEl(
+            getAllocator().reallocate(this->BeginX, capacity_in_bytes(),
+                                      NewCapacity * sizeof(T), alignof(T)),
+            NewCapacity * sizeof(T), size_in_bytes());
+    }
+
+    setHeapBuffer(NewElts, NewCapacity);
+}
+
 /// SmallVectorTemplateBase<isPodLike = false> - This is where we put method
 /// implementations that are designed to work with non-POD-like T's.
-template <typename T, bool isPodLike>
-class SmallVectorTemplateBase : public SmallVectorTemplateCommon<T> {
+template <typename T, typename AllocT, bool isPodLike>
+class SmallVectorTemplateBase : public SmallVectorTemplateCommon<T, AllocT> {
 protected:
-    SmallVectorTemplateBase(size_t Size) : SmallVectorTemplateCommon<T>(Size) {}
+    SmallVectorTemplateBase(size_t Size, const AllocT& A)
+        : SmallVectorTemplateCommon<T, AllocT>(Size, A) {}
 
     static void destroy_range(T* S, T* E) {
         while (S != E) {
@@ -186,40 +351,46 @@ protected:
 
     /// Grow the allocated memory (without initializing new elements), doubling
     /// the size of the allocated memory. Guarantees space for at least one more
-    /// element, or MinSize more elements if specified.
-    void grow(size_t MinSize = 0);
+    /// element, or MinSize more elements if specified. If Exact is set, the
+    /// new capacity is exactly MinSize.
+    void grow(size_t MinSize = 0, bool Exact = false);
 
 public:
     void push_back(const T& Elt) {
-        if (this->EndX >= this->CapacityX)
+        if (this->size() >= this->capacity())
             this->grow();
         ::new ((void*)this->end()) T(Elt);
-        this->setEnd(this->end() + 1);
+        this->set_size(this->size() + 1);
     }
 
     void push_back(T&& Elt) {
-        if (this->EndX >= this->CapacityX)
+        if (this->size() >= this->capacity())
             this->grow();
         ::new ((void*)this->end()) T(::std::move(Elt));
-        this->setEnd(this->end() + 1);
+        this->set_size(this->size() + 1);
     }
 
     void pop_back() {
-        this->setEnd(this->end() - 1);
+        this->set_size(this->size() - 1);
         this->end()->~T();
     }
 };
 
 // Define this out-of-line to dissuade the C++ compiler from inlining it.
-template <typename T, bool isPodLike>
-void SmallVectorTemplateBase<T, isPodLike>::grow(size_t MinSize) {
-    size_t CurCapacity = this->capacity();
-    size_t CurSize = this->size();
-    // Always grow, even from zero.
-    size_t NewCapacity = size_t(detail::nextPowerOfTwo(CurCapacity + 2));
-    if (NewCapacity < MinSize)
-        NewCapacity = MinSize;
-    T* NewElts = static_cast<T*>(malloc(NewCapacity * sizeof(T)));
+template <typename T, typename AllocT, bool isPodLike>
+void SmallVectorTemplateBase<T, AllocT, isPodLike>::grow(size_t MinSize,
+                                                         bool Exact) {
+    // Elements that can be relocated with memcpy take the same path as PODs,
+    // which lets the allocator extend the buffer in place.
+    if (detail::isTriviallyRelocatable<T>::value) {
+        this->grow_pod(MinSize, Exact);
+        return;
+    }
+
+    size_t NewCapacity = this->getNewCapacity(MinSize, Exact);
+    T* NewElts = static_cast<T*>(this->avoidFirstEl(
+        this->getAllocator().allocate(NewCapacity * sizeof(T), alignof(T)),
+        NewCapacity * sizeof(T), 0));
 
     // Move the elements over.
     this->uninitialized_move(this->begin(), this->end(), NewElts);
@@ -228,20 +399,19 @@ void SmallVectorTemplateBase<T, isPodLike>::grow(size_t MinSize) {
     destroy_range(this->begin(), this->end());
 
     // If this wasn't grown from the inline copy, deallocate the old space.
-    if (!this->isSmall())
-        free(this->begin());
+    this->deallocateBuffer();
 
-    this->setEnd(NewElts + CurSize);
-    this->BeginX = NewElts;
-    this->CapacityX = this->begin() + NewCapacity;
+    this->setHeapBuffer(NewElts, NewCapacity);
 }
 
 /// SmallVectorTemplateBase<isPodLike = true> - This is where we put method
 /// implementations that are designed to work with POD-like T's.
-template <typename T>
-class SmallVectorTemplateBase<T, true> : public SmallVectorTemplateCommon<T> {
+template <typename T, typename AllocT>
+class SmallVectorTemplateBase<T, AllocT, true>
+    : public SmallVectorTemplateCommon<T, AllocT> {
 protected:
-    SmallVectorTemplateBase(size_t Size) : SmallVectorTemplateCommon<T>(Size) {}
+    SmallVectorTemplateBase(size_t Size, const AllocT& A)
+        : SmallVectorTemplateCommon<T, AllocT>(Size, A) {}
 
     // No need to do a destroy loop for POD's.
     static void destroy_range(T*, T*) {}
@@ -279,28 +449,30 @@ protected:
     }
 
     /// Double the size of the allocated memory, guaranteeing space for at
-    /// least one more element or MinSize if specified.
-    void grow(size_t MinSize = 0) {
-        this->grow_pod(MinSize * sizeof(T), sizeof(T));
+    /// least one more element or MinSize if specified. If Exact is set, the
+    /// new capacity is exactly MinSize.
+    void grow(size_t MinSize = 0, bool Exact = false) {
+        this->grow_pod(MinSize, Exact);
     }
 
 public:
     void push_back(const T& Elt) {
-        if (this->EndX >= this->CapacityX)
+        if (this->size() >= this->capacity())
             this->grow();
         memcpy(this->end(), &Elt, sizeof(T));
-        this->setEnd(this->end() + 1);
+        this->set_size(this->size() + 1);
     }
 
-    void pop_back() { this->setEnd(this->end() - 1); }
+    void pop_back() { this->set_size(this->size() - 1); }
 };
 
 /// This class consists of common code factored out of the SmallVector class to
 /// reduce code duplication based on the SmallVector 'N' template parameter.
-template <typename T>
+template <typename T, typename AllocT = MallocAllocator>
 class SmallVectorImpl
-    : public SmallVectorTemplateBase<T, detail::isPodLike<T>::value> {
-    typedef SmallVectorTemplateBase<T, detail::isPodLike<T>::value> SuperClass;
+    : public SmallVectorTemplateBase<T, AllocT, detail::isPodLike<T>::value> {
+    typedef SmallVectorTemplateBase<T, AllocT, detail::isPodLike<T>::value>
+        SuperClass;
 
     SmallVectorImpl(const SmallVectorImpl&) = delete;
 
@@ -311,9 +483,8 @@ public:
 
 protected:
     // Default ctor - Initialize to empty.
-    explicit SmallVectorImpl(unsigned N)
-        : SmallVectorTemplateBase<T, detail::isPodLike<T>::value>(N *
-                                                                  sizeof(T)) {}
+    explicit SmallVectorImpl(unsigned N, const AllocT& A)
+        : SuperClass(N, A) {}
 
 public:
     ~SmallVectorImpl() {
@@ -321,37 +492,50 @@ public:
         this->destroy_range(this->begin(), this->end());
 
         // If this wasn't grown from the inline copy, deallocate the old space.
-        if (!this->isSmall())
-            free(this->begin());
+        this->deallocateBuffer();
     }
 
     void clear() {
         this->destroy_range(this->begin(), this->end());
-        this->EndX = this->BeginX;
+        this->Size = 0;
     }
 
-    void resize(size_type N) {
+private:
+    template <bool ForOverwrite>
+    void resizeImpl(size_type N) {
         if (N < this->size()) {
             this->destroy_range(this->begin() + N, this->end());
-            this->setEnd(this->begin() + N);
+            this->set_size(N);
         } else if (N > this->size()) {
             if (this->capacity() < N)
                 this->grow(N);
             for (auto I = this->end(), E = this->begin() + N; I != E; ++I)
-                new (&*I) T();
-            this->setEnd(this->begin() + N);
+                if (ForOverwrite)
+                    new (&*I) T;
+                else
+                    new (&*I) T();
+            this->set_size(N);
         }
     }
 
+public:
+    void resize(size_type N) { resizeImpl<false>(N); }
+
+    /// Like resize(), but default-initialize the new elements instead of
+    /// value-initializing them. For trivial types such as char this leaves
+    /// them uninitialized, which saves zeroing a buffer that is about to be
+    /// overwritten, e.g. by read() or memcpy().
+    void resize_for_overwrite(size_type N) { resizeImpl<true>(N); }
+
     void resize(size_type N, const T& NV) {
         if (N < this->size()) {
             this->destroy_range(this->begin() + N, this->end());
-            this->setEnd(this->begin() + N);
+            this->set_size(N);
         } else if (N > this->size()) {
             if (this->capacity() < N)
                 this->grow(N);
             std::uninitialized_fill(this->end(), this->begin() + N, NV);
-            this->setEnd(this->begin() + N);
+            this->set_size(N);
         }
     }
 
@@ -360,6 +544,13 @@ public:
             this->grow(N);
     }
 
+    /// Like reserve(), but allocate room for exactly N elements rather than
+    /// following the growth policy. Use it when the final size is known.
+    void reserve_exact(size_type N) {
+        if (this->capacity() < N)
+            this->grow(N, /*Exact=*/true);
+    }
+
     T pop_back_val() {
         T Result = ::std::move(this->back());
         this->pop_back();
@@ -373,32 +564,42 @@ public:
     void append(in_iter in_start, in_iter in_end) {
         size_type NumInputs = std::distance(in_start, in_end);
         // Grow allocated space if needed.
-        if (NumInputs > size_type(this->capacity_ptr() - this->end()))
+        if (NumInputs > this->capacity() - this->size())
             this->grow(this->size() + NumInputs);
 
         // Copy the new elements over.
         this->uninitialized_copy(in_start, in_end, this->end());
-        this->setEnd(this->end() + NumInputs);
+        this->set_size(this->size() + NumInputs);
     }
 
     /// Add the specified range to the end of the SmallVector.
     void append(size_type NumInputs, const T& Elt) {
         // Grow allocated space if needed.
-        if (NumInputs > size_type(this->capacity_ptr() - this->end()))
+        if (NumInputs > this->capacity() - this->size())
             this->grow(this->size() + NumInputs);
 
         // Copy the new elements over.
         std::uninitialized_fill_n(this->end(), NumInputs, Elt);
-        this->setEnd(this->end() + NumInputs);
+        this->set_size(this->size() + NumInputs);
     }
 
     void append(std::initializer_list<T> IL) { append(IL.begin(), IL.end()); }
 
+    /// Add N default-initialized elements to the end of the SmallVector and
+    /// return them, so that they can be filled in directly. For trivial types
+    /// the elements are left uninitialized. The returned range is invalidated
+    /// by the next operation that grows the vector.
+    MutableArrayRef<T> append_uninitialized(size_type N) {
+        size_type OldSize = this->size();
+        resize_for_overwrite(OldSize + N);
+        return MutableArrayRef<T>(this->begin() + OldSize, N);
+    }
+
     void assign(size_type NumElts, const T& Elt) {
         clear();
         if (this->capacity() < NumElts)
             this->grow(NumElts);
-        this->setEnd(this->begin() + NumElts);
+        this->set_size(NumElts);
         std::uninitialized_fill(this->begin(), this->end(), Elt);
     }
 
@@ -436,7 +637,7 @@ public:
         iterator I = std::move(E, this->end(), S);
         // Drop the last elts.
         this->destroy_range(I, this->end());
-        this->setEnd(I);
+        this->set_size(I - this->begin());
         return (N);
     }
 
@@ -449,7 +650,7 @@ public:
         assert(I >= this->begin() && "Insertion iterator is out of bounds.");
         assert(I <= this->end() && "Inserting past the end of the vector.");
 
-        if (this->EndX >= this->CapacityX) {
+        if (this->size() >= this->capacity()) {
             size_t EltNo = I - this->begin();
             this->grow();
             I = this->begin() + EltNo;
@@ -458,13 +659,11 @@ public:
         ::new ((void*)this->end()) T(::std::move(this->back()));
         // Push everything else over.
         std::move_backward(I, this->end() - 1, this->end());
-        this->setEnd(this->end() + 1);
+        this->set_size(this->size() + 1);
 
         // If we just moved the element we're inserting, be sure to update
         // the reference.
-        T* EltPtr = &Elt;
-        if (I <= EltPtr && EltPtr < this->EndX)
-            ++EltPtr;
+        T* EltPtr = this->shiftedIfInRange(&Elt, I);
 
         *I = ::std::move(*EltPtr);
         return I;
@@ -479,7 +678,7 @@ public:
         assert(I >= this->begin() && "Insertion iterator is out of bounds.");
         assert(I <= this->end() && "Inserting past the end of the vector.");
 
-        if (this->EndX >= this->CapacityX) {
+        if (this->size() >= this->capacity()) {
             size_t EltNo = I - this->begin();
             this->grow();
             I = this->begin() + EltNo;
@@ -487,13 +686,11 @@ public:
         ::new ((void*)this->end()) T(std::move(this->back()));
         // Push everything else over.
         std::move_backward(I, this->end() - 1, this->end());
-        this->setEnd(this->end() + 1);
+        this->set_size(this->size() + 1);
 
         // If we just moved the element we're inserting, be sure to update
         // the reference.
-        const T* EltPtr = &Elt;
-        if (I <= EltPtr && EltPtr < this->EndX)
-            ++EltPtr;
+        const T* EltPtr = this->shiftedIfInRange(&Elt, I);
 
         *I = *EltPtr;
         return I;
@@ -541,7 +738,7 @@ public:
 
         // Move over the elements that we're about to overwrite.
         T* OldEnd = this->end();
-        this->setEnd(this->end() + NumToInsert);
+        this->set_size(this->size() + NumToInsert);
         size_t NumOverwritten = OldEnd - I;
         this->uninitialized_move(I, OldEnd, this->end() - NumOverwritten);
 
@@ -598,7 +795,7 @@ public:
 
         // Move over the elements that we're about to overwrite.
         T* OldEnd = this->end();
-        this->setEnd(this->end() + NumToInsert);
+        this->set_size(this->size() + NumToInsert);
         size_t NumOverwritten = OldEnd - I;
         this->uninitialized_move(I, OldEnd, this->end() - NumOverwritten);
 
@@ -620,10 +817,10 @@ public:
 
     template <typename... ArgTypes>
     void emplace_back(ArgTypes&&... Args) {
-        if (this->EndX >= this->CapacityX)
+        if (this->size() >= this->capacity())
             this->grow();
         ::new ((void*)this->end()) T(std::forward<ArgTypes>(Args)...);
-        this->setEnd(this->end() + 1);
+        this->set_size(this->size() + 1);
     }
 
     SmallVectorImpl& operator=(const SmallVectorImpl& RHS);
@@ -643,34 +840,20 @@ public:
         return std::lexicographical_compare(this->begin(), this->end(),
                                             RHS.begin(), RHS.end());
     }
-
-    /// Set the array size to \p N, which the current array must have enough
-    /// capacity for.
-    ///
-    /// This does not construct or destroy any elements in the vector.
-    ///
-    /// Clients can use this in conjunction with capacity() to write past the
-    /// end
-    /// of the buffer when they know that more elements are available, and only
-    /// update the size later. This avoids the cost of value initializing
-    /// elements
-    /// which will only be overwritten.
-    void set_size(size_type N) {
-        assert(N <= this->capacity());
-        this->setEnd(this->begin() + N);
-    }
 };
 
-template <typename T>
-void SmallVectorImpl<T>::swap(SmallVectorImpl<T>& RHS) {
+template <typename T, typename AllocT>
+void SmallVectorImpl<T, AllocT>::swap(SmallVectorImpl<T, AllocT>& RHS) {
     if (this == &RHS)
         return;
 
-    // We can only avoid copying elements if neither vector is small.
+    // We can only avoid copying elements if neither vector is small. The
+    // allocators go along with their buffers.
     if (!this->isSmall() && !RHS.isSmall()) {
         std::swap(this->BeginX, RHS.BeginX);
-        std::swap(this->EndX, RHS.EndX);
-        std::swap(this->CapacityX, RHS.CapacityX);
+        std::swap(this->Size, RHS.Size);
+        std::swap(this->Capacity, RHS.Capacity);
+        std::swap(this->getAllocator(), RHS.getAllocator());
         return;
     }
     if (RHS.size() > this->capacity())
@@ -685,27 +868,27 @@ void SmallVectorImpl<T>::swap(SmallVectorImpl<T>& RHS) {
     for (size_type i = 0; i != NumShared; ++i)
         std::swap((*this)[i], RHS[i]);
 
-    // Copy over the extra elts.
+    // Move over the extra elts, so that move-only types can be swapped too.
     if (this->size() > RHS.size()) {
         size_t EltDiff = this->size() - RHS.size();
-        this->uninitialized_copy(this->begin() + NumShared, this->end(),
+        this->uninitialized_move(this->begin() + NumShared, this->end(),
                                  RHS.end());
-        RHS.setEnd(RHS.end() + EltDiff);
+        RHS.set_size(RHS.size() + EltDiff);
         this->destroy_range(this->begin() + NumShared, this->end());
-        this->setEnd(this->begin() + NumShared);
+        this->set_size(NumShared);
     } else if (RHS.size() > this->size()) {
         size_t EltDiff = RHS.size() - this->size();
-        this->uninitialized_copy(RHS.begin() + NumShared, RHS.end(),
+        this->uninitialized_move(RHS.begin() + NumShared, RHS.end(),
                                  this->end());
-        this->setEnd(this->end() + EltDiff);
+        this->set_size(this->size() + EltDiff);
         this->destroy_range(RHS.begin() + NumShared, RHS.end());
-        RHS.setEnd(RHS.begin() + NumShared);
+        RHS.set_size(NumShared);
     }
 }
 
-template <typename T>
-SmallVectorImpl<T>& SmallVectorImpl<T>::
-operator=(const SmallVectorImpl<T>& RHS) {
+template <typename T, typename AllocT>
+SmallVectorImpl<T, AllocT>& SmallVectorImpl<T, AllocT>::
+operator=(const SmallVectorImpl<T, AllocT>& RHS) {
     // Avoid self-assignment.
     if (this == &RHS)
         return *this;
@@ -727,7 +910,7 @@ operator=(const SmallVectorImpl<T>& RHS) {
         this->destroy_range(NewEnd, this->end());
 
         // Trim.
-        this->setEnd(NewEnd);
+        this->set_size(NewEnd - this->begin());
         return *this;
     }
 
@@ -737,7 +920,7 @@ operator=(const SmallVectorImpl<T>& RHS) {
     if (this->capacity() < RHSSize) {
         // Destroy current elements.
         this->destroy_range(this->begin(), this->end());
-        this->setEnd(this->begin());
+        this->set_size(0);
         CurSize = 0;
         this->grow(RHSSize);
     } else if (CurSize) {
@@ -750,24 +933,26 @@ operator=(const SmallVectorImpl<T>& RHS) {
                              this->begin() + CurSize);
 
     // Set end.
-    this->setEnd(this->begin() + RHSSize);
+    this->set_size(RHSSize);
     return *this;
 }
 
-template <typename T>
-SmallVectorImpl<T>& SmallVectorImpl<T>::operator=(SmallVectorImpl<T>&& RHS) {
+template <typename T, typename AllocT>
+SmallVectorImpl<T, AllocT>& SmallVectorImpl<T, AllocT>::
+operator=(SmallVectorImpl<T, AllocT>&& RHS) {
     // Avoid self-assignment.
     if (this == &RHS)
         return *this;
 
-    // If the RHS isn't small, clear this vector and then steal its buffer.
+    // If the RHS isn't small, clear this vector and then steal its buffer
+    // together with the allocator that owns it.
     if (!RHS.isSmall()) {
         this->destroy_range(this->begin(), this->end());
-        if (!this->isSmall())
-            free(this->begin());
+        this->deallocateBuffer();
+        this->getAllocator() = RHS.getAllocator();
         this->BeginX = RHS.BeginX;
-        this->EndX = RHS.EndX;
-        this->CapacityX = RHS.CapacityX;
+        this->Size = RHS.Size;
+        this->Capacity = RHS.Capacity;
         RHS.resetToSmall();
         return *this;
     }
@@ -784,7 +969,7 @@ SmallVectorImpl<T>& SmallVectorImpl<T>::operator=(SmallVectorImpl<T>&& RHS) {
 
         // Destroy excess elements and trim the bounds.
         this->destroy_range(NewEnd, this->end());
-        this->setEnd(NewEnd);
+        this->set_size(NewEnd - this->begin());
 
         // Clear the RHS.
         RHS.clear();
@@ -799,7 +984,7 @@ SmallVectorImpl<T>& SmallVectorImpl<T>::operator=(SmallVectorImpl<T>&& RHS) {
     if (this->capacity() < RHSSize) {
         // Destroy current elements.
         this->destroy_range(this->begin(), this->end());
-        this->setEnd(this->begin());
+        this->set_size(0);
         CurSize = 0;
         this->grow(RHSSize);
     } else if (CurSize) {
@@ -812,24 +997,20 @@ SmallVectorImpl<T>& SmallVectorImpl<T>::operator=(SmallVectorImpl<T>&& RHS) {
                              this->begin() + CurSize);
 
     // Set end.
-    this->setEnd(this->begin() + RHSSize);
+    this->set_size(RHSSize);
 
     RHS.clear();
     return *this;
 }
 
-/// Storage for the SmallVector elements which aren't contained in
-/// SmallVectorTemplateCommon. There are 'N-1' elements here. The remaining '1'
-/// element is in the base class. This is specialized for the N=1 and N=0 cases
-/// to avoid allocating unnecessary storage.
-template <typename T, unsigned N>
+/// Storage for the SmallVector elements which are stored in place. It is a
+/// base class of SmallVector, so that it takes no space when N is 0.
+template <typename T, unsigned N, size_t Align = alignof(T)>
 struct SmallVectorStorage {
-    typename SmallVectorTemplateCommon<T>::U InlineElts[N - 1];
+    alignas(Align) char InlineElts[N * sizeof(T)];
 };
-template <typename T>
-struct SmallVectorStorage<T, 1> {};
-template <typename T>
-struct SmallVectorStorage<T, 0> {};
+template <typename T, size_t Align>
+struct alignas(T) SmallVectorStorage<T, 0, Align> {};
 
 /// This is a 'vector' (really, a variable-sized array), optimized
 /// for the case when the array is small.  It contains some number of elements
@@ -837,57 +1018,67 @@ struct SmallVectorStorage<T, 0> {};
 /// elements is below that threshold.  This allows normal "small" cases to be
 /// fast without losing generality for large inputs.
 ///
+/// Elements that do not fit in place are stored in memory obtained from AllocT,
+/// which defaults to malloc. Use ArenaAllocator to spill into a
+/// BumpPtrAllocator instead, or AlignedAllocator to over-align both the inline
+/// and the heap buffer.
+///
 /// Note that this does not attempt to be exception safe.
 ///
-template <typename T, unsigned N>
-class SmallVector : public SmallVectorImpl<T> {
-    /// Inline space for elements which aren't stored in the base class.
-    SmallVectorStorage<T, N> Storage;
+template <typename T, unsigned N, typename AllocT = MallocAllocator>
+class SmallVector
+    : public SmallVectorImpl<T, AllocT>,
+      SmallVectorStorage<T, N, SmallVectorInlineAlignment<T, AllocT>::value> {
+    typedef SmallVectorImpl<T, AllocT> Impl;
 
 public:
-    SmallVector() : SmallVectorImpl<T>(N) {}
+    SmallVector() : Impl(N, AllocT()) {}
 
-    explicit SmallVector(size_t Size, const T& Value = T())
-        : SmallVectorImpl<T>(N) {
+    explicit SmallVector(const AllocT& A) : Impl(N, A) {}
+
+    explicit SmallVector(size_t Size, const T& Value = T(),
+                         const AllocT& A = AllocT())
+        : Impl(N, A) {
         this->assign(Size, Value);
     }
 
     template <typename ItTy>
-    SmallVector(ItTy S, ItTy E) : SmallVectorImpl<T>(N) {
+    SmallVector(ItTy S, ItTy E, const AllocT& A = AllocT()) : Impl(N, A) {
         this->append(S, E);
     }
 
-    SmallVector(std::initializer_list<T> IL) : SmallVectorImpl<T>(N) {
+    SmallVector(std::initializer_list<T> IL, const AllocT& A = AllocT())
+        : Impl(N, A) {
         this->assign(IL);
     }
 
-    SmallVector(const SmallVector& RHS) : SmallVectorImpl<T>(N) {
+    SmallVector(const SmallVector& RHS) : Impl(N, RHS.getAllocator()) {
         if (!RHS.empty())
-            SmallVectorImpl<T>::operator=(RHS);
+            Impl::operator=(RHS);
     }
 
     const SmallVector& operator=(const SmallVector& RHS) {
-        SmallVectorImpl<T>::operator=(RHS);
+        Impl::operator=(RHS);
         return *this;
     }
 
-    SmallVector(SmallVector&& RHS) : SmallVectorImpl<T>(N) {
+    SmallVector(SmallVector&& RHS) : Impl(N, RHS.getAllocator()) {
         if (!RHS.empty())
-            SmallVectorImpl<T>::operator=(::std::move(RHS));
+            Impl::operator=(::std::move(RHS));
     }
 
     const SmallVector& operator=(SmallVector&& RHS) {
-        SmallVectorImpl<T>::operator=(::std::move(RHS));
+        Impl::operator=(::std::move(RHS));
         return *this;
     }
 
-    SmallVector(SmallVectorImpl<T>&& RHS) : SmallVectorImpl<T>(N) {
+    SmallVector(Impl&& RHS) : Impl(N, RHS.getAllocator()) {
         if (!RHS.empty())
-            SmallVectorImpl<T>::operator=(::std::move(RHS));
+            Impl::operator=(::std::move(RHS));
     }
 
-    const SmallVector& operator=(SmallVectorImpl<T>&& RHS) {
-        SmallVectorImpl<T>::operator=(::std::move(RHS));
+    const SmallVector& operator=(Impl&& RHS) {
+        Impl::operator=(::std::move(RHS));
         return *this;
     }
 
@@ -897,22 +1088,34 @@ public:
     }
 };
 
-template <typename T, unsigned N>
-static inline size_t capacity_in_bytes(const SmallVector<T, N>& X) {
+/// A SmallVector whose data is aligned to Alignment bytes, whether it is
+/// stored in place or on the heap. SIMD kernels can use aligned loads on it.
+template <typename T, unsigned N, size_t Alignment,
+          typename AllocT = MallocAllocator>
+using AlignedSmallVector =
+    SmallVector<T, N, AlignedAllocator<Alignment, AllocT>>;
+
+template <typename T, unsigned N, typename AllocT>
+static inline size_t capacity_in_bytes(const SmallVector<T, N, AllocT>& X) {
     return X.capacity_in_bytes();
 }
 }
 
 namespace std {
 /// Implement std::swap in terms of SmallVector swap.
-template <typename T>
-inline void swap(ds::SmallVectorImpl<T>& LHS, ds::SmallVectorImpl<T>& RHS) {
+template <typename T, typename AllocT>
+inline void swap(ds::SmallVectorImpl<T, AllocT>& LHS,
+                 ds::SmallVectorImpl<T, AllocT>& RHS) {
     LHS.swap(RHS);
 }
 
 /// Implement std::swap in terms of SmallVector swap.
-template <typename T, unsigned N>
-inline void swap(ds::SmallVector<T, N>& LHS, ds::SmallVector<T, N>& RHS) {
+template <typename T, unsigned N, typename AllocT>
+inline void swap(ds::SmallVector<T, N, AllocT>& LHS,
+                 ds::SmallVector<T, N, AllocT>& RHS) {
     LHS.swap(RHS);
 }
-}
\ No newline at end of file
+}
+
+// Defines MutableArrayRef, which append_uninitialized() returns.
+#include "DataStructure/ArrayRef.h"
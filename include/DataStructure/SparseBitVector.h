@@ -0,0 +1,415 @@
+#pragma once
+
+#include "DataStructure/Detail.h"
+#include "DataStructure/DynamicBitSet.h"
+#include "DataStructure/SmallVector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+
+namespace ds {
+
+// A set of unsigned integers drawn from a huge universe, stored as a sorted
+// list of fixed-size bit set elements. Only elements with at least one set bit
+// are stored, so the memory used is proportional to the number of distinct
+// ElementSize-bit ranges the members fall into, not to the largest member.
+// This makes it a good fit for points-to sets and the like, which hold a few
+// dozen IDs out of millions.
+//
+// This follows llvm::SparseBitVector, except that the elements live in one
+// sorted array rather than in a linked list: lookups are binary searches, and
+// the set operations walk both arrays in lockstep. Appending members in
+// increasing order, the common way to build these sets, is amortized O(1).
+template <unsigned ElementSize = 128>
+class SparseBitVector {
+    static_assert(ElementSize % 64 == 0 && ElementSize != 0,
+                  "ElementSize has to be a multiple of 64");
+
+public:
+    using size_type = std::size_t;
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+private:
+    static constexpr unsigned WordsPerElement = ElementSize / 64;
+
+    struct Element {
+        // The element holds bits [index * ElementSize, (index + 1) *
+        // ElementSize).
+        size_type index;
+        uint64_t words[WordsPerElement];
+
+        explicit Element(size_type index) : index(index), words() {}
+
+        bool empty() const {
+            for (auto word : words)
+                if (word != 0)
+                    return false;
+            return true;
+        }
+        size_type count() const {
+            size_type ret = 0;
+            for (auto word : words)
+                ret += static_cast<size_type>(detail::popcount(word));
+            return ret;
+        }
+        size_type findFirst() const {
+            for (unsigned i = 0; i != WordsPerElement; ++i)
+                if (words[i] != 0)
+                    return index * ElementSize + i * 64 +
+                           detail::findFirstSet(words[i]);
+            return npos;
+        }
+        size_type findLast() const {
+            for (unsigned i = WordsPerElement; i != 0; --i)
+                if (words[i - 1] != 0)
+                    return index * ElementSize + (i - 1) * 64 +
+                           detail::findLastSet(words[i - 1]);
+            return npos;
+        }
+        bool operator==(const Element& rhs) const {
+            return index == rhs.index &&
+                   std::equal(words, words + WordsPerElement, rhs.words);
+        }
+    };
+
+    using ElementList = SmallVector<Element, 0>;
+    ElementList elements;
+
+    static size_type elementIndex(size_type pos) { return pos / ElementSize; }
+    static unsigned wordIndex(size_type pos) {
+        return static_cast<unsigned>(pos % ElementSize / 64);
+    }
+    static uint64_t bitMask(size_type pos) { return uint64_t(1) << (pos % 64); }
+
+    // The first element whose index is not less than idx.
+    typename ElementList::const_iterator lowerBound(size_type idx) const {
+        // Members are usually added in increasing order, so check the last
+        // element before searching.
+        if (elements.empty() || elements.back().index < idx)
+            return elements.end();
+        return std::lower_bound(
+            elements.begin(), elements.end(), idx,
+            [](const Element& e, size_type i) { return e.index < i; });
+    }
+    typename ElementList::iterator lowerBound(size_type idx) {
+        auto self = static_cast<const SparseBitVector*>(this);
+        auto it = self->lowerBound(idx);
+        return elements.begin() + (it - self->elements.begin());
+    }
+
+    // Removes the elements that have become empty.
+    void eraseEmpty() {
+        elements.erase(std::remove_if(elements.begin(), elements.end(),
+                                      [](const Element& e) {
+                                          return e.empty();
+                                      }),
+                       elements.end());
+    }
+
+public:
+    SparseBitVector() = default;
+
+    // Converts a DynamicBitSet, holding the positions of its set bits.
+    template <typename Block, typename Allocator>
+    explicit SparseBitVector(const DynamicBitSet<Block, Allocator>& bits) {
+        bits.for_each_set_bit([this](size_type pos) { set(pos); });
+    }
+
+    // Returns the members as a DynamicBitSet of numBits bits, which has to be
+    // larger than every member.
+    template <typename Block = unsigned long,
+              typename Allocator = std::allocator<Block>>
+    DynamicBitSet<Block, Allocator> to_dynamic_bitset(size_type numBits) const {
+        assert((empty() || find_last() < numBits) && "Bit set too small");
+        DynamicBitSet<Block, Allocator> ret(numBits);
+        for (auto pos : *this)
+            ret.set(pos);
+        return ret;
+    }
+
+    bool empty() const { return elements.empty(); }
+    void clear() { elements.clear(); }
+
+    // The number of members.
+    size_type count() const {
+        size_type ret = 0;
+        for (auto& e : elements)
+            ret += e.count();
+        return ret;
+    }
+
+    // The number of bytes allocated on the heap.
+    size_type getMemorySize() const {
+        return elements.capacity() * sizeof(Element);
+    }
+
+    bool test(size_type pos) const {
+        auto it = lowerBound(elementIndex(pos));
+        return it != elements.end() && it->index == elementIndex(pos) &&
+               (it->words[wordIndex(pos)] & bitMask(pos)) != 0;
+    }
+
+    void set(size_type pos) {
+        auto idx = elementIndex(pos);
+        auto it = lowerBound(idx);
+        if (it == elements.end() || it->index != idx)
+            it = elements.insert(it, Element(idx));
+        it->words[wordIndex(pos)] |= bitMask(pos);
+    }
+
+    void reset(size_type pos) {
+        auto idx = elementIndex(pos);
+        auto it = lowerBound(idx);
+        if (it == elements.end() || it->index != idx)
+            return;
+        it->words[wordIndex(pos)] &= ~bitMask(pos);
+        if (it->empty())
+            elements.erase(it);
+    }
+
+    // Sets pos and returns whether it was set before.
+    bool test_set(size_type pos) {
+        if (test(pos))
+            return true;
+        set(pos);
+        return false;
+    }
+
+    size_type find_first() const {
+        return empty() ? npos : elements.front().findFirst();
+    }
+    size_type find_last() const {
+        return empty() ? npos : elements.back().findLast();
+    }
+
+    // Adds the members of rhs. Returns whether this set changed.
+    bool union_with(const SparseBitVector& rhs) {
+        if (this == &rhs || rhs.empty())
+            return false;
+
+        // Count the elements that only rhs has, make room for them at the end
+        // and merge both lists from the back, so that every element moves at
+        // most once.
+        size_type numNew = 0;
+        auto lhsIt = elements.begin(), lhsEnd = elements.end();
+        for (auto& e : rhs.elements) {
+            while (lhsIt != lhsEnd && lhsIt->index < e.index)
+                ++lhsIt;
+            if (lhsIt == lhsEnd || lhsIt->index != e.index)
+                ++numNew;
+        }
+
+        bool changed = numNew != 0;
+        size_type oldSize = elements.size();
+        elements.resize(oldSize + numNew, Element(0));
+        auto out = elements.end();
+        auto lhsRev = elements.begin() + oldSize;
+        auto rhsRev = rhs.elements.end();
+        while (rhsRev != rhs.elements.begin()) {
+            auto& r = *(rhsRev - 1);
+            if (lhsRev != elements.begin() && (lhsRev - 1)->index > r.index) {
+                *--out = *--lhsRev;
+            } else if (lhsRev != elements.begin() &&
+                       (lhsRev - 1)->index == r.index) {
+                Element merged = *--lhsRev;
+                for (unsigned i = 0; i != WordsPerElement; ++i) {
+                    auto word = merged.words[i] | r.words[i];
+                    changed |= word != merged.words[i];
+                    merged.words[i] = word;
+                }
+                *--out = merged;
+                --rhsRev;
+            } else {
+                *--out = r;
+                --rhsRev;
+            }
+        }
+        assert(out == lhsRev && "Merge went wrong");
+        return changed;
+    }
+
+    // Removes the members that rhs does not have. Returns whether this set
+    // changed.
+    bool intersect_with(const SparseBitVector& rhs) {
+        if (this == &rhs)
+            return false;
+
+        bool changed = false;
+        auto rhsIt = rhs.elements.begin(), rhsEnd = rhs.elements.end();
+        for (auto& e : elements) {
+            while (rhsIt != rhsEnd && rhsIt->index < e.index)
+                ++rhsIt;
+            if (rhsIt == rhsEnd || rhsIt->index != e.index) {
+                std::fill(e.words, e.words + WordsPerElement, 0);
+                changed = true;
+                continue;
+            }
+            for (unsigned i = 0; i != WordsPerElement; ++i) {
+                auto word = e.words[i] & rhsIt->words[i];
+                changed |= word != e.words[i];
+                e.words[i] = word;
+            }
+        }
+        if (changed)
+            eraseEmpty();
+        return changed;
+    }
+
+    // Removes the members that rhs has. Returns whether this set changed.
+    bool subtract(const SparseBitVector& rhs) {
+        if (this == &rhs) {
+            bool changed = !empty();
+            clear();
+            return changed;
+        }
+
+        bool changed = false;
+        auto rhsIt = rhs.elements.begin(), rhsEnd = rhs.elements.end();
+        for (auto& e : elements) {
+            while (rhsIt != rhsEnd && rhsIt->index < e.index)
+                ++rhsIt;
+            if (rhsIt == rhsEnd)
+                break;
+            if (rhsIt->index != e.index)
+                continue;
+            for (unsigned i = 0; i != WordsPerElement; ++i) {
+                auto word = e.words[i] & ~rhsIt->words[i];
+                changed |= word != e.words[i];
+                e.words[i] = word;
+            }
+        }
+        if (changed)
+            eraseEmpty();
+        return changed;
+    }
+
+    SparseBitVector& operator|=(const SparseBitVector& rhs) {
+        union_with(rhs);
+        return *this;
+    }
+    SparseBitVector& operator&=(const SparseBitVector& rhs) {
+        intersect_with(rhs);
+        return *this;
+    }
+    SparseBitVector& operator-=(const SparseBitVector& rhs) {
+        subtract(rhs);
+        return *this;
+    }
+
+    // Whether this set and rhs have a member in common.
+    bool intersects(const SparseBitVector& rhs) const {
+        auto rhsIt = rhs.elements.begin(), rhsEnd = rhs.elements.end();
+        for (auto& e : elements) {
+            while (rhsIt != rhsEnd && rhsIt->index < e.index)
+                ++rhsIt;
+            if (rhsIt == rhsEnd)
+                return false;
+            if (rhsIt->index != e.index)
+                continue;
+            for (unsigned i = 0; i != WordsPerElement; ++i)
+                if ((e.words[i] & rhsIt->words[i]) != 0)
+                    return true;
+        }
+        return false;
+    }
+
+    // Whether every member of this set is a member of rhs.
+    bool is_subset_of(const SparseBitVector& rhs) const {
+        auto rhsIt = rhs.elements.begin(), rhsEnd = rhs.elements.end();
+        for (auto& e : elements) {
+            while (rhsIt != rhsEnd && rhsIt->index < e.index)
+                ++rhsIt;
+            if (rhsIt == rhsEnd || rhsIt->index != e.index)
+                return false;
+            for (unsigned i = 0; i != WordsPerElement; ++i)
+                if ((e.words[i] & ~rhsIt->words[i]) != 0)
+                    return false;
+        }
+        return true;
+    }
+
+    bool operator==(const SparseBitVector& rhs) const {
+        return elements.size() == rhs.elements.size() &&
+               std::equal(elements.begin(), elements.end(),
+                          rhs.elements.begin());
+    }
+    bool operator!=(const SparseBitVector& rhs) const {
+        return !(*this == rhs);
+    }
+
+    // A forward iterator over the members, in increasing order. Like
+    // DynamicBitSet's set-bit iterator, it keeps a copy of the current word
+    // and clears its lowest bit on every step.
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = size_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const size_type*;
+        using reference = size_type;
+
+    private:
+        const Element* elem;
+        const Element* end;
+        unsigned wordIdx;
+        uint64_t current;
+
+        void skipZeroWords() {
+            while (current == 0) {
+                if (++wordIdx == WordsPerElement) {
+                    wordIdx = 0;
+                    if (++elem == end)
+                        return;
+                }
+                current = elem->words[wordIdx];
+            }
+        }
+
+    public:
+        iterator(const Element* elem, const Element* end)
+            : elem(elem), end(end), wordIdx(0),
+              current(elem != end ? elem->words[0] : 0) {
+            if (elem != end)
+                skipZeroWords();
+        }
+
+        size_type operator*() const {
+            return elem->index * ElementSize + wordIdx * 64 +
+                   detail::findFirstSet(current);
+        }
+
+        iterator& operator++() {
+            current &= current - 1;
+            skipZeroWords();
+            return *this;
+        }
+        iterator operator++(int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const iterator& rhs) const {
+            return elem == rhs.elem && current == rhs.current &&
+                   wordIdx == rhs.wordIdx;
+        }
+        bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+    };
+    using const_iterator = iterator;
+
+    iterator begin() const {
+        return iterator(elements.data(), elements.data() + elements.size());
+    }
+    iterator end() const {
+        auto last = elements.data() + elements.size();
+        return iterator(last, last);
+    }
+};
+
+template <unsigned ElementSize>
+constexpr typename SparseBitVector<ElementSize>::size_type
+    SparseBitVector<ElementSize>::npos;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "DataStructure/StringView.h"
+
+#include <cstdint>
+
+namespace ds {
+
+// A precompiled substring searcher based on the Two-Way algorithm of
+// Crochemore and Perrin. Building the searcher takes O(m) time for a needle of
+// length m; every search afterwards takes O(n) time for a text of length n,
+// regardless of the shape of the needle, and never allocates.
+// Mismatching windows are skipped with a bad-character shift on the last byte
+// of the window, which makes the common case sublinear.
+//
+// A searcher is immutable once built, so a single instance can be shared by
+// many threads. It keeps a reference to the needle rather than a copy: the
+// needle's storage has to outlive the searcher.
+//
+// A Backward searcher runs the same algorithm over the reversed needle and text
+// and is used to find the last occurrence of the needle.
+class StringSearcher {
+public:
+    enum class Direction { Forward, Backward };
+
+private:
+    StringView needle;
+    Direction dir;
+    // Critical factorization of the needle: needle = u v with |u| = critPos.
+    size_t critPos;
+    size_t period;
+    // How much of the needle is known to match after shifting by 'period'.
+    // This is zero unless the needle is periodic.
+    size_t memAfterShift;
+    // Bytes present in the needle, and for those bytes the distance from
+    // their last occurrence to the end of the needle.
+    uint64_t byteSet[4];
+    size_t shift[256];
+
+    template <bool Backward, typename Callback>
+    void search(StringView text, size_t from, Callback cb) const;
+
+public:
+    explicit StringSearcher(StringView needle,
+                            Direction dir = Direction::Forward);
+
+    StringView getNeedle() const { return needle; }
+    Direction getDirection() const { return dir; }
+
+    // Returns the index of the first occurrence of the needle in 'text' that
+    // starts at or after 'from', or StringView::npos. Requires a Forward
+    // searcher.
+    size_t find(StringView text, size_t from = 0) const;
+
+    // Returns the index of the last occurrence of the needle in 'text', or
+    // StringView::npos. Requires a Backward searcher.
+    size_t rfind(StringView text) const;
+
+    // Returns the number of (possibly overlapping) occurrences of the needle in
+    // 'text'. Requires a Forward searcher.
+    size_t count(StringView text) const;
+};
+}
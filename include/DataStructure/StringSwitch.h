@@ -0,0 +1,93 @@
+#pragma once
+
+#include "DataStructure/StringView.h"
+
+#include <cassert>
+#include <cstdint>
+
+namespace ds {
+
+// 64-bit FNV-1a hash of 's'. It is constexpr, so hashes of literals can be
+// computed at compile time and used as case labels; see the _sh literal below.
+constexpr uint64_t hashString(StringView s) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0, e = s.size(); i != e; ++i) {
+        hash ^= static_cast<unsigned char>(s[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline namespace literals {
+// "foo"_sh is hashString("foo") as a compile-time constant. This allows
+//   switch (hashString(cmd)) {
+//   case "start"_sh:
+//       if (cmd == "start") ...
+// Since different strings may share a hash, each case still has to compare
+// the string itself.
+constexpr uint64_t operator""_sh(const char* s, size_t n) {
+    return hashString(StringView(s, n));
+}
+}
+
+// A switch statement over strings, modeled after LLVM's StringSwitch:
+//
+//   Color color = StringSwitch<Color>(name)
+//                     .Case("red", Red)
+//                     .Cases("green", "lime", Green)
+//                     .Default(Unknown);
+//
+// Like LLVM's, each case first compares the length of its literal, which is a
+// compile-time constant, against that of the input, so only the cases of the
+// right length pay for a memcmp. The input is never hashed; for a switch
+// statement on hashes use hashString() and the _sh literal above instead.
+// The first matching case wins. T has to be default constructible.
+template <typename T, typename R = T>
+class StringSwitch {
+private:
+    StringView str;
+    T result;
+    bool matched;
+
+    template <size_t N>
+    constexpr bool matches(const char (&s)[N]) const {
+        return !matched && str.size() == N - 1 &&
+               str.equals(StringView(s, N - 1));
+    }
+
+public:
+    constexpr explicit StringSwitch(StringView s)
+        : str(s), result(), matched(false) {}
+
+    template <size_t N>
+    constexpr StringSwitch& Case(const char (&s)[N], T value) {
+        if (matches(s)) {
+            result = value;
+            matched = true;
+        }
+        return *this;
+    }
+
+    template <size_t N0, size_t N1>
+    constexpr StringSwitch& Cases(const char (&s0)[N0], const char (&s1)[N1],
+                                  T value) {
+        return Case(s0, value).Case(s1, value);
+    }
+
+    template <size_t N0, size_t N1, size_t N2>
+    constexpr StringSwitch& Cases(const char (&s0)[N0], const char (&s1)[N1],
+                                  const char (&s2)[N2], T value) {
+        return Case(s0, value).Case(s1, value).Case(s2, value);
+    }
+
+    constexpr R Default(T value) const {
+        return matched ? R(result) : R(value);
+    }
+
+    // Requires one of the cases to have matched.
+    constexpr operator R() const {
+        assert(matched && "StringSwitch does not match any case!");
+        return R(result);
+    }
+};
+}
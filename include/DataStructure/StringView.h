@@ -1,39 +1,123 @@
 #pragma once
 
+#include "DataStructure/Detail.h"
+
+#include <cassert>
+#include <cstddef>
 #include <iosfwd>
+#include <iterator>
+#include <limits>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace ds {
 
+class CodePointRange;
+
 class StringView {
 public:
     using iterator = const char*;
     using const_iterator = const char*;
     using size_type = size_t;
-    static const size_t npos;
+    static constexpr size_t npos = ~size_t(0);
 
 private:
     const char* _data;
     size_t length;
 
+    // Compile-time capable strlen and memcmp. The GNU builtins fold to
+    // constants on literal arguments and call the library otherwise.
+    static constexpr size_t lengthOf(const char* s) {
+#ifdef __GNUC__
+        return __builtin_strlen(s);
+#else
+        size_t n = 0;
+        while (s[n] != '\0')
+            ++n;
+        return n;
+#endif
+    }
+    static constexpr int compareMemory(const char* lhs, const char* rhs,
+                                       size_t len) {
+        if (len == 0)
+            return 0;
+#ifdef __GNUC__
+        return __builtin_memcmp(lhs, rhs, len);
+#else
+        for (size_t i = 0; i != len; ++i) {
+            auto l = static_cast<unsigned char>(lhs[i]);
+            auto r = static_cast<unsigned char>(rhs[i]);
+            if (l != r)
+                return l < r ? -1 : 1;
+        }
+        return 0;
+#endif
+    }
+
+    size_t consumeUnsigned(unsigned radix, unsigned long long& result) const;
+    size_t consumeSigned(unsigned radix, long long& result) const;
+
+    template <typename T>
+    size_t getAsIntegerImpl(unsigned radix, T& result, std::true_type) const {
+        long long value;
+        auto n = consumeSigned(radix, value);
+        if (n == 0 || value < std::numeric_limits<T>::min() ||
+            value > std::numeric_limits<T>::max())
+            return 0;
+        result = static_cast<T>(value);
+        return n;
+    }
+    template <typename T>
+    size_t getAsIntegerImpl(unsigned radix, T& result,
+                            std::false_type) const {
+        unsigned long long value;
+        auto n = consumeUnsigned(radix, value);
+        if (n == 0 || value > std::numeric_limits<T>::max())
+            return 0;
+        result = static_cast<T>(value);
+        return n;
+    }
+
 public:
-    StringView() : _data(nullptr), length(0) {}
-    StringView(const char* s);
-    StringView(const char* s, size_t len);
+    constexpr StringView() : _data(nullptr), length(0) {}
+    constexpr StringView(const char* s) : _data(s), length(0) {
+        assert(s && "StringView cannot be built from NULL");
+        length = lengthOf(s);
+    }
+    constexpr StringView(const char* s, size_t len) : _data(s), length(len) {
+        assert((_data || length == 0) &&
+               "StringView cannot be built from NULL with non-null length");
+    }
     StringView(const std::string& s) : _data(s.data()), length(s.length()) {}
-    const char* data() const { return _data; }
-    bool empty() const { return length == 0; }
-    size_t size() const { return length; }
-    iterator begin() const { return _data; }
-    iterator end() const { return _data + length; }
-    char front() const;
-    char back() const;
-
-    bool equals(StringView rhs) const;
+    constexpr const char* data() const { return _data; }
+    constexpr bool empty() const { return length == 0; }
+    constexpr size_t size() const { return length; }
+    constexpr iterator begin() const { return _data; }
+    constexpr iterator end() const { return _data + length; }
+    constexpr char front() const {
+        assert(!empty());
+        return _data[0];
+    }
+    constexpr char back() const {
+        assert(!empty());
+        return _data[length - 1];
+    }
+
+    constexpr bool equals(StringView rhs) const {
+        return length == rhs.length &&
+               compareMemory(_data, rhs._data, length) == 0;
+    }
     bool equals_lower(StringView rhs) const;
 
-    int compare(StringView rhs) const;
+    constexpr int compare(StringView rhs) const {
+        if (int res = compareMemory(_data, rhs._data,
+                                    length < rhs.length ? length : rhs.length))
+            return res < 0 ? -1 : 1;
+        if (length == rhs.length)
+            return 0;
+        return length < rhs.length ? -1 : 1;
+    }
     int compare_lower(StringView rhs) const;
 
     std::string to_string() const {
@@ -43,10 +127,24 @@ public:
             return std::string(_data, length);
     }
     operator std::string() const { return to_string(); }
-    char operator[](size_t idx) const;
-    bool startswith(StringView prefix) const;
-    bool endswith(StringView suffix) const;
+    constexpr char operator[](size_t idx) const {
+        assert(idx < length && "Index out of bound!");
+        return _data[idx];
+    }
+    constexpr bool startswith(StringView prefix) const {
+        return length >= prefix.length &&
+               compareMemory(_data, prefix._data, prefix.length) == 0;
+    }
+    constexpr bool endswith(StringView suffix) const {
+        return length >= suffix.length &&
+               compareMemory(end() - suffix.length, suffix._data,
+                             suffix.length) == 0;
+    }
 
+    // The substring searches look for the first byte of short needles and
+    // compare the rest. Longer needles in long strings get a StringSearcher,
+    // which is built anew on every call; code that searches for the same
+    // needle many times should build one StringSearcher and reuse it.
     size_t find(char c, size_t from = 0) const;
     size_t find(StringView s, size_t from = 0) const;
     size_t rfind(char c, size_t from = npos) const;
@@ -64,50 +162,282 @@ public:
     size_t count(char c) const;
     size_t count(StringView s) const;
 
-    StringView substr(size_t start, size_t n = npos) const;
-    StringView slice(size_t start, size_t end) const;
-    StringView dropFront(size_t n = 1) const;
-    StringView dropBack(size_t n = 1) const;
+    // Parses an integer from the front of the string and returns the number
+    // of characters consumed. Signed types accept a leading '-'. 'radix' may
+    // be anything in [2, 36], or 0 to detect it from a "0x", "0b", "0o" or
+    // "0" prefix (defaulting to 10).
+    // Returns 0 and leaves 'result' untouched if there is no number or it
+    // does not fit in T. Nothing is allocated and the locale is not consulted.
+    template <typename T>
+    size_t getAsInteger(unsigned radix, T& result) const {
+        static_assert(std::is_integral<T>::value &&
+                          !std::is_same<T, bool>::value &&
+                          sizeof(T) <= sizeof(long long),
+                      "getAsInteger() needs an integer type");
+        return getAsIntegerImpl(radix, result, std::is_signed<T>());
+    }
+
+    // Parses a floating-point number ("-1.5e3", "inf", "nan", ...) from the
+    // front of the string and returns the number of characters consumed, or 0
+    // if there is no number or it overflows a double. The decimal point is
+    // always '.', whatever the current locale is.
+    size_t getAsDouble(double& result) const;
+
+    constexpr StringView substr(size_t start, size_t n = npos) const {
+        start = start < length ? start : length;
+        return StringView(_data + start,
+                          n < length - start ? n : length - start);
+    }
+    constexpr StringView slice(size_t start, size_t end) const {
+        start = start < length ? start : length;
+        end = end < start ? start : (end < length ? end : length);
+        return StringView(_data + start, end - start);
+    }
+    constexpr StringView dropFront(size_t n = 1) const {
+        assert(size() >= n && "Dropping more elements than exist!");
+        return substr(n);
+    }
+    constexpr StringView dropBack(size_t n = 1) const {
+        assert(size() >= n && "Dropping more elements than exist!");
+        return substr(0, size() - n);
+    }
+    // Returns true if the string is well-formed UTF-8: no overlong encodings,
+    // surrogates, code points above U+10FFFF, or truncated sequences.
+    bool isValidUTF8() const;
+    // Returns the number of code points in a valid UTF-8 string. For invalid
+    // input this is the number of bytes that are not continuation bytes.
+    size_t countCodePoints() const;
+    // Iterates over the code points of the string decoded as UTF-8.
+    CodePointRange codePoints() const;
+
     StringView ltrim(StringView chars = " \t\n\v\f\r") const;
     StringView rtrim(StringView chars = " \t\n\v\f\r") const;
     StringView trim(StringView chars = " \t\n\v\f\r") const;
 };
 
-inline bool operator==(StringView lhs, StringView rhs) {
+constexpr bool operator==(StringView lhs, StringView rhs) {
     return lhs.equals(rhs);
 }
-inline bool operator!=(StringView lhs, StringView rhs) {
+constexpr bool operator!=(StringView lhs, StringView rhs) {
     return !(lhs == rhs);
 }
-inline bool operator<(StringView lhs, StringView rhs) {
+constexpr bool operator<(StringView lhs, StringView rhs) {
     return lhs.compare(rhs) == -1;
 }
-inline bool operator<=(StringView lhs, StringView rhs) {
+constexpr bool operator<=(StringView lhs, StringView rhs) {
     return lhs.compare(rhs) != 1;
 }
-inline bool operator>(StringView lhs, StringView rhs) {
+constexpr bool operator>(StringView lhs, StringView rhs) {
     return lhs.compare(rhs) == 1;
 }
-inline bool operator>=(StringView lhs, StringView rhs) {
+constexpr bool operator>=(StringView lhs, StringView rhs) {
     return lhs.compare(rhs) != -1;
 }
 
 std::ostream& operator<<(std::ostream&, const StringView&);
 
+template <typename T, typename AllocT>
+class SmallVectorImpl;
+
+// A lazily evaluated view of the pieces of a string cut at a separator. The
+// separator can be a single character, a multi-character string, or any
+// character out of a set. Pieces are produced one at a time while iterating,
+// so splitting never allocates.
+// At most 'maxSplit' cuts are made (a negative value means no limit), and the
+// rest of the string is yielded as the last piece. Empty pieces are skipped
+// unless 'keepEmpty' is set; skipped pieces still count towards 'maxSplit'.
+class SplitRange {
+public:
+    enum class SeparatorKind { Char, String, AnyOf };
+
+    class iterator {
+    private:
+        const SplitRange* range;
+        StringView piece, rest;
+        int splitsLeft;
+        bool lastPiece, atEnd;
+
+        void advance();
+
+    public:
+        using difference_type = std::ptrdiff_t;
+        using value_type = StringView;
+        using pointer = const StringView*;
+        using reference = const StringView&;
+        using iterator_category = std::forward_iterator_tag;
+
+        iterator()
+            : range(nullptr), splitsLeft(0), lastPiece(true), atEnd(true) {}
+        explicit iterator(const SplitRange& range)
+            : range(&range), rest(range.str), splitsLeft(range.maxSplit),
+              lastPiece(false), atEnd(false) {
+            advance();
+        }
+
+        reference operator*() const { return piece; }
+        pointer operator->() const { return &piece; }
+        iterator& operator++() {
+            advance();
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator ret = *this;
+            advance();
+            return ret;
+        }
+        bool operator==(const iterator& rhs) const {
+            if (atEnd || rhs.atEnd)
+                return atEnd == rhs.atEnd;
+            return piece.data() == rhs.piece.data() &&
+                   rest.data() == rhs.rest.data() &&
+                   lastPiece == rhs.lastPiece;
+        }
+        bool operator!=(const iterator& rhs) const { return !(*this == rhs); }
+    };
+    using const_iterator = iterator;
+
+private:
+    StringView str, sep;
+    char sepChar;
+    SeparatorKind kind;
+    int maxSplit;
+    bool keepEmpty;
+
+    SplitRange(StringView str, StringView sep, char sepChar,
+               SeparatorKind kind, int maxSplit, bool keepEmpty)
+        : str(str), sep(sep), sepChar(sepChar), kind(kind),
+          maxSplit(maxSplit), keepEmpty(keepEmpty) {}
+
+    // Returns the position of the next separator in 'text' (or npos) and
+    // stores its length in 'sepLen'.
+    size_t findSeparator(StringView text, size_t& sepLen) const;
+
+public:
+    SplitRange(StringView str, char sep, int maxSplit = -1,
+               bool keepEmpty = true)
+        : SplitRange(str, StringView(), sep, SeparatorKind::Char, maxSplit,
+                     keepEmpty) {}
+    // A multi-character separator. An empty separator never matches.
+    SplitRange(StringView str, StringView sep, int maxSplit = -1,
+               bool keepEmpty = true)
+        : SplitRange(str, sep, 0, SeparatorKind::String, maxSplit,
+                     keepEmpty) {}
+    // Splits at any character in 'chars'.
+    static SplitRange anyOf(StringView str, StringView chars,
+                            int maxSplit = -1, bool keepEmpty = true) {
+        return SplitRange(str, chars, 0, SeparatorKind::AnyOf, maxSplit,
+                          keepEmpty);
+    }
+
+    SeparatorKind getSeparatorKind() const { return kind; }
+
+    iterator begin() const { return iterator(*this); }
+    iterator end() const { return iterator(); }
+};
+
+// A view of a UTF-8 string as a sequence of code points (as char32_t). Each
+// ill-formed sequence is decoded as U+FFFD, consuming its longest valid prefix
+// (or one byte) as recommended by the Unicode standard, so iteration always
+// makes progress and never reads past the string.
+class CodePointRange {
+public:
+    static constexpr char32_t ReplacementCharacter = 0xFFFD;
+
+    class iterator {
+    private:
+        const char* pos;
+        const char* stop;
+        size_t len;
+        char32_t cp;
+
+        static char32_t decodeMultiByte(const char* s, size_t n, size_t& len);
+
+        void decode() {
+            if (pos == stop)
+                return;
+            auto b = static_cast<unsigned char>(*pos);
+            if (b < 0x80) {
+                cp = b;
+                len = 1;
+            } else
+                cp = decodeMultiByte(pos, stop - pos, len);
+        }
+
+    public:
+        using difference_type = std::ptrdiff_t;
+        using value_type = char32_t;
+        using pointer = const char32_t*;
+        using reference = const char32_t&;
+        using iterator_category = std::forward_iterator_tag;
+
+        iterator() : pos(nullptr), stop(nullptr), len(0), cp(0) {}
+        iterator(const char* pos, const char* stop)
+            : pos(pos), stop(stop), len(0), cp(0) {
+            decode();
+        }
+
+        reference operator*() const { return cp; }
+        pointer operator->() const { return &cp; }
+        // The bytes the current code point was decoded from.
+        StringView getBytes() const { return StringView(pos, len); }
+
+        iterator& operator++() {
+            pos += len;
+            decode();
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+        bool operator==(const iterator& rhs) const { return pos == rhs.pos; }
+        bool operator!=(const iterator& rhs) const { return pos != rhs.pos; }
+    };
+    using const_iterator = iterator;
+
+private:
+    StringView str;
+
+public:
+    explicit CodePointRange(StringView str) : str(str) {}
+
+    iterator begin() const { return iterator(str.begin(), str.end()); }
+    iterator end() const { return iterator(str.end(), str.end()); }
+};
+
+inline CodePointRange StringView::codePoints() const {
+    return CodePointRange(*this);
+}
+
 std::vector<StringView> split(StringView str, char sep, int maxSplit = -1,
                               bool keepEmpty = true);
+
+// These append the pieces to 'out' instead of returning a fresh vector, so
+// callers can reuse the same storage across many calls.
+template <typename AllocT>
+void split_into(SmallVectorImpl<StringView, AllocT>& out,
+                const SplitRange& range) {
+    for (auto piece : range)
+        out.push_back(piece);
+}
+template <typename AllocT>
+void split_into(SmallVectorImpl<StringView, AllocT>& out, StringView str,
+                char sep, int maxSplit = -1, bool keepEmpty = true) {
+    split_into(out, SplitRange(str, sep, maxSplit, keepEmpty));
+}
+template <typename AllocT>
+void split_into(SmallVectorImpl<StringView, AllocT>& out, StringView str,
+                StringView sep, int maxSplit = -1, bool keepEmpty = true) {
+    split_into(out, SplitRange(str, sep, maxSplit, keepEmpty));
+}
 }
 
 namespace std {
 template <>
 struct hash<ds::StringView> {
     size_t operator()(const ds::StringView& s) const {
-        size_t hash = 14695981039346656037UL;
-        for (size_t i = 0ul, e = s.size(); i != e; ++i) {
-            hash ^= s[i];
-            hash *= 1099511628211UL;
-        }
-        return hash;
+        return static_cast<size_t>(ds::detail::hashBytes(s.data(), s.size()));
     }
 };
 }
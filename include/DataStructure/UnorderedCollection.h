@@ -1,9 +1,10 @@
 #pragma once
 
+#include "DataStructure/SmallVector.h"
+
 #include <algorithm>
 #include <iterator>
 #include <memory>
-#include <vector>
 
 namespace ds {
 
@@ -30,7 +31,9 @@ namespace ds {
 // std::list can also satisfy all the constraints mentioned above, the cost it
 // pays (two additional pointers for each element) does not justify the
 // additional benefit it provides (stable iterators) for some of the
-// applications I had in mind.
+// applications I had in mind. The vector is a SmallVector, which relocates the
+// unique_ptrs with realloc when it grows. Its 32-bit size caps the collection
+// at max_size() elements, past which create() throws std::length_error.
 
 // Due to the way UnorderedCollection is implemented, it has an additional
 // feature of holding polymorphic objects. Elements in UnorderedCollection<T>
@@ -48,7 +51,7 @@ template <typename T>
 class UnorderedCollection {
 private:
     using ListElementType = std::unique_ptr<T>;
-    using ListType = std::vector<ListElementType>;
+    using ListType = SmallVector<ListElementType, 0, MallocAllocator>;
     ListType allocList;
 
     friend class UnorderedCollectionIterator<T>;
@@ -56,7 +59,9 @@ private:
 
 public:
     using value_type = T;
-    using allocator_type = typename ListType::allocator_type;
+    // The allocation policy of the vector of element pointers, which lets it
+    // relocate them with realloc (see Allocator.h).
+    using allocation_policy = MallocAllocator;
     using deleter_type = typename ListElementType::deleter_type;
     using size_type = typename ListType::size_type;
     using difference_type = typename ListType::difference_type;
@@ -82,6 +87,7 @@ public:
 
     bool empty() const { return allocList.empty(); }
     size_type size() const { return allocList.size(); }
+    size_type max_size() const { return allocList.max_size(); }
 
     void reserve(size_type sz) { allocList.reserve(sz); }
     void clear() { return allocList.clear(); }
@@ -228,13 +234,13 @@ typename UnorderedCollection<T>::iterator UnorderedCollection<T>::end() {
 template <typename T>
 typename UnorderedCollection<T>::const_iterator
 UnorderedCollection<T>::begin() const {
-    return const_iterator(allocList.cbegin());
+    return const_iterator(allocList.begin());
 }
 
 template <typename T>
 typename UnorderedCollection<T>::const_iterator
 UnorderedCollection<T>::end() const {
-    return const_iterator(allocList.cend());
+    return const_iterator(allocList.end());
 }
 }
 
@@ -0,0 +1,74 @@
+#include "DataStructure/Allocator.h"
+
+#include <algorithm>
+
+namespace ds {
+
+void* MallocAllocator::allocateAligned(size_t size, size_t alignment) {
+    void* ret = nullptr;
+    int err = ::posix_memalign(&ret, alignment, size);
+    assert(err == 0 && "Out of memory");
+    (void)err;
+    return ret;
+}
+
+void* MallocAllocator::reallocateAligned(void* ptr, size_t oldSize,
+                                         size_t newSize, size_t alignment) {
+    // realloc() often extends the block in place, which keeps it aligned. Only
+    // if the block moved to a misaligned address does it have to be copied
+    // once more.
+    void* ret = std::realloc(ptr, newSize);
+    assert(ret && "Out of memory");
+    if (reinterpret_cast<uintptr_t>(ret) % alignment == 0)
+        return ret;
+    void* aligned = allocateAligned(newSize, alignment);
+    std::memcpy(aligned, ret, std::min(oldSize, newSize));
+    std::free(ret);
+    return aligned;
+}
+
+constexpr size_t BumpPtrAllocator::SlabSize;
+constexpr size_t BumpPtrAllocator::MaxSlabSize;
+
+void* BumpPtrAllocator::allocateSlow(size_t size, size_t alignment) {
+    size_t slabSize = std::min(SlabSize << (numSlabs / 4), MaxSlabSize);
+    size_t needed = sizeof(Slab) + alignment - 1 + size;
+    bool dedicated = needed > slabSize;
+    if (dedicated)
+        slabSize = needed;
+
+    auto slab = static_cast<Slab*>(std::malloc(slabSize));
+    assert(slab && "Out of memory");
+    ++numSlabs;
+
+    auto begin = reinterpret_cast<char*>(slab + 1);
+    auto addr = reinterpret_cast<uintptr_t>(begin);
+    auto ret = begin + (((addr + alignment - 1) & ~uintptr_t(alignment - 1)) -
+                        addr);
+    bytesAllocated += size;
+
+    // A dedicated slab goes behind the current one, which may still have room
+    // for later small allocations.
+    if (dedicated && slabs != nullptr) {
+        slab->prev = slabs->prev;
+        slabs->prev = slab;
+        return ret;
+    }
+    slab->prev = slabs;
+    slabs = slab;
+    cur = ret + size;
+    end = reinterpret_cast<char*>(slab) + slabSize;
+    return ret;
+}
+
+void BumpPtrAllocator::reset() {
+    while (slabs != nullptr) {
+        auto prev = slabs->prev;
+        std::free(slabs);
+        slabs = prev;
+    }
+    cur = end = nullptr;
+    numSlabs = 0;
+    bytesAllocated = 0;
+}
+}
@@ -0,0 +1,241 @@
+#include "DataStructure/BitMatrix.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ds {
+
+namespace {
+
+using Word = BitMatrix::block_type;
+
+const size_t npos = static_cast<size_t>(-1);
+
+// The multiplication works on tiles of the rows of b and of the result that
+// are this many words wide, 256 KB for the 64 rows of b a tile uses, which
+// stay in L2.
+const size_t TileWords = 512;
+const size_t RowBlock = 64;
+
+void orWords(Word* dst, const Word* src, size_t n) {
+    if (n * sizeof(Word) >= detail::BitKernelMinBytes) {
+        detail::bitsApply(detail::BitOp::Or, dst, src, n * sizeof(Word));
+    } else {
+        for (size_t i = 0; i != n; ++i)
+            dst[i] |= src[i];
+    }
+}
+
+size_t findNext(const Word* row, size_t numWords, size_t pos) {
+    auto i = pos / 64;
+    if (i >= numWords)
+        return npos;
+    Word rest = row[i] & ~((Word(1) << (pos % 64)) - 1);
+    while (rest == 0) {
+        if (++i == numWords)
+            return npos;
+        rest = row[i];
+    }
+    return i * 64 + detail::findFirstSet(rest);
+}
+
+// Runs fn(begin, end) over chunks of [0, n), in parallel if the rows that
+// the n items touch, of rowWords words each, add up to the serial cutoff.
+template <typename Fn>
+void forEachChunk(size_t n, size_t rowWords, const ParallelOptions& opts,
+                  Fn fn) {
+    ParallelOptions rowOpts = opts;
+    rowOpts.serialCutoff = std::max<size_t>(
+        2, opts.serialCutoff / std::max<size_t>(rowWords, 1));
+    detail::forEachChunk(n, detail::CacheLineSize, rowOpts, fn);
+}
+
+// The strongly connected components of the graph, numbered in the order
+// Tarjan's algorithm finds them. That is a reverse topological order: every
+// edge between two components leads to one with a smaller number.
+struct Components {
+    std::vector<size_t> compOf;
+    // The nodes of component c are members[start[c]], ..., up to start[c + 1].
+    std::vector<size_t> members;
+    std::vector<size_t> start;
+
+    size_t size() const { return start.size() - 1; }
+    size_t representative(size_t c) const { return members[start[c]]; }
+};
+
+Components findComponents(const BitMatrix& m) {
+    const size_t n = m.rows(), numWords = (n + 63) / 64;
+    const size_t unvisited = npos;
+    std::vector<size_t> index(n, unvisited), low(n), stack;
+    DynamicBitSet<> onStack(n);
+    struct Frame {
+        size_t node, next;
+    };
+    std::vector<Frame> frames;
+    Components ret;
+    ret.compOf.resize(n);
+    size_t numVisited = 0, numComps = 0;
+
+    for (size_t root = 0; root < n; ++root) {
+        if (index[root] != unvisited)
+            continue;
+        index[root] = low[root] = numVisited++;
+        stack.push_back(root);
+        onStack.set(root);
+        frames.push_back({root, 0});
+        while (!frames.empty()) {
+            auto& frame = frames.back();
+            auto v = frame.node;
+            auto w = findNext(m.row(v).data(), numWords, frame.next);
+            if (w != npos) {
+                frame.next = w + 1;
+                if (index[w] == unvisited) {
+                    index[w] = low[w] = numVisited++;
+                    stack.push_back(w);
+                    onStack.set(w);
+                    frames.push_back({w, 0});
+                } else if (onStack.test(w)) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+            frames.pop_back();
+            if (!frames.empty()) {
+                auto parent = frames.back().node;
+                low[parent] = std::min(low[parent], low[v]);
+            }
+            if (low[v] != index[v])
+                continue;
+            size_t member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack.reset(member);
+                ret.compOf[member] = numComps;
+            } while (member != v);
+            ++numComps;
+        }
+    }
+
+    // Group the nodes by component.
+    ret.start.assign(numComps + 1, 0);
+    for (auto c : ret.compOf)
+        ++ret.start[c + 1];
+    for (size_t c = 0; c < numComps; ++c)
+        ret.start[c + 1] += ret.start[c];
+    ret.members.resize(n);
+    auto next = ret.start;
+    for (size_t v = 0; v < n; ++v)
+        ret.members[next[ret.compOf[v]]++] = v;
+    return ret;
+}
+}
+
+void BitMatrix::transitive_closure(const ParallelOptions& opts) {
+    assert(numRows == numCols && "Closure of a non-square matrix");
+    const size_t n = numRows, numWords = (n + 63) / 64;
+    auto comps = findComponents(*this);
+    const size_t numComps = comps.size();
+
+    // Put every component on the level above its highest successor, and note
+    // the components that reach themselves: those with a cycle, be it a
+    // self-loop.
+    std::vector<size_t> level(numComps, 0);
+    std::vector<char> cyclic(numComps, 0);
+    size_t numLevels = 0;
+    for (size_t c = 0; c < numComps; ++c) {
+        cyclic[c] = comps.start[c + 1] - comps.start[c] > 1;
+        for (auto i = comps.start[c]; i != comps.start[c + 1]; ++i) {
+            auto v = comps.members[i];
+            row(v).for_each_set_bit([&](size_t w) {
+                auto d = comps.compOf[w];
+                if (d != c)
+                    level[c] = std::max(level[c], level[d] + 1);
+                else if (w == v)
+                    cyclic[c] = 1;
+            });
+        }
+        numLevels = std::max(numLevels, level[c] + 1);
+    }
+    std::vector<size_t> byLevel(numComps), levelStart(numLevels + 1, 0);
+    for (auto l : level)
+        ++levelStart[l + 1];
+    for (size_t l = 0; l < numLevels; ++l)
+        levelStart[l + 1] += levelStart[l];
+    {
+        auto next = levelStart;
+        for (size_t c = 0; c < numComps; ++c)
+            byLevel[next[level[c]]++] = c;
+    }
+
+    // The row of the representative collects the closure of the component,
+    // and is then copied to the other members. A component only reads the
+    // final rows of the components below it, so the ones on a level do not
+    // interfere with each other.
+    auto closeComponent = [&](size_t c, std::vector<size_t>& succs) {
+        succs.clear();
+        for (auto i = comps.start[c]; i != comps.start[c + 1]; ++i)
+            row(comps.members[i]).for_each_set_bit([&](size_t w) {
+                auto d = comps.compOf[w];
+                if (d != c)
+                    succs.push_back(d);
+            });
+        // Successors higher up reach more, so try them first.
+        std::sort(succs.begin(), succs.end(), std::greater<size_t>());
+        succs.erase(std::unique(succs.begin(), succs.end()), succs.end());
+
+        auto rep = comps.representative(c);
+        auto acc = row(rep);
+        acc.reset();
+        if (cyclic[c])
+            for (auto i = comps.start[c]; i != comps.start[c + 1]; ++i)
+                acc.set(comps.members[i]);
+        for (auto d : succs) {
+            auto r = comps.representative(d);
+            if (acc.test(r))
+                continue;
+            orWords(acc.data(), rowData(r), numWords);
+            acc.set(r);
+        }
+        for (auto i = comps.start[c] + 1; i < comps.start[c + 1]; ++i)
+            row(comps.members[i]).assign(acc);
+    };
+
+    for (size_t l = 0; l < numLevels; ++l) {
+        auto first = levelStart[l];
+        forEachChunk(levelStart[l + 1] - first, numWords, opts,
+                     [&](size_t begin, size_t end) {
+                         std::vector<size_t> succs;
+                         for (auto i = begin; i != end; ++i)
+                             closeComponent(byLevel[first + i], succs);
+                     });
+    }
+}
+
+BitMatrix multiply(const BitMatrix& a, const BitMatrix& b,
+                   const ParallelOptions& opts) {
+    assert(a.cols() == b.rows() && "Dimension mismatch");
+    BitMatrix ret(a.rows(), b.cols());
+    const size_t aWords = (a.cols() + 63) / 64, outWords = (b.cols() + 63) / 64;
+
+    forEachChunk(a.rows(), outWords, opts, [&](size_t begin, size_t end) {
+        for (auto first = begin; first < end; first += RowBlock) {
+            auto last = std::min(first + RowBlock, end);
+            for (size_t tile = 0; tile < outWords; tile += TileWords) {
+                auto width = std::min(TileWords, outWords - tile);
+                // One word of a row of a selects from 64 rows of b.
+                for (size_t k = 0; k < aWords; ++k)
+                    for (auto i = first; i != last; ++i) {
+                        auto out = ret.rowData(i) + tile;
+                        for (auto word = a.rowData(i)[k]; word != 0;
+                             word &= word - 1) {
+                            auto j = k * 64 + detail::findFirstSet(word);
+                            orWords(out, b.rowData(j) + tile, width);
+                        }
+                    }
+            }
+        }
+    });
+    return ret;
+}
+}
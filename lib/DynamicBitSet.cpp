@@ -0,0 +1,547 @@
+#include "DataStructure/DynamicBitSet.h"
+
+#include <cstring>
+
+#ifdef DS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using ds::detail::BitOp;
+
+inline uint64_t load64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void store64(unsigned char* p, uint64_t v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+// The bitwise operations, on 64-bit words and on SIMD vectors. The binary ones
+// implement the compound assignment operators; together with First and
+// NotFirst they also express the predicates as "is op(a, b) non-zero
+// anywhere?": intersects is And, !is_subset_of is AndNot, any is First and
+// !all is NotFirst.
+struct AndOp {
+    static uint64_t word(uint64_t a, uint64_t b) { return a & b; }
+#ifdef DS_X86_DISPATCH
+    DS_TARGET("avx2") static __m256i vec(__m256i a, __m256i b) {
+        return _mm256_and_si256(a, b);
+    }
+    DS_TARGET("avx512f") static __m512i vec(__m512i a, __m512i b) {
+        return _mm512_and_si512(a, b);
+    }
+#endif
+};
+
+struct OrOp {
+    static uint64_t word(uint64_t a, uint64_t b) { return a | b; }
+#ifdef DS_X86_DISPATCH
+    DS_TARGET("avx2") static __m256i vec(__m256i a, __m256i b) {
+        return _mm256_or_si256(a, b);
+    }
+    DS_TARGET("avx512f") static __m512i vec(__m512i a, __m512i b) {
+        return _mm512_or_si512(a, b);
+    }
+#endif
+};
+
+struct XorOp {
+    static uint64_t word(uint64_t a, uint64_t b) { return a ^ b; }
+#ifdef DS_X86_DISPATCH
+    DS_TARGET("avx2") static __m256i vec(__m256i a, __m256i b) {
+        return _mm256_xor_si256(a, b);
+    }
+    DS_TARGET("avx512f") static __m512i vec(__m512i a, __m512i b) {
+        return _mm512_xor_si512(a, b);
+    }
+#endif
+};
+
+struct AndNotOp {
+    static uint64_t word(uint64_t a, uint64_t b) { return a & ~b; }
+#ifdef DS_X86_DISPATCH
+    DS_TARGET("avx2") static __m256i vec(__m256i a, __m256i b) {
+        return _mm256_andnot_si256(b, a);
+    }
+    // _mm512_andnot_si512 passes GCC an undefined vector to merge into,
+    // which -Wmaybe-uninitialized reports once inlined. The vpternlogq it
+    // compiles to anyway takes no such operand.
+    DS_TARGET("avx512f") static __m512i vec(__m512i a, __m512i b) {
+        return _mm512_ternarylogic_epi64(a, b, b, 0x30);
+    }
+#endif
+};
+
+struct FirstOp {
+    static uint64_t word(uint64_t a, uint64_t) { return a; }
+#ifdef DS_X86_DISPATCH
+    DS_TARGET("avx2") static __m256i vec(__m256i a, __m256i) { return a; }
+    DS_TARGET("avx512f") static __m512i vec(__m512i a, __m512i) { return a; }
+#endif
+};
+
+struct NotFirstOp {
+    static uint64_t word(uint64_t a, uint64_t) { return ~a; }
+#ifdef DS_X86_DISPATCH
+    DS_TARGET("avx2") static __m256i vec(__m256i a, __m256i) {
+        return _mm256_xor_si256(a, _mm256_set1_epi32(-1));
+    }
+    DS_TARGET("avx512f") static __m512i vec(__m512i a, __m512i) {
+        return _mm512_ternarylogic_epi64(a, a, a, 0x55);
+    }
+#endif
+};
+
+// Scalar kernels. They go through 64-bit words and finish with single bytes.
+// Bytes are widened to words and the result is cut back to 8 bits, which keeps
+// NotFirst from seeing the zero-extension.
+
+template <typename Op>
+void applyScalar(unsigned char* dst, const unsigned char* src, size_t n) {
+    size_t i = 0;
+    for (; n - i >= 8; i += 8)
+        store64(dst + i, Op::word(load64(dst + i), load64(src + i)));
+    for (; i != n; ++i)
+        dst[i] = static_cast<unsigned char>(Op::word(dst[i], src[i]));
+}
+
+template <typename Op>
+bool anyOfScalar(const unsigned char* a, const unsigned char* b, size_t n) {
+    size_t i = 0;
+    for (; n - i >= 8; i += 8)
+        if (Op::word(load64(a + i), load64(b + i)) != 0)
+            return true;
+    for (; i != n; ++i)
+        if ((Op::word(a[i], b[i]) & 0xFF) != 0)
+            return true;
+    return false;
+}
+
+size_t countScalar(const unsigned char* p, size_t n) {
+    size_t count = 0, i = 0;
+    for (; n - i >= 8; i += 8)
+        count += ds::detail::popcount(load64(p + i));
+    for (; i != n; ++i)
+        count += ds::detail::popcount(p[i]);
+    return count;
+}
+
+// The changed-flag kernels OR together the XOR of every old and new word, and
+// test the result once at the end.
+
+template <typename Op>
+bool applyChangedScalar(unsigned char* dst, const unsigned char* src,
+                        size_t n) {
+    uint64_t diff = 0;
+    size_t i = 0;
+    for (; n - i >= 8; i += 8) {
+        auto old = load64(dst + i);
+        auto r = Op::word(old, load64(src + i));
+        diff |= r ^ old;
+        store64(dst + i, r);
+    }
+    for (; i != n; ++i) {
+        auto r = static_cast<unsigned char>(Op::word(dst[i], src[i]));
+        diff |= r ^ dst[i];
+        dst[i] = r;
+    }
+    return diff != 0;
+}
+
+bool orAndNotScalar(unsigned char* dst, const unsigned char* gen,
+                    const unsigned char* in, const unsigned char* kill,
+                    size_t n) {
+    uint64_t diff = 0;
+    size_t i = 0;
+    for (; n - i >= 8; i += 8) {
+        auto r = load64(gen + i) | (load64(in + i) & ~load64(kill + i));
+        diff |= r ^ load64(dst + i);
+        store64(dst + i, r);
+    }
+    for (; i != n; ++i) {
+        auto r = static_cast<unsigned char>(gen[i] | (in[i] & ~kill[i]));
+        diff |= r ^ dst[i];
+        dst[i] = r;
+    }
+    return diff != 0;
+}
+
+#ifdef DS_X86_DISPATCH
+
+// The same loop as countScalar, compiled to use the popcnt instruction rather
+// than a libgcc helper.
+DS_TARGET("popcnt")
+size_t countPopcnt(const unsigned char* p, size_t n) {
+    size_t count = 0, i = 0;
+    for (; n - i >= 8; i += 8)
+        count += __builtin_popcountll(load64(p + i));
+    for (; i != n; ++i)
+        count += __builtin_popcount(p[i]);
+    return count;
+}
+
+DS_TARGET("avx2")
+__m256i loadu256(const unsigned char* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+template <typename Op>
+DS_TARGET("avx2")
+void applyAVX2(unsigned char* dst, const unsigned char* src, size_t n) {
+    size_t i = 0;
+    for (; n - i >= 64; i += 64) {
+        auto r0 = Op::vec(loadu256(dst + i), loadu256(src + i));
+        auto r1 = Op::vec(loadu256(dst + i + 32), loadu256(src + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), r0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 32), r1);
+    }
+    applyScalar<Op>(dst + i, src + i, n - i);
+}
+
+// Tests four vectors at a time, so that the early exit costs one branch per
+// 128 bytes.
+template <typename Op>
+DS_TARGET("avx2")
+bool anyOfAVX2(const unsigned char* a, const unsigned char* b, size_t n) {
+    size_t i = 0;
+    for (; n - i >= 128; i += 128) {
+        auto r0 = Op::vec(loadu256(a + i), loadu256(b + i));
+        auto r1 = Op::vec(loadu256(a + i + 32), loadu256(b + i + 32));
+        auto r2 = Op::vec(loadu256(a + i + 64), loadu256(b + i + 64));
+        auto r3 = Op::vec(loadu256(a + i + 96), loadu256(b + i + 96));
+        auto r = _mm256_or_si256(_mm256_or_si256(r0, r1),
+                                 _mm256_or_si256(r2, r3));
+        if (!_mm256_testz_si256(r, r))
+            return true;
+    }
+    for (; n - i >= 32; i += 32) {
+        auto r = Op::vec(loadu256(a + i), loadu256(b + i));
+        if (!_mm256_testz_si256(r, r))
+            return true;
+    }
+    return anyOfScalar<Op>(a + i, b + i, n - i);
+}
+
+// Counts the bits of every byte by looking up both nibbles in a 16-entry table
+// (Mula's algorithm), and sums the byte counts into 64-bit lanes with vpsadbw.
+DS_TARGET("avx2,popcnt")
+size_t countAVX2(const unsigned char* p, size_t n) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3,
+                                           2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3,
+                                           1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibbles = _mm256_set1_epi8(0x0F);
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; n - i >= 32; i += 32) {
+        auto v = loadu256(p + i);
+        auto lo = _mm256_and_si256(v, lowNibbles);
+        auto hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowNibbles);
+        auto bytes = _mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+                                     _mm256_shuffle_epi8(table, hi));
+        acc = _mm256_add_epi64(acc,
+                               _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+    size_t count = size_t(_mm256_extract_epi64(acc, 0)) +
+                   size_t(_mm256_extract_epi64(acc, 1)) +
+                   size_t(_mm256_extract_epi64(acc, 2)) +
+                   size_t(_mm256_extract_epi64(acc, 3));
+    return count + countPopcnt(p + i, n - i);
+}
+
+template <typename Op>
+DS_TARGET("avx2")
+bool applyChangedAVX2(unsigned char* dst, const unsigned char* src, size_t n) {
+    auto diff = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; n - i >= 32; i += 32) {
+        auto old = loadu256(dst + i);
+        auto r = Op::vec(old, loadu256(src + i));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(r, old));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), r);
+    }
+    bool changed = !_mm256_testz_si256(diff, diff);
+    return applyChangedScalar<Op>(dst + i, src + i, n - i) || changed;
+}
+
+DS_TARGET("avx2")
+bool orAndNotAVX2(unsigned char* dst, const unsigned char* gen,
+                  const unsigned char* in, const unsigned char* kill,
+                  size_t n) {
+    auto diff = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; n - i >= 32; i += 32) {
+        auto r = _mm256_or_si256(
+            loadu256(gen + i),
+            _mm256_andnot_si256(loadu256(kill + i), loadu256(in + i)));
+        diff = _mm256_or_si256(diff, _mm256_xor_si256(r, loadu256(dst + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), r);
+    }
+    bool changed = !_mm256_testz_si256(diff, diff);
+    return orAndNotScalar(dst + i, gen + i, in + i, kill + i, n - i) ||
+           changed;
+}
+
+// The AVX-512 kernels handle the last partial vector with masked loads and
+// stores instead of falling back to scalar code.
+DS_TARGET("avx512f,avx512bw")
+__mmask64 tailMask(size_t n) {
+    return n >= 64 ? ~__mmask64(0) : (__mmask64(1) << n) - 1;
+}
+
+DS_TARGET("avx512f")
+__m512i loadu512(const unsigned char* p) {
+    return _mm512_loadu_si512(p);
+}
+
+template <typename Op>
+DS_TARGET("avx512f,avx512bw")
+void applyAVX512(unsigned char* dst, const unsigned char* src, size_t n) {
+    size_t i = 0;
+    for (; n - i >= 64; i += 64)
+        _mm512_storeu_si512(dst + i,
+                            Op::vec(loadu512(dst + i), loadu512(src + i)));
+    if (i != n) {
+        auto mask = tailMask(n - i);
+        auto r = Op::vec(_mm512_maskz_loadu_epi8(mask, dst + i),
+                         _mm512_maskz_loadu_epi8(mask, src + i));
+        _mm512_mask_storeu_epi8(dst + i, mask, r);
+    }
+}
+
+template <typename Op>
+DS_TARGET("avx512f,avx512bw")
+bool anyOfAVX512(const unsigned char* a, const unsigned char* b, size_t n) {
+    size_t i = 0;
+    for (; n - i >= 256; i += 256) {
+        auto r0 = Op::vec(loadu512(a + i), loadu512(b + i));
+        auto r1 = Op::vec(loadu512(a + i + 64), loadu512(b + i + 64));
+        auto r2 = Op::vec(loadu512(a + i + 128), loadu512(b + i + 128));
+        auto r3 = Op::vec(loadu512(a + i + 192), loadu512(b + i + 192));
+        auto r = _mm512_or_si512(_mm512_or_si512(r0, r1),
+                                 _mm512_or_si512(r2, r3));
+        if (_mm512_test_epi64_mask(r, r) != 0)
+            return true;
+    }
+    for (; n - i >= 64; i += 64) {
+        auto r = Op::vec(loadu512(a + i), loadu512(b + i));
+        if (_mm512_test_epi64_mask(r, r) != 0)
+            return true;
+    }
+    if (i == n)
+        return false;
+    // Bytes past the end load as zero, which NotFirst turns into ones, so only
+    // the bytes inside the range are tested.
+    auto mask = tailMask(n - i);
+    auto r = Op::vec(_mm512_maskz_loadu_epi8(mask, a + i),
+                     _mm512_maskz_loadu_epi8(mask, b + i));
+    return _mm512_mask_test_epi8_mask(mask, r, r) != 0;
+}
+
+template <typename Op>
+DS_TARGET("avx512f,avx512bw")
+bool applyChangedAVX512(unsigned char* dst, const unsigned char* src,
+                        size_t n) {
+    auto diff = _mm512_setzero_si512();
+    for (size_t i = 0; i < n; i += 64) {
+        auto mask = tailMask(n - i);
+        auto old = _mm512_maskz_loadu_epi8(mask, dst + i);
+        auto r = Op::vec(old, _mm512_maskz_loadu_epi8(mask, src + i));
+        // diff | (r ^ old)
+        diff = _mm512_ternarylogic_epi64(diff, r, old, 0xF6);
+        _mm512_mask_storeu_epi8(dst + i, mask, r);
+    }
+    return _mm512_test_epi64_mask(diff, diff) != 0;
+}
+
+// gen | (in & ~kill) is a single vpternlogq. Bytes past the end load as zero
+// in every operand, so they never count as changed.
+DS_TARGET("avx512f,avx512bw")
+bool orAndNotAVX512(unsigned char* dst, const unsigned char* gen,
+                    const unsigned char* in, const unsigned char* kill,
+                    size_t n) {
+    auto diff = _mm512_setzero_si512();
+    for (size_t i = 0; i < n; i += 64) {
+        auto mask = tailMask(n - i);
+        auto r = _mm512_ternarylogic_epi64(
+            _mm512_maskz_loadu_epi8(mask, gen + i),
+            _mm512_maskz_loadu_epi8(mask, in + i),
+            _mm512_maskz_loadu_epi8(mask, kill + i), 0xF4);
+        diff = _mm512_ternarylogic_epi64(
+            diff, r, _mm512_maskz_loadu_epi8(mask, dst + i), 0xF6);
+        _mm512_mask_storeu_epi8(dst + i, mask, r);
+    }
+    return _mm512_test_epi64_mask(diff, diff) != 0;
+}
+
+DS_TARGET("avx512f,avx512bw,avx512vpopcntdq")
+size_t countAVX512(const unsigned char* p, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; n - i >= 64; i += 64)
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(loadu512(p + i)));
+    if (i != n)
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi8(
+                                        tailMask(n - i), p + i)));
+    // Sum the lanes by hand: _mm512_reduce_add_epi64 goes through undefined
+    // vectors that trip -Wmaybe-uninitialized, which the zeroing extracts
+    // here do not.
+    auto half = _mm256_add_epi64(_mm512_maskz_extracti64x4_epi64(0xF, acc, 0),
+                                 _mm512_maskz_extracti64x4_epi64(0xF, acc, 1));
+    return size_t(_mm256_extract_epi64(half, 0)) +
+           size_t(_mm256_extract_epi64(half, 1)) +
+           size_t(_mm256_extract_epi64(half, 2)) +
+           size_t(_mm256_extract_epi64(half, 3));
+}
+
+// VPOPCNTQ is an extension of its own that not every AVX-512 CPU has.
+bool hostHasVectorPopcount() {
+    static const bool has = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512vpopcntdq") != 0;
+    }();
+    return has;
+}
+
+#endif
+
+template <typename Op>
+void apply(unsigned char* dst, const unsigned char* src, size_t n) {
+#ifdef DS_X86_DISPATCH
+    switch (ds::detail::hostSIMDLevel()) {
+    case ds::detail::SIMDLevel::AVX512:
+        return applyAVX512<Op>(dst, src, n);
+    case ds::detail::SIMDLevel::AVX2:
+        return applyAVX2<Op>(dst, src, n);
+    default:
+        break;
+    }
+#endif
+    applyScalar<Op>(dst, src, n);
+}
+
+template <typename Op>
+bool anyOf(const void* a, const void* b, size_t n) {
+    auto pa = static_cast<const unsigned char*>(a);
+    auto pb = static_cast<const unsigned char*>(b);
+#ifdef DS_X86_DISPATCH
+    switch (ds::detail::hostSIMDLevel()) {
+    case ds::detail::SIMDLevel::AVX512:
+        return anyOfAVX512<Op>(pa, pb, n);
+    case ds::detail::SIMDLevel::AVX2:
+        return anyOfAVX2<Op>(pa, pb, n);
+    default:
+        break;
+    }
+#endif
+    return anyOfScalar<Op>(pa, pb, n);
+}
+
+template <typename Op>
+bool applyChanged(unsigned char* dst, const unsigned char* src, size_t n) {
+#ifdef DS_X86_DISPATCH
+    switch (ds::detail::hostSIMDLevel()) {
+    case ds::detail::SIMDLevel::AVX512:
+        return applyChangedAVX512<Op>(dst, src, n);
+    case ds::detail::SIMDLevel::AVX2:
+        return applyChangedAVX2<Op>(dst, src, n);
+    default:
+        break;
+    }
+#endif
+    return applyChangedScalar<Op>(dst, src, n);
+}
+}
+
+namespace ds {
+namespace detail {
+
+void bitsApply(BitOp op, void* dst, const void* src, size_t numBytes) {
+    auto d = static_cast<unsigned char*>(dst);
+    auto s = static_cast<const unsigned char*>(src);
+    switch (op) {
+    case BitOp::And:
+        return apply<AndOp>(d, s, numBytes);
+    case BitOp::Or:
+        return apply<OrOp>(d, s, numBytes);
+    case BitOp::Xor:
+        return apply<XorOp>(d, s, numBytes);
+    case BitOp::AndNot:
+        return apply<AndNotOp>(d, s, numBytes);
+    }
+}
+
+bool bitsApplyChanged(BitOp op, void* dst, const void* src, size_t numBytes) {
+    auto d = static_cast<unsigned char*>(dst);
+    auto s = static_cast<const unsigned char*>(src);
+    switch (op) {
+    case BitOp::And:
+        return applyChanged<AndOp>(d, s, numBytes);
+    case BitOp::Or:
+        return applyChanged<OrOp>(d, s, numBytes);
+    case BitOp::Xor:
+        return applyChanged<XorOp>(d, s, numBytes);
+    case BitOp::AndNot:
+        return applyChanged<AndNotOp>(d, s, numBytes);
+    }
+    return false;
+}
+
+bool bitsOrAndNot(void* dst, const void* gen, const void* in, const void* kill,
+                  size_t numBytes) {
+    auto d = static_cast<unsigned char*>(dst);
+    auto g = static_cast<const unsigned char*>(gen);
+    auto i = static_cast<const unsigned char*>(in);
+    auto k = static_cast<const unsigned char*>(kill);
+#ifdef DS_X86_DISPATCH
+    switch (hostSIMDLevel()) {
+    case SIMDLevel::AVX512:
+        return orAndNotAVX512(d, g, i, k, numBytes);
+    case SIMDLevel::AVX2:
+        return orAndNotAVX2(d, g, i, k, numBytes);
+    default:
+        break;
+    }
+#endif
+    return orAndNotScalar(d, g, i, k, numBytes);
+}
+
+size_t bitsCount(const void* data, size_t numBytes) {
+    auto p = static_cast<const unsigned char*>(data);
+#ifdef DS_X86_DISPATCH
+    switch (hostSIMDLevel()) {
+    case SIMDLevel::AVX512:
+        if (hostHasVectorPopcount())
+            return countAVX512(p, numBytes);
+        return countAVX2(p, numBytes);
+    case SIMDLevel::AVX2:
+        return countAVX2(p, numBytes);
+    case SIMDLevel::SSE42:
+        return countPopcnt(p, numBytes);
+    default:
+        break;
+    }
+#endif
+    return countScalar(p, numBytes);
+}
+
+bool bitsAny(const void* data, size_t numBytes) {
+    return anyOf<FirstOp>(data, data, numBytes);
+}
+
+bool bitsAllOnes(const void* data, size_t numBytes) {
+    return !anyOf<NotFirstOp>(data, data, numBytes);
+}
+
+bool bitsIntersect(const void* lhs, const void* rhs, size_t numBytes) {
+    return anyOf<AndOp>(lhs, rhs, numBytes);
+}
+
+bool bitsSubset(const void* lhs, const void* rhs, size_t numBytes) {
+    return !anyOf<AndNotOp>(lhs, rhs, numBytes);
+}
+}
+}
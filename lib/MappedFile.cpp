@@ -0,0 +1,149 @@
+#include "DataStructure/MappedFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+[[noreturn]] void throwSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+int toAdvice(ds::MappedFile::AccessHint hint) {
+    switch (hint) {
+    case ds::MappedFile::AccessHint::Sequential:
+        return MADV_SEQUENTIAL;
+    case ds::MappedFile::AccessHint::Random:
+        return MADV_RANDOM;
+    case ds::MappedFile::AccessHint::Normal:
+        break;
+    }
+    return MADV_NORMAL;
+}
+}
+
+namespace ds {
+
+MappedFile::MappedFile(const std::string& path, AccessHint hint)
+    : data(nullptr), length(0) {
+    int fd;
+    do {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0)
+        throwSystemError("cannot open " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        throwSystemError("cannot stat " + path);
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        return;
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    // The mapping keeps its own reference to the file.
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        errno = err;
+        throwSystemError("cannot map " + path);
+    }
+
+    // The hints are only advisory, so failures are ignored.
+    ::madvise(addr, size, toAdvice(hint));
+    if (hint == AccessHint::Sequential)
+        ::madvise(addr, size, MADV_WILLNEED);
+
+    data = static_cast<const char*>(addr);
+    length = size;
+}
+
+void MappedFile::unmap() {
+    if (data != nullptr)
+        ::munmap(const_cast<char*>(data), length);
+    data = nullptr;
+    length = 0;
+}
+
+std::vector<StringView> splitIntoChunks(StringView text, size_t numChunks,
+                                        char delimiter) {
+    std::vector<StringView> ret;
+    if (text.empty())
+        return ret;
+    if (numChunks == 0)
+        numChunks = 1;
+
+    size_t chunkSize = (text.size() + numChunks - 1) / numChunks;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.size();
+        if (text.size() - begin > chunkSize) {
+            auto idx = text.find(delimiter, begin + chunkSize - 1);
+            if (idx != StringView::npos)
+                end = idx + 1;
+        }
+        ret.push_back(text.slice(begin, end));
+        begin = end;
+    }
+    return ret;
+}
+
+void forEachChunk(StringView text, unsigned numThreads,
+                  const std::function<void(size_t, StringView)>& fn,
+                  char delimiter) {
+    if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    auto chunks = splitIntoChunks(text, numThreads, delimiter);
+    if (chunks.size() <= 1) {
+        if (!chunks.empty())
+            fn(0, chunks[0]);
+        return;
+    }
+
+    std::exception_ptr error;
+    std::mutex errorLock;
+    auto run = [&](size_t idx) {
+        try {
+            fn(idx, chunks[idx]);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(errorLock);
+            if (!error)
+                error = std::current_exception();
+        }
+    };
+
+    // The calling thread takes the first chunk itself.
+    std::vector<std::thread> threads;
+    threads.reserve(chunks.size() - 1);
+    try {
+        for (size_t i = 1; i != chunks.size(); ++i)
+            threads.emplace_back(run, i);
+    } catch (...) {
+        // Destroying a joinable std::thread terminates the program, so wait
+        // for the threads that did start before reporting the failure.
+        for (auto& t : threads)
+            t.join();
+        throw;
+    }
+    run(0);
+    for (auto& t : threads)
+        t.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+}
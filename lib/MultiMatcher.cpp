@@ -0,0 +1,179 @@
+#include "DataStructure/MultiMatcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// Mode::Auto builds the DFA only if its table has at most this many entries.
+static constexpr size_t AutoDFAMaxEntries = 1 << 20;
+
+// The trie as it is being built. Children are kept unsorted in a small vector
+// per state and are flattened into the compact layout afterwards.
+struct TrieBuilder {
+    std::vector<std::vector<std::pair<unsigned char, uint32_t>>> children;
+    std::vector<std::vector<uint32_t>> outputs;
+
+    TrieBuilder() : children(1), outputs(1) {}
+
+    uint32_t child(uint32_t s, unsigned char c) const {
+        for (auto& edge : children[s])
+            if (edge.first == c)
+                return edge.second;
+        return std::numeric_limits<uint32_t>::max();
+    }
+
+    uint32_t addChild(uint32_t s, unsigned char c) {
+        auto next = child(s, c);
+        if (next != std::numeric_limits<uint32_t>::max())
+            return next;
+        next = static_cast<uint32_t>(children.size());
+        children.emplace_back();
+        outputs.emplace_back();
+        children[s].emplace_back(c, next);
+        return next;
+    }
+};
+}
+
+namespace ds {
+
+constexpr MultiMatcher::StateID MultiMatcher::Root;
+constexpr MultiMatcher::StateID MultiMatcher::NoState;
+
+void MultiMatcher::build(ArrayRef<StringView> patterns, Mode mode) {
+    // Copy the patterns and insert them into the trie.
+    TrieBuilder trie;
+    patternOffsets.reserve(patterns.size() + 1);
+    patternOffsets.push_back(0);
+    for (unsigned i = 0, e = patterns.size(); i != e; ++i) {
+        auto pattern = patterns[i];
+        patternData.append(pattern.data(), pattern.size());
+        patternOffsets.push_back(static_cast<uint32_t>(patternData.size()));
+        if (pattern.empty())
+            continue;
+
+        uint32_t s = Root;
+        for (char c : pattern)
+            s = trie.addChild(s, static_cast<unsigned char>(c));
+        trie.outputs[s].push_back(i);
+    }
+
+    // Flatten the trie into the compact layout.
+    auto numStates = trie.children.size();
+    edgeBegin.reserve(numStates + 1);
+    outputBegin.reserve(numStates + 1);
+    for (size_t s = 0; s != numStates; ++s) {
+        auto& edges = trie.children[s];
+        std::sort(edges.begin(), edges.end());
+        edgeBegin.push_back(static_cast<uint32_t>(edgeLabels.size()));
+        for (auto& edge : edges) {
+            edgeLabels.push_back(edge.first);
+            edgeTargets.push_back(edge.second);
+        }
+        outputBegin.push_back(static_cast<uint32_t>(outputs.size()));
+        outputs.insert(outputs.end(), trie.outputs[s].begin(),
+                       trie.outputs[s].end());
+    }
+    edgeBegin.push_back(static_cast<uint32_t>(edgeLabels.size()));
+    outputBegin.push_back(static_cast<uint32_t>(outputs.size()));
+
+    for (unsigned c = 0; c != 256; ++c)
+        rootNext[c] = Root;
+    for (auto& edge : trie.children[Root])
+        rootNext[edge.first] = edge.second;
+
+    // Compute failure and output links in breadth-first order, so that every
+    // state's failure target is finished before the state itself.
+    failLinks.assign(numStates, Root);
+    reportFrom.assign(numStates, NoState);
+    outputLinks.assign(numStates, NoState);
+    std::vector<StateID> queue;
+    queue.reserve(numStates);
+    queue.push_back(Root);
+    for (size_t head = 0; head != queue.size(); ++head) {
+        auto s = queue[head];
+        for (auto i = edgeBegin[s], e = edgeBegin[s + 1]; i != e; ++i) {
+            auto c = edgeLabels[i];
+            auto next = edgeTargets[i];
+            auto fail = s == Root ? Root : stepCompact(failLinks[s], c);
+            failLinks[next] = fail;
+            outputLinks[next] = reportFrom[fail];
+            reportFrom[next] = outputBegin[next] != outputBegin[next + 1]
+                                   ? next
+                                   : outputLinks[next];
+            queue.push_back(next);
+        }
+    }
+
+    // The byte classes: every byte that occurs in some pattern gets a class
+    // of its own, all other bytes share class 0.
+    std::memset(byteClass, 0, sizeof(byteClass));
+    numClasses = 1;
+    for (auto c : edgeLabels) {
+        if (byteClass[c] == 0)
+            byteClass[c] = static_cast<uint16_t>(numClasses++);
+    }
+
+    switch (mode) {
+    case Mode::Compact:
+        useDFA = false;
+        break;
+    case Mode::DFA:
+        useDFA = true;
+        break;
+    case Mode::Auto:
+        useDFA = numStates * numClasses <= AutoDFAMaxEntries;
+        break;
+    }
+    if (useDFA)
+        buildDFA();
+}
+
+void MultiMatcher::buildDFA() {
+    auto numStates = failLinks.size();
+    dfaTable.assign(numStates * numClasses, Root);
+
+    // A representative byte for each class (class 0 always leads to the root).
+    unsigned char classByte[257] = {0};
+    for (unsigned c = 0; c != 256; ++c)
+        classByte[byteClass[c]] = static_cast<unsigned char>(c);
+
+    // Failure targets are strictly shallower than their source, so filling
+    // the rows in breadth-first order lets us copy missing transitions from
+    // the already completed row of the failure target.
+    std::vector<StateID> queue;
+    queue.reserve(numStates);
+    queue.push_back(Root);
+    for (size_t head = 0; head != queue.size(); ++head) {
+        auto s = queue[head];
+        auto row = dfaTable.data() + size_t(s) * numClasses;
+        auto failRow = dfaTable.data() + size_t(failLinks[s]) * numClasses;
+        for (unsigned k = 1; k != numClasses; ++k)
+            row[k] = s == Root ? rootNext[classByte[k]] : failRow[k];
+        for (auto i = edgeBegin[s], e = edgeBegin[s + 1]; i != e; ++i) {
+            row[byteClass[edgeLabels[i]]] = edgeTargets[i];
+            queue.push_back(edgeTargets[i]);
+        }
+    }
+}
+
+std::vector<MultiMatcher::Match> MultiMatcher::findAll(StringView text) const {
+    std::vector<Match> ret;
+    scan(text, [&ret](const Match& m) { ret.push_back(m); });
+    return ret;
+}
+
+bool MultiMatcher::containsAny(StringView text) const {
+    auto p = reinterpret_cast<const unsigned char*>(text.data());
+    StateID s = Root;
+    for (size_t i = 0, e = text.size(); i != e; ++i) {
+        s = useDFA ? stepDFA(s, p[i]) : stepCompact(s, p[i]);
+        if (reportFrom[s] != NoState)
+            return true;
+    }
+    return false;
+}
+}
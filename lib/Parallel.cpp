@@ -0,0 +1,201 @@
+#include "DataStructure/Parallel.h"
+
+#include <deque>
+#include <exception>
+
+namespace ds {
+
+// A batch of tasks submitted through run().
+struct ThreadPool::Job {
+    const std::function<void(size_t)>* task;
+    std::atomic<size_t> remaining;
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+
+    Job(const std::function<void(size_t)>& task, size_t numTasks)
+        : task(&task), remaining(numTasks) {}
+};
+
+// The tasks [begin, end) of a job.
+struct ThreadPool::WorkItem {
+    Job* job;
+    size_t begin, end;
+};
+
+struct ThreadPool::Deque {
+    std::mutex mutex;
+    std::deque<WorkItem> items;
+};
+
+namespace {
+// The pool the current thread works for, and the index of its deque.
+thread_local ThreadPool* currentPool = nullptr;
+thread_local size_t currentDeque = 0;
+}
+
+ThreadPool::ThreadPool(unsigned numThreads)
+    : numThreads(std::max(1u, numThreads)), numPending(0), stopping(false) {
+    for (unsigned i = 0; i != this->numThreads; ++i)
+        deques.emplace_back(new Deque());
+    workers.reserve(this->numThreads - 1);
+    for (unsigned i = 0; i + 1 < this->numThreads; ++i)
+        workers.emplace_back([this, i] { workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::getDefault() {
+    static ThreadPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
+
+size_t ThreadPool::getOwnDeque() const {
+    // Threads outside the pool share the last deque.
+    return currentPool == this ? currentDeque : deques.size() - 1;
+}
+
+void ThreadPool::push(size_t dequeIdx, const WorkItem& item) {
+    // Count the item before it becomes visible, so that the count never drops
+    // below zero. A thread that wakes up early simply looks again.
+    numPending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> guard(deques[dequeIdx]->mutex);
+        deques[dequeIdx]->items.push_back(item);
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+bool ThreadPool::pop(size_t dequeIdx, WorkItem& item) {
+    if (numPending.load() == 0)
+        return false;
+
+    // Take the most recently pushed item of our own deque, which is the
+    // smallest and the most likely to be in cache.
+    {
+        auto& own = *deques[dequeIdx];
+        std::lock_guard<std::mutex> guard(own.mutex);
+        if (!own.items.empty()) {
+            item = own.items.back();
+            own.items.pop_back();
+            numPending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Otherwise steal the oldest, hence largest, item of someone else.
+    for (size_t i = 1; i != deques.size(); ++i) {
+        auto& victim = *deques[(dequeIdx + i) % deques.size()];
+        std::lock_guard<std::mutex> guard(victim.mutex);
+        if (!victim.items.empty()) {
+            item = victim.items.front();
+            victim.items.pop_front();
+            numPending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(size_t dequeIdx, WorkItem item) {
+    // Split the range until a single task is left, leaving the upper halves
+    // for others to steal.
+    while (item.end - item.begin > 1) {
+        size_t mid = item.begin + (item.end - item.begin) / 2;
+        push(dequeIdx, WorkItem{item.job, mid, item.end});
+        item.end = mid;
+    }
+
+    Job& job = *item.job;
+    try {
+        (*job.task)(item.begin);
+    } catch (...) {
+        std::lock_guard<std::mutex> guard(job.mutex);
+        if (!job.error)
+            job.error = std::current_exception();
+    }
+    // Decrement and notify under the lock: once remaining reaches zero, run()
+    // may return and destroy the job, so the last finisher must be done with
+    // it by the time run() can acquire the mutex.
+    std::lock_guard<std::mutex> guard(job.mutex);
+    if (job.remaining.fetch_sub(1) == 1)
+        job.done.notify_all();
+}
+
+void ThreadPool::workerLoop(size_t idx) {
+    currentPool = this;
+    currentDeque = idx;
+    while (true) {
+        WorkItem item;
+        if (pop(idx, item)) {
+            execute(idx, item);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this] { return stopping || numPending.load(); });
+        if (stopping && numPending.load() == 0)
+            return;
+    }
+}
+
+void ThreadPool::run(size_t numTasks, const std::function<void(size_t)>& task) {
+    if (numTasks == 0)
+        return;
+    if (numThreads == 1 || numTasks == 1) {
+        for (size_t i = 0; i != numTasks; ++i)
+            task(i);
+        return;
+    }
+
+    Job job(task, numTasks);
+    size_t own = getOwnDeque();
+    execute(own, WorkItem{&job, 0, numTasks});
+
+    // Help out until the job is done. The items we pick up may belong to other
+    // jobs, which is what keeps nested calls from deadlocking. When there is
+    // nothing left to pick up, the remaining tasks are running elsewhere, and
+    // their finishers will wake us up.
+    WorkItem item;
+    while (job.remaining.load() != 0 && pop(own, item))
+        execute(own, item);
+
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.done.wait(lock, [&job] { return job.remaining.load() == 0; });
+    if (job.error)
+        std::rethrow_exception(job.error);
+}
+
+namespace detail {
+
+Chunking computeChunking(size_t numElems, size_t elemSize,
+                         const ParallelOptions& opts) {
+    unsigned numThreads = getPool(opts).getNumThreads();
+    if (numElems < opts.serialCutoff || numThreads == 1 || numElems < 2)
+        return Chunking{numElems, 1};
+
+    // A few chunks per thread even out differences in the cost of elements
+    // and in the speed of threads.
+    size_t numChunks = size_t(numThreads) * 4;
+    size_t chunkSize = (numElems + numChunks - 1) / numChunks;
+
+    // Round the chunk size up to whole cache lines.
+    if (elemSize < CacheLineSize) {
+        size_t perLine = CacheLineSize / elemSize;
+        chunkSize = (chunkSize + perLine - 1) / perLine * perLine;
+    }
+    return Chunking{chunkSize, (numElems + chunkSize - 1) / chunkSize};
+}
+}
+}
@@ -0,0 +1,129 @@
+#include "DataStructure/RankSelect.h"
+
+#ifdef DS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace ds {
+
+namespace {
+
+unsigned selectInWordScalar(uint64_t word, unsigned k) {
+    // Find the byte that holds the bit, then clear the set bits before it.
+    unsigned shift = 0;
+    for (;; shift += 8) {
+        auto n = static_cast<unsigned>(
+            detail::popcount((word >> shift) & 0xFF));
+        if (k < n)
+            break;
+        k -= n;
+    }
+    word >>= shift;
+    for (; k != 0; --k)
+        word &= word - 1;
+    return shift + detail::findFirstSet(word);
+}
+
+#ifdef DS_X86_DISPATCH
+
+// PDEP deposits a single bit at the position of the k-th set bit of the word.
+DS_TARGET("bmi,bmi2") unsigned selectInWordBMI2(uint64_t word, unsigned k) {
+    return static_cast<unsigned>(_tzcnt_u64(_pdep_u64(uint64_t(1) << k, word)));
+}
+
+bool hostHasBMI2() {
+    static const bool has = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2") != 0;
+    }();
+    return has;
+}
+
+#endif
+
+// The position of the k-th set bit of word, which has more than k.
+unsigned selectInWord(uint64_t word, unsigned k) {
+#ifdef DS_X86_DISPATCH
+    if (hostHasBMI2())
+        return selectInWordBMI2(word, k);
+#endif
+    return selectInWordScalar(word, k);
+}
+}
+
+constexpr RankSelectIndex::size_type RankSelectIndex::npos;
+constexpr RankSelectIndex::size_type RankSelectIndex::LowerBlockBits;
+constexpr RankSelectIndex::size_type RankSelectIndex::BasicBlockWords;
+constexpr RankSelectIndex::size_type RankSelectIndex::UpperBlockShift;
+constexpr RankSelectIndex::size_type RankSelectIndex::SelectSampleRate;
+
+void RankSelectIndex::build() {
+    // One entry more than there are lower blocks, so that rank(size()) does
+    // not need a special case.
+    const size_type numLower = (numBits + LowerBlockBits - 1) / LowerBlockBits;
+    const size_type wordsPerLower = LowerBlockBits / 64;
+    entries.reserve(numLower + 1);
+    upper.reserve((numLower >> UpperBlockShift) + 1);
+    samples.reserve(numBits / SelectSampleRate + 1);
+
+    for (size_type block = 0; block <= numLower; ++block) {
+        if ((block & ((size_type(1) << UpperBlockShift) - 1)) == 0)
+            upper.push_back(total);
+        uint64_t entry = total - upper.back();
+        size_type count = 0;
+        for (size_type basic = 0; basic != 4; ++basic) {
+            size_type basicCount = 0;
+            auto first = block * wordsPerLower + basic * BasicBlockWords;
+            auto last = std::min(first + BasicBlockWords, numWords);
+            for (auto i = first; i < last; ++i)
+                basicCount +=
+                    static_cast<size_type>(detail::popcount(loadWord(i)));
+            if (basic != 3)
+                entry |= uint64_t(basicCount) << (32 + 10 * basic);
+            count += basicCount;
+        }
+        entries.push_back(entry);
+        total += count;
+        while (samples.size() * SelectSampleRate < total)
+            samples.push_back(static_cast<uint32_t>(block));
+    }
+}
+
+RankSelectIndex::size_type RankSelectIndex::select(size_type k) const {
+    if (k >= total)
+        return npos;
+
+    // The k-th set bit lies between the lower blocks of the samples around it.
+    // Find the last lower block that starts with at most k set bits.
+    auto sample = k / SelectSampleRate;
+    size_type lo = samples[sample];
+    size_type hi = sample + 1 < samples.size() ? samples[sample + 1] + 1
+                                               : entries.size() - 1;
+    while (hi - lo > 1) {
+        auto mid = lo + (hi - lo) / 2;
+        if (lowerRank(mid) <= k)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    // Then narrow it down to a basic block, and to a word.
+    k -= lowerRank(lo);
+    auto entry = entries[lo];
+    auto word = lo * (LowerBlockBits / 64);
+    for (unsigned basic = 0; basic != 3; ++basic) {
+        auto count = (entry >> (32 + 10 * basic)) & 0x3FF;
+        if (k < count)
+            break;
+        k -= count;
+        word += BasicBlockWords;
+    }
+    for (;; ++word) {
+        auto bits = loadWord(word);
+        auto count = static_cast<size_type>(detail::popcount(bits));
+        if (k < count)
+            return word * 64 + selectInWord(bits, static_cast<unsigned>(k));
+        k -= count;
+    }
+}
+}
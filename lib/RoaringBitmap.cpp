@@ -0,0 +1,982 @@
+#include "DataStructure/RoaringBitmap.h"
+#include "DataStructure/DynamicBitSet.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef DS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using ds::detail::BitOp;
+using ds::detail::RoaringContainer;
+using Kind = RoaringContainer::Kind;
+
+const uint32_t MaxArraySize = RoaringContainer::MaxArraySize;
+const size_t BitmapWords = RoaringContainer::BitmapWords;
+const size_t BitmapBytes = BitmapWords * sizeof(uint64_t);
+
+uint32_t countBits(const uint64_t* words) {
+    return static_cast<uint32_t>(ds::detail::bitsCount(words, BitmapBytes));
+}
+
+// Sets bits [first, last] of a bitmap.
+void setBitRange(uint64_t* words, uint32_t first, uint32_t last) {
+    size_t firstWord = first / 64, lastWord = last / 64;
+    uint64_t firstMask = ~uint64_t(0) << (first % 64);
+    uint64_t lastMask = ~uint64_t(0) >> (63 - last % 64);
+    if (firstWord == lastWord) {
+        words[firstWord] |= firstMask & lastMask;
+        return;
+    }
+    words[firstWord] |= firstMask;
+    for (size_t i = firstWord + 1; i < lastWord; ++i)
+        words[i] = ~uint64_t(0);
+    words[lastWord] |= lastMask;
+}
+
+// Array intersection. Lists of very different lengths are intersected by
+// searching the longer one for every value of the shorter one, with galloping
+// so that the searches only look ahead. Otherwise the lists are merged, eight
+// values at a time with SSE4.2 where available. out may be a, as no value is
+// written before it is read.
+
+size_t gallop(const uint16_t* p, size_t pos, size_t n, uint16_t v) {
+    size_t step = 1;
+    while (pos + step < n && p[pos + step] < v)
+        step *= 2;
+    return std::lower_bound(p + pos, p + std::min(pos + step + 1, n), v) - p;
+}
+
+size_t intersectGalloping(const uint16_t* small, size_t numSmall,
+                          const uint16_t* large, size_t numLarge,
+                          uint16_t* out) {
+    size_t k = 0, j = 0;
+    for (size_t i = 0; i != numSmall && j != numLarge; ++i) {
+        j = gallop(large, j, numLarge, small[i]);
+        if (j != numLarge && large[j] == small[i])
+            out[k++] = small[i];
+    }
+    return k;
+}
+
+size_t intersectScalar(const uint16_t* a, size_t na, const uint16_t* b,
+                       size_t nb, uint16_t* out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i != na && j != nb) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            out[k++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return k;
+}
+
+#ifdef DS_X86_DISPATCH
+
+// Compares eight values of a against eight values of b at once (Schlegel et
+// al.). The mask of PCMPESTRM has a bit for every value of a that equals any
+// value of b; then the block with the smaller maximum is done.
+DS_TARGET("sse4.2")
+size_t intersectSSE42(const uint16_t* a, size_t na, const uint16_t* b,
+                      size_t nb, uint16_t* out) {
+    const int mode = _SIDD_UWORD_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+    size_t i = 0, j = 0, k = 0;
+    while (na - i >= 8 && nb - j >= 8) {
+        auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        auto maxA = static_cast<uint16_t>(_mm_extract_epi16(va, 7));
+        auto maxB = static_cast<uint16_t>(_mm_extract_epi16(vb, 7));
+        auto mask = static_cast<unsigned>(
+            _mm_cvtsi128_si32(_mm_cmpestrm(vb, 8, va, 8, mode)));
+        for (; mask != 0; mask &= mask - 1)
+            out[k++] = a[i + __builtin_ctz(mask)];
+        if (maxA <= maxB)
+            i += 8;
+        if (maxB <= maxA)
+            j += 8;
+    }
+    return k + intersectScalar(a + i, na - i, b + j, nb - j, out + k);
+}
+
+#endif
+
+size_t intersectArrays(const uint16_t* a, size_t na, const uint16_t* b,
+                       size_t nb, uint16_t* out) {
+    if (na * 32 < nb)
+        return intersectGalloping(a, na, b, nb, out);
+    if (nb * 32 < na)
+        return intersectGalloping(b, nb, a, na, out);
+#ifdef DS_X86_DISPATCH
+    if (ds::detail::hostSIMDLevel() != ds::detail::SIMDLevel::Scalar)
+        return intersectSSE42(a, na, b, nb, out);
+#endif
+    return intersectScalar(a, na, b, nb, out);
+}
+
+// Appends the run [first, last] to a run list, merging it with the last run if
+// they overlap or touch. Runs have to be appended in order of their starts.
+void appendRun(std::vector<uint16_t>& runs, uint32_t first, uint32_t last) {
+    if (!runs.empty()) {
+        size_t n = runs.size();
+        uint32_t prevLast = uint32_t(runs[n - 2]) + runs[n - 1];
+        if (first <= prevLast + 1) {
+            if (last > prevLast)
+                runs[n - 1] = static_cast<uint16_t>(last - runs[n - 2]);
+            return;
+        }
+    }
+    runs.push_back(static_cast<uint16_t>(first));
+    runs.push_back(static_cast<uint16_t>(last - first));
+}
+
+uint32_t countRunValues(const std::vector<uint16_t>& runs) {
+    uint32_t ret = 0;
+    for (size_t i = 1; i < runs.size(); i += 2)
+        ret += uint32_t(runs[i]) + 1;
+    return ret;
+}
+
+// The number of runs the values of a container would form.
+size_t countRuns(const RoaringContainer& c) {
+    switch (c.kind) {
+    case Kind::Array: {
+        size_t ret = c.card != 0;
+        for (size_t i = 1; i < c.card; ++i)
+            ret += c.values[i] != c.values[i - 1] + 1;
+        return ret;
+    }
+    case Kind::Bitmap: {
+        // Count the set bits whose lower neighbour is clear.
+        size_t ret = 0;
+        uint64_t carry = 0;
+        for (auto word : c.words) {
+            ret += ds::detail::popcount(word & ~((word << 1) | carry));
+            carry = word >> 63;
+        }
+        return ret;
+    }
+    case Kind::Run:
+        return c.numRuns();
+    }
+    return 0;
+}
+
+// The space a container takes in the serialized format, and so the measure of
+// which kind is best.
+size_t serializedBytes(Kind kind, uint32_t card, size_t numRuns) {
+    switch (kind) {
+    case Kind::Array:
+        return card * sizeof(uint16_t);
+    case Kind::Bitmap:
+        return BitmapBytes;
+    case Kind::Run:
+        return sizeof(uint16_t) + numRuns * 2 * sizeof(uint16_t);
+    }
+    return 0;
+}
+
+// The portable serialized format, as specified by the Roaring libraries. All
+// integers are little-endian.
+//
+// * A cookie. Bitmaps without run containers write SerialCookieNoRuns and the
+//   number of containers as two 32-bit words. Bitmaps with runs write
+//   SerialCookie in the low 16 bits and the number of containers minus one in
+//   the high 16 bits, followed by a bit set that marks the run containers.
+// * For every container, its key and its cardinality minus one, as 16-bit
+//   integers.
+// * For every container, the 32-bit offset of its data from the start of the
+//   stream. Bitmaps with runs leave this out if they have fewer than
+//   NoOffsetThreshold containers.
+// * The containers. Runs are a 16-bit count followed by (start, length - 1)
+//   pairs. Other containers are sorted 16-bit arrays if they hold at most
+//   4096 values and 1024 64-bit words otherwise.
+const uint32_t SerialCookieNoRuns = 12346;
+const uint32_t SerialCookie = 12347;
+const size_t NoOffsetThreshold = 4;
+
+class Writer {
+    unsigned char* p;
+
+public:
+    explicit Writer(char* out) : p(reinterpret_cast<unsigned char*>(out)) {}
+
+    void write8(uint8_t v) { *p++ = v; }
+    void write16(uint16_t v) {
+        write8(static_cast<uint8_t>(v));
+        write8(static_cast<uint8_t>(v >> 8));
+    }
+    void write32(uint32_t v) {
+        write16(static_cast<uint16_t>(v));
+        write16(static_cast<uint16_t>(v >> 16));
+    }
+    void write64(uint64_t v) {
+        write32(static_cast<uint32_t>(v));
+        write32(static_cast<uint32_t>(v >> 32));
+    }
+};
+
+class Reader {
+    const unsigned char* p;
+    const unsigned char* end;
+
+public:
+    explicit Reader(ds::StringView data)
+        : p(reinterpret_cast<const unsigned char*>(data.data())),
+          end(p + data.size()) {}
+
+    void need(size_t n) const {
+        if (size_t(end - p) < n)
+            fail("truncated data");
+    }
+    void skip(size_t n) {
+        need(n);
+        p += n;
+    }
+    uint8_t read8() {
+        need(1);
+        return *p++;
+    }
+    uint16_t read16() {
+        uint16_t lo = read8();
+        return static_cast<uint16_t>(lo | (read8() << 8));
+    }
+    uint32_t read32() {
+        uint32_t lo = read16();
+        return lo | (uint32_t(read16()) << 16);
+    }
+    uint64_t read64() {
+        uint64_t lo = read32();
+        return lo | (uint64_t(read32()) << 32);
+    }
+
+    [[noreturn]] static void fail(const char* what) {
+        throw std::invalid_argument(std::string("RoaringBitmap: ") + what);
+    }
+};
+}
+
+namespace ds {
+namespace detail {
+
+constexpr uint32_t RoaringContainer::MaxArraySize;
+constexpr size_t RoaringContainer::BitmapWords;
+
+const uint64_t* RoaringContainer::asBitmap(std::vector<uint64_t>& buf) const {
+    if (kind == Kind::Bitmap)
+        return words.data();
+    buf.assign(BitmapWords, 0);
+    if (kind == Kind::Array) {
+        for (auto v : values)
+            buf[v / 64] |= uint64_t(1) << (v % 64);
+    } else {
+        for (size_t i = 0, e = numRuns(); i != e; ++i)
+            setBitRange(buf.data(), runStart(i), runEnd(i));
+    }
+    return buf.data();
+}
+
+void RoaringContainer::toArray() {
+    if (kind == Kind::Array)
+        return;
+    std::vector<uint16_t> array;
+    array.reserve(card);
+    auto append = [&](uint32_t v) { array.push_back(uint16_t(v)); };
+    forEach(0, append);
+    values = std::move(array);
+    words = std::vector<uint64_t>();
+    kind = Kind::Array;
+}
+
+void RoaringContainer::toBitmap() {
+    if (kind == Kind::Bitmap)
+        return;
+    std::vector<uint64_t> bitmap;
+    asBitmap(bitmap);
+    words = std::move(bitmap);
+    values = std::vector<uint16_t>();
+    kind = Kind::Bitmap;
+}
+
+void RoaringContainer::toRuns() {
+    if (kind == Kind::Run)
+        return;
+    std::vector<uint16_t> runs;
+    runs.reserve(2 * countRuns(*this));
+    auto append = [&](uint32_t v) { appendRun(runs, v, v); };
+    forEach(0, append);
+    values = std::move(runs);
+    words = std::vector<uint64_t>();
+    kind = Kind::Run;
+}
+
+void RoaringContainer::normalize() {
+    if (kind == Kind::Array && card > MaxArraySize)
+        toBitmap();
+    else if (kind == Kind::Bitmap && card <= MaxArraySize)
+        toArray();
+}
+
+bool RoaringContainer::runOptimize() {
+    size_t runs = countRuns(*this);
+    Kind flat = card <= MaxArraySize ? Kind::Array : Kind::Bitmap;
+    bool useRuns = serializedBytes(Kind::Run, card, runs) <
+                   serializedBytes(flat, card, runs);
+    if (useRuns == (kind == Kind::Run))
+        return false;
+    if (useRuns)
+        toRuns();
+    else if (flat == Kind::Array)
+        toArray();
+    else
+        toBitmap();
+    return true;
+}
+
+bool RoaringContainer::set(uint16_t v) {
+    switch (kind) {
+    case Kind::Array: {
+        auto it = std::lower_bound(values.begin(), values.end(), v);
+        if (it != values.end() && *it == v)
+            return false;
+        if (card == MaxArraySize) {
+            toBitmap();
+            return set(v);
+        }
+        values.insert(it, v);
+        break;
+    }
+    case Kind::Bitmap: {
+        auto& word = words[v / 64];
+        auto mask = uint64_t(1) << (v % 64);
+        if (word & mask)
+            return false;
+        word |= mask;
+        break;
+    }
+    case Kind::Run: {
+        if (test(v))
+            return false;
+        // Extend the runs that end right before or start right after v, or
+        // start a new one.
+        size_t n = numRuns(), i = 0;
+        while (i != n && runStart(i) < v)
+            ++i;
+        bool extendsPrev = i != 0 && runEnd(i - 1) + 1 == v;
+        bool extendsNext = i != n && runStart(i) == uint32_t(v) + 1;
+        if (extendsPrev && extendsNext) {
+            values[2 * i - 1] = static_cast<uint16_t>(runEnd(i) -
+                                                      runStart(i - 1));
+            values.erase(values.begin() + 2 * i, values.begin() + 2 * i + 2);
+        } else if (extendsPrev) {
+            ++values[2 * i - 1];
+        } else if (extendsNext) {
+            values[2 * i] = v;
+            ++values[2 * i + 1];
+        } else {
+            uint16_t run[] = {v, 0};
+            values.insert(values.begin() + 2 * i, run, run + 2);
+        }
+        break;
+    }
+    }
+    ++card;
+    return true;
+}
+
+bool RoaringContainer::reset(uint16_t v) {
+    switch (kind) {
+    case Kind::Array: {
+        auto it = std::lower_bound(values.begin(), values.end(), v);
+        if (it == values.end() || *it != v)
+            return false;
+        values.erase(it);
+        break;
+    }
+    case Kind::Bitmap: {
+        auto& word = words[v / 64];
+        auto mask = uint64_t(1) << (v % 64);
+        if (!(word & mask))
+            return false;
+        word &= ~mask;
+        if (--card == MaxArraySize)
+            toArray();
+        return true;
+    }
+    case Kind::Run: {
+        size_t n = numRuns(), i = 0;
+        while (i != n && runEnd(i) < v)
+            ++i;
+        if (i == n || runStart(i) > v)
+            return false;
+        uint32_t first = runStart(i), last = runEnd(i);
+        if (first == last) {
+            values.erase(values.begin() + 2 * i, values.begin() + 2 * i + 2);
+        } else if (v == first) {
+            ++values[2 * i];
+            --values[2 * i + 1];
+        } else if (v == last) {
+            --values[2 * i + 1];
+        } else {
+            values[2 * i + 1] = static_cast<uint16_t>(v - 1 - first);
+            uint16_t run[] = {static_cast<uint16_t>(v + 1),
+                              static_cast<uint16_t>(last - v - 1)};
+            values.insert(values.begin() + 2 * i + 2, run, run + 2);
+        }
+        break;
+    }
+    }
+    --card;
+    return true;
+}
+
+void RoaringContainer::setRange(uint32_t first, uint32_t last) {
+    if (card == 0 || kind == Kind::Run) {
+        // Merge the range into the runs.
+        std::vector<uint16_t> runs;
+        runs.reserve(values.size() + 2);
+        size_t i = 0, n = kind == Kind::Run ? numRuns() : 0;
+        for (; i != n && runStart(i) < first; ++i)
+            appendRun(runs, runStart(i), runEnd(i));
+        appendRun(runs, first, last);
+        for (; i != n; ++i)
+            appendRun(runs, runStart(i), runEnd(i));
+        values = std::move(runs);
+        card = countRunValues(values);
+        kind = Kind::Run;
+        return;
+    }
+    toBitmap();
+    setBitRange(words.data(), first, last);
+    card = countBits(words.data());
+    normalize();
+}
+
+uint32_t RoaringContainer::rank(uint16_t v) const {
+    switch (kind) {
+    case Kind::Array:
+        return static_cast<uint32_t>(
+            std::upper_bound(values.begin(), values.end(), v) -
+            values.begin());
+    case Kind::Bitmap: {
+        size_t word = v / 64;
+        auto ret = ds::detail::bitsCount(words.data(), word * sizeof(uint64_t));
+        ret += detail::popcount(words[word] & (~uint64_t(0) >> (63 - v % 64)));
+        return static_cast<uint32_t>(ret);
+    }
+    case Kind::Run: {
+        uint32_t ret = 0;
+        for (size_t i = 0, e = numRuns(); i != e && runStart(i) <= v; ++i)
+            ret += std::min(runEnd(i), uint32_t(v)) - runStart(i) + 1;
+        return ret;
+    }
+    }
+    return 0;
+}
+
+uint16_t RoaringContainer::select(uint32_t k) const {
+    assert(k < card && "Select out of range");
+    switch (kind) {
+    case Kind::Array:
+        return values[k];
+    case Kind::Bitmap:
+        for (size_t i = 0;; ++i) {
+            auto word = words[i];
+            auto numBits = static_cast<uint32_t>(detail::popcount(word));
+            if (k < numBits) {
+                for (; k != 0; --k)
+                    word &= word - 1;
+                return static_cast<uint16_t>(i * 64 + findFirstSet(word));
+            }
+            k -= numBits;
+        }
+    case Kind::Run:
+        for (size_t i = 0;; ++i) {
+            uint32_t length = runEnd(i) - runStart(i) + 1;
+            if (k < length)
+                return static_cast<uint16_t>(runStart(i) + k);
+            k -= length;
+        }
+    }
+    return 0;
+}
+
+uint16_t RoaringContainer::minimum() const {
+    switch (kind) {
+    case Kind::Array:
+    case Kind::Run:
+        return values.front();
+    case Kind::Bitmap: {
+        size_t i = 0;
+        while (words[i] == 0)
+            ++i;
+        return static_cast<uint16_t>(i * 64 + findFirstSet(words[i]));
+    }
+    }
+    return 0;
+}
+
+uint16_t RoaringContainer::maximum() const {
+    switch (kind) {
+    case Kind::Array:
+        return values.back();
+    case Kind::Bitmap: {
+        size_t i = BitmapWords - 1;
+        while (words[i] == 0)
+            --i;
+        return static_cast<uint16_t>(i * 64 + findLastSet(words[i]));
+    }
+    case Kind::Run:
+        return static_cast<uint16_t>(runEnd(numRuns() - 1));
+    }
+    return 0;
+}
+
+void RoaringContainer::unionWith(const RoaringContainer& rhs) {
+    if (kind == Kind::Run && rhs.kind == Kind::Run) {
+        std::vector<uint16_t> runs;
+        runs.reserve(values.size() + rhs.values.size());
+        size_t i = 0, j = 0, n = numRuns(), m = rhs.numRuns();
+        while (i != n || j != m) {
+            if (j == m || (i != n && runStart(i) <= rhs.runStart(j))) {
+                appendRun(runs, runStart(i), runEnd(i));
+                ++i;
+            } else {
+                appendRun(runs, rhs.runStart(j), rhs.runEnd(j));
+                ++j;
+            }
+        }
+        values = std::move(runs);
+        card = countRunValues(values);
+        return;
+    }
+    if (kind == Kind::Array && rhs.kind == Kind::Array &&
+        card + rhs.card <= MaxArraySize) {
+        std::vector<uint16_t> merged;
+        merged.resize(card + rhs.card);
+        auto end = std::set_union(values.begin(), values.end(),
+                                  rhs.values.begin(), rhs.values.end(),
+                                  merged.begin());
+        merged.erase(end, merged.end());
+        card = static_cast<uint32_t>(merged.size());
+        values = std::move(merged);
+        return;
+    }
+    toBitmap();
+    if (rhs.kind == Kind::Array) {
+        for (auto v : rhs.values)
+            words[v / 64] |= uint64_t(1) << (v % 64);
+    } else {
+        std::vector<uint64_t> buf;
+        ds::detail::bitsApply(BitOp::Or, words.data(), rhs.asBitmap(buf),
+                              BitmapBytes);
+    }
+    card = countBits(words.data());
+    normalize();
+}
+
+void RoaringContainer::intersectWith(const RoaringContainer& rhs) {
+    if (kind == Kind::Array) {
+        if (rhs.kind == Kind::Array) {
+            card = static_cast<uint32_t>(
+                intersectArrays(values.data(), card, rhs.values.data(),
+                                rhs.card, values.data()));
+            values.erase(values.begin() + card, values.end());
+        } else {
+            values.erase(std::remove_if(values.begin(), values.end(),
+                                        [&](uint16_t v) {
+                                            return !rhs.test(v);
+                                        }),
+                         values.end());
+            card = static_cast<uint32_t>(values.size());
+        }
+        return;
+    }
+    if (rhs.kind == Kind::Array) {
+        // The result is a subset of rhs, and so an array.
+        std::vector<uint16_t> array;
+        array.reserve(rhs.card);
+        for (auto v : rhs.values)
+            if (test(v))
+                array.push_back(v);
+        values = std::move(array);
+        words = std::vector<uint64_t>();
+        card = static_cast<uint32_t>(values.size());
+        kind = Kind::Array;
+        return;
+    }
+    toBitmap();
+    std::vector<uint64_t> buf;
+    ds::detail::bitsApply(BitOp::And, words.data(), rhs.asBitmap(buf),
+                          BitmapBytes);
+    card = countBits(words.data());
+    normalize();
+}
+
+void RoaringContainer::subtract(const RoaringContainer& rhs) {
+    if (kind == Kind::Array) {
+        values.erase(std::remove_if(values.begin(), values.end(),
+                                    [&](uint16_t v) { return rhs.test(v); }),
+                     values.end());
+        card = static_cast<uint32_t>(values.size());
+        return;
+    }
+    toBitmap();
+    if (rhs.kind == Kind::Array) {
+        for (auto v : rhs.values)
+            words[v / 64] &= ~(uint64_t(1) << (v % 64));
+    } else {
+        std::vector<uint64_t> buf;
+        ds::detail::bitsApply(BitOp::AndNot, words.data(), rhs.asBitmap(buf),
+                              BitmapBytes);
+    }
+    card = countBits(words.data());
+    normalize();
+}
+
+bool RoaringContainer::intersects(const RoaringContainer& rhs) const {
+    if (kind == Kind::Array)
+        return std::any_of(values.begin(), values.end(),
+                           [&](uint16_t v) { return rhs.test(v); });
+    if (rhs.kind == Kind::Array)
+        return rhs.intersects(*this);
+    std::vector<uint64_t> lhsBuf, rhsBuf;
+    return ds::detail::bitsIntersect(asBitmap(lhsBuf), rhs.asBitmap(rhsBuf),
+                                     BitmapBytes);
+}
+
+bool RoaringContainer::isSubsetOf(const RoaringContainer& rhs) const {
+    if (card > rhs.card)
+        return false;
+    if (kind == Kind::Array)
+        return std::all_of(values.begin(), values.end(),
+                           [&](uint16_t v) { return rhs.test(v); });
+    std::vector<uint64_t> lhsBuf, rhsBuf;
+    return ds::detail::bitsSubset(asBitmap(lhsBuf), rhs.asBitmap(rhsBuf),
+                                  BitmapBytes);
+}
+
+bool RoaringContainer::operator==(const RoaringContainer& rhs) const {
+    if (card != rhs.card)
+        return false;
+    if (kind == rhs.kind)
+        return kind == Kind::Bitmap ? words == rhs.words
+                                    : values == rhs.values;
+    // The same values can be held as runs and as something else.
+    std::vector<uint64_t> lhsBuf, rhsBuf;
+    return std::memcmp(asBitmap(lhsBuf), rhs.asBitmap(rhsBuf), BitmapBytes) ==
+           0;
+}
+}
+
+constexpr RoaringBitmap::size_type RoaringBitmap::npos;
+
+RoaringBitmap::Container& RoaringBitmap::getOrInsert(uint16_t key) {
+    auto i = lowerBound(key);
+    if (i == keys.size() || keys[i] != key) {
+        keys.insert(keys.begin() + i, key);
+        containers.insert(containers.begin() + i, Container());
+    }
+    return containers[i];
+}
+
+void RoaringBitmap::eraseEmpty() {
+    size_t out = 0;
+    for (size_t i = 0, e = keys.size(); i != e; ++i) {
+        if (containers[i].card == 0)
+            continue;
+        if (out != i) {
+            keys[out] = keys[i];
+            containers[out] = std::move(containers[i]);
+        }
+        ++out;
+    }
+    keys.erase(keys.begin() + out, keys.end());
+    containers.erase(containers.begin() + out, containers.end());
+}
+
+RoaringBitmap::size_type RoaringBitmap::getMemorySize() const {
+    size_type ret = keys.capacity() * sizeof(uint16_t) +
+                    containers.capacity() * sizeof(Container);
+    for (auto& c : containers)
+        ret += c.getMemorySize();
+    return ret;
+}
+
+void RoaringBitmap::set_range(uint32_t first, uint32_t last) {
+    assert(first <= last && "Invalid range");
+    for (uint32_t key = highBits(first), lastKey = highBits(last);; ++key) {
+        uint32_t lo = key == highBits(first) ? lowBits(first) : 0;
+        uint32_t hi = key == lastKey ? lowBits(last) : 0xFFFF;
+        getOrInsert(static_cast<uint16_t>(key)).setRange(lo, hi);
+        if (key == lastKey)
+            break;
+    }
+}
+
+void RoaringBitmap::reset(uint32_t v) {
+    auto i = lowerBound(highBits(v));
+    if (i == keys.size() || keys[i] != highBits(v))
+        return;
+    if (containers[i].reset(lowBits(v)) && containers[i].card == 0) {
+        keys.erase(keys.begin() + i);
+        containers.erase(containers.begin() + i);
+    }
+}
+
+RoaringBitmap::size_type RoaringBitmap::rank(uint32_t v) const {
+    size_type ret = 0;
+    for (size_t i = 0, e = keys.size(); i != e && keys[i] <= highBits(v); ++i)
+        ret += keys[i] < highBits(v) ? containers[i].card
+                                     : containers[i].rank(lowBits(v));
+    return ret;
+}
+
+uint32_t RoaringBitmap::select(size_type k) const {
+    for (size_t i = 0, e = keys.size(); i != e; ++i) {
+        if (k < containers[i].card)
+            return (uint32_t(keys[i]) << 16) |
+                   containers[i].select(static_cast<uint32_t>(k));
+        k -= containers[i].card;
+    }
+    assert(false && "Select out of range");
+    return 0;
+}
+
+RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap& rhs) {
+    if (this == &rhs || rhs.empty())
+        return *this;
+    std::vector<uint16_t> newKeys;
+    std::vector<Container> newContainers;
+    newKeys.reserve(keys.size() + rhs.keys.size());
+    newContainers.reserve(keys.size() + rhs.keys.size());
+    size_t i = 0, j = 0, n = keys.size(), m = rhs.keys.size();
+    while (i != n || j != m) {
+        if (j == m || (i != n && keys[i] < rhs.keys[j])) {
+            newKeys.push_back(keys[i]);
+            newContainers.push_back(std::move(containers[i++]));
+        } else if (i == n || rhs.keys[j] < keys[i]) {
+            newKeys.push_back(rhs.keys[j]);
+            newContainers.push_back(rhs.containers[j++]);
+        } else {
+            containers[i].unionWith(rhs.containers[j++]);
+            newKeys.push_back(keys[i]);
+            newContainers.push_back(std::move(containers[i++]));
+        }
+    }
+    keys = std::move(newKeys);
+    containers = std::move(newContainers);
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap& rhs) {
+    if (this == &rhs)
+        return *this;
+    size_t j = 0, m = rhs.keys.size();
+    for (size_t i = 0, e = keys.size(); i != e; ++i) {
+        while (j != m && rhs.keys[j] < keys[i])
+            ++j;
+        if (j != m && rhs.keys[j] == keys[i])
+            containers[i].intersectWith(rhs.containers[j]);
+        else
+            containers[i] = Container();
+    }
+    eraseEmpty();
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::operator-=(const RoaringBitmap& rhs) {
+    if (this == &rhs) {
+        clear();
+        return *this;
+    }
+    size_t j = 0, m = rhs.keys.size();
+    for (size_t i = 0, e = keys.size(); i != e; ++i) {
+        while (j != m && rhs.keys[j] < keys[i])
+            ++j;
+        if (j != m && rhs.keys[j] == keys[i])
+            containers[i].subtract(rhs.containers[j]);
+    }
+    eraseEmpty();
+    return *this;
+}
+
+bool RoaringBitmap::intersects(const RoaringBitmap& rhs) const {
+    size_t j = 0, m = rhs.keys.size();
+    for (size_t i = 0, e = keys.size(); i != e; ++i) {
+        while (j != m && rhs.keys[j] < keys[i])
+            ++j;
+        if (j == m)
+            return false;
+        if (rhs.keys[j] == keys[i] &&
+            containers[i].intersects(rhs.containers[j]))
+            return true;
+    }
+    return false;
+}
+
+bool RoaringBitmap::is_subset_of(const RoaringBitmap& rhs) const {
+    size_t j = 0, m = rhs.keys.size();
+    for (size_t i = 0, e = keys.size(); i != e; ++i) {
+        while (j != m && rhs.keys[j] < keys[i])
+            ++j;
+        if (j == m || rhs.keys[j] != keys[i] ||
+            !containers[i].isSubsetOf(rhs.containers[j]))
+            return false;
+    }
+    return true;
+}
+
+bool RoaringBitmap::run_optimize() {
+    bool changed = false;
+    for (auto& c : containers)
+        changed |= c.runOptimize();
+    return changed;
+}
+
+RoaringBitmap::size_type RoaringBitmap::getSerializedSize() const {
+    bool hasRuns = std::any_of(
+        containers.begin(), containers.end(),
+        [](const Container& c) { return c.kind == Container::Kind::Run; });
+    size_t n = keys.size();
+    size_type ret = hasRuns ? 4 + (n + 7) / 8 : 8;
+    ret += 4 * n;
+    if (!hasRuns || n >= NoOffsetThreshold)
+        ret += 4 * n;
+    for (auto& c : containers)
+        ret += serializedBytes(c.kind, c.card, c.numRuns());
+    return ret;
+}
+
+void RoaringBitmap::serialize(char* out) const {
+    bool hasRuns = std::any_of(
+        containers.begin(), containers.end(),
+        [](const Container& c) { return c.kind == Container::Kind::Run; });
+    size_t n = keys.size();
+    Writer writer(out);
+    size_t offset;
+    if (hasRuns) {
+        writer.write32(SerialCookie | uint32_t(n - 1) << 16);
+        for (size_t i = 0; i < n; i += 8) {
+            uint8_t flags = 0;
+            for (size_t j = i; j != std::min(i + 8, n); ++j)
+                if (containers[j].kind == Container::Kind::Run)
+                    flags |= uint8_t(1) << (j - i);
+            writer.write8(flags);
+        }
+        offset = 4 + (n + 7) / 8 + 4 * n;
+    } else {
+        writer.write32(SerialCookieNoRuns);
+        writer.write32(static_cast<uint32_t>(n));
+        offset = 8 + 4 * n;
+    }
+    for (size_t i = 0; i != n; ++i) {
+        writer.write16(keys[i]);
+        writer.write16(static_cast<uint16_t>(containers[i].card - 1));
+    }
+    if (!hasRuns || n >= NoOffsetThreshold) {
+        offset += 4 * n;
+        for (auto& c : containers) {
+            writer.write32(static_cast<uint32_t>(offset));
+            offset += serializedBytes(c.kind, c.card, c.numRuns());
+        }
+    }
+    for (auto& c : containers) {
+        switch (c.kind) {
+        case Container::Kind::Array:
+            for (auto v : c.values)
+                writer.write16(v);
+            break;
+        case Container::Kind::Bitmap:
+            for (auto word : c.words)
+                writer.write64(word);
+            break;
+        case Container::Kind::Run:
+            writer.write16(static_cast<uint16_t>(c.numRuns()));
+            for (auto v : c.values)
+                writer.write16(v);
+            break;
+        }
+    }
+}
+
+RoaringBitmap RoaringBitmap::deserialize(StringView data) {
+    Reader reader(data);
+    uint32_t cookie = reader.read32();
+    size_t n;
+    std::vector<uint8_t> runFlags;
+    if ((cookie & 0xFFFF) == SerialCookie) {
+        n = (cookie >> 16) + 1;
+        for (size_t i = 0; i < n; i += 8)
+            runFlags.push_back(reader.read8());
+    } else if (cookie == SerialCookieNoRuns) {
+        n = reader.read32();
+        if (n > 0x10000)
+            Reader::fail("too many containers");
+    } else {
+        Reader::fail("unknown cookie");
+    }
+
+    RoaringBitmap ret;
+    // Check the header for truncation before allocating room for it.
+    reader.need(4 * n);
+    ret.keys.reserve(n);
+    ret.containers.resize(n);
+    for (size_t i = 0; i != n; ++i) {
+        ret.keys.push_back(reader.read16());
+        ret.containers[i].card = uint32_t(reader.read16()) + 1;
+        if (i != 0 && ret.keys[i] <= ret.keys[i - 1])
+            Reader::fail("keys out of order");
+    }
+    // The containers follow each other, so the offsets are not needed.
+    if (runFlags.empty() || n >= NoOffsetThreshold)
+        reader.skip(4 * n);
+
+    for (size_t i = 0; i != n; ++i) {
+        auto& c = ret.containers[i];
+        if (!runFlags.empty() && (runFlags[i / 8] >> (i % 8)) & 1) {
+            c.kind = Container::Kind::Run;
+            size_t numRuns = reader.read16();
+            reader.need(4 * numRuns);
+            c.values.reserve(2 * numRuns);
+            uint32_t prevLast = 0;
+            for (size_t j = 0; j != numRuns; ++j) {
+                uint32_t first = reader.read16();
+                uint32_t last = first + reader.read16();
+                if (last > 0xFFFF || (j != 0 && first <= prevLast))
+                    Reader::fail("malformed run container");
+                // Adjacent runs are merged, so that equal sets compare equal.
+                appendRun(c.values, first, last);
+                prevLast = last;
+            }
+            if (countRunValues(c.values) != c.card)
+                Reader::fail("wrong cardinality");
+        } else if (c.card <= Container::MaxArraySize) {
+            reader.need(2 * size_t(c.card));
+            c.values.reserve(c.card);
+            for (size_t j = 0; j != c.card; ++j) {
+                c.values.push_back(reader.read16());
+                if (j != 0 && c.values[j] <= c.values[j - 1])
+                    Reader::fail("array container out of order");
+            }
+        } else {
+            c.kind = Container::Kind::Bitmap;
+            reader.need(BitmapBytes);
+            c.words.resize(BitmapWords);
+            for (auto& word : c.words)
+                word = reader.read64();
+            if (countBits(c.words.data()) != c.card)
+                Reader::fail("wrong cardinality");
+        }
+    }
+    return ret;
+}
+}
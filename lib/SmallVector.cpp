@@ -1,30 +1,39 @@
 #include "DataStructure/SmallVector.h"
 
+#include <stdexcept>
+#include <string>
+
 namespace ds {
 
-/// grow_pod - This is an implementation of the grow() method which only works
-/// on POD-like datatypes and is out of line to reduce code duplication.
-void SmallVectorBase::grow_pod(void* FirstEl, size_t MinSizeInBytes,
-                               size_t TSize) {
-    size_t CurSizeBytes = size_in_bytes();
-    size_t NewCapacityInBytes = 2 * capacity_in_bytes() + TSize; // Always grow.
-    if (NewCapacityInBytes < MinSizeInBytes)
-        NewCapacityInBytes = MinSizeInBytes;
+template <typename SizeT>
+size_t SmallVectorBase<SizeT>::getNewCapacity(size_t MinSize, bool Exact,
+                                              unsigned GrowthNum,
+                                              unsigned GrowthDen) const {
+    constexpr size_t MaxSize = SizeTypeMax();
+    if (MinSize > MaxSize)
+        throw std::length_error("SmallVector unable to grow. Requested "
+                                "capacity (" +
+                                std::to_string(MinSize) +
+                                ") is larger than maximum value for size type");
+    if (Exact)
+        return MinSize;
+    if (capacity() == MaxSize)
+        throw std::length_error(
+            "SmallVector capacity unable to grow. Already at maximum size");
 
-    void* NewElts;
-    if (BeginX == FirstEl) {
-        NewElts = malloc(NewCapacityInBytes);
+    // In theory the multiplication can overflow if the capacity is 64 bit, but
+    // the original capacity would never be large enough for this to be a
+    // problem.
+    size_t NewCapacity =
+        capacity() * GrowthNum / GrowthDen + 1; // Always grow.
+    return std::min(std::max(NewCapacity, MinSize), MaxSize);
+}
 
-        // Copy the elements over.  No need to run dtors on PODs.
-        memcpy(NewElts, this->BeginX, CurSizeBytes);
-    } else {
-        // If this wasn't grown from the inline copy, grow the allocated space.
-        NewElts = realloc(this->BeginX, NewCapacityInBytes);
-    }
-    assert(NewElts && "Out of memory");
+template class SmallVectorBase<uint32_t>;
 
-    this->EndX = (char*)NewElts + CurSizeBytes;
-    this->BeginX = NewElts;
-    this->CapacityX = (char*)this->BeginX + NewCapacityInBytes;
-}
+// Disable the uint64_t instantiation for 32-bit builds, where it would be an
+// exact duplicate of the uint32_t one.
+#if SIZE_MAX > UINT32_MAX
+template class SmallVectorBase<uint64_t>;
+#endif
 }
\ No newline at end of file
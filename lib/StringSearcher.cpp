@@ -0,0 +1,189 @@
+#include "DataStructure/StringSearcher.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+// Indexes a byte sequence either front-to-back or back-to-front. Backward
+// searches run the forward algorithm on reversed needle and text.
+template <bool Backward>
+class Bytes {
+private:
+    const unsigned char* base;
+    size_t len;
+
+public:
+    explicit Bytes(ds::StringView s)
+        : base(reinterpret_cast<const unsigned char*>(s.data())),
+          len(s.size()) {}
+
+    unsigned char operator[](size_t i) const {
+        return Backward ? base[len - 1 - i] : base[i];
+    }
+    size_t size() const { return len; }
+};
+
+// Computes the maximal suffix of 'n' with respect to the byte order (or its
+// reverse if 'reversed' is set). Returns the position right before the suffix
+// (which may be -1) and stores the period of the suffix in 'period'.
+template <bool Backward>
+size_t maximalSuffix(const Bytes<Backward>& n, bool reversed, size_t& period) {
+    size_t m = n.size();
+    size_t ip = static_cast<size_t>(-1), jp = 0, k = 1, p = 1;
+    while (jp + k < m) {
+        auto a = n[ip + k], b = n[jp + k];
+        if (a == b) {
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else
+                ++k;
+        } else if (reversed ? a < b : a > b) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    period = p;
+    return ip;
+}
+}
+
+namespace ds {
+
+StringSearcher::StringSearcher(StringView needle, Direction dir)
+    : needle(needle), dir(dir), critPos(0), period(1), memAfterShift(0) {
+    std::memset(byteSet, 0, sizeof(byteSet));
+    size_t m = needle.size();
+    if (m == 0)
+        return;
+
+    auto build = [this, m](const auto& n) {
+        for (size_t i = 0; i != m; ++i) {
+            auto c = n[i];
+            byteSet[c / 64] |= uint64_t(1) << (c % 64);
+            shift[c] = i + 1;
+        }
+
+        // The critical factorization is the later of the two maximal
+        // suffixes computed with opposite orders.
+        size_t p0, p1;
+        size_t ms0 = maximalSuffix(n, false, p0);
+        size_t ms1 = maximalSuffix(n, true, p1);
+        size_t ms = ms0, p = p0;
+        if (ms1 + 1 > ms0 + 1) {
+            ms = ms1;
+            p = p1;
+        }
+
+        // The needle is periodic if its prefix of length ms + 1 repeats after
+        // p bytes. Otherwise no two occurrences can be closer than the longer
+        // half of the factorization.
+        bool periodic = true;
+        for (size_t i = 0; i != ms + 1 && periodic; ++i)
+            periodic = (i + p < m && n[i] == n[i + p]);
+        if (periodic) {
+            memAfterShift = m - p;
+        } else {
+            memAfterShift = 0;
+            p = std::max(ms + 1, m - ms - 1) + 1;
+        }
+        critPos = ms + 1;
+        period = p;
+    };
+    if (dir == Direction::Forward)
+        build(Bytes<false>(needle));
+    else
+        build(Bytes<true>(needle));
+}
+
+// Calls 'cb' with the (oriented) position of every occurrence of the needle at
+// or after 'from' until it returns false.
+template <bool Backward, typename Callback>
+void StringSearcher::search(StringView text, size_t from, Callback cb) const {
+    Bytes<Backward> n(needle), h(text);
+    size_t m = needle.size(), len = text.size();
+    assert(m != 0);
+
+    size_t pos = from, mem = 0;
+    while (pos <= len && len - pos >= m) {
+        // Check the last byte of the window first and use it to skip ahead.
+        auto last = h[pos + m - 1];
+        if (!(byteSet[last / 64] & (uint64_t(1) << (last % 64)))) {
+            pos += m;
+            mem = 0;
+            continue;
+        }
+        if (size_t k = m - shift[last]) {
+            pos += std::max(k, mem);
+            mem = 0;
+            continue;
+        }
+
+        // Match the right half of the factorization, then the left half.
+        size_t k = std::max(critPos, mem);
+        while (k < m && n[k] == h[pos + k])
+            ++k;
+        if (k < m) {
+            pos += k - critPos + 1;
+            mem = 0;
+            continue;
+        }
+        k = critPos;
+        while (k > mem && n[k - 1] == h[pos + k - 1])
+            --k;
+        if (k <= mem && !cb(pos))
+            return;
+        pos += period;
+        mem = memAfterShift;
+    }
+}
+
+size_t StringSearcher::find(StringView text, size_t from) const {
+    assert(dir == Direction::Forward && "find() needs a forward searcher");
+    if (from > text.size())
+        return StringView::npos;
+    if (needle.empty())
+        return from;
+
+    size_t ret = StringView::npos;
+    search<false>(text, from, [&ret](size_t pos) {
+        ret = pos;
+        return false;
+    });
+    return ret;
+}
+
+size_t StringSearcher::rfind(StringView text) const {
+    assert(dir == Direction::Backward && "rfind() needs a backward searcher");
+    if (needle.size() > text.size())
+        return StringView::npos;
+    if (needle.empty())
+        return text.size();
+
+    size_t ret = StringView::npos;
+    search<true>(text, 0, [&ret, &text, this](size_t pos) {
+        ret = text.size() - pos - needle.size();
+        return false;
+    });
+    return ret;
+}
+
+size_t StringSearcher::count(StringView text) const {
+    assert(dir == Direction::Forward && "count() needs a forward searcher");
+    if (needle.empty())
+        return text.size() + 1;
+
+    size_t ret = 0;
+    search<false>(text, 0, [&ret](size_t) {
+        ++ret;
+        return true;
+    });
+    return ret;
+}
+}
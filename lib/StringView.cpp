@@ -1,14 +1,30 @@
 #include "DataStructure/StringView.h"
+#include "DataStructure/Detail.h"
+#include "DataStructure/StringSearcher.h"
 
 #include <algorithm>
-#include <bitset>
 #include <cassert>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <ostream>
 
+#ifdef DS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+#ifdef __APPLE__
+#include <xlocale.h>
+#endif
+
 namespace {
 
-static constexpr unsigned NUM_CHAR_BITS = 8;
+// Substring searches over fewer bytes than this, or for needles shorter than
+// ShortNeedleLength, skip the Two-Way preprocessing and look for the first byte
+// of the needle instead, comparing the rest wherever it occurs.
+static constexpr size_t TwoWayThreshold = 64;
+static constexpr size_t ShortNeedleLength = 16;
 
 inline char ascii_tolower(char x) {
     if (x >= 'A' && x <= 'Z')
@@ -27,45 +43,562 @@ inline int ascii_strncasecmp(const char* lhs, const char* rhs, size_t len) {
     return 0;
 }
 
-int compareMemory(const char* lhs, const char* rhs, size_t len) {
-    if (len == 0)
-        return 0;
-    else
-        return std::memcmp(lhs, rhs, len);
+// A set of bytes laid out for the nibble-lookup membership test: bit h of
+// rows[l] is set iff the byte (h << 4 | l) belongs to the set. The SIMD kernels
+// split each row into two byte tables (high nibble 0-7 and 8-15) and use pshufb
+// to look up 16 or 32 bytes at once.
+struct CharSet {
+    uint16_t rows[16];
+
+    explicit CharSet(ds::StringView chars) {
+        std::memset(rows, 0, sizeof(rows));
+        for (char c : chars) {
+            auto uc = static_cast<unsigned char>(c);
+            rows[uc & 0xF] |= static_cast<uint16_t>(1u << (uc >> 4));
+        }
+    }
+
+    bool test(unsigned char c) const {
+        return (rows[c & 0xF] >> (c >> 4)) & 1;
+    }
+};
+
+// Describes what a scan is looking for: either a single byte or a CharSet,
+// optionally negated.
+struct ByteMatcher {
+    const CharSet* set;
+    unsigned char c;
+    bool negate;
+
+    ByteMatcher(char c, bool negate)
+        : set(nullptr), c(static_cast<unsigned char>(c)), negate(negate) {}
+    ByteMatcher(const CharSet& set, bool negate)
+        : set(&set), c(0), negate(negate) {}
+
+    bool test(unsigned char x) const {
+        return (set ? set->test(x) : x == c) != negate;
+    }
+};
+
+// Portable kernels. They are also used to finish the tail of the SIMD kernels.
+size_t findFirstScalar(const unsigned char* s, size_t n,
+                       const ByteMatcher& m) {
+    for (size_t i = 0; i != n; ++i)
+        if (m.test(s[i]))
+            return i;
+    return ds::StringView::npos;
 }
+
+size_t findLastScalar(const unsigned char* s, size_t n, const ByteMatcher& m) {
+    for (size_t i = n; i != 0; --i)
+        if (m.test(s[i - 1]))
+            return i - 1;
+    return ds::StringView::npos;
 }
 
-namespace ds {
+size_t countScalar(const unsigned char* s, size_t n, unsigned char c) {
+    size_t count = 0;
+    for (size_t i = 0; i != n; ++i)
+        count += (s[i] == c);
+    return count;
+}
 
-const size_t StringView::npos = ~size_t(0);
+#ifdef DS_X86_DISPATCH
+
+// SSE4.2 kernels (16 bytes per step)
+
+DS_TARGET("sse4.2")
+inline unsigned setMask128(__m128i x, __m128i lowTbl, __m128i highTbl) {
+    const __m128i hiBits =
+        _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64,
+                      -128);
+    __m128i lo = _mm_and_si128(x, _mm_set1_epi8(0x0F));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x0F));
+    // Bytes >= 0x80 have their sign bit set, which is exactly the blendv
+    // selector for the second row table.
+    __m128i row = _mm_blendv_epi8(_mm_shuffle_epi8(lowTbl, lo),
+                                  _mm_shuffle_epi8(highTbl, lo), x);
+    __m128i hit = _mm_and_si128(row, _mm_shuffle_epi8(hiBits, hi));
+    return ~_mm_movemask_epi8(_mm_cmpeq_epi8(hit, _mm_setzero_si128())) &
+           0xFFFF;
+}
+
+struct Matcher128 {
+    bool isSet;
+    unsigned flip;
+    __m128i needle, lowTbl, highTbl;
+
+    DS_TARGET("sse4.2") explicit Matcher128(const ByteMatcher& m)
+        : isSet(m.set != nullptr), flip(m.negate ? 0xFFFF : 0) {
+        needle = _mm_set1_epi8(static_cast<char>(m.c));
+        if (isSet) {
+            auto rows = reinterpret_cast<const __m128i*>(m.set->rows);
+            auto r0 = _mm_loadu_si128(rows);
+            auto r1 = _mm_loadu_si128(rows + 1);
+            auto lowByte = _mm_set1_epi16(0x00FF);
+            lowTbl = _mm_packus_epi16(_mm_and_si128(r0, lowByte),
+                                      _mm_and_si128(r1, lowByte));
+            highTbl =
+                _mm_packus_epi16(_mm_srli_epi16(r0, 8), _mm_srli_epi16(r1, 8));
+        } else {
+            lowTbl = highTbl = _mm_setzero_si128();
+        }
+    }
 
-StringView::StringView(const char* s) : _data(s) {
-    assert(s && "StringView cannot be built from NULL");
-    length = std::strlen(s);
+    DS_TARGET("sse4.2") unsigned mask(const unsigned char* p) const {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned m = isSet ? setMask128(x, lowTbl, highTbl)
+                           : _mm_movemask_epi8(_mm_cmpeq_epi8(x, needle));
+        return m ^ flip;
+    }
+};
+
+DS_TARGET("sse4.2")
+size_t findFirstSSE42(const unsigned char* s, size_t n, const ByteMatcher& m) {
+    if (n < 16)
+        return findFirstScalar(s, n, m);
+    Matcher128 matcher(m);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+        if (unsigned mask = matcher.mask(s + i))
+            return i + __builtin_ctz(mask);
+    if (i != n) {
+        // Re-scan the last 16 bytes and drop the ones we have already seen.
+        if (unsigned mask = matcher.mask(s + n - 16) >> (16 - (n - i)))
+            return i + __builtin_ctz(mask);
+    }
+    return ds::StringView::npos;
+}
+
+DS_TARGET("sse4.2")
+size_t findLastSSE42(const unsigned char* s, size_t n, const ByteMatcher& m) {
+    if (n < 16)
+        return findLastScalar(s, n, m);
+    Matcher128 matcher(m);
+    size_t i = n;
+    for (; i >= 16; i -= 16)
+        if (unsigned mask = matcher.mask(s + i - 16))
+            return i - 16 + (31 - __builtin_clz(mask));
+    if (i != 0) {
+        if (unsigned mask = matcher.mask(s) & ((1u << i) - 1))
+            return 31 - __builtin_clz(mask);
+    }
+    return ds::StringView::npos;
+}
+
+DS_TARGET("sse4.2")
+size_t countSSE42(const unsigned char* s, size_t n, unsigned char c) {
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(c));
+    const __m128i zero = _mm_setzero_si128();
+    size_t count = 0, i = 0;
+    while (i + 16 <= n) {
+        // Accumulate matches in 8-bit lanes (each compare yields -1) and
+        // flush them before any lane can overflow.
+        __m128i acc = zero;
+        for (unsigned iter = 0; iter != 255 && i + 16 <= n; ++iter, i += 16) {
+            __m128i x =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(x, needle));
+        }
+        __m128i sums = _mm_sad_epu8(acc, zero);
+        count += _mm_cvtsi128_si64(sums) + _mm_extract_epi64(sums, 1);
+    }
+    return count + countScalar(s + i, n - i, c);
+}
+
+// AVX2 kernels (32 bytes per step)
+
+DS_TARGET("avx2")
+inline unsigned setMask256(__m256i x, __m256i lowTbl, __m256i highTbl) {
+    const __m256i hiBits = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8,
+        16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    __m256i lo = _mm256_and_si256(x, _mm256_set1_epi8(0x0F));
+    __m256i hi =
+        _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi8(0x0F));
+    __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lowTbl, lo),
+                                     _mm256_shuffle_epi8(highTbl, lo), x);
+    __m256i hit = _mm256_and_si256(row, _mm256_shuffle_epi8(hiBits, hi));
+    return ~static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(hit, _mm256_setzero_si256())));
+}
+
+struct Matcher256 {
+    bool isSet;
+    unsigned flip;
+    __m256i needle, lowTbl, highTbl;
+
+    DS_TARGET("avx2") explicit Matcher256(const ByteMatcher& m)
+        : isSet(m.set != nullptr), flip(m.negate ? ~0u : 0) {
+        needle = _mm256_set1_epi8(static_cast<char>(m.c));
+        if (isSet) {
+            auto rows = reinterpret_cast<const __m128i*>(m.set->rows);
+            auto r0 = _mm_loadu_si128(rows);
+            auto r1 = _mm_loadu_si128(rows + 1);
+            auto lowByte = _mm_set1_epi16(0x00FF);
+            // pshufb works within 128-bit lanes, so both lanes get a copy.
+            lowTbl = _mm256_broadcastsi128_si256(_mm_packus_epi16(
+                _mm_and_si128(r0, lowByte), _mm_and_si128(r1, lowByte)));
+            highTbl = _mm256_broadcastsi128_si256(
+                _mm_packus_epi16(_mm_srli_epi16(r0, 8), _mm_srli_epi16(r1, 8)));
+        } else {
+            lowTbl = highTbl = _mm256_setzero_si256();
+        }
+    }
+
+    DS_TARGET("avx2") unsigned mask(const unsigned char* p) const {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned m = isSet ? setMask256(x, lowTbl, highTbl)
+                           : static_cast<unsigned>(_mm256_movemask_epi8(
+                                 _mm256_cmpeq_epi8(x, needle)));
+        return m ^ flip;
+    }
+};
+
+DS_TARGET("avx2")
+size_t findFirstAVX2(const unsigned char* s, size_t n, const ByteMatcher& m) {
+    if (n < 32)
+        return findFirstSSE42(s, n, m);
+    Matcher256 matcher(m);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+        if (unsigned mask = matcher.mask(s + i))
+            return i + __builtin_ctz(mask);
+    if (i != n) {
+        if (unsigned mask = matcher.mask(s + n - 32) >> (32 - (n - i)))
+            return i + __builtin_ctz(mask);
+    }
+    return ds::StringView::npos;
+}
+
+DS_TARGET("avx2")
+size_t findLastAVX2(const unsigned char* s, size_t n, const ByteMatcher& m) {
+    if (n < 32)
+        return findLastSSE42(s, n, m);
+    Matcher256 matcher(m);
+    size_t i = n;
+    for (; i >= 32; i -= 32)
+        if (unsigned mask = matcher.mask(s + i - 32))
+            return i - 32 + (31 - __builtin_clz(mask));
+    if (i != 0) {
+        if (unsigned mask = matcher.mask(s) & ((1u << i) - 1))
+            return 31 - __builtin_clz(mask);
+    }
+    return ds::StringView::npos;
+}
+
+DS_TARGET("avx2")
+size_t countAVX2(const unsigned char* s, size_t n, unsigned char c) {
+    const __m256i needle = _mm256_set1_epi8(static_cast<char>(c));
+    const __m256i zero = _mm256_setzero_si256();
+    size_t count = 0, i = 0;
+    while (i + 32 <= n) {
+        __m256i acc = zero;
+        for (unsigned iter = 0; iter != 255 && i + 32 <= n; ++iter, i += 32) {
+            __m256i x =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(x, needle));
+        }
+        __m256i sums = _mm256_sad_epu8(acc, zero);
+        count += _mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+                 _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3);
+    }
+    return count + countSSE42(s + i, n - i, c);
+}
+
+#endif
+
+// Entry points. They pick the widest kernel the host supports.
+size_t findFirstByte(const char* s, size_t n, const ByteMatcher& m) {
+    auto p = reinterpret_cast<const unsigned char*>(s);
+#ifdef DS_X86_DISPATCH
+    switch (ds::detail::hostSIMDLevel()) {
+    case ds::detail::SIMDLevel::AVX512:
+    case ds::detail::SIMDLevel::AVX2:
+        return findFirstAVX2(p, n, m);
+    case ds::detail::SIMDLevel::SSE42:
+        return findFirstSSE42(p, n, m);
+    default:
+        break;
+    }
+#endif
+    return findFirstScalar(p, n, m);
+}
+
+// Like findFirstByte, but starts at offset 'from' and returns an index relative
+// to 's'.
+size_t findFirstByte(const char* s, size_t n, size_t from,
+                     const ByteMatcher& m) {
+    if (from >= n)
+        return ds::StringView::npos;
+    auto idx = findFirstByte(s + from, n - from, m);
+    return idx == ds::StringView::npos ? idx : from + idx;
+}
+
+size_t findLastByte(const char* s, size_t n, const ByteMatcher& m) {
+    auto p = reinterpret_cast<const unsigned char*>(s);
+#ifdef DS_X86_DISPATCH
+    switch (ds::detail::hostSIMDLevel()) {
+    case ds::detail::SIMDLevel::AVX512:
+    case ds::detail::SIMDLevel::AVX2:
+        return findLastAVX2(p, n, m);
+    case ds::detail::SIMDLevel::SSE42:
+        return findLastSSE42(p, n, m);
+    default:
+        break;
+    }
+#endif
+    return findLastScalar(p, n, m);
+}
+
+size_t countByte(const char* s, size_t n, char c) {
+    auto p = reinterpret_cast<const unsigned char*>(s);
+    auto uc = static_cast<unsigned char>(c);
+#ifdef DS_X86_DISPATCH
+    switch (ds::detail::hostSIMDLevel()) {
+    case ds::detail::SIMDLevel::AVX512:
+    case ds::detail::SIMDLevel::AVX2:
+        return countAVX2(p, n, uc);
+    case ds::detail::SIMDLevel::SSE42:
+        return countSSE42(p, n, uc);
+    default:
+        break;
+    }
+#endif
+    return countScalar(p, n, uc);
+}
+
+// Finds the first occurrence of needle[0, n) in s[from, size), n >= 1, with
+// memchr on its first byte. Takes O(size * n) time in the worst case, which
+// only pays off for short needles or haystacks.
+size_t findShort(const char* s, size_t size, size_t from, const char* needle,
+                 size_t n) {
+    if (size - from < n)
+        return ds::StringView::npos;
+    const char* p = s + from;
+    const char* last = s + (size - n);
+    while (p <= last) {
+        p = static_cast<const char*>(std::memchr(p, needle[0], last - p + 1));
+        if (p == nullptr)
+            break;
+        if (std::memcmp(p + 1, needle + 1, n - 1) == 0)
+            return p - s;
+        ++p;
+    }
+    return ds::StringView::npos;
 }
 
-StringView::StringView(const char* s, size_t len) : _data(s), length(len) {
-    assert((_data || length == 0) &&
-           "StringView cannot be built from NULL with non-null length");
+// Like findShort, but finds the last occurrence in s[0, size).
+size_t rfindShort(const char* s, size_t size, const char* needle, size_t n) {
+    ByteMatcher first(needle[0], false);
+    for (size_t end = size - n + 1; end != 0;) {
+        auto i = findLastByte(s, end, first);
+        if (i == ds::StringView::npos)
+            break;
+        if (std::memcmp(s + i + 1, needle + 1, n - 1) == 0)
+            return i;
+        end = i;
+    }
+    return ds::StringView::npos;
+}
+
+// Returns the value of the digit 'c' in bases up to 36, or 36 if 'c' is not a
+// digit at all.
+inline unsigned digitValue(unsigned char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 10;
+    return 36;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// SWAR helpers for parsing eight decimal digits at once. The first character is
+// the lowest byte of the word.
+inline uint64_t loadEightBytes(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline bool isEightDigits(uint64_t v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0) |
+            (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+           0x3333333333333333;
+}
+
+inline uint32_t parseEightDigits(uint64_t v) {
+    v = (v & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;
+    v = (v & 0x00FF00FF00FF00FF) * 6553601 >> 16;
+    return static_cast<uint32_t>((v & 0x0000FFFF0000FFFF) * 42949672960001 >>
+                                 32);
+}
+#endif
+
+// Parses digits of base 'radix' from p[0, n) into 'result'. Returns the number
+// of digits consumed, or 0 if there are none or the value overflows.
+size_t parseDigits(const char* p, size_t n, unsigned radix,
+                   unsigned long long& result) {
+    using ULL = unsigned long long;
+    ULL value = 0;
+    size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Below 10^11, multiplying by 10^8 and adding eight digits cannot
+    // overflow 64 bits.
+    if (radix == 10 && sizeof(ULL) == sizeof(uint64_t)) {
+        while (n - i >= 8 && value < 100000000000ULL) {
+            auto word = loadEightBytes(p + i);
+            if (!isEightDigits(word))
+                break;
+            value = value * 100000000 + parseEightDigits(word);
+            i += 8;
+        }
+    }
+#endif
+    const ULL maxValue = std::numeric_limits<ULL>::max();
+    for (; i != n; ++i) {
+        auto d = digitValue(static_cast<unsigned char>(p[i]));
+        if (d >= radix)
+            break;
+        if (value > (maxValue - d) / radix)
+            return 0;
+        value = value * radix + d;
+    }
+    if (i != 0)
+        result = value;
+    return i;
+}
+
+// Strips a radix prefix from 's' if 'radix' is 0 and returns the radix to use.
+// A prefix that no digit follows is not one: "0x" is just the number 0.
+unsigned detectRadix(ds::StringView& s, unsigned radix) {
+    if (radix != 0)
+        return radix;
+    if (s.size() >= 2 && s[0] == '0') {
+        unsigned prefixed = 0;
+        switch (s[1] | 0x20) {
+        case 'x':
+            prefixed = 16;
+            break;
+        case 'b':
+            prefixed = 2;
+            break;
+        case 'o':
+            prefixed = 8;
+            break;
+        default:
+            if (s[1] >= '0' && s[1] <= '9') {
+                s = s.dropFront(1);
+                return 8;
+            }
+            return 10;
+        }
+        if (s.size() >= 3 &&
+            digitValue(static_cast<unsigned char>(s[2])) < prefixed) {
+            s = s.dropFront(2);
+            return prefixed;
+        }
+    }
+    return 10;
+}
+
+// Powers of ten that are exactly representable as doubles.
+const double exactPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Matches 'word' case-insensitively at the front of 's'.
+bool startsWithLower(ds::StringView s, size_t pos, const char* word) {
+    size_t len = std::strlen(word);
+    return s.size() - pos >= len && s.substr(pos, len).equals_lower(word);
+}
+
+// Significant digits past this many can only affect the rounding of a double
+// by being non-zero or not.
+const size_t MaxSignificantDigits = 768;
+
+// Converts the validated number s[0, n) with the C library. This is the slow
+// path for inputs the fast path cannot round correctly. The number is
+// rewritten as "<sign><digits>e<exponent>" into a buffer on the stack, with
+// the digits past MaxSignificantDigits folded into one sticky '1', so that
+// input of any length converts without allocating.
+double parseDoubleSlow(const char* s, size_t n) {
+    char buf[MaxSignificantDigits + 32];
+    size_t len = 0, i = 0;
+    if (s[i] == '-' || s[i] == '+')
+        buf[len++] = s[i++];
+
+    int64_t exponent = 0;
+    size_t significant = 0;
+    bool inFraction = false, sticky = false;
+    for (; i != n; ++i) {
+        char c = s[i];
+        if (c == '.') {
+            inFraction = true;
+            continue;
+        }
+        if (c < '0' || c > '9')
+            break;
+        if (significant == 0 && c == '0') {
+            exponent -= inFraction;
+        } else if (significant < MaxSignificantDigits) {
+            buf[len++] = c;
+            ++significant;
+            exponent -= inFraction;
+        } else {
+            sticky |= c != '0';
+            exponent += !inFraction;
+        }
+    }
+    if (significant == 0)
+        buf[len++] = '0';
+    if (sticky) {
+        buf[len++] = '1';
+        --exponent;
+    }
+
+    // What is left is an exponent with at least one digit.
+    if (i != n) {
+        bool negExp = s[++i] == '-';
+        if (s[i] == '-' || s[i] == '+')
+            ++i;
+        int64_t e = 0;
+        for (; i != n; ++i) {
+            if (e < 100000)
+                e = e * 10 + (s[i] - '0');
+        }
+        exponent += negExp ? -e : e;
+    }
+    std::snprintf(buf + len, sizeof(buf) - len, "e%lld",
+                  static_cast<long long>(exponent));
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+    static const locale_t cLocale = newlocale(LC_ALL_MASK, "C", nullptr);
+    return strtod_l(buf, nullptr, cLocale);
+#else
+    return std::strtod(buf, nullptr);
+#endif
 }
 
-bool StringView::equals(StringView rhs) const {
-    return (length == rhs.length &&
-            compareMemory(_data, rhs._data, rhs.length) == 0);
+// Checks the exponent bits rather than calling std::isinf(), which
+// -ffinite-math-only folds to false.
+bool isInfOrNaN(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 52 & 0x7FF) == 0x7FF;
+}
 }
 
+namespace ds {
+
+constexpr size_t StringView::npos;
+
 bool StringView::equals_lower(StringView rhs) const {
     return length == rhs.length && compare_lower(rhs) == 0;
 }
 
-int StringView::compare(StringView rhs) const {
-    if (int res = compareMemory(_data, rhs._data, std::min(length, rhs.length)))
-        return res < 0 ? -1 : 1;
-    if (length == rhs.length)
-        return 0;
-    return length < rhs.length ? -1 : 1;
-}
-
 int StringView::compare_lower(StringView rhs) const {
     if (int res =
             ascii_strncasecmp(_data, rhs._data, std::min(length, rhs.length)))
@@ -75,17 +608,6 @@ int StringView::compare_lower(StringView rhs) const {
     return length < rhs.length ? -1 : 1;
 }
 
-bool StringView::startswith(StringView prefix) const {
-    return length >= prefix.length &&
-           compareMemory(_data, prefix._data, prefix.length) == 0;
-}
-
-bool StringView::endswith(StringView suffix) const {
-    return length >= suffix.length &&
-           compareMemory(end() - suffix.length, suffix._data, suffix.length) ==
-               0;
-}
-
 size_t StringView::find(char c, size_t from) const {
     size_t findBegin = std::min(from, length);
     if (findBegin < length) {
@@ -103,107 +625,180 @@ size_t StringView::find(StringView s, size_t from) const {
     size_t n = s.size();
     if (n == 0)
         return from;
+    if (n == 1)
+        return find(needle[0], from);
 
-    size_t size = length - from;
-    if (size < n)
-        return npos;
-
-    const char* start = _data + from;
-    const char* stop = start + (size - n + 1);
-    if (size < 16 || n > 255) {
-        do {
-            if (std::memcmp(start, needle, n) == 0)
-                return start - _data;
-            ++start;
-        } while (start < stop);
-        return npos;
-    }
-
-    uint8_t badCharSkip[256];
-    std::memset(badCharSkip, n, 256);
-    for (unsigned i = 0; i != n - 1; ++i)
-        badCharSkip[static_cast<uint8_t>(s[i])] =
-            static_cast<uint8_t>(n - 1 - i);
-
-    do {
-        if (std::memcmp(start, needle, n) == 0)
-            return start - _data;
-        start += badCharSkip[(uint8_t)start[n - 1]];
-    } while (start < stop);
-
-    return npos;
+    if (n < ShortNeedleLength || length - from < TwoWayThreshold)
+        return findShort(_data, length, from, needle, n);
+    return StringSearcher(s).find(*this, from);
 }
 size_t StringView::rfind(char c, size_t from) const {
-    from = std::min(from, length);
-    size_t i = from;
-    while (i != 0) {
-        --i;
-        if (_data[i] == c)
-            return i;
-    }
-    return npos;
+    return findLastByte(_data, std::min(from, length), ByteMatcher(c, false));
 }
 size_t StringView::rfind(StringView s) const {
     size_t n = s.size();
     if (n > length)
         return npos;
-    for (size_t i = length - n + 1, e = 0; i != e;) {
-        --i;
-        if (substr(i, n).equals(s))
-            return i;
-    }
-    return npos;
+    if (n == 0)
+        return length;
+    if (n == 1)
+        return rfind(s[0]);
+    if (n < ShortNeedleLength || length < TwoWayThreshold)
+        return rfindShort(_data, length, s.data(), n);
+    return StringSearcher(s, StringSearcher::Direction::Backward).rfind(*this);
 }
 
-size_t StringView::count(char c) const {
-    size_t count = 0;
-    for (size_t i = 0, e = length; i != e; ++i)
-        if (_data[i] == c)
-            ++count;
-    return count;
-}
+size_t StringView::count(char c) const { return countByte(_data, length, c); }
 
 size_t StringView::count(StringView s) const {
-    size_t count = 0;
     size_t n = s.size();
     if (n > length)
         return 0;
-    for (size_t i = 0, e = length - n + 1; i != e; ++i)
-        if (substr(i, n).equals(s))
+    if (n == 0)
+        return length + 1;
+    if (n == 1)
+        return count(s[0]);
+    if (n < ShortNeedleLength || length < TwoWayThreshold) {
+        size_t count = 0;
+        for (size_t i = 0;
+             (i = findShort(_data, length, i, s.data(), n)) != npos; ++i)
             ++count;
-    return count;
-}
+        return count;
+    }
+    return StringSearcher(s).count(*this);
+}
+
+size_t StringView::consumeUnsigned(unsigned radix,
+                                   unsigned long long& result) const {
+    assert((radix == 0 || (radix >= 2 && radix <= 36)) && "Invalid radix!");
+    auto s = *this;
+    radix = detectRadix(s, radix);
+    auto n = parseDigits(s.data(), s.size(), radix, result);
+    return n == 0 ? 0 : n + (s.data() - _data);
+}
+
+size_t StringView::consumeSigned(unsigned radix, long long& result) const {
+    if (empty() || _data[0] != '-') {
+        unsigned long long value;
+        auto n = consumeUnsigned(radix, value);
+        if (n == 0 || value > static_cast<unsigned long long>(
+                                  std::numeric_limits<long long>::max()))
+            return 0;
+        result = static_cast<long long>(value);
+        return n;
+    }
 
-char StringView::front() const {
-    assert(!empty());
-    return _data[0];
+    unsigned long long value;
+    auto n = dropFront(1).consumeUnsigned(radix, value);
+    if (n == 0 || value > static_cast<unsigned long long>(
+                              std::numeric_limits<long long>::max()) +
+                              1)
+        return 0;
+    result = static_cast<long long>(0 - value);
+    return n + 1;
 }
 
-char StringView::back() const {
-    assert(!empty());
-    return _data[length - 1];
-}
-char StringView::operator[](size_t idx) const {
-    assert(idx < length && "Index out of bound!");
-    return _data[idx];
-}
+size_t StringView::getAsDouble(double& result) const {
+    size_t i = 0;
+    bool negative = false;
+    if (i != length && (_data[i] == '-' || _data[i] == '+'))
+        negative = _data[i++] == '-';
 
-StringView StringView::substr(size_t start, size_t n) const {
-    start = std::min(start, length);
-    return StringView(_data + start, std::min(n, length - start));
-}
-StringView StringView::slice(size_t start, size_t end) const {
-    start = std::min(start, length);
-    end = std::min(std::max(start, end), length);
-    return StringView(_data + start, end - start);
-}
-StringView StringView::dropFront(size_t n) const {
-    assert(size() >= n && "Dropping more elements than exist!");
-    return substr(n);
-}
-StringView StringView::dropBack(size_t n) const {
-    assert(size() >= n && "Dropping more elements than exist!");
-    return substr(0, size() - n);
+    if (startsWithLower(*this, i, "inf")) {
+        i += startsWithLower(*this, i, "infinity") ? 8 : 3;
+        result = negative ? -std::numeric_limits<double>::infinity()
+                          : std::numeric_limits<double>::infinity();
+        return i;
+    }
+    if (startsWithLower(*this, i, "nan")) {
+        result = negative ? -std::numeric_limits<double>::quiet_NaN()
+                          : std::numeric_limits<double>::quiet_NaN();
+        return i + 3;
+    }
+
+    // Collect up to 19 significant digits into 'mantissa' and track where the
+    // decimal point goes in 'exponent'.
+    uint64_t mantissa = 0;
+    int64_t exponent = 0;
+    size_t numDigits = 0, significant = 0;
+    bool truncated = false;
+    auto addDigit = [&](unsigned d) {
+        ++numDigits;
+        if (significant == 0 && d == 0)
+            return false;
+        if (significant < 19) {
+            mantissa = mantissa * 10 + d;
+            ++significant;
+            return false;
+        }
+        truncated |= d != 0;
+        return true;
+    };
+    for (; i != length && _data[i] >= '0' && _data[i] <= '9'; ++i) {
+        if (addDigit(_data[i] - '0'))
+            ++exponent;
+    }
+    if (i != length && _data[i] == '.') {
+        for (++i; i != length && _data[i] >= '0' && _data[i] <= '9'; ++i) {
+            if (!addDigit(_data[i] - '0'))
+                --exponent;
+        }
+    }
+    if (numDigits == 0)
+        return 0;
+
+    // The exponent only counts if at least one digit follows it.
+    if (i != length && (_data[i] | 0x20) == 'e') {
+        size_t j = i + 1;
+        bool negExp = false;
+        if (j != length && (_data[j] == '-' || _data[j] == '+'))
+            negExp = _data[j++] == '-';
+        if (j != length && _data[j] >= '0' && _data[j] <= '9') {
+            int64_t e = 0;
+            for (; j != length && _data[j] >= '0' && _data[j] <= '9'; ++j) {
+                if (e < 100000)
+                    e = e * 10 + (_data[j] - '0');
+            }
+            exponent += negExp ? -e : e;
+            i = j;
+        }
+    }
+
+    // Clinger's fast path: if the mantissa and the power of ten are both
+    // exact doubles, a single correctly rounded multiply or divide gives the
+    // correctly rounded result.
+    const uint64_t maxExactMantissa = uint64_t(1) << 53;
+    if (!truncated && mantissa <= maxExactMantissa) {
+        double value = -1;
+        if (mantissa == 0) {
+            value = 0;
+        } else if (exponent >= -22 && exponent <= 22) {
+            value = static_cast<double>(mantissa);
+            value = exponent < 0 ? value / exactPowersOfTen[-exponent]
+                                 : value * exactPowersOfTen[exponent];
+        } else if (exponent > 22 && exponent <= 22 + 15) {
+            // Move the excess exponent into the mantissa as long as it stays
+            // exact.
+            auto m = mantissa;
+            auto e = exponent;
+            while (e > 22 && m <= maxExactMantissa / 10) {
+                m *= 10;
+                --e;
+            }
+            if (e == 22)
+                value = static_cast<double>(m) * exactPowersOfTen[22];
+        }
+        if (value >= 0) {
+            result = negative ? -value : value;
+            return i;
+        }
+    }
+
+    double value = parseDoubleSlow(_data, i);
+    if (isInfOrNaN(value))
+        return 0;
+    result = value;
+    return i;
 }
 
 size_t StringView::find_first_of(char c, size_t from) const {
@@ -211,32 +806,21 @@ size_t StringView::find_first_of(char c, size_t from) const {
 }
 
 size_t StringView::find_first_of(StringView chars, size_t from) const {
-    std::bitset<1 << NUM_CHAR_BITS> charBits;
-    for (size_type i = 0; i != chars.size(); ++i)
-        charBits.set((unsigned char)chars[i]);
-
-    for (size_type i = std::min(from, length), e = length; i != e; ++i)
-        if (charBits.test((unsigned char)_data[i]))
-            return i;
-    return npos;
+    if (chars.size() == 1)
+        return find(chars[0], from);
+    return findFirstByte(_data, length, from,
+                         ByteMatcher(CharSet(chars), false));
 }
 
 size_t StringView::find_first_not_of(char c, size_t from) const {
-    for (size_type i = std::min(from, length), e = length; i != e; ++i)
-        if (_data[i] != c)
-            return i;
-    return npos;
+    return findFirstByte(_data, length, from, ByteMatcher(c, true));
 }
 
 size_t StringView::find_first_not_of(StringView chars, size_t from) const {
-    std::bitset<1 << NUM_CHAR_BITS> charBits;
-    for (size_type i = 0; i != chars.size(); ++i)
-        charBits.set((unsigned char)chars[i]);
-
-    for (size_type i = std::min(from, length), e = length; i != e; ++i)
-        if (!charBits.test((unsigned char)_data[i]))
-            return i;
-    return npos;
+    if (chars.size() == 1)
+        return find_first_not_of(chars[0], from);
+    return findFirstByte(_data, length, from,
+                         ByteMatcher(CharSet(chars), true));
 }
 
 size_t StringView::find_last_of(char c, size_t from) const {
@@ -244,32 +828,21 @@ size_t StringView::find_last_of(char c, size_t from) const {
 }
 
 size_t StringView::find_last_of(StringView chars, size_t from) const {
-    std::bitset<1 << NUM_CHAR_BITS> charBits;
-    for (size_type i = 0; i != chars.size(); ++i)
-        charBits.set((unsigned char)chars[i]);
-
-    for (size_type i = std::min(from, length) - 1, e = -1; i != e; --i)
-        if (charBits.test((unsigned char)_data[i]))
-            return i;
-    return npos;
+    if (chars.size() == 1)
+        return rfind(chars[0], from);
+    return findLastByte(_data, std::min(from, length),
+                        ByteMatcher(CharSet(chars), false));
 }
 
 size_t StringView::find_last_not_of(char c, size_t from) const {
-    for (size_type i = std::min(from, length) - 1, e = -1; i != e; --i)
-        if (_data[i] != c)
-            return i;
-    return npos;
+    return findLastByte(_data, std::min(from, length), ByteMatcher(c, true));
 }
 
 size_t StringView::find_last_not_of(StringView chars, size_t from) const {
-    std::bitset<1 << NUM_CHAR_BITS> charBits;
-    for (size_type i = 0, e = chars.size(); i != e; ++i)
-        charBits.set((unsigned char)chars[i]);
-
-    for (size_type i = std::min(from, length) - 1, e = -1; i != e; --i)
-        if (!charBits.test((unsigned char)_data[i]))
-            return i;
-    return npos;
+    if (chars.size() == 1)
+        return find_last_not_of(chars[0], from);
+    return findLastByte(_data, std::min(from, length),
+                        ByteMatcher(CharSet(chars), true));
 }
 
 StringView StringView::ltrim(StringView chars) const {
@@ -292,27 +865,51 @@ std::ostream& operator<<(std::ostream& os, const StringView& s) {
     return os;
 }
 
+size_t SplitRange::findSeparator(StringView text, size_t& sepLen) const {
+    switch (kind) {
+    case SeparatorKind::Char:
+        sepLen = 1;
+        return text.find(sepChar);
+    case SeparatorKind::String:
+        sepLen = sep.size();
+        return sep.empty() ? StringView::npos : text.find(sep);
+    case SeparatorKind::AnyOf:
+        sepLen = 1;
+        return text.find_first_of(sep);
+    }
+    return StringView::npos;
+}
+
+void SplitRange::iterator::advance() {
+    while (!lastPiece) {
+        if (splitsLeft != 0) {
+            size_t sepLen;
+            auto idx = range->findSeparator(rest, sepLen);
+            if (idx != StringView::npos) {
+                piece = rest.slice(0, idx);
+                rest = rest.slice(idx + sepLen, StringView::npos);
+                --splitsLeft;
+                if (range->keepEmpty || idx > 0)
+                    return;
+                continue;
+            }
+        }
+
+        lastPiece = true;
+        piece = rest;
+        if (range->keepEmpty || !piece.empty())
+            return;
+    }
+    atEnd = true;
+}
+
 std::vector<StringView> split(StringView str, char sep, int maxSplit,
                               bool keepEmpty) {
     std::vector<StringView> ret;
     if (maxSplit > 0)
         ret.reserve(maxSplit + 1);
-
-    while (maxSplit != 0) {
-        auto idx = str.find(sep);
-        if (idx == StringView::npos)
-            break;
-
-        if (keepEmpty || idx > 0)
-            ret.push_back(str.slice(0, idx));
-
-        str = str.slice(idx + 1, StringView::npos);
-        --maxSplit;
-    }
-
-    if (keepEmpty || !str.empty())
-        ret.push_back(str);
-
+    for (auto piece : SplitRange(str, sep, maxSplit, keepEmpty))
+        ret.push_back(piece);
     return ret;
 }
 }
@@ -0,0 +1,424 @@
+#include "DataStructure/Detail.h"
+#include "DataStructure/StringView.h"
+
+#include <cstring>
+
+#ifdef DS_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Checks one sequence at the front of p[0, n) against the well-formed byte
+// sequences of the Unicode standard (table 3-7). Returns the length of the
+// sequence, or the length of its longest valid prefix (at least 1) with
+// 'valid' cleared if the sequence is ill-formed. 'cp' receives the decoded
+// code point of a valid sequence.
+size_t checkSequence(const unsigned char* p, size_t n, bool& valid,
+                     char32_t& cp) {
+    unsigned char b0 = p[0];
+    valid = true;
+    if (b0 < 0x80) {
+        cp = b0;
+        return 1;
+    }
+
+    size_t len;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (b0 >= 0xC2 && b0 <= 0xDF) {
+        len = 2;
+        cp = b0 & 0x1F;
+    } else if (b0 >= 0xE0 && b0 <= 0xEF) {
+        len = 3;
+        cp = b0 & 0x0F;
+        if (b0 == 0xE0)
+            lo = 0xA0;
+        else if (b0 == 0xED)
+            hi = 0x9F;
+    } else if (b0 >= 0xF0 && b0 <= 0xF4) {
+        len = 4;
+        cp = b0 & 0x07;
+        if (b0 == 0xF0)
+            lo = 0x90;
+        else if (b0 == 0xF4)
+            hi = 0x8F;
+    } else {
+        valid = false;
+        return 1;
+    }
+
+    // Only the second byte has a restricted range.
+    for (size_t i = 1; i != len; ++i) {
+        if (i == n || p[i] < lo || p[i] > hi) {
+            valid = false;
+            return i;
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+        lo = 0x80;
+        hi = 0xBF;
+    }
+    return len;
+}
+
+bool isValidScalar(const unsigned char* p, size_t n) {
+    size_t i = 0;
+    while (i != n) {
+        // Skip ASCII a word at a time.
+        if (n - i >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p + i, sizeof(word));
+            if ((word & 0x8080808080808080ULL) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        bool valid;
+        char32_t cp;
+        i += checkSequence(p + i, n - i, valid, cp);
+        if (!valid)
+            return false;
+    }
+    return true;
+}
+
+size_t countLeadBytesScalar(const unsigned char* p, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i != n; ++i)
+        count += (p[i] & 0xC0) != 0x80;
+    return count;
+}
+
+#ifdef DS_X86_DISPATCH
+
+// The lookup algorithm of Keiser and Lemire ("Validating UTF-8 in less than one
+// instruction per byte", 2021). Every byte is classified by three 16-entry
+// tables indexed by the high nibble of the previous byte, the low nibble of the
+// previous byte, and the high nibble of the byte itself. Each table entry is a
+// set of error kinds that the nibble is compatible with, so ANDing the three
+// lookups leaves exactly the errors of the 2-byte window. Errors that need to
+// look 3 or 4 bytes back (missing or extra continuation bytes) are found by
+// checking where continuation bytes must appear.
+namespace utf8_lookup {
+constexpr uint8_t TooShort = 1 << 0;
+constexpr uint8_t TooLong = 1 << 1;
+constexpr uint8_t Overlong3 = 1 << 2;
+constexpr uint8_t TooLarge = 1 << 3;
+constexpr uint8_t Surrogate = 1 << 4;
+constexpr uint8_t Overlong2 = 1 << 5;
+constexpr uint8_t TooLarge1000 = 1 << 6;
+constexpr uint8_t Overlong4 = 1 << 6;
+constexpr uint8_t TwoConts = 1 << 7;
+constexpr uint8_t Carry = TooShort | TooLong | TwoConts;
+
+// Indexed by the high nibble of the previous byte.
+#define DS_UTF8_BYTE1_HIGH                                                     \
+    TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,    \
+        TwoConts, TwoConts, TwoConts, TwoConts, TooShort | Overlong2,          \
+        TooShort, TooShort | Overlong3 | Surrogate,                            \
+        TooShort | TooLarge | TooLarge1000 | Overlong4
+
+// Indexed by the low nibble of the previous byte.
+#define DS_UTF8_BYTE1_LOW                                                      \
+    Carry | Overlong3 | Overlong2 | Overlong4, Carry | Overlong2, Carry,       \
+        Carry, Carry | TooLarge, Carry | TooLarge | TooLarge1000,              \
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,      \
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,      \
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000,      \
+        Carry | TooLarge | TooLarge1000,                                       \
+        Carry | TooLarge | TooLarge1000 | Surrogate,                           \
+        Carry | TooLarge | TooLarge1000, Carry | TooLarge | TooLarge1000
+
+// Indexed by the high nibble of the current byte.
+#define DS_UTF8_BYTE2_HIGH                                                     \
+    TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,      \
+        TooShort,                                                              \
+        TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4, \
+        TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,                 \
+        TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,                 \
+        TooLong | Overlong2 | TwoConts | Surrogate | TooLarge, TooShort,       \
+        TooShort, TooShort, TooShort
+}
+
+DS_TARGET("sse4.2")
+inline __m128i nibbleHigh128(__m128i x) {
+    return _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x0F));
+}
+
+// Returns the error bits of the 16 bytes in 'input', given the 16 bytes that
+// precede it.
+DS_TARGET("sse4.2")
+__m128i checkBlock128(__m128i input, __m128i prev) {
+    using namespace utf8_lookup;
+    const __m128i byte1High = _mm_setr_epi8(DS_UTF8_BYTE1_HIGH);
+    const __m128i byte1Low = _mm_setr_epi8(DS_UTF8_BYTE1_LOW);
+    const __m128i byte2High = _mm_setr_epi8(DS_UTF8_BYTE2_HIGH);
+
+    __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+    __m128i special = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(byte1High, nibbleHigh128(prev1)),
+                      _mm_shuffle_epi8(byte1Low, _mm_and_si128(
+                                                     prev1,
+                                                     _mm_set1_epi8(0x0F)))),
+        _mm_shuffle_epi8(byte2High, nibbleHigh128(input)));
+
+    // A byte must be a continuation if the byte two back starts a 3 or 4
+    // byte sequence, or the byte three back starts a 4 byte sequence.
+    __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+    __m128i isThird = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0u - 0x80));
+    __m128i isFourth = _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0u - 0x80));
+    __m128i must23 = _mm_and_si128(_mm_or_si128(isThird, isFourth),
+                                   _mm_set1_epi8(char(0x80)));
+    return _mm_xor_si128(must23, special);
+}
+
+// Nonzero if the block ends in the middle of a sequence.
+DS_TARGET("sse4.2")
+inline __m128i isIncomplete128(__m128i input) {
+    const __m128i maxValue =
+        _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                      char(0xF0 - 1), char(0xE0 - 1), char(0xC0 - 1));
+    return _mm_subs_epu8(input, maxValue);
+}
+
+// Carries the validation state from one block to the next.
+struct Validator128 {
+    __m128i error, prev, prevIncomplete;
+
+    DS_TARGET("sse4.2") Validator128() {
+        error = prev = prevIncomplete = _mm_setzero_si128();
+    }
+
+    DS_TARGET("sse4.2") void step(__m128i input) {
+        error = _mm_or_si128(error, checkBlock128(input, prev));
+        prevIncomplete = isIncomplete128(input);
+        prev = input;
+    }
+
+    // Skips a block known to be ASCII only, which is fine unless the previous
+    // block ended in the middle of a sequence.
+    DS_TARGET("sse4.2") void stepASCII(__m128i input) {
+        error = _mm_or_si128(error, prevIncomplete);
+        prevIncomplete = _mm_setzero_si128();
+        prev = input;
+    }
+
+    DS_TARGET("sse4.2") bool hasError() const {
+        return !_mm_testz_si128(error, error);
+    }
+};
+
+DS_TARGET("sse4.2")
+bool isValidSSE42(const unsigned char* p, size_t n) {
+    Validator128 v;
+    size_t i = 0;
+    for (; n - i >= 64; i += 64) {
+        // Test 64 bytes for ASCII at once. Checking every block separately
+        // would mispredict on text with a sprinkle of non-ASCII characters.
+        auto src = reinterpret_cast<const __m128i*>(p + i);
+        auto a = _mm_loadu_si128(src), b = _mm_loadu_si128(src + 1);
+        auto c = _mm_loadu_si128(src + 2), d = _mm_loadu_si128(src + 3);
+        auto any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        if (_mm_movemask_epi8(any) == 0) {
+            v.stepASCII(d);
+            continue;
+        }
+        v.step(a);
+        v.step(b);
+        v.step(c);
+        v.step(d);
+        // Bail out early once something is wrong.
+        if ((i & 1023) == 960 && v.hasError())
+            return false;
+    }
+    for (; n - i >= 16; i += 16)
+        v.step(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+    if (i != n) {
+        alignas(16) unsigned char buf[16] = {0};
+        std::memcpy(buf, p + i, n - i);
+        v.step(_mm_load_si128(reinterpret_cast<const __m128i*>(buf)));
+    }
+    v.error = _mm_or_si128(v.error, v.prevIncomplete);
+    return !v.hasError();
+}
+
+DS_TARGET("sse4.2")
+size_t countLeadBytesSSE42(const unsigned char* p, size_t n) {
+    // Continuation bytes are exactly the bytes <= -65 as signed values.
+    const __m128i threshold = _mm_set1_epi8(-65);
+    size_t count = 0, i = 0;
+    for (; n - i >= 16; i += 16) {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpgt_epi8(x, threshold));
+        count += __builtin_popcount(mask);
+    }
+    return count + countLeadBytesScalar(p + i, n - i);
+}
+
+// AVX2 kernels (32 bytes per step)
+
+DS_TARGET("avx2")
+inline __m256i nibbleHigh256(__m256i x) {
+    return _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi8(0x0F));
+}
+
+DS_TARGET("avx2")
+inline __m256i table256(__m128i t) {
+    return _mm256_broadcastsi128_si256(t);
+}
+
+DS_TARGET("avx2")
+__m256i checkBlock256(__m256i input, __m256i prev) {
+    using namespace utf8_lookup;
+    const __m256i byte1High = table256(_mm_setr_epi8(DS_UTF8_BYTE1_HIGH));
+    const __m256i byte1Low = table256(_mm_setr_epi8(DS_UTF8_BYTE1_LOW));
+    const __m256i byte2High = table256(_mm_setr_epi8(DS_UTF8_BYTE2_HIGH));
+
+    // The upper lane of 'input' preceded by the lower one, and the lower lane
+    // preceded by the upper lane of 'prev'.
+    __m256i shifted = _mm256_permute2x128_si256(prev, input, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(byte1High, nibbleHigh256(prev1)),
+            _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(
+                                              prev1, _mm256_set1_epi8(0x0F)))),
+        _mm256_shuffle_epi8(byte2High, nibbleHigh256(input)));
+
+    __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+    __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+    __m256i isThird = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0u - 0x80));
+    __m256i isFourth =
+        _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0u - 0x80));
+    __m256i must23 = _mm256_and_si256(_mm256_or_si256(isThird, isFourth),
+                                      _mm256_set1_epi8(char(0x80)));
+    return _mm256_xor_si256(must23, special);
+}
+
+DS_TARGET("avx2")
+inline __m256i isIncomplete256(__m256i input) {
+    const __m256i maxValue = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, char(0xF0 - 1),
+        char(0xE0 - 1), char(0xC0 - 1));
+    return _mm256_subs_epu8(input, maxValue);
+}
+
+struct Validator256 {
+    __m256i error, prev, prevIncomplete;
+
+    DS_TARGET("avx2") Validator256() {
+        error = prev = prevIncomplete = _mm256_setzero_si256();
+    }
+
+    DS_TARGET("avx2") void step(__m256i input) {
+        error = _mm256_or_si256(error, checkBlock256(input, prev));
+        prevIncomplete = isIncomplete256(input);
+        prev = input;
+    }
+
+    DS_TARGET("avx2") void stepASCII(__m256i input) {
+        error = _mm256_or_si256(error, prevIncomplete);
+        prevIncomplete = _mm256_setzero_si256();
+        prev = input;
+    }
+
+    DS_TARGET("avx2") bool hasError() const {
+        return !_mm256_testz_si256(error, error);
+    }
+};
+
+DS_TARGET("avx2")
+bool isValidAVX2(const unsigned char* p, size_t n) {
+    Validator256 v;
+    size_t i = 0;
+    for (; n - i >= 64; i += 64) {
+        // As in the SSE version, test for ASCII 64 bytes at a time.
+        auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        auto b =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 32));
+        if (_mm256_movemask_epi8(_mm256_or_si256(a, b)) == 0) {
+            v.stepASCII(b);
+            continue;
+        }
+        v.step(a);
+        v.step(b);
+        if ((i & 1023) == 960 && v.hasError())
+            return false;
+    }
+    for (; n - i >= 32; i += 32)
+        v.step(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+    if (i != n) {
+        alignas(32) unsigned char buf[32] = {0};
+        std::memcpy(buf, p + i, n - i);
+        v.step(_mm256_load_si256(reinterpret_cast<const __m256i*>(buf)));
+    }
+    v.error = _mm256_or_si256(v.error, v.prevIncomplete);
+    return !v.hasError();
+}
+
+DS_TARGET("avx2,popcnt")
+size_t countLeadBytesAVX2(const unsigned char* p, size_t n) {
+    const __m256i threshold = _mm256_set1_epi8(-65);
+    size_t count = 0, i = 0;
+    for (; n - i >= 32; i += 32) {
+        auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned mask =
+            _mm256_movemask_epi8(_mm256_cmpgt_epi8(x, threshold));
+        count += __builtin_popcount(mask);
+    }
+    return count + countLeadBytesScalar(p + i, n - i);
+}
+
+#undef DS_UTF8_BYTE1_HIGH
+#undef DS_UTF8_BYTE1_LOW
+#undef DS_UTF8_BYTE2_HIGH
+
+#endif
+}
+
+namespace ds {
+
+constexpr char32_t CodePointRange::ReplacementCharacter;
+
+bool StringView::isValidUTF8() const {
+    auto p = reinterpret_cast<const unsigned char*>(_data);
+#ifdef DS_X86_DISPATCH
+    switch (detail::hostSIMDLevel()) {
+    case detail::SIMDLevel::AVX512:
+    case detail::SIMDLevel::AVX2:
+        return isValidAVX2(p, length);
+    case detail::SIMDLevel::SSE42:
+        return isValidSSE42(p, length);
+    default:
+        break;
+    }
+#endif
+    return isValidScalar(p, length);
+}
+
+size_t StringView::countCodePoints() const {
+    auto p = reinterpret_cast<const unsigned char*>(_data);
+#ifdef DS_X86_DISPATCH
+    switch (detail::hostSIMDLevel()) {
+    case detail::SIMDLevel::AVX512:
+    case detail::SIMDLevel::AVX2:
+        return countLeadBytesAVX2(p, length);
+    case detail::SIMDLevel::SSE42:
+        return countLeadBytesSSE42(p, length);
+    default:
+        break;
+    }
+#endif
+    return countLeadBytesScalar(p, length);
+}
+
+char32_t CodePointRange::iterator::decodeMultiByte(const char* s, size_t n,
+                                                   size_t& len) {
+    bool valid;
+    char32_t cp;
+    len = checkSequence(reinterpret_cast<const unsigned char*>(s), n, valid,
+                        cp);
+    return valid ? cp : ReplacementCharacter;
+}
+}
@@ -0,0 +1,106 @@
+#include "DataStructure/Allocator.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+
+using namespace ds;
+
+namespace {
+
+bool isAligned(void* p, size_t alignment) {
+    return reinterpret_cast<uintptr_t>(p) % alignment == 0;
+}
+
+TEST(AllocatorTest, Malloc) {
+    MallocAllocator alloc;
+    auto p = static_cast<char*>(alloc.allocate(16, 8));
+    ASSERT_NE(nullptr, p);
+    std::memcpy(p, "0123456789abcdef", 16);
+    p = static_cast<char*>(alloc.reallocate(p, 16, 1024, 8));
+    EXPECT_EQ(0, std::memcmp(p, "0123456789abcdef", 16));
+    alloc.deallocate(p, 1024);
+
+    p = static_cast<char*>(alloc.allocate(10, 8));
+    EXPECT_LE(10u, alloc.getUsableSize(p, 10));
+    alloc.deallocate(p, 10);
+}
+
+TEST(AllocatorTest, OverAligned) {
+    MallocAllocator alloc;
+    auto p = static_cast<char*>(alloc.allocate(100, 128));
+    EXPECT_TRUE(isAligned(p, 128));
+    std::memset(p, 'x', 100);
+    for (size_t size : {200, 5000, 1 << 20}) {
+        p = static_cast<char*>(alloc.reallocate(p, 100, size, 128));
+        EXPECT_TRUE(isAligned(p, 128));
+        EXPECT_EQ('x', p[99]);
+    }
+    alloc.deallocate(p, 1 << 20);
+
+    AlignedAllocator<64> aligned;
+    for (size_t size : {1, 24, 1000}) {
+        void* q = aligned.allocate(size, 1);
+        EXPECT_TRUE(isAligned(q, 64));
+        aligned.deallocate(q, size);
+    }
+    EXPECT_EQ(64u, detail::MinAlignmentOf<AlignedAllocator<64>>::value);
+    EXPECT_EQ(1u, detail::MinAlignmentOf<MallocAllocator>::value);
+}
+
+TEST(AllocatorTest, Traits) {
+    BumpPtrAllocator arena;
+    char buf[16];
+    EXPECT_EQ(16u, detail::getUsableSize(ArenaAllocator(arena), buf, 16));
+
+    using Default = detail::GrowthFactorOf<MallocAllocator>;
+    EXPECT_EQ(2u, Default::Numerator);
+    EXPECT_EQ(1u, Default::Denominator);
+    using Slow = detail::GrowthFactorOf<GrowthFactor<3, 2>>;
+    EXPECT_EQ(3u, Slow::Numerator);
+    EXPECT_EQ(2u, Slow::Denominator);
+}
+
+TEST(AllocatorTest, BumpPtr) {
+    BumpPtrAllocator arena;
+    EXPECT_EQ(0u, arena.getNumSlabs());
+
+    auto a = arena.allocate(3, 1);
+    auto b = arena.allocate(8, 8);
+    auto c = arena.allocate(16, 64);
+    EXPECT_TRUE(isAligned(b, 8));
+    EXPECT_TRUE(isAligned(c, 64));
+    EXPECT_LT(static_cast<char*>(a), static_cast<char*>(b));
+    EXPECT_LT(static_cast<char*>(b), static_cast<char*>(c));
+    EXPECT_EQ(1u, arena.getNumSlabs());
+    EXPECT_EQ(27u, arena.getBytesAllocated());
+
+    // The most recent allocation can grow in place and be given back.
+    EXPECT_EQ(c, arena.reallocate(c, 16, 64, 64));
+    arena.deallocate(c, 64);
+    EXPECT_EQ(11u, arena.getBytesAllocated());
+    EXPECT_EQ(c, arena.allocate(64, 64));
+
+    // Other allocations are copied when they grow.
+    std::memcpy(b, "abcdefgh", 8);
+    auto d = arena.reallocate(b, 8, 32, 8);
+    EXPECT_NE(b, d);
+    EXPECT_EQ(0, std::memcmp(d, "abcdefgh", 8));
+
+    // Large allocations get their own slab.
+    auto big = arena.allocate(1 << 20, 16);
+    EXPECT_TRUE(isAligned(big, 16));
+    EXPECT_EQ(2u, arena.getNumSlabs());
+    // ... without abandoning the current one.
+    auto e = arena.allocate(8, 8);
+    EXPECT_EQ(static_cast<char*>(d) + 32, static_cast<char*>(e));
+
+    for (int i = 0; i < 10000; ++i)
+        std::memset(arena.allocate(100, 4), 0xAB, 100);
+    EXPECT_LT(arena.getNumSlabs(), 40u);
+
+    arena.reset();
+    EXPECT_EQ(0u, arena.getNumSlabs());
+    EXPECT_EQ(0u, arena.getBytesAllocated());
+}
+}
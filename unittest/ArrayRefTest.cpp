@@ -1,4 +1,5 @@
 #include "DataStructure/ArrayRef.h"
+#include "DataStructure/StringView.h"
 
 #include "gtest/gtest.h"
 
@@ -147,4 +148,40 @@ TEST(ArrayRefTest, makeArrayRef) {
     EXPECT_NE(&AR2Ref, &AR2);
     EXPECT_TRUE(AR2.equals(AR2Ref));
 }
+
+TEST(ArrayRefTest, Alignment) {
+    alignas(64) float Buf[32] = {};
+    ArrayRef<float> AR(Buf);
+    EXPECT_TRUE(AR.isAligned(64));
+    EXPECT_EQ(Buf, AR.alignedData<64>());
+    EXPECT_FALSE(AR.slice(1).isAligned(8));
+    EXPECT_TRUE(AR.slice(16).isAligned(64));
+
+    MutableArrayRef<float> MAR(Buf);
+    MAR.alignedData<32>()[3] = 1.0f;
+    EXPECT_EQ(1.0f, Buf[3]);
+}
+
+TEST(ArrayRefTest, Hash) {
+    std::hash<ArrayRef<uint32_t>> hasher;
+    std::vector<uint32_t> V1(64), V2(64);
+    for (uint32_t I = 0; I < 64; ++I)
+        V1[I] = V2[I] = I * 2654435761u;
+    EXPECT_EQ(hasher(V1), hasher(V2));
+    EXPECT_NE(hasher(V1), hasher(ArrayRef<uint32_t>(V1).drop_back()));
+    V2[63] ^= 1u << 31;
+    EXPECT_NE(hasher(V1), hasher(V2));
+    EXPECT_EQ(hasher(ArrayRef<uint32_t>()),
+              hasher(ArrayRef<uint32_t>(V1).slice(3, 0)));
+
+    // Arrays of characters hash like the string they spell.
+    const char Str[] = "hello, world";
+    EXPECT_EQ(std::hash<StringView>()(Str),
+              std::hash<ArrayRef<char>>()(ArrayRef<char>(Str, 12)));
+
+    // Element types whose equality is not bytewise hash element by element.
+    std::vector<double> D1 = {0.0, 1.5}, D2 = {-0.0, 1.5};
+    EXPECT_EQ(std::hash<ArrayRef<double>>()(D1),
+              std::hash<ArrayRef<double>>()(D2));
+}
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "DataStructure/AtomicBitSet.h"
+#include "DataStructure/Parallel.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+template <typename BitSet>
+void testBasic() {
+    BitSet s(200);
+    EXPECT_EQ(200u, s.size());
+    EXPECT_TRUE(s.none());
+    EXPECT_TRUE(s.test_and_set(3));
+    EXPECT_FALSE(s.test_and_set(3));
+    s.set(199);
+    s.set(64, std::memory_order_relaxed);
+    EXPECT_TRUE(s.test(3));
+    EXPECT_TRUE(s.test(64, std::memory_order_relaxed));
+    EXPECT_FALSE(s.test(65));
+    EXPECT_EQ(3u, s.count());
+    s.reset(64);
+    EXPECT_FALSE(s.test(64));
+    EXPECT_TRUE(s.any());
+
+    std::vector<size_t> bits;
+    s.for_each_set_bit([&](size_t pos) { bits.push_back(pos); });
+    EXPECT_EQ(std::vector<size_t>({3, 199}), bits);
+
+    s.reset();
+    EXPECT_TRUE(s.none());
+
+    BitSet moved = std::move(s);
+    EXPECT_EQ(200u, moved.size());
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(AtomicBitSetTest, BasicTest) {
+    testBasic<AtomicBitSet<>>();
+    testBasic<AtomicBitSet<unsigned char>>();
+    testBasic<AtomicBitSet<unsigned long, true>>();
+    static_assert(sizeof(AtomicBitSet<>) == 3 * sizeof(size_t), "");
+
+    AtomicBitSet<> empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(0u, empty.count());
+}
+
+template <typename Block, bool Padded>
+void testConversions() {
+    std::mt19937 rng(7);
+    DynamicBitSet<Block> dense(1001);
+    for (int i = 0; i < 300; ++i)
+        dense.set(rng() % dense.size());
+
+    AtomicBitSet<Block, Padded> atomic(dense);
+    EXPECT_EQ(dense.size(), atomic.size());
+    EXPECT_EQ(dense.count(), atomic.count());
+    EXPECT_EQ(dense, atomic.to_dynamic_bitset());
+
+    // Merging reports whether it set anything new.
+    DynamicBitSet<Block> other(1001);
+    other.set(0);
+    other.set(1000);
+    bool changed = !dense.test(0) || !dense.test(1000);
+    EXPECT_EQ(changed, atomic.merge_from(other));
+    EXPECT_FALSE(atomic.merge_from(other));
+    EXPECT_FALSE(atomic.merge_from(dense));
+    dense |= other;
+    EXPECT_EQ(dense, atomic.to_dynamic_bitset());
+}
+
+TEST(AtomicBitSetTest, Conversions) {
+    testConversions<unsigned long, false>();
+    testConversions<unsigned char, false>();
+    testConversions<unsigned short, true>();
+}
+
+template <typename BitSet>
+void testConcurrent(ThreadPool& pool) {
+    // Every thread tries to set every bit; each bit is won exactly once.
+    const size_t numBits = 10000, numTasks = 8;
+    BitSet s(numBits);
+    std::atomic<size_t> wins(0);
+    pool.run(numTasks, [&](size_t task) {
+        size_t won = 0;
+        for (size_t i = 0; i < numBits; ++i)
+            won += s.test_and_set((i * 7 + task * 131) % numBits,
+                                  std::memory_order_relaxed);
+        wins += won;
+    });
+    EXPECT_EQ(numBits, wins.load());
+    EXPECT_EQ(numBits, s.count());
+
+    // Threads merge their local results.
+    s.reset();
+    pool.run(numTasks, [&](size_t task) {
+        DynamicBitSet<typename BitSet::block_type> local(numBits);
+        for (size_t i = task; i < numBits; i += numTasks)
+            local.set(i);
+        EXPECT_TRUE(s.merge_from(local));
+    });
+    EXPECT_EQ(numBits, s.count());
+}
+
+TEST(AtomicBitSetTest, Concurrent) {
+    ThreadPool pool(4);
+    testConcurrent<AtomicBitSet<>>(pool);
+    testConcurrent<AtomicBitSet<unsigned char>>(pool);
+    testConcurrent<AtomicBitSet<unsigned long, true>>(pool);
+}
+}
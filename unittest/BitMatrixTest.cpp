@@ -0,0 +1,170 @@
+#include "DataStructure/BitMatrix.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+TEST(BitMatrixTest, BasicTest) {
+    BitMatrix m(3, 100);
+    EXPECT_EQ(3u, m.rows());
+    EXPECT_EQ(100u, m.cols());
+    EXPECT_EQ(0u, m.count());
+    m.set(0, 5).set(0, 99).set(2, 64);
+    EXPECT_TRUE(m.test(0, 5));
+    EXPECT_FALSE(m.test(1, 5));
+    EXPECT_EQ(3u, m.count());
+
+    auto row = m[0];
+    EXPECT_EQ(100u, row.size());
+    EXPECT_EQ(2u, row.count());
+    EXPECT_EQ(5u, row.find_first());
+    EXPECT_EQ(99u, row.find_next(5));
+    EXPECT_EQ(BitMatrix::row_reference::npos, row.find_next(99));
+    EXPECT_TRUE(m[1].none());
+    EXPECT_FALSE(row.intersects(m[2]));
+
+    // Rows are views: changing one changes the matrix.
+    m[1] |= m[0];
+    m[1] |= m[2];
+    EXPECT_EQ(6u, m.count());
+    EXPECT_TRUE(m[0].is_subset_of(m[1]));
+    EXPECT_FALSE(m[1].or_with_changed(m[2]));
+    m[1] -= m[2];
+    EXPECT_TRUE(m[1] == m[0]);
+    EXPECT_TRUE(m[1].or_with_changed(m[2]));
+    m[2].set();
+    EXPECT_TRUE(m[2].all());
+    EXPECT_EQ(100u, m[2].count());
+    m[2].reset().flip(7);
+    std::vector<size_t> bits;
+    m[2].for_each_set_bit([&](size_t pos) { bits.push_back(pos); });
+    EXPECT_EQ(std::vector<size_t>({7}), bits);
+
+    // Conversions from and to DynamicBitSet.
+    DynamicBitSet<> s(100);
+    s.set(1).set(70);
+    m[2].assign(s);
+    EXPECT_EQ(s, m[2].to_dynamic_bitset());
+    EXPECT_EQ(m[0].to_dynamic_bitset(), m.row(0).to_dynamic_bitset());
+
+    const BitMatrix& cm = m;
+    BitMatrix::const_row_reference crow = cm[2];
+    EXPECT_TRUE(crow.test(70));
+    EXPECT_TRUE(crow == m[2]);
+
+    BitMatrix copy = m;
+    EXPECT_EQ(m, copy);
+    copy.reset(0, 5);
+    EXPECT_NE(m, copy);
+    BitMatrix moved = std::move(copy);
+    EXPECT_TRUE(copy.empty());
+    EXPECT_EQ(m.count() - 1, moved.count());
+    moved.reset();
+    EXPECT_EQ(0u, moved.count());
+}
+
+BitMatrix makeRandom(std::mt19937& rng, size_t rows, size_t cols,
+                     unsigned permille) {
+    BitMatrix m(rows, cols);
+    for (size_t i = 0; i < rows; ++i)
+        for (size_t j = 0; j < cols; ++j)
+            if (rng() % 1000 < permille)
+                m.set(i, j);
+    return m;
+}
+
+BitMatrix naiveMultiply(const BitMatrix& a, const BitMatrix& b) {
+    BitMatrix ret(a.rows(), b.cols());
+    for (size_t i = 0; i < a.rows(); ++i)
+        for (size_t k = 0; k < a.cols(); ++k)
+            if (a.test(i, k))
+                for (size_t j = 0; j < b.cols(); ++j)
+                    if (b.test(k, j))
+                        ret.set(i, j);
+    return ret;
+}
+
+TEST(BitMatrixTest, Multiply) {
+    std::mt19937 rng(1);
+    ThreadPool pool(4);
+    ParallelOptions parallel;
+    parallel.pool = &pool;
+    parallel.serialCutoff = 0;
+    // The last shapes take several row blocks and column tiles.
+    for (auto shape : {std::vector<size_t>{1, 1, 1}, {3, 70, 5},
+                       {64, 64, 64}, {65, 130, 200}, {150, 40, 5000}}) {
+        auto a = makeRandom(rng, shape[0], shape[1], 50);
+        auto b = makeRandom(rng, shape[1], shape[2], 50);
+        auto expected = naiveMultiply(a, b);
+        EXPECT_EQ(expected, multiply(a, b)) << shape[0];
+        EXPECT_EQ(expected, multiply(a, b, parallel)) << shape[0];
+    }
+}
+
+// Reachability by a DFS from every node.
+BitMatrix naiveClosure(const BitMatrix& m) {
+    size_t n = m.rows();
+    BitMatrix ret(n, n);
+    for (size_t s = 0; s < n; ++s) {
+        std::vector<size_t> stack;
+        m[s].for_each_set_bit([&](size_t w) { stack.push_back(w); });
+        while (!stack.empty()) {
+            auto v = stack.back();
+            stack.pop_back();
+            if (ret.test(s, v))
+                continue;
+            ret.set(s, v);
+            m[v].for_each_set_bit([&](size_t w) { stack.push_back(w); });
+        }
+    }
+    return ret;
+}
+
+TEST(BitMatrixTest, TransitiveClosure) {
+    std::mt19937 rng(2);
+    ThreadPool pool(4);
+    ParallelOptions parallel;
+    parallel.pool = &pool;
+    parallel.serialCutoff = 0;
+
+    BitMatrix empty;
+    empty.transitive_closure();
+    EXPECT_TRUE(empty.empty());
+
+    // A chain, a cycle, and a node with a self-loop.
+    BitMatrix g(6, 6);
+    g.set(0, 1).set(1, 2).set(3, 4).set(4, 3).set(5, 5);
+    g.transitive_closure();
+    EXPECT_TRUE(g.test(0, 2));
+    EXPECT_FALSE(g.test(0, 0));
+    EXPECT_FALSE(g.test(2, 2));
+    EXPECT_TRUE(g.test(3, 3));
+    EXPECT_TRUE(g.test(4, 4));
+    EXPECT_TRUE(g.test(5, 5));
+    EXPECT_EQ(8u, g.count());
+
+    for (size_t n : {1, 63, 64, 65, 300, 700}) {
+        // Sparse graphs with a few cycles, dense ones, and DAGs.
+        for (unsigned permille : {2, 10, 100}) {
+            auto m = makeRandom(rng, n, n, permille);
+            auto dag = m;
+            for (size_t i = 0; i < n; ++i)
+                for (size_t j = 0; j <= i; ++j)
+                    dag.reset(i, j);
+            for (auto* graph : {&m, &dag}) {
+                auto expected = naiveClosure(*graph);
+                auto serial = *graph, par = *graph;
+                serial.transitive_closure();
+                par.transitive_closure(parallel);
+                EXPECT_EQ(expected, serial) << n << " " << permille;
+                EXPECT_EQ(expected, par) << n << " " << permille;
+            }
+        }
+    }
+}
+}
@@ -373,4 +373,14 @@ TEST(DenseMapCustomTest, TryEmplaceTest) {
     EXPECT_EQ(try1.first, try2.first);
     EXPECT_NE(nullptr, p);
 }
+
+TEST(DenseMapCustomTest, RelocateTest) {
+    // unique_ptr values are relocated with memcpy when the table grows.
+    DenseMap<int, std::unique_ptr<int>> Map;
+    for (int i = 0; i < 1000; ++i)
+        Map.try_emplace(i, new int(i * 2));
+    EXPECT_EQ(1000u, Map.size());
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(i * 2, *Map[i]);
+}
 }
@@ -2,6 +2,10 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 using namespace ds;
 
 namespace {
@@ -48,4 +52,225 @@ TEST(DynamicBitSetTest, BasicTest) {
     s1 &= s3;
     EXPECT_EQ(s1, DynamicBitSet<>(8, 0b00011000));
 }
+
+template <typename BitSet>
+BitSet makeRandom(std::mt19937& rng, size_t size, unsigned density) {
+    BitSet ret(size);
+    for (size_t i = 0; i < size; ++i)
+        if (rng() % 100 < density)
+            ret.set(i);
+    return ret;
+}
+
+template <typename Block>
+void testBulkOps() {
+    using BitSet = DynamicBitSet<Block>;
+    std::mt19937 rng(42);
+    for (size_t size : {0, 1, 7, 63, 64, 65, 200, 511, 512, 513, 1000, 2049,
+                        4097, 12345}) {
+        auto a = makeRandom<BitSet>(rng, size, 50);
+        auto b = makeRandom<BitSet>(rng, size, 50);
+
+        size_t expectedCount = 0;
+        std::vector<bool> expectedAnd(size), expectedOr(size),
+            expectedXor(size), expectedDiff(size);
+        for (size_t i = 0; i < size; ++i) {
+            expectedCount += a.test(i);
+            expectedAnd[i] = a.test(i) && b.test(i);
+            expectedOr[i] = a.test(i) || b.test(i);
+            expectedXor[i] = a.test(i) != b.test(i);
+            expectedDiff[i] = a.test(i) && !b.test(i);
+        }
+        EXPECT_EQ(expectedCount, a.count()) << size;
+
+        auto c = a;
+        c &= b;
+        for (size_t i = 0; i < size; ++i)
+            ASSERT_EQ(expectedAnd[i], c.test(i)) << size;
+        EXPECT_TRUE(c.is_subset_of(a));
+        EXPECT_TRUE(c.is_subset_of(b));
+        c = a;
+        c |= b;
+        for (size_t i = 0; i < size; ++i)
+            ASSERT_EQ(expectedOr[i], c.test(i)) << size;
+        EXPECT_TRUE(a.is_subset_of(c));
+        c = a;
+        c ^= b;
+        for (size_t i = 0; i < size; ++i)
+            ASSERT_EQ(expectedXor[i], c.test(i)) << size;
+        c = a;
+        c -= b;
+        for (size_t i = 0; i < size; ++i)
+            ASSERT_EQ(expectedDiff[i], c.test(i)) << size;
+        EXPECT_FALSE(c.intersects(b));
+        EXPECT_EQ(c.any(), c.intersects(a));
+
+        // Sets that differ in a single bit, wherever it is.
+        BitSet empty(size), full(size);
+        full.set();
+        EXPECT_FALSE(empty.any());
+        EXPECT_TRUE(full.all());
+        EXPECT_EQ(size, full.count());
+        for (size_t pos : {size_t(0), size / 3, size - 1}) {
+            if (pos >= size)
+                continue;
+            BitSet one(size);
+            one.set(pos);
+            EXPECT_TRUE(one.any()) << size << " " << pos;
+            EXPECT_EQ(1u, one.count());
+            EXPECT_TRUE(one.intersects(full));
+            EXPECT_FALSE(one.intersects(empty));
+            EXPECT_FALSE(one.is_subset_of(empty));
+            EXPECT_TRUE(one.is_proper_subset_of(full) || size == 1);
+            auto almost = full;
+            almost.reset(pos);
+            EXPECT_FALSE(almost.all()) << size << " " << pos;
+            EXPECT_FALSE(one.is_subset_of(almost));
+            EXPECT_TRUE(empty.is_subset_of(almost));
+        }
+    }
+}
+
+TEST(DynamicBitSetTest, BulkOps) {
+    testBulkOps<unsigned char>();
+    testBulkOps<unsigned short>();
+    testBulkOps<unsigned>();
+    testBulkOps<unsigned long>();
+}
+
+template <typename Block>
+void testSetBitScan() {
+    using BitSet = DynamicBitSet<Block>;
+    auto npos = BitSet::npos;
+    std::mt19937 rng(7);
+    for (size_t size : {0, 1, 8, 63, 64, 65, 300, 1000, 4096}) {
+        for (unsigned density : {0u, 1u, 30u, 100u}) {
+            auto s = makeRandom<BitSet>(rng, size, density);
+            std::vector<size_t> expected;
+            for (size_t i = 0; i < size; ++i)
+                if (s.test(i))
+                    expected.push_back(i);
+
+            std::vector<size_t> found;
+            for (auto pos = s.find_first(); pos != npos;
+                 pos = s.find_next(pos))
+                found.push_back(pos);
+            EXPECT_EQ(expected, found) << size << " " << density;
+
+            found.clear();
+            for (auto pos : s.set_bits())
+                found.push_back(pos);
+            EXPECT_EQ(expected, found) << size << " " << density;
+
+            found.clear();
+            s.for_each_set_bit([&](size_t pos) { found.push_back(pos); });
+            EXPECT_EQ(expected, found) << size << " " << density;
+
+            found.clear();
+            for (auto pos = s.find_last(); pos != npos; pos = s.find_prev(pos))
+                found.push_back(pos);
+            std::reverse(found.begin(), found.end());
+            EXPECT_EQ(expected, found) << size << " " << density;
+
+            // find_prev() from every position, including past the end.
+            for (size_t pos = 0; pos <= size + 1; ++pos) {
+                auto it = std::lower_bound(expected.begin(), expected.end(),
+                                           pos);
+                auto prev = it == expected.begin() ? npos : *(it - 1);
+                ASSERT_EQ(prev, s.find_prev(pos)) << size << " " << pos;
+            }
+        }
+    }
+}
+
+template <typename Block>
+void testChangedOps() {
+    using BitSet = DynamicBitSet<Block>;
+    std::mt19937 rng(3);
+    for (size_t size : {1, 63, 64, 65, 511, 512, 513, 1000, 4097, 12345}) {
+        auto gen = makeRandom<BitSet>(rng, size, 5);
+        auto in = makeRandom<BitSet>(rng, size, 50);
+        auto kill = makeRandom<BitSet>(rng, size, 10);
+
+        auto expected = in;
+        expected -= kill;
+        expected |= gen;
+        BitSet out(size);
+        EXPECT_EQ(expected.any(), out.assign_or_andnot(gen, in, kill)) << size;
+        EXPECT_EQ(expected, out);
+        EXPECT_FALSE(out.assign_or_andnot(gen, in, kill)) << size;
+        // in may be the output itself.
+        auto iterated = out;
+        iterated -= kill;
+        iterated |= gen;
+        EXPECT_EQ(iterated != out, out.assign_or_andnot(gen, out, kill));
+        EXPECT_EQ(iterated, out);
+
+        // A single new bit anywhere is a change.
+        for (size_t pos : {size_t(0), size / 2, size - 1}) {
+            auto c = out;
+            c.reset(pos);
+            BitSet one(size);
+            one.set(pos);
+            EXPECT_TRUE(c.or_with_changed(one)) << size << " " << pos;
+            EXPECT_FALSE(c.or_with_changed(one)) << size << " " << pos;
+            auto expectedOr = out;
+            expectedOr.set(pos);
+            EXPECT_EQ(expectedOr, c);
+            EXPECT_TRUE(c.subtract_with_changed(one));
+            EXPECT_FALSE(c.subtract_with_changed(one));
+            EXPECT_FALSE(c.test(pos));
+            one.flip();
+            EXPECT_FALSE(c.and_with_changed(one));
+            c.set(pos);
+            EXPECT_TRUE(c.and_with_changed(one));
+        }
+    }
+}
+
+TEST(DynamicBitSetTest, ChangedOps) {
+    testChangedOps<unsigned char>();
+    testChangedOps<unsigned short>();
+    testChangedOps<unsigned>();
+    testChangedOps<unsigned long>();
+}
+
+TEST(DynamicBitSetTest, SetBitScan) {
+    testSetBitScan<unsigned char>();
+    testSetBitScan<unsigned>();
+    testSetBitScan<unsigned long>();
+
+    DynamicBitSet<> s(200);
+    s.set(5).set(64).set(199);
+    auto range = s.set_bits();
+    auto it = range.begin();
+    EXPECT_EQ(5u, *it++);
+    EXPECT_EQ(64u, *it);
+    EXPECT_EQ(199u, *++it);
+    EXPECT_TRUE(++it == range.end());
+    EXPECT_EQ(std::vector<size_t>({5, 64, 199}),
+              std::vector<size_t>(range.begin(), range.end()));
+}
+
+TEST(DynamicBitSetTest, BlockRange) {
+    DynamicBitSet<unsigned char> s(20);
+    s.set(0);
+    s.set(9);
+    s.set(19);
+    std::vector<unsigned char> blocks;
+    to_block_range(s, std::back_inserter(blocks));
+    EXPECT_EQ(std::vector<unsigned char>({0x01, 0x02, 0x08}), blocks);
+
+    // Only the given blocks are overwritten, and bits past the end are
+    // dropped.
+    std::vector<unsigned char> in = {0x80, 0xFF};
+    from_block_range(in.begin(), in.end(), s);
+    EXPECT_EQ(10u, s.count());
+    EXPECT_TRUE(s.test(7));
+    EXPECT_TRUE(s.test(19));
+    in = {0x00, 0x00, 0xFF};
+    from_block_range(in.begin(), in.end(), s);
+    EXPECT_EQ(4u, s.count());
+    EXPECT_EQ(16u, s.find_first());
+}
 }
@@ -0,0 +1,121 @@
+#include "DataStructure/MappedFile.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace ds;
+
+namespace {
+
+// Writes 'contents' to a fresh temporary file that is removed on destruction.
+class TempFile {
+private:
+    std::string path;
+
+public:
+    explicit TempFile(const std::string& contents) {
+        char name[] = "/tmp/MappedFileTestXXXXXX";
+        int fd = ::mkstemp(name);
+        EXPECT_LE(0, fd);
+        path = name;
+        auto written = ::write(fd, contents.data(), contents.size());
+        EXPECT_EQ(static_cast<ssize_t>(contents.size()), written);
+        ::close(fd);
+    }
+    ~TempFile() { std::remove(path.c_str()); }
+
+    const std::string& getPath() const { return path; }
+};
+
+std::vector<std::string> records(StringView text, char delimiter = '\n') {
+    std::vector<std::string> ret;
+    for (auto record : RecordRange(text, delimiter))
+        ret.push_back(record);
+    return ret;
+}
+
+using Strs = std::vector<std::string>;
+
+// Containers only move their elements during reallocation if that cannot
+// throw.
+static_assert(std::is_nothrow_move_constructible<MappedFile>::value &&
+                  std::is_nothrow_move_assignable<MappedFile>::value,
+              "MappedFile moves should be noexcept");
+
+TEST(MappedFileTest, Basic) {
+    TempFile file("first\nsecond\r\n\nlast");
+    MappedFile mapped(file.getPath());
+    EXPECT_EQ(19U, mapped.size());
+    EXPECT_EQ("first\nsecond\r\n\nlast", mapped.getBuffer());
+    EXPECT_EQ(Strs({"first", "second", "", "last"}),
+              records(mapped.getBuffer()));
+
+    MappedFile moved(std::move(mapped));
+    EXPECT_TRUE(mapped.empty());
+    EXPECT_EQ(19U, moved.getBuffer().size());
+
+    TempFile emptyFile("");
+    MappedFile emptyMapped(emptyFile.getPath());
+    EXPECT_TRUE(emptyMapped.empty());
+    EXPECT_EQ(Strs(), records(emptyMapped.getBuffer()));
+
+    EXPECT_THROW(MappedFile("/nonexistent/MappedFileTest"),
+                 std::system_error);
+}
+
+TEST(MappedFileTest, Records) {
+    EXPECT_EQ(Strs({"a", "b"}), records("a\nb\n"));
+    EXPECT_EQ(Strs({"a", "b"}), records("a\nb"));
+    EXPECT_EQ(Strs({"", ""}), records("\n\n"));
+    EXPECT_EQ(Strs({"x\r", "y"}), records("x\r;y;", ';'));
+}
+
+TEST(MappedFileTest, Chunks) {
+    std::string text;
+    for (int i = 0; i < 1000; ++i)
+        text += "record " + std::to_string(i) + "\n";
+
+    for (size_t n : {1, 2, 3, 7, 64, 100000}) {
+        auto chunks = splitIntoChunks(text, n);
+        EXPECT_LE(chunks.size(), n);
+        std::string joined;
+        for (auto chunk : chunks) {
+            EXPECT_FALSE(chunk.empty());
+            EXPECT_EQ('\n', chunk.back());
+            joined += chunk;
+        }
+        EXPECT_EQ(text, joined);
+    }
+    EXPECT_TRUE(splitIntoChunks("", 4).empty());
+    EXPECT_EQ(1U, splitIntoChunks("no delimiter at all", 4).size());
+
+    TempFile file(text);
+    MappedFile mapped(file.getPath());
+    std::atomic<size_t> numRecords(0), numBytes(0);
+    forEachChunk(mapped.getBuffer(), 4, [&](size_t, StringView chunk) {
+        numBytes += chunk.size();
+        for (auto record : RecordRange(chunk)) {
+            EXPECT_TRUE(record.startswith("record "));
+            ++numRecords;
+        }
+    });
+    EXPECT_EQ(1000U, numRecords.load());
+    EXPECT_EQ(text.size(), numBytes.load());
+
+    EXPECT_THROW(forEachChunk(mapped.getBuffer(), 4,
+                              [](size_t idx, StringView) {
+                                  if (idx == 2)
+                                      throw std::runtime_error("failed");
+                              }),
+                 std::runtime_error);
+}
+}
@@ -0,0 +1,143 @@
+#include "DataStructure/MatrixRef.h"
+
+#include "gtest/gtest.h"
+
+#include <numeric>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+TEST(MatrixRefTest, StridedArrayRef) {
+    int arr[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    StridedArrayRef<int> evens(arr, 5, 2);
+    EXPECT_EQ(5u, evens.size());
+    EXPECT_EQ(0, evens.front());
+    EXPECT_EQ(8, evens.back());
+    EXPECT_EQ(std::vector<int>({0, 2, 4, 6, 8}), evens.vec());
+    EXPECT_EQ(std::vector<int>({4, 6}), evens.slice(2, 2).vec());
+    EXPECT_EQ(std::vector<int>({0, 6}), evens.every(3).vec());
+    EXPECT_EQ(std::vector<int>({8, 6, 4, 2, 0}),
+              std::vector<int>(evens.rbegin(), evens.rend()));
+    EXPECT_EQ(5, evens.end() - evens.begin());
+    EXPECT_EQ(6, evens.begin()[3]);
+    EXPECT_FALSE(evens.isContiguous());
+
+    std::vector<int> vec(arr, arr + 10);
+    StridedArrayRef<int> all(vec);
+    EXPECT_TRUE(all.isContiguous());
+    EXPECT_EQ(ArrayRef<int>(vec), all.asArrayRef());
+    EXPECT_EQ(all.every(2), evens);
+    EXPECT_NE(all.every(2).drop_back(), evens);
+
+    SmallVector<int, 4> small(arr, arr + 10);
+    MutableStridedArrayRef<int> odds = MutableStridedArrayRef<int>(small)
+                                           .drop_front()
+                                           .every(2);
+    for (auto& elem : odds)
+        elem = -elem;
+    EXPECT_EQ(-9, small[9]);
+    EXPECT_EQ(2, small[2]);
+    std::sort(odds.begin(), odds.end());
+    EXPECT_EQ(-9, small[1]);
+    EXPECT_EQ(-1, small[9]);
+}
+
+TEST(MatrixRefTest, RowsColsBlocks) {
+    // A 3 x 4 matrix stored with a leading dimension of 5.
+    std::vector<int> storage(15);
+    std::iota(storage.begin(), storage.end(), 0);
+    MatrixRef<int> m(storage, 3, 4, 5);
+    EXPECT_EQ(3u, m.rows());
+    EXPECT_EQ(4u, m.cols());
+    EXPECT_EQ(12u, m.size());
+    EXPECT_TRUE(m.isRowMajor());
+    EXPECT_EQ(7, m(1, 2));
+
+    EXPECT_EQ(std::vector<int>({5, 6, 7, 8}), m.row(1).vec());
+    EXPECT_TRUE(m.row(1).isContiguous());
+    EXPECT_EQ(std::vector<int>({3, 8, 13}), m.col(3).vec());
+
+    auto b = m.block(1, 1, 2, 2);
+    EXPECT_EQ(6, b(0, 0));
+    EXPECT_EQ(12, b(1, 1));
+    EXPECT_EQ(std::vector<int>({7, 12}), b.col(1).vec());
+
+    auto t = m.transpose();
+    EXPECT_EQ(4u, t.rows());
+    EXPECT_EQ(3u, t.cols());
+    EXPECT_FALSE(t.isRowMajor());
+    for (size_t i = 0; i < m.rows(); ++i)
+        for (size_t j = 0; j < m.cols(); ++j)
+            EXPECT_EQ(m(i, j), t(j, i));
+    EXPECT_EQ(m.col(2), t.row(2));
+    EXPECT_EQ(7, t.block(1, 1, 3, 2)(1, 0));
+}
+
+TEST(MatrixRefTest, Mutable) {
+    SmallVector<double, 16> storage(12, 0.0);
+    MutableMatrixRef<double> m(storage, 3, 4);
+    m.col(1).front() = 1.0;
+    m.transpose()(3, 2) = 2.0;
+    m.block(1, 0, 2, 2).row(1)[0] = 3.0;
+    EXPECT_EQ(1.0, storage[1]);
+    EXPECT_EQ(2.0, storage[11]);
+    EXPECT_EQ(3.0, storage[8]);
+
+    m.block(0, 2, 3, 2).fill(5.0);
+    EXPECT_EQ(std::vector<double>({0.0, 1.0, 5.0, 5.0}), m.row(0).vec());
+    EXPECT_EQ(std::vector<double>({5.0, 5.0, 5.0}), m.col(3).vec());
+}
+
+TEST(MatrixRefTest, Tiles) {
+    std::vector<int> storage(7 * 10);
+    MutableMatrixRef<int> m(storage, 7, 10);
+
+    // Every element is covered by exactly one tile, and tiles are visited row
+    // by row.
+    std::vector<std::pair<size_t, size_t>> sizes;
+    auto tiles = m.tiles(3, 4);
+    for (auto it = tiles.begin(), e = tiles.end(); it != e; ++it) {
+        auto tile = *it;
+        sizes.emplace_back(tile.rows(), tile.cols());
+        for (size_t i = 0; i < tile.rows(); ++i)
+            for (auto& elem : tile.row(i))
+                elem += 1 + int(it.row() * 10 + it.col());
+    }
+    std::vector<std::pair<size_t, size_t>> expected = {
+        {3, 4}, {3, 4}, {3, 2}, {3, 4}, {3, 4}, {3, 2}, {1, 4}, {1, 4}, {1, 2}};
+    EXPECT_EQ(expected, sizes);
+    EXPECT_EQ(1, m(0, 0));
+    EXPECT_EQ(9, m(2, 9));
+    EXPECT_EQ(35, m(3, 5));
+    EXPECT_EQ(69, m(6, 9));
+
+    size_t numTiles = 0;
+    for (auto tile : MatrixRef<int>(storage, 7, 10).transpose().tiles(8, 8)) {
+        EXPECT_LE(tile.rows(), 8u);
+        ++numTiles;
+    }
+    EXPECT_EQ(2u, numTiles);
+
+    MatrixRef<int> empty(storage, 0, 10);
+    EXPECT_TRUE(empty.tiles(2, 2).begin() == empty.tiles(2, 2).end());
+}
+
+TEST(MatrixRefTest, CopyInto) {
+    std::vector<float> src(37 * 300), dst(300 * 37), copy(37 * 300);
+    std::iota(src.begin(), src.end(), 0.0f);
+    MatrixRef<float> in(src, 37, 300);
+
+    copy_into(in.transpose(), MutableMatrixRef<float>(dst, 300, 37));
+    for (size_t i = 0; i < 37; ++i)
+        for (size_t j = 0; j < 300; ++j)
+            ASSERT_EQ(src[i * 300 + j], dst[j * 37 + i]);
+
+    copy_into(in, MutableMatrixRef<float>(copy, 37, 300));
+    EXPECT_EQ(src, copy);
+
+    static_assert(defaultTileSize<float>() == 64, "");
+    static_assert(defaultTileSize<double>() == 32, "");
+}
+}
@@ -0,0 +1,99 @@
+#include "DataStructure/MultiMatcher.h"
+#include "DataStructure/StringMap.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+
+using namespace ds;
+
+namespace {
+
+using MatchTuple = std::tuple<unsigned, size_t, size_t>;
+
+std::vector<MatchTuple> sorted(const std::vector<MultiMatcher::Match>& ms) {
+    std::vector<MatchTuple> ret;
+    for (auto& m : ms)
+        ret.emplace_back(m.pattern, m.begin, m.end);
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+std::vector<MatchTuple> naiveFindAll(const std::vector<StringView>& patterns,
+                                     StringView text) {
+    std::vector<MatchTuple> ret;
+    for (unsigned i = 0; i != patterns.size(); ++i) {
+        auto n = patterns[i].size();
+        if (n == 0)
+            continue;
+        for (size_t j = 0; j + n <= text.size(); ++j)
+            if (text.substr(j, n) == patterns[i])
+                ret.emplace_back(i, j, j + n);
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+TEST(MultiMatcherTest, Basic) {
+    std::vector<StringView> patterns = {"he", "she", "his", "hers", ""};
+    StringView text("ushers said his hers");
+    for (auto mode : {MultiMatcher::Mode::Compact, MultiMatcher::Mode::DFA}) {
+        MultiMatcher matcher(patterns, mode);
+        EXPECT_EQ(mode == MultiMatcher::Mode::DFA, matcher.isDFA());
+        EXPECT_EQ(5U, matcher.getNumPatterns());
+        EXPECT_EQ("hers", matcher.getPattern(3));
+
+        auto matches = matcher.findAll(text);
+        EXPECT_EQ(naiveFindAll(patterns, text), sorted(matches));
+        // "she" and "he" end at the same position; the longer one comes first.
+        ASSERT_GE(matches.size(), 2U);
+        EXPECT_EQ(1U, matches[0].pattern);
+        EXPECT_EQ(0U, matches[1].pattern);
+
+        EXPECT_TRUE(matcher.containsAny(text));
+        EXPECT_FALSE(matcher.containsAny("abc def"));
+        EXPECT_FALSE(matcher.containsAny(""));
+    }
+}
+
+TEST(MultiMatcherTest, StringMapPatterns) {
+    StringMap<int> blocked;
+    blocked["foo"] = 1;
+    blocked["bar"] = 2;
+    blocked["oob"] = 3;
+    MultiMatcher matcher(blocked);
+
+    int total = 0;
+    matcher.scan("foobar", [&](const MultiMatcher::Match& m) {
+        total += blocked.lookup(matcher.getPattern(m.pattern));
+    });
+    EXPECT_EQ(6, total);
+}
+
+TEST(MultiMatcherTest, Random) {
+    std::mt19937 rng(7);
+    for (unsigned iter = 0; iter != 50; ++iter) {
+        auto alphabet = 2 + rng() % 4;
+        std::vector<std::string> storage(1 + rng() % 20);
+        for (auto& p : storage) {
+            p.resize(1 + rng() % 6);
+            for (auto& c : p)
+                c = 'a' + rng() % alphabet;
+        }
+        std::vector<StringView> patterns(storage.begin(), storage.end());
+        std::string text(200, ' ');
+        for (auto& c : text)
+            c = 'a' + rng() % (alphabet + 1);
+
+        auto expected = naiveFindAll(patterns, text);
+        for (auto mode : {MultiMatcher::Mode::Compact,
+                          MultiMatcher::Mode::DFA}) {
+            MultiMatcher matcher(patterns, mode);
+            EXPECT_EQ(expected, sorted(matcher.findAll(text)));
+            EXPECT_EQ(!expected.empty(), matcher.containsAny(text));
+        }
+    }
+}
+}
@@ -0,0 +1,147 @@
+#include "DataStructure/Parallel.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+// Runs on a pool of its own and forces the parallel code paths even for small
+// inputs.
+class ParallelTest : public ::testing::TestWithParam<unsigned> {
+protected:
+    ThreadPool pool;
+    ParallelOptions opts;
+
+    ParallelTest() : pool(GetParam()) {
+        opts.pool = &pool;
+        opts.serialCutoff = 16;
+    }
+};
+
+TEST_P(ParallelTest, ThreadPool) {
+    EXPECT_EQ(GetParam(), pool.getNumThreads());
+
+    std::vector<std::atomic<int>> hits(1000);
+    pool.run(hits.size(), [&](size_t i) { ++hits[i]; });
+    for (auto& hit : hits)
+        EXPECT_EQ(1, hit.load());
+
+    // Nested batches must not deadlock.
+    std::atomic<size_t> total(0);
+    pool.run(8, [&](size_t i) {
+        pool.run(100, [&](size_t j) { total += i * 100 + j; });
+    });
+    EXPECT_EQ(799u * 800 / 2, total.load());
+
+    EXPECT_THROW(pool.run(50,
+                          [](size_t i) {
+                              if (i == 17)
+                                  throw std::runtime_error("failed");
+                          }),
+                 std::runtime_error);
+    pool.run(0, [](size_t) { FAIL(); });
+}
+
+TEST_P(ParallelTest, ForAndTransform) {
+    std::vector<int> data(10000);
+    parallel_for(size_t(0), data.size(), [&](size_t i) { data[i] = int(i); },
+                 opts);
+    for (size_t i = 0; i < data.size(); ++i)
+        ASSERT_EQ(int(i), data[i]);
+
+    parallel_for(MutableArrayRef<int>(data), [](int& x) { x *= 2; }, opts);
+    std::atomic<long> sum(0);
+    parallel_for(ArrayRef<int>(data), [&](int x) { sum += x; }, opts);
+    EXPECT_EQ(9999L * 10000, sum.load());
+
+    std::vector<std::string> strs(data.size());
+    parallel_transform(ArrayRef<int>(data), MutableArrayRef<std::string>(strs),
+                       [](int x) { return std::to_string(x); }, opts);
+    EXPECT_EQ("19998", strs.back());
+
+    // Transform in place.
+    parallel_transform(ArrayRef<int>(data), MutableArrayRef<int>(data),
+                       [](int x) { return x + 1; }, opts);
+    EXPECT_EQ(1, data[0]);
+    EXPECT_EQ(19999, data.back());
+}
+
+TEST_P(ParallelTest, Reduce) {
+    std::vector<long> data(12345);
+    std::iota(data.begin(), data.end(), 1);
+    EXPECT_EQ(12345L * 12346 / 2 + 7,
+              parallel_reduce(ArrayRef<long>(data), 7L, std::plus<long>(),
+                              opts));
+    EXPECT_EQ(12345L, parallel_reduce(ArrayRef<long>(data), 0L,
+                                      [](long a, long b) {
+                                          return std::max(a, b);
+                                      },
+                                      opts));
+
+    // String concatenation is associative but not commutative.
+    std::vector<std::string> strs;
+    std::string expected;
+    for (int i = 0; i < 500; ++i) {
+        strs.push_back(std::to_string(i % 10));
+        expected += strs.back();
+    }
+    EXPECT_EQ(expected,
+              parallel_reduce(ArrayRef<std::string>(strs), std::string(),
+                              std::plus<std::string>(), opts));
+
+    EXPECT_EQ(3, parallel_reduce(ArrayRef<int>(), 3));
+    EXPECT_EQ(6, parallel_reduce(ArrayRef<int>({1, 2, 3})));
+}
+
+TEST_P(ParallelTest, Sort) {
+    std::mt19937 rng(GetParam());
+    for (size_t size : {0, 1, 15, 100, 1000, 54321}) {
+        std::vector<unsigned> data(size);
+        for (auto& x : data)
+            x = rng() % 1000;
+        auto expected = data;
+        std::sort(expected.begin(), expected.end());
+        parallel_sort(MutableArrayRef<unsigned>(data), std::less<unsigned>(),
+                      opts);
+        EXPECT_EQ(expected, data);
+
+        parallel_sort(MutableArrayRef<unsigned>(data),
+                      std::greater<unsigned>(), opts);
+        EXPECT_TRUE(std::is_sorted(data.begin(), data.end(),
+                                   std::greater<unsigned>()));
+    }
+}
+
+TEST_P(ParallelTest, PrefixSum) {
+    for (size_t size : {0, 1, 17, 1000, 33333}) {
+        std::vector<long> data(size);
+        std::iota(data.begin(), data.end(), 1);
+        std::vector<long> expected(size);
+        std::partial_sum(data.begin(), data.end(), expected.begin());
+
+        std::vector<long> out(size);
+        parallel_prefix_sum(ArrayRef<long>(data), MutableArrayRef<long>(out),
+                            std::plus<long>(), opts);
+        EXPECT_EQ(expected, out);
+
+        // In place.
+        parallel_prefix_sum(ArrayRef<long>(data), MutableArrayRef<long>(data),
+                            std::plus<long>(), opts);
+        EXPECT_EQ(expected, data);
+    }
+
+    std::vector<int> small = {3, 1, 4, 1, 5};
+    parallel_prefix_sum(MutableArrayRef<int>(small));
+    EXPECT_EQ(std::vector<int>({3, 4, 8, 9, 14}), small);
+}
+
+INSTANTIATE_TEST_CASE_P(Threads, ParallelTest, ::testing::Values(1u, 3u, 8u));
+}
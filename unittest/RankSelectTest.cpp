@@ -0,0 +1,87 @@
+#include "DataStructure/RankSelect.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+// Checks rank() at every position and select() for every set bit.
+template <typename Block>
+void checkIndex(const DynamicBitSet<Block>& bits) {
+    RankSelectIndex index(bits);
+    EXPECT_EQ(bits.size(), index.size());
+    EXPECT_EQ(bits.count(), index.count());
+
+    size_t rank = 0;
+    for (size_t i = 0; i < bits.size(); ++i) {
+        ASSERT_EQ(rank, index.rank(i)) << i;
+        EXPECT_EQ(i - rank, index.rank0(i));
+        if (bits.test(i)) {
+            ASSERT_EQ(i, index.select(rank)) << rank;
+            ++rank;
+        }
+    }
+    EXPECT_EQ(rank, index.rank(bits.size()));
+    EXPECT_EQ(RankSelectIndex::npos, index.select(rank));
+}
+
+template <typename Block>
+void testRandom() {
+    std::mt19937 rng(11);
+    for (size_t size : {0, 1, 63, 64, 65, 511, 512, 2047, 2048, 2049, 100000}) {
+        for (double density : {0.0, 0.01, 0.5, 0.99, 1.0}) {
+            DynamicBitSet<Block> bits(size);
+            std::bernoulli_distribution hit(density);
+            for (size_t i = 0; i < size; ++i)
+                if (hit(rng))
+                    bits.set(i);
+            checkIndex(bits);
+        }
+    }
+}
+
+TEST(RankSelectTest, RandomTest) {
+    testRandom<unsigned long>();
+    testRandom<unsigned char>();
+    testRandom<unsigned short>();
+    testRandom<unsigned>();
+}
+
+TEST(RankSelectTest, Clustered) {
+    // Long runs of ones and zeros put many select samples into one lower
+    // block, and no samples into others.
+    DynamicBitSet<> bits(300000);
+    for (size_t i = 1000; i < 60000; ++i)
+        bits.set(i);
+    for (size_t i = 250000; i < 250100; ++i)
+        bits.set(i);
+    bits.set(299999);
+    checkIndex(bits);
+
+    RankSelectIndex index(bits);
+    EXPECT_EQ(1000u, index.select(0));
+    EXPECT_EQ(59000u, index.rank(60000));
+    EXPECT_EQ(250000u, index.select(59000));
+    EXPECT_EQ(299999u, index.select(59100));
+}
+
+TEST(RankSelectTest, SpaceOverhead) {
+    std::mt19937 rng(5);
+    DynamicBitSet<> bits(1 << 22);
+    for (size_t i = 0; i < bits.size(); ++i)
+        if (rng() % 2)
+            bits.set(i);
+    RankSelectIndex index(bits);
+    EXPECT_LT(index.getMemorySize() * 100, bits.size() / 8 * 5);
+    for (size_t i = 0; i < 10000; ++i) {
+        auto k = rng() % index.count();
+        auto pos = index.select(k);
+        ASSERT_TRUE(bits.test(pos));
+        ASSERT_EQ(k, index.rank(pos));
+    }
+}
+}
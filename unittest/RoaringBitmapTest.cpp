@@ -0,0 +1,274 @@
+#include "DataStructure/RoaringBitmap.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+std::vector<uint32_t> toVector(const RoaringBitmap& r) {
+    return std::vector<uint32_t>(r.begin(), r.end());
+}
+
+std::string serialize(const RoaringBitmap& r) {
+    std::string ret(r.getSerializedSize(), '\0');
+    r.serialize(&ret[0]);
+    return ret;
+}
+
+TEST(RoaringBitmapTest, BasicTest) {
+    RoaringBitmap r;
+    EXPECT_TRUE(r.empty());
+    EXPECT_EQ(0u, r.count());
+    EXPECT_EQ(RoaringBitmap::npos, r.find_first());
+    EXPECT_TRUE(r.begin() == r.end());
+
+    r.set(7);
+    r.set(0xFFFFFFFF);
+    r.set(65536);
+    r.set(65535);
+    EXPECT_FALSE(r.test_set(100000));
+    EXPECT_TRUE(r.test_set(100000));
+    EXPECT_EQ(5u, r.count());
+    EXPECT_TRUE(r.test(65535));
+    EXPECT_FALSE(r.test(65537));
+    EXPECT_EQ(7u, r.find_first());
+    EXPECT_EQ(0xFFFFFFFFu, r.find_last());
+    EXPECT_EQ(std::vector<uint32_t>({7, 65535, 65536, 100000, 0xFFFFFFFF}),
+              toVector(r));
+
+    r.reset(65536);
+    r.reset(65537);
+    r.reset(0xFFFFFFFF);
+    EXPECT_EQ(std::vector<uint32_t>({7, 65535, 100000}), toVector(r));
+    EXPECT_EQ(RoaringBitmap({100000, 65535, 7}), r);
+    r.clear();
+    EXPECT_TRUE(r.empty());
+}
+
+TEST(RoaringBitmapTest, Containers) {
+    // An array grows into a bitmap past 4096 values, and shrinks back.
+    RoaringBitmap r;
+    for (uint32_t v = 0; v < 2 * 4097; v += 2)
+        r.set(v);
+    EXPECT_EQ(4097u, r.count());
+    auto bitmapSize = r.getMemorySize();
+    EXPECT_GE(bitmapSize, 8192u);
+    r.reset(0);
+    EXPECT_EQ(4096u, r.count());
+    EXPECT_LT(r.getMemorySize(), bitmapSize + 8192);
+    EXPECT_EQ(2u, r.find_first());
+    EXPECT_EQ(8192u, r.find_last());
+
+    // Ranges are stored as runs, which cover a whole chunk in a few bytes.
+    RoaringBitmap range;
+    range.set_range(10, 3 * 65536 + 5);
+    EXPECT_EQ(3u * 65536 - 4, range.count());
+    EXPECT_LT(range.getMemorySize(), 1024u);
+    EXPECT_TRUE(range.test(65536 * 2));
+    EXPECT_FALSE(range.test(9));
+    EXPECT_FALSE(range.test(3 * 65536 + 6));
+
+    // Editing runs splits and joins them.
+    range.reset(100);
+    range.reset(10);
+    range.reset(3 * 65536 + 5);
+    EXPECT_FALSE(range.test(100));
+    EXPECT_TRUE(range.test(101));
+    EXPECT_EQ(11u, range.find_first());
+    range.set(100);
+    range.set(10);
+    range.set(9);
+    EXPECT_EQ(3u * 65536 - 4, range.count());
+    EXPECT_EQ(9u, range.find_first());
+
+    // run_optimize picks whatever is smallest, and does not change the set.
+    RoaringBitmap copy;
+    range.for_each_set_bit([&](uint32_t v) { copy.set(v); });
+    EXPECT_EQ(range, copy);
+    EXPECT_TRUE(copy.run_optimize());
+    EXPECT_FALSE(copy.run_optimize());
+    EXPECT_EQ(range, copy);
+    EXPECT_LT(copy.getMemorySize(), 1024u);
+
+    std::vector<uint32_t> values;
+    r.for_each_set_bit([&](uint32_t v) { values.push_back(v); });
+    EXPECT_EQ(toVector(r), values);
+    EXPECT_FALSE(r.run_optimize());
+}
+
+// Random sets whose density differs from chunk to chunk, so that all kinds of
+// containers meet.
+RoaringBitmap makeRandom(std::mt19937& rng, std::set<uint32_t>& ref) {
+    RoaringBitmap ret;
+    for (uint32_t key = 0; key < 6; ++key) {
+        uint32_t high = key << 16;
+        switch (rng() % 5) {
+        case 0:
+            break;
+        case 1:
+            for (int i = 0, e = rng() % 100; i < e; ++i) {
+                auto v = high | (rng() & 0xFFFF);
+                ret.set(v);
+                ref.insert(v);
+            }
+            break;
+        case 2:
+            for (int i = 0; i < 20000; ++i) {
+                auto v = high | (rng() & 0xFFFF);
+                ret.set(v);
+                ref.insert(v);
+            }
+            break;
+        default:
+            for (int i = 0, e = 1 + rng() % 20; i < e; ++i) {
+                uint32_t first = high | (rng() & 0xFFFF);
+                uint32_t last = std::min(first + uint32_t(rng() % 5000),
+                                         high | 0xFFFF);
+                ret.set_range(first, last);
+                for (auto v = first; v <= last; ++v)
+                    ref.insert(v);
+            }
+            break;
+        }
+    }
+    if (rng() % 2)
+        ret.run_optimize();
+    return ret;
+}
+
+TEST(RoaringBitmapTest, SetOps) {
+    std::mt19937 rng(0);
+    for (int iter = 0; iter < 30; ++iter) {
+        std::set<uint32_t> refA, refB;
+        auto a = makeRandom(rng, refA), b = makeRandom(rng, refB);
+        ASSERT_EQ(std::vector<uint32_t>(refA.begin(), refA.end()),
+                  toVector(a));
+        ASSERT_EQ(refA.size(), a.count());
+
+        std::set<uint32_t> refUnion = refA, refInter, refDiff;
+        refUnion.insert(refB.begin(), refB.end());
+        for (auto v : refA) {
+            if (refB.count(v))
+                refInter.insert(v);
+            else
+                refDiff.insert(v);
+        }
+
+        auto u = a | b;
+        EXPECT_EQ(std::vector<uint32_t>(refUnion.begin(), refUnion.end()),
+                  toVector(u));
+        EXPECT_EQ(refUnion.size(), u.count());
+        EXPECT_TRUE(a.is_subset_of(u));
+        EXPECT_TRUE(b.is_subset_of(u));
+
+        auto in = a & b;
+        EXPECT_EQ(std::vector<uint32_t>(refInter.begin(), refInter.end()),
+                  toVector(in));
+        EXPECT_EQ(!refInter.empty(), a.intersects(b));
+        EXPECT_TRUE(in.is_subset_of(a));
+
+        auto d = a - b;
+        EXPECT_EQ(std::vector<uint32_t>(refDiff.begin(), refDiff.end()),
+                  toVector(d));
+        EXPECT_FALSE(d.intersects(b));
+
+        // Equality does not depend on the kinds of containers.
+        auto optimized = u;
+        optimized.run_optimize();
+        EXPECT_EQ(u, optimized);
+        EXPECT_EQ(a, (in | d));
+    }
+}
+
+TEST(RoaringBitmapTest, ArrayIntersection) {
+    // Arrays of similar and of very different lengths, with and without 0,
+    // which the SSE4.2 compare must not mistake for a terminator.
+    std::mt19937 rng(1);
+    for (int iter = 0; iter < 200; ++iter) {
+        std::set<uint32_t> refA, refB;
+        RoaringBitmap a, b;
+        for (int i = 0, e = rng() % 3000; i < e; ++i) {
+            auto v = rng() % 8000;
+            a.set(v);
+            refA.insert(v);
+        }
+        for (int i = 0, e = iter % 2 ? rng() % 3000 : rng() % 40; i < e; ++i) {
+            auto v = rng() % 8000;
+            b.set(v);
+            refB.insert(v);
+        }
+        std::vector<uint32_t> expected;
+        std::set_intersection(refA.begin(), refA.end(), refB.begin(),
+                              refB.end(), std::back_inserter(expected));
+        EXPECT_EQ(expected, toVector(a & b));
+        EXPECT_EQ(expected, toVector(b & a));
+    }
+}
+
+TEST(RoaringBitmapTest, RankSelect) {
+    std::mt19937 rng(2);
+    std::set<uint32_t> ref;
+    auto r = makeRandom(rng, ref);
+    r |= makeRandom(rng, ref);
+    std::vector<uint32_t> sorted(ref.begin(), ref.end());
+    ASSERT_FALSE(sorted.empty());
+    for (size_t k = 0; k < sorted.size(); k += 1 + rng() % 50) {
+        EXPECT_EQ(sorted[k], r.select(k));
+        EXPECT_EQ(k + 1, r.rank(sorted[k]));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        uint32_t v = rng() % (7 << 16);
+        EXPECT_EQ(size_t(std::upper_bound(sorted.begin(), sorted.end(), v) -
+                         sorted.begin()),
+                  r.rank(v));
+    }
+    EXPECT_EQ(sorted.back(), r.select(sorted.size() - 1));
+    EXPECT_EQ(r.count(), r.rank(0xFFFFFFFF));
+}
+
+TEST(RoaringBitmapTest, Serialization) {
+    // The reference encodings of the portable format.
+    RoaringBitmap small = {1, 2, 3};
+    EXPECT_EQ(std::string("\x3A\x30\0\0\x01\0\0\0\0\0\x02\0\x10\0\0\0"
+                          "\x01\0\x02\0\x03\0",
+                          22),
+              serialize(small));
+    RoaringBitmap range;
+    range.set_range(0, 99);
+    EXPECT_EQ(std::string("\x3B\x30\0\0\x01\0\0\x63\0\x01\0\0\0\x63\0", 15),
+              serialize(range));
+    EXPECT_EQ(std::string("\x3A\x30\0\0\0\0\0\0", 8),
+              serialize(RoaringBitmap()));
+
+    std::mt19937 rng(3);
+    for (int iter = 0; iter < 20; ++iter) {
+        std::set<uint32_t> ref;
+        auto r = makeRandom(rng, ref);
+        r.set(0xFFFF0000u + iter);
+        auto bytes = serialize(r);
+        ASSERT_EQ(r.getSerializedSize(), bytes.size());
+        auto copy = RoaringBitmap::deserialize(bytes);
+        EXPECT_EQ(r, copy);
+        EXPECT_EQ(bytes, serialize(copy));
+
+        // Every truncation is detected.
+        auto cut = rng() % bytes.size();
+        EXPECT_THROW(RoaringBitmap::deserialize(StringView(bytes.data(), cut)),
+                     std::invalid_argument);
+    }
+
+    auto bytes = serialize(small);
+    bytes[0] = 0x42;
+    EXPECT_THROW(RoaringBitmap::deserialize(bytes), std::invalid_argument);
+    bytes = serialize(small);
+    bytes[18] = 0x05;
+    EXPECT_THROW(RoaringBitmap::deserialize(bytes), std::invalid_argument);
+}
+}
@@ -3,7 +3,11 @@
 
 #include "gtest/gtest.h"
 
+#include <cstdarg>
+#include <limits>
 #include <list>
+#include <new>
+#include <string>
 
 using namespace ds;
 
@@ -463,6 +467,17 @@ TYPED_TEST(SmallVectorTest, InsertCopy) {
     this->assertValuesInOrder(this->theVector, 4u, 1, 77, 2, 3);
 }
 
+// Insert a copy of an element of the vector itself, which the insertion moves.
+TEST(SmallVectorTest, InsertSelfReference) {
+    SmallVector<int, 8> V = {1, 2, 3, 4};
+    V.insert(V.begin() + 1, V[2]);
+    EXPECT_TRUE(make_array_ref(V).equals({1, 3, 2, 3, 4}));
+    V.insert(V.begin(), std::move(V.back()));
+    EXPECT_TRUE(make_array_ref(V).equals({4, 1, 3, 2, 3, 4}));
+    V.insert(V.begin() + 2, V[1]);
+    EXPECT_TRUE(make_array_ref(V).equals({4, 1, 1, 3, 2, 3, 4}));
+}
+
 // Insert repeated elements.
 TYPED_TEST(SmallVectorTest, InsertRepeatedTest) {
     SCOPED_TRACE("InsertRepeatedTest");
@@ -889,4 +904,267 @@ TEST(SmallVectorTest, InitializerList) {
     V2.insert(V2.begin() + 1, 5);
     EXPECT_TRUE(make_array_ref(V2).equals({4, 5, 3, 2}));
 }
-}
\ No newline at end of file
+
+TEST(SmallVectorTest, ArenaAllocator) {
+    BumpPtrAllocator arena;
+    SmallVector<int, 4, ArenaAllocator> V(arena);
+    for (int i = 0; i < 4; ++i)
+        V.push_back(i);
+    EXPECT_EQ(0u, arena.getBytesAllocated());
+
+    // Spilling takes memory from the arena, and growing the most recent
+    // allocation extends it in place.
+    for (int i = 4; i < 1000; ++i)
+        V.push_back(i);
+    EXPECT_LE(1000 * sizeof(int), arena.getBytesAllocated());
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(i, V[i]);
+
+    // Non-POD elements use the same allocator.
+    SmallVector<std::string, 1, ArenaAllocator> S(arena);
+    for (int i = 0; i < 100; ++i)
+        S.push_back(std::to_string(i));
+    EXPECT_EQ("99", S.back());
+
+    // Moving a spilled vector hands over both the buffer and the allocator.
+    BumpPtrAllocator other;
+    SmallVector<std::string, 1, ArenaAllocator> T(other);
+    T = std::move(S);
+    EXPECT_EQ(100u, T.size());
+    EXPECT_EQ(&arena, &T.getAllocator().getArena());
+    EXPECT_EQ(0u, other.getBytesAllocated());
+
+    SmallVector<int, 4, ArenaAllocator> W(other);
+    W.append(size_t(10), 7);
+    std::swap(V, W);
+    EXPECT_EQ(10u, V.size());
+    EXPECT_EQ(&other, &V.getAllocator().getArena());
+    EXPECT_EQ(999, W.back());
+
+    EXPECT_TRUE(make_array_ref(V).equals({7, 7, 7, 7, 7, 7, 7, 7, 7, 7}));
+
+    // A vector without inline elements that lives in the arena itself. Its
+    // first buffer must not land right behind it, where the inline elements
+    // would be.
+    using Vec = SmallVector<int, 0, ArenaAllocator>;
+    BumpPtrAllocator third;
+    auto* P = new (third.allocate(sizeof(Vec), alignof(Vec))) Vec(third);
+    P->push_back(0);
+    EXPECT_NE(static_cast<void*>(P + 1), static_cast<void*>(P->data()));
+    for (int i = 1; i < 100; ++i)
+        P->push_back(i);
+    EXPECT_EQ(99, P->back());
+    using StrVec = SmallVector<std::string, 0, ArenaAllocator>;
+    auto* Q =
+        new (third.allocate(sizeof(StrVec), alignof(StrVec))) StrVec(third);
+    Q->push_back("a");
+    EXPECT_NE(static_cast<void*>(Q + 1), static_cast<void*>(Q->data()));
+    Q->~StrVec();
+    P->~Vec();
+}
+
+// Counts constructor and destructor calls, and opts into trivial relocation.
+struct Relocatable {
+    static int numMoves;
+    static int numLive;
+    int value;
+
+    Relocatable(int v) : value(v) { ++numLive; }
+    Relocatable(Relocatable&& other) : value(other.value) {
+        ++numMoves;
+        ++numLive;
+    }
+    ~Relocatable() { --numLive; }
+};
+int Relocatable::numMoves = 0;
+int Relocatable::numLive = 0;
+}
+
+namespace ds {
+namespace detail {
+template <>
+struct isTriviallyRelocatable<Relocatable> {
+    static constexpr bool value = true;
+};
+}
+}
+
+namespace {
+
+TEST(SmallVectorTest, TrivialRelocation) {
+    static_assert(detail::isTriviallyRelocatable<std::unique_ptr<int>>::value,
+                  "unique_ptr should be relocatable");
+    static_assert(!detail::isTriviallyRelocatable<std::string>::value,
+                  "std::string must not be relocatable");
+
+    {
+        SmallVector<Relocatable, 2> V;
+        for (int i = 0; i < 100; ++i)
+            V.emplace_back(i);
+        EXPECT_EQ(0, Relocatable::numMoves);
+        EXPECT_EQ(100, Relocatable::numLive);
+        for (int i = 0; i < 100; ++i)
+            EXPECT_EQ(i, V[i].value);
+    }
+    EXPECT_EQ(0, Relocatable::numLive);
+
+    SmallVector<std::unique_ptr<int>, 4> P;
+    for (int i = 0; i < 1000; ++i)
+        P.push_back(std::unique_ptr<int>(new int(i)));
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(i, *P[i]);
+}
+
+struct Huge {
+    int value;
+};
+}
+
+namespace ds {
+template <>
+struct SmallVectorSizeType<Huge> {
+    using type = uint64_t;
+};
+}
+
+namespace {
+
+TEST(SmallVectorTest, CompactHeader) {
+    // One pointer plus two 32-bit counters, or 64-bit ones for tiny types.
+    using Size32 = SmallVectorBase<uint32_t>;
+    using Size64 = SmallVectorBase<uint64_t>;
+    static_assert(sizeof(SmallVector<int, 0>) == sizeof(Size32), "");
+    static_assert(sizeof(SmallVector<void*, 0>) == sizeof(Size32), "");
+    static_assert(sizeof(SmallVector<char, 0>) ==
+                      (sizeof(void*) >= 8 ? sizeof(Size64) : sizeof(Size32)),
+                  "");
+    static_assert(sizeof(SmallVector<Huge, 0>) == sizeof(Size64), "");
+    static_assert(sizeof(SmallVector<int, 4>) == sizeof(Size32) + 16, "");
+
+    SmallVector<int, 0> V;
+    EXPECT_EQ(0u, V.capacity());
+    EXPECT_EQ(std::numeric_limits<uint32_t>::max(), V.max_size());
+    for (int i = 0; i < 100; ++i)
+        V.push_back(i);
+    EXPECT_EQ(99, V.back());
+
+    // The inline elements are found behind a stateful allocator as well.
+    BumpPtrAllocator arena;
+    SmallVector<char, 3, ArenaAllocator> C(arena);
+    C.append({'a', 'b', 'c'});
+    EXPECT_EQ(0u, arena.getBytesAllocated());
+    C.push_back('d');
+    EXPECT_NE(0u, arena.getBytesAllocated());
+    EXPECT_EQ("abcd", std::string(C.begin(), C.end()));
+}
+
+TEST(SmallVectorTest, UninitializedAppend) {
+    SmallVector<char, 8> Buf;
+    // malloc may hand out a few more bytes than asked for.
+    Buf.reserve_exact(100);
+    size_t Capacity = Buf.capacity();
+    EXPECT_LE(100u, Capacity);
+    EXPECT_GT(200u, Capacity);
+    Buf.reserve_exact(50);
+    EXPECT_EQ(Capacity, Buf.capacity());
+
+    MutableArrayRef<char> Chunk = Buf.append_uninitialized(5);
+    EXPECT_EQ(5u, Chunk.size());
+    EXPECT_EQ(Buf.data(), Chunk.data());
+    memcpy(Chunk.data(), "hello", 5);
+    Chunk = Buf.append_uninitialized(6);
+    memcpy(Chunk.data(), " world", 6);
+    EXPECT_EQ("hello world", std::string(Buf.begin(), Buf.end()));
+
+    Buf.resize_for_overwrite(3);
+    EXPECT_EQ("hel", std::string(Buf.begin(), Buf.end()));
+    Buf.resize_for_overwrite(200);
+    EXPECT_EQ(200u, Buf.size());
+    EXPECT_EQ('l', Buf[2]);
+
+    // Non-trivial elements are still default-constructed.
+    SmallVector<std::string, 1> Strs;
+    Strs.resize_for_overwrite(3);
+    EXPECT_TRUE(Strs[2].empty());
+    Strs.append_uninitialized(2)[1] = "x";
+    EXPECT_EQ(5u, Strs.size());
+    EXPECT_EQ("x", Strs.back());
+    Strs.reserve_exact(9);
+    EXPECT_LE(9u, Strs.capacity());
+    EXPECT_GT(18u, Strs.capacity());
+}
+
+// Hands out 64 bytes more than asked for, and says so.
+struct SlackAllocator : MallocAllocator {
+    void* allocate(size_t size, size_t alignment) {
+        return MallocAllocator::allocate(size + 64, alignment);
+    }
+    void* reallocate(void* ptr, size_t oldSize, size_t newSize,
+                     size_t alignment) {
+        return MallocAllocator::reallocate(ptr, oldSize, newSize + 64,
+                                           alignment);
+    }
+    size_t getUsableSize(void*, size_t size) const { return size + 64; }
+};
+
+TEST(SmallVectorTest, GrowthPolicy) {
+    // The slack the allocator reports becomes capacity.
+    SmallVector<int, 0, SlackAllocator> V;
+    V.push_back(0);
+    EXPECT_EQ(17u, V.capacity());
+    for (int i = 1; i < 18; ++i)
+        V.push_back(i);
+    EXPECT_EQ(2 * 17 + 1 + 16u, V.capacity());
+
+    SmallVector<char, 0> C;
+    C.push_back('x');
+    EXPECT_LE(1u, C.capacity());
+
+    // Grow by 1.5x instead of 2x.
+    BumpPtrAllocator arena;
+    SmallVector<int, 0, GrowthFactor<3, 2, ArenaAllocator>> G(arena);
+    std::vector<size_t> Capacities;
+    for (int i = 0; i < 12; ++i) {
+        G.push_back(i);
+        if (Capacities.empty() || Capacities.back() != G.capacity())
+            Capacities.push_back(G.capacity());
+    }
+    EXPECT_EQ(std::vector<size_t>({1, 2, 4, 7, 11, 17}), Capacities);
+    EXPECT_EQ(&arena, &G.getAllocator().getArena());
+}
+
+TEST(SmallVectorTest, Alignment) {
+    auto isAligned = [](const void* P, size_t A) {
+        return reinterpret_cast<uintptr_t>(P) % A == 0;
+    };
+
+    AlignedSmallVector<float, 16, 64> V;
+    static_assert(alignof(decltype(V)) == 64, "");
+    EXPECT_TRUE(isAligned(V.data(), 64));
+    for (int i = 0; i < 16; ++i)
+        V.push_back(float(i));
+    EXPECT_TRUE(make_array_ref(V).isAligned(64));
+    for (int i = 16; i < 1000; ++i) {
+        V.push_back(float(i));
+        EXPECT_TRUE(isAligned(V.data(), 64));
+    }
+    EXPECT_EQ(999.0f, V.back());
+    EXPECT_EQ(500.0f, make_array_ref(V).alignedData<64>()[500]);
+
+    // No inline elements, so no need to over-align the vector itself.
+    AlignedSmallVector<double, 0, 32> W;
+    EXPECT_EQ(sizeof(SmallVector<double, 0>), sizeof(W));
+    W.append(size_t(100), 1.0);
+    EXPECT_TRUE(isAligned(W.data(), 32));
+
+    // The arena honors the alignment as well.
+    BumpPtrAllocator arena;
+    AlignedSmallVector<char, 3, 64, ArenaAllocator> C(arena);
+    C.append({'a', 'b', 'c'});
+    EXPECT_TRUE(isAligned(C.data(), 64));
+    EXPECT_EQ(0u, arena.getBytesAllocated());
+    C.append(size_t(100), 'd');
+    EXPECT_TRUE(isAligned(C.data(), 64));
+    EXPECT_EQ("abcd", std::string(C.begin(), C.begin() + 4));
+}
+}
@@ -0,0 +1,142 @@
+#include "DataStructure/SparseBitVector.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace ds;
+
+namespace {
+
+TEST(SparseBitVectorTest, BasicTest) {
+    SparseBitVector<> s;
+    EXPECT_TRUE(s.empty());
+    EXPECT_EQ(0u, s.count());
+    EXPECT_EQ(SparseBitVector<>::npos, s.find_first());
+    EXPECT_TRUE(s.begin() == s.end());
+
+    s.set(5);
+    s.set(100000000);
+    s.set(127);
+    s.set(128);
+    EXPECT_FALSE(s.test_set(64));
+    EXPECT_TRUE(s.test_set(64));
+    EXPECT_EQ(5u, s.count());
+    EXPECT_TRUE(s.test(127));
+    EXPECT_FALSE(s.test(126));
+    EXPECT_FALSE(s.test(99999999));
+    EXPECT_EQ(5u, s.find_first());
+    EXPECT_EQ(100000000u, s.find_last());
+    EXPECT_EQ(std::vector<size_t>({5, 64, 127, 128, 100000000}),
+              std::vector<size_t>(s.begin(), s.end()));
+
+    // Only the ranges that hold a member take up memory.
+    EXPECT_LE(s.getMemorySize(), 8 * (sizeof(size_t) + 16));
+
+    s.reset(128);
+    s.reset(129);
+    s.reset(200000000);
+    EXPECT_FALSE(s.test(128));
+    EXPECT_EQ(4u, s.count());
+    s.reset(100000000);
+    EXPECT_EQ(127u, s.find_last());
+
+    s.clear();
+    EXPECT_TRUE(s.empty());
+}
+
+// Checks every operation against std::set on random sets.
+template <unsigned ElementSize>
+void testSetOps() {
+    using Sparse = SparseBitVector<ElementSize>;
+    std::mt19937 rng(ElementSize);
+    auto makeRandom = [&](std::set<size_t>& ref) {
+        Sparse ret;
+        // Clustered members, so that elements hold more than one bit.
+        for (int i = 0, e = rng() % 40; i < e; ++i) {
+            size_t base = rng() % 4000;
+            for (int j = 0, f = rng() % 8; j < f; ++j) {
+                size_t pos = base + rng() % 300;
+                ret.set(pos);
+                ref.insert(pos);
+            }
+        }
+        return ret;
+    };
+    auto toSet = [](const Sparse& s) {
+        return std::set<size_t>(s.begin(), s.end());
+    };
+
+    for (int iter = 0; iter < 200; ++iter) {
+        std::set<size_t> refA, refB;
+        Sparse a = makeRandom(refA), b = makeRandom(refB);
+        ASSERT_EQ(refA, toSet(a));
+        ASSERT_EQ(refA.size(), a.count());
+
+        std::set<size_t> refUnion = refA, refInter, refDiff;
+        refUnion.insert(refB.begin(), refB.end());
+        for (auto pos : refA) {
+            if (refB.count(pos))
+                refInter.insert(pos);
+            else
+                refDiff.insert(pos);
+        }
+
+        Sparse u = a;
+        EXPECT_EQ(refUnion != refA, u.union_with(b));
+        EXPECT_EQ(refUnion, toSet(u));
+        EXPECT_FALSE(u.union_with(b));
+        EXPECT_TRUE(a.is_subset_of(u));
+        EXPECT_TRUE(b.is_subset_of(u));
+
+        Sparse in = a;
+        EXPECT_EQ(refInter != refA, in.intersect_with(b));
+        EXPECT_EQ(refInter, toSet(in));
+        EXPECT_EQ(!refInter.empty(), a.intersects(b));
+        EXPECT_TRUE(in.is_subset_of(b));
+
+        Sparse d = a;
+        EXPECT_EQ(refDiff != refA, d.subtract(b));
+        EXPECT_EQ(refDiff, toSet(d));
+        EXPECT_FALSE(d.intersects(b));
+
+        // The results never keep empty elements around.
+        EXPECT_EQ(a, (Sparse(a) &= b) |= d);
+        EXPECT_EQ(in, (Sparse(a) -= d));
+        EXPECT_EQ(refA.empty() ? Sparse::npos : *refA.begin(),
+                  a.find_first());
+        EXPECT_EQ(refA.empty() ? Sparse::npos : *refA.rbegin(),
+                  a.find_last());
+    }
+
+    Sparse s;
+    s.set(3);
+    EXPECT_FALSE(s.union_with(s));
+    EXPECT_FALSE(s.intersect_with(s));
+    EXPECT_TRUE(s.subtract(s));
+    EXPECT_TRUE(s.empty());
+}
+
+TEST(SparseBitVectorTest, SetOps) {
+    testSetOps<64>();
+    testSetOps<128>();
+    testSetOps<512>();
+}
+
+TEST(SparseBitVectorTest, DynamicBitSet) {
+    DynamicBitSet<unsigned char> dense(1000);
+    for (size_t pos : {0, 7, 8, 500, 999})
+        dense.set(pos);
+    SparseBitVector<> sparse(dense);
+    EXPECT_EQ(std::vector<size_t>({0, 7, 8, 500, 999}),
+              std::vector<size_t>(sparse.begin(), sparse.end()));
+    EXPECT_EQ(dense, sparse.to_dynamic_bitset<unsigned char>(1000));
+
+    auto wide = sparse.to_dynamic_bitset(2000);
+    EXPECT_EQ(2000u, wide.size());
+    EXPECT_EQ(5u, wide.count());
+    EXPECT_TRUE(wide.test(999));
+}
+}
@@ -0,0 +1,100 @@
+#include "DataStructure/StringSearcher.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+#include <string>
+
+using namespace ds;
+
+namespace {
+
+size_t naiveFind(StringView text, StringView needle, size_t from) {
+    if (from > text.size())
+        return StringView::npos;
+    auto pos = text.to_string().find(needle.to_string(), from);
+    return pos == std::string::npos ? StringView::npos : pos;
+}
+
+size_t naiveRFind(StringView text, StringView needle) {
+    auto pos = text.to_string().rfind(needle.to_string());
+    return pos == std::string::npos ? StringView::npos : pos;
+}
+
+size_t naiveCount(StringView text, StringView needle) {
+    size_t count = 0;
+    for (size_t i = 0; i + needle.size() <= text.size(); ++i)
+        if (text.substr(i, needle.size()) == needle)
+            ++count;
+    return count;
+}
+
+TEST(StringSearcherTest, Basic) {
+    StringView text("hellx xello hell ello world foo bar hello");
+    StringSearcher hello("hello");
+    EXPECT_EQ(36U, hello.find(text));
+    EXPECT_EQ(StringView::npos, hello.find(text, 37));
+    EXPECT_EQ(1U, hello.count(text));
+    EXPECT_EQ(StringView::npos, hello.find("hell"));
+    EXPECT_EQ(hello.getNeedle(), "hello");
+
+    StringSearcher hell("hell", StringSearcher::Direction::Backward);
+    EXPECT_EQ(36U, hell.rfind(text));
+    EXPECT_EQ(StringView::npos, hell.rfind("hel"));
+
+    StringSearcher empty("");
+    EXPECT_EQ(3U, empty.find(text, 3));
+    EXPECT_EQ(StringView::npos, empty.find("ab", 3));
+}
+
+TEST(StringSearcherTest, PeriodicNeedles) {
+    // Highly periodic inputs are the worst case for naive search.
+    std::string text(1000, 'a');
+    StringSearcher aaa("aaa");
+    EXPECT_EQ(0U, aaa.find(text));
+    EXPECT_EQ(998U, aaa.count(text));
+    EXPECT_EQ(997U,
+              StringSearcher("aaa", StringSearcher::Direction::Backward)
+                  .rfind(text));
+
+    std::string needle(100, 'a');
+    needle.back() = 'b';
+    text += needle;
+    EXPECT_EQ(1000U, StringSearcher(needle).find(text));
+    EXPECT_EQ(1000U, StringView(text).find(needle));
+    EXPECT_EQ(1000U, StringView(text).rfind(needle));
+    EXPECT_EQ(1U, StringView(text).count(needle));
+}
+
+TEST(StringSearcherTest, Random) {
+    // Small alphabets produce lots of partial matches and periodic needles.
+    std::mt19937 rng(1234);
+    for (unsigned iter = 0; iter != 300; ++iter) {
+        auto alphabet = 2 + rng() % 3;
+        std::string text(64 + rng() % 400, ' ');
+        for (auto& c : text)
+            c = 'a' + rng() % alphabet;
+        std::string needle;
+        if (iter % 2) {
+            auto start = rng() % text.size();
+            needle = text.substr(start, 2 + rng() % 40);
+        } else {
+            needle.resize(2 + rng() % 12);
+            for (auto& c : needle)
+                c = 'a' + rng() % alphabet;
+        }
+
+        StringSearcher fwd(needle);
+        StringSearcher bwd(needle, StringSearcher::Direction::Backward);
+        for (size_t from : {size_t(0), size_t(1), text.size() / 3})
+            EXPECT_EQ(naiveFind(text, needle, from), fwd.find(text, from));
+        EXPECT_EQ(naiveRFind(text, needle), bwd.rfind(text));
+        EXPECT_EQ(naiveCount(text, needle), fwd.count(text));
+
+        StringView str(text);
+        EXPECT_EQ(naiveFind(text, needle, 5), str.find(needle, 5));
+        EXPECT_EQ(naiveRFind(text, needle), str.rfind(needle));
+        EXPECT_EQ(naiveCount(text, needle), str.count(needle));
+    }
+}
+}
@@ -0,0 +1,72 @@
+#include "DataStructure/StringSwitch.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace ds;
+
+namespace {
+
+enum class Command { Start, Stop, Status, Unknown };
+
+Command parseCommand(StringView s) {
+    return StringSwitch<Command>(s)
+        .Case("start", Command::Start)
+        .Cases("stop", "halt", "quit", Command::Stop)
+        .Case("status", Command::Status)
+        .Default(Command::Unknown);
+}
+
+constexpr int parseDigitName(StringView s) {
+    return StringSwitch<int>(s)
+        .Case("zero", 0)
+        .Case("one", 1)
+        .Cases("two", "deux", 2)
+        .Default(-1);
+}
+
+int dispatch(StringView cmd) {
+    switch (hashString(cmd)) {
+    case "alpha"_sh:
+        return cmd == "alpha" ? 1 : 0;
+    case "beta"_sh:
+        return cmd == "beta" ? 2 : 0;
+    default:
+        return 0;
+    }
+}
+
+TEST(StringSwitchTest, Hash) {
+    static_assert(hashString("") == 14695981039346656037ULL, "");
+    static_assert(hashString("foo") == "foo"_sh, "");
+    static_assert(hashString("foo") != hashString("bar"), "");
+    EXPECT_EQ(hashString(std::string("hello")), "hello"_sh);
+}
+
+TEST(StringSwitchTest, Basic) {
+    EXPECT_EQ(Command::Start, parseCommand("start"));
+    EXPECT_EQ(Command::Stop, parseCommand("stop"));
+    EXPECT_EQ(Command::Stop, parseCommand("halt"));
+    EXPECT_EQ(Command::Stop, parseCommand("quit"));
+    EXPECT_EQ(Command::Status, parseCommand(std::string("status")));
+    EXPECT_EQ(Command::Unknown, parseCommand("stat"));
+    EXPECT_EQ(Command::Unknown, parseCommand(""));
+
+    // The first matching case wins.
+    EXPECT_EQ(1, StringSwitch<int>("a").Case("a", 1).Case("a", 2).Default(0));
+
+    int two = StringSwitch<int>("two").Case("one", 1).Case("two", 2);
+    EXPECT_EQ(2, two);
+
+    EXPECT_EQ(1, dispatch("alpha"));
+    EXPECT_EQ(2, dispatch("beta"));
+    EXPECT_EQ(0, dispatch("gamma"));
+}
+
+TEST(StringSwitchTest, Constexpr) {
+    static_assert(parseDigitName("one") == 1, "");
+    static_assert(parseDigitName("deux") == 2, "");
+    static_assert(parseDigitName("three") == -1, "");
+}
+}
@@ -1,7 +1,17 @@
+#include "DataStructure/SmallVector.h"
 #include "DataStructure/StringView.h"
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+
 using namespace ds;
 
 namespace {
@@ -13,6 +23,20 @@ TEST(StringViewTest, Construction) {
     EXPECT_EQ("hello", StringView(std::string("hello")));
 }
 
+TEST(StringViewTest, Constexpr) {
+    constexpr StringView s("hello world");
+    static_assert(s.size() == 11, "");
+    static_assert(s[4] == 'o', "");
+    static_assert(s.front() == 'h' && s.back() == 'd', "");
+    static_assert(s.startswith("hello") && s.endswith("world"), "");
+    static_assert(s.substr(6) == "world", "");
+    static_assert(s.slice(0, 5) == "hello", "");
+    static_assert(s.dropFront(6).dropBack(1) == "worl", "");
+    static_assert(StringView("abc") < StringView("abd"), "");
+    static_assert(StringView("ab").compare("abc") == -1, "");
+    static_assert(StringView() == "", "");
+}
+
 TEST(StringViewTest, Iteration) {
     StringView S("hello");
     const char* p = "hello";
@@ -157,4 +181,396 @@ TEST(StringViewTest, Count) {
     EXPECT_EQ(1U, Str.count("ello"));
     EXPECT_EQ(0U, Str.count("zz"));
 }
-}
\ No newline at end of file
+
+// Substring searches take the first-byte scan for short needles or haystacks
+// and Two-Way otherwise. Check both against std::string.
+TEST(StringViewTest, FindSubstring) {
+    std::mt19937 rng(3);
+    std::string text(400, ' ');
+    for (auto& c : text)
+        c = "ab"[rng() % 2];
+    for (size_t len : {0, 1, 20, 63, 64, 200, 400}) {
+        std::string hay = text.substr(0, len);
+        StringView str(hay);
+        for (size_t n : {2, 3, 8, 15, 16, 17, 40}) {
+            for (int iter = 0; iter < 8; ++iter) {
+                // Needles taken from the text match somewhere; random ones
+                // mostly do not.
+                std::string needle(n, ' ');
+                if (iter % 2 == 0 && n <= len)
+                    needle = hay.substr(rng() % (len - n + 1), n);
+                else
+                    for (auto& c : needle)
+                        c = "ab"[rng() % 2];
+                size_t count = 0;
+                for (auto i = hay.find(needle); i != std::string::npos;
+                     i = hay.find(needle, i + 1))
+                    ++count;
+                EXPECT_EQ(hay.find(needle), str.find(needle)) << len;
+                EXPECT_EQ(hay.find(needle, len / 3), str.find(needle, len / 3))
+                    << len;
+                EXPECT_EQ(hay.rfind(needle), str.rfind(needle)) << len;
+                EXPECT_EQ(count, str.count(needle)) << len;
+            }
+        }
+    }
+}
+
+// Long inputs go through the vectorized kernels (including their unaligned
+// tails), so check them against a naive byte-at-a-time scan.
+TEST(StringViewTest, FindLong) {
+    std::mt19937 rng(42);
+    std::string buf(300, ' ');
+    for (auto& c : buf)
+        c = "abc\x80\xff"[rng() % 5];
+    StringView charSets[] = {"x", "b", "\xff", "bc", "a\x80", "\x80\xff", "",
+                             StringView("\0\x7f", 2)};
+    auto naiveFind = [](StringView s, StringView chars, bool negate,
+                        bool last, size_t from) {
+        auto inSet = [&](char c) {
+            return (chars.find(c) != StringView::npos) != negate;
+        };
+        if (last) {
+            for (size_t i = std::min(from, s.size()); i != 0; --i)
+                if (inSet(s[i - 1]))
+                    return i - 1;
+        } else {
+            for (size_t i = from; i < s.size(); ++i)
+                if (inSet(s[i]))
+                    return i;
+        }
+        return StringView::npos;
+    };
+
+    for (size_t len = 0; len <= buf.size(); len += 7) {
+        StringView str(buf.data(), len);
+        for (auto chars : charSets) {
+            for (size_t from : {size_t(0), size_t(5), size_t(33), len / 2,
+                                StringView::npos}) {
+                size_t start = std::min(from, len);
+                EXPECT_EQ(naiveFind(str, chars, false, false, start),
+                          str.find_first_of(chars, start));
+                EXPECT_EQ(naiveFind(str, chars, true, false, start),
+                          str.find_first_not_of(chars, start));
+                EXPECT_EQ(naiveFind(str, chars, false, true, from),
+                          str.find_last_of(chars, from));
+                EXPECT_EQ(naiveFind(str, chars, true, true, from),
+                          str.find_last_not_of(chars, from));
+                if (chars.size() == 1) {
+                    EXPECT_EQ(naiveFind(str, chars, false, true, from),
+                              str.rfind(chars[0], from));
+                    EXPECT_EQ(naiveFind(str, chars, true, false, start),
+                              str.find_first_not_of(chars[0], start));
+                }
+            }
+            if (chars.size() == 1) {
+                EXPECT_EQ(
+                    (size_t)std::count(str.begin(), str.end(), chars[0]),
+                    str.count(chars[0]));
+            }
+        }
+    }
+
+    // More than 255 blocks exercises the counter flush in count(char).
+    std::string big(40000, 'a');
+    big[0] = big[20000] = big[39999] = 'z';
+    EXPECT_EQ(39997U, StringView(big).count('a'));
+    EXPECT_EQ(3U, StringView(big).count('z'));
+}
+
+TEST(StringViewTest, Split) {
+    auto pieces = [](const SplitRange& range) {
+        std::vector<std::string> ret;
+        for (auto piece : range)
+            ret.push_back(piece.to_string());
+        return ret;
+    };
+    using Strs = std::vector<std::string>;
+
+    EXPECT_EQ(Strs({"a", "", "b", "c", ""}),
+              pieces(SplitRange("a,,b,c,", ',')));
+    EXPECT_EQ(Strs({"a", "b", "c"}),
+              pieces(SplitRange("a,,b,c,", ',', -1, false)));
+    EXPECT_EQ(Strs({"a", ",b,c,"}), pieces(SplitRange("a,,b,c,", ',', 1)));
+    EXPECT_EQ(Strs({"a", "b,c,"}),
+              pieces(SplitRange("a,,b,c,", ',', 2, false)));
+    EXPECT_EQ(Strs({"a,,b,c,"}), pieces(SplitRange("a,,b,c,", ',', 0)));
+    EXPECT_EQ(Strs({""}), pieces(SplitRange("", ',')));
+    EXPECT_EQ(Strs(), pieces(SplitRange("", ',', -1, false)));
+    EXPECT_EQ(Strs(), pieces(SplitRange(",,", ',', -1, false)));
+
+    EXPECT_EQ(Strs({"a", "b", "", "c"}),
+              pieces(SplitRange("a::b::::c", "::")));
+    EXPECT_EQ(Strs({"a::b"}), pieces(SplitRange("a::b", "")));
+    EXPECT_EQ(Strs({"a", "b", "c", "d"}),
+              pieces(SplitRange::anyOf("a b\tc  \nd", " \t\n", -1, false)));
+
+    // The lazy range and the eager split() agree.
+    StringView csv("x,y,,z");
+    auto eager = split(csv, ',');
+    SplitRange lazy(csv, ',');
+    EXPECT_TRUE(std::equal(eager.begin(), eager.end(), lazy.begin()));
+    EXPECT_EQ(eager.size(),
+              (size_t)std::distance(lazy.begin(), lazy.end()));
+
+    // split_into appends to caller-provided storage.
+    SmallVector<StringView, 4> out;
+    split_into(out, csv, ',', -1, false);
+    ASSERT_EQ(3U, out.size());
+    EXPECT_EQ("z", out[2]);
+    split_into(out, "p--q", "--");
+    ASSERT_EQ(5U, out.size());
+    EXPECT_EQ("p", out[3]);
+    EXPECT_EQ("q", out[4]);
+}
+
+TEST(StringViewTest, GetAsInteger) {
+    int i = 42;
+    EXPECT_EQ(3U, StringView("123").getAsInteger(10, i));
+    EXPECT_EQ(123, i);
+    EXPECT_EQ(4U, StringView("-123,456").getAsInteger(10, i));
+    EXPECT_EQ(-123, i);
+    EXPECT_EQ(0U, StringView("").getAsInteger(10, i));
+    EXPECT_EQ(0U, StringView("-").getAsInteger(10, i));
+    EXPECT_EQ(0U, StringView("abc").getAsInteger(10, i));
+    EXPECT_EQ(-123, i);
+
+    EXPECT_EQ(2U, StringView("ff").getAsInteger(16, i));
+    EXPECT_EQ(255, i);
+    EXPECT_EQ(4U, StringView("0x1F").getAsInteger(0, i));
+    EXPECT_EQ(31, i);
+    EXPECT_EQ(5U, StringView("0b101").getAsInteger(0, i));
+    EXPECT_EQ(5, i);
+    EXPECT_EQ(3U, StringView("017").getAsInteger(0, i));
+    EXPECT_EQ(15, i);
+    EXPECT_EQ(1U, StringView("0").getAsInteger(0, i));
+    EXPECT_EQ(0, i);
+    // A prefix without digits after it is just a zero.
+    i = 1;
+    EXPECT_EQ(1U, StringView("0x").getAsInteger(0, i));
+    EXPECT_EQ(0, i);
+    i = 1;
+    EXPECT_EQ(1U, StringView("0b2").getAsInteger(0, i));
+    EXPECT_EQ(0, i);
+
+    // Range checks against the target type.
+    unsigned char uc;
+    EXPECT_EQ(3U, StringView("255").getAsInteger(10, uc));
+    EXPECT_EQ(255, uc);
+    EXPECT_EQ(0U, StringView("256").getAsInteger(10, uc));
+    EXPECT_EQ(0U, StringView("-1").getAsInteger(10, uc));
+    int8_t sc;
+    EXPECT_EQ(4U, StringView("-128").getAsInteger(10, sc));
+    EXPECT_EQ(-128, sc);
+    EXPECT_EQ(0U, StringView("128").getAsInteger(10, sc));
+
+    // Long digit runs go through the eight-at-a-time path.
+    uint64_t u;
+    EXPECT_EQ(20U, StringView("18446744073709551615").getAsInteger(10, u));
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(), u);
+    EXPECT_EQ(0U, StringView("18446744073709551616").getAsInteger(10, u));
+    EXPECT_EQ(19U, StringView("1234567812345678123x").getAsInteger(10, u));
+    EXPECT_EQ(1234567812345678123ULL, u);
+    EXPECT_EQ(9U, StringView("000000001").getAsInteger(10, u));
+    EXPECT_EQ(1U, u);
+    int64_t s64;
+    EXPECT_EQ(20U, StringView("-9223372036854775808").getAsInteger(10, s64));
+    EXPECT_EQ(std::numeric_limits<int64_t>::min(), s64);
+    EXPECT_EQ(0U, StringView("9223372036854775808").getAsInteger(10, s64));
+
+    std::mt19937_64 rng(7);
+    for (int iter = 0; iter < 1000; ++iter) {
+        uint64_t v = rng() >> (rng() % 64);
+        auto str = std::to_string(v);
+        uint64_t parsed = 0;
+        EXPECT_EQ(str.size(), StringView(str).getAsInteger(10, parsed));
+        EXPECT_EQ(v, parsed);
+    }
+}
+
+// The bits of a double. The tests look at these rather than call
+// std::isinf() and friends, which -ffinite-math-only folds away.
+uint64_t bitsOf(double d) {
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+const uint64_t SignBit = uint64_t(1) << 63;
+const uint64_t InfBits = uint64_t(0x7FF) << 52;
+
+TEST(StringViewTest, GetAsDouble) {
+    double d = 0;
+    EXPECT_EQ(3U, StringView("1.5").getAsDouble(d));
+    EXPECT_EQ(1.5, d);
+    EXPECT_EQ(5U, StringView("-2e-3,").getAsDouble(d));
+    EXPECT_EQ(-2e-3, d);
+    EXPECT_EQ(2U, StringView(".5").getAsDouble(d));
+    EXPECT_EQ(0.5, d);
+    EXPECT_EQ(2U, StringView("5.").getAsDouble(d));
+    EXPECT_EQ(5.0, d);
+    EXPECT_EQ(1U, StringView("7e").getAsDouble(d));
+    EXPECT_EQ(7.0, d);
+    EXPECT_EQ(2U, StringView("-0").getAsDouble(d));
+    EXPECT_EQ(SignBit, bitsOf(d));
+    EXPECT_EQ(8U, StringView("Infinity").getAsDouble(d));
+    EXPECT_EQ(InfBits, bitsOf(d));
+    EXPECT_EQ(4U, StringView("-inf").getAsDouble(d));
+    EXPECT_EQ(SignBit | InfBits, bitsOf(d));
+    EXPECT_EQ(3U, StringView("NaN").getAsDouble(d));
+    EXPECT_EQ(InfBits, bitsOf(d) & InfBits);
+    EXPECT_NE(0u, bitsOf(d) & ~(SignBit | InfBits));
+
+    d = 1;
+    EXPECT_EQ(0U, StringView("").getAsDouble(d));
+    EXPECT_EQ(0U, StringView(".").getAsDouble(d));
+    EXPECT_EQ(0U, StringView("-e5").getAsDouble(d));
+    EXPECT_EQ(0U, StringView("1e400").getAsDouble(d));
+    EXPECT_EQ(1, d);
+    EXPECT_EQ(6U, StringView("1e-400").getAsDouble(d));
+    EXPECT_EQ(0, d);
+
+    // Inputs beyond the fast path.
+    EXPECT_EQ(24U, StringView("0.1000000000000000055511").getAsDouble(d));
+    EXPECT_EQ(0.1, d);
+    EXPECT_EQ(23U, StringView("2.2250738585072014e-308").getAsDouble(d));
+    EXPECT_EQ(std::numeric_limits<double>::min(), d);
+    EXPECT_EQ(23U, StringView("1.7976931348623157e+308").getAsDouble(d));
+    EXPECT_EQ(std::numeric_limits<double>::max(), d);
+
+    // Long inputs, whose digits past the first few hundred only count for
+    // rounding.
+    std::string halfway = "9007199254740993." + std::string(1000, '0');
+    std::string above = halfway + "1";
+    EXPECT_EQ(halfway.size(), StringView(halfway).getAsDouble(d));
+    EXPECT_EQ(9007199254740992.0, d);
+    EXPECT_EQ(above.size(), StringView(above).getAsDouble(d));
+    EXPECT_EQ(9007199254740994.0, d);
+    std::string tiny = "0." + std::string(400, '0') + "1e100";
+    EXPECT_EQ(tiny.size(), StringView(tiny).getAsDouble(d));
+    EXPECT_EQ(1e-301, d);
+    d = 1;
+    EXPECT_EQ(0U, StringView("1" + std::string(400, '0')).getAsDouble(d));
+    EXPECT_EQ(1, d);
+
+    // Round trips agree with strtod.
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    char buf[64];
+    for (int iter = 0; iter < 2000; ++iter) {
+        double v = dist(rng);
+        if (iter % 3 == 1)
+            v = std::ldexp(v, static_cast<int>(rng() % 200) - 100);
+        const char* fmt = iter % 2 ? "%.17g" : "%.6g";
+        int len = std::snprintf(buf, sizeof(buf), fmt, v);
+        double parsed = 0;
+        EXPECT_EQ(static_cast<size_t>(len),
+                  StringView(buf, len).getAsDouble(parsed));
+        EXPECT_EQ(std::strtod(buf, nullptr), parsed) << buf;
+    }
+}
+
+TEST(StringViewTest, UTF8) {
+    EXPECT_TRUE(StringView("").isValidUTF8());
+    EXPECT_TRUE(StringView("plain ascii").isValidUTF8());
+    EXPECT_TRUE(StringView("\xC3\xA9t\xC3\xA9").isValidUTF8());
+    EXPECT_TRUE(StringView("\xE2\x82\xAC \xF0\x9F\x98\x80").isValidUTF8());
+    EXPECT_TRUE(StringView("\xF4\x8F\xBF\xBF").isValidUTF8());
+    EXPECT_TRUE(StringView("\xED\x9F\xBF").isValidUTF8());
+
+    const char* invalid[] = {
+        "\x80",             // stray continuation
+        "\xC3",             // truncated
+        "\xC3\x28",         // missing continuation
+        "\xC0\xAF",         // overlong 2-byte
+        "\xE0\x80\xAF",     // overlong 3-byte
+        "\xF0\x80\x80\xAF", // overlong 4-byte
+        "\xED\xA0\x80",     // surrogate
+        "\xF4\x90\x80\x80", // above U+10FFFF
+        "\xF8\x88\x80\x80", // 5-byte lead
+        "\xE2\x82\xAC\xAC", // extra continuation
+        "\xFF",
+    };
+    for (auto str : invalid) {
+        EXPECT_FALSE(StringView(str).isValidUTF8()) << str;
+        // The same error must be found at every position of a longer string.
+        for (size_t pad : {1, 13, 14, 15, 29, 30, 31, 63, 64, 100}) {
+            std::string padded(pad, 'a');
+            padded += str;
+            EXPECT_FALSE(StringView(padded).isValidUTF8()) << pad;
+            padded += std::string(70, 'b');
+            EXPECT_FALSE(StringView(padded).isValidUTF8()) << pad;
+        }
+    }
+
+    StringView mixed("a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+    EXPECT_EQ(4U, mixed.countCodePoints());
+    std::vector<char32_t> cps(mixed.codePoints().begin(),
+                              mixed.codePoints().end());
+    EXPECT_EQ(std::vector<char32_t>({'a', 0xE9, 0x20AC, 0x1F600}), cps);
+
+    // Ill-formed sequences decode to U+FFFD one maximal prefix at a time.
+    StringView bad("\xE2\x82x\x80\xF0\x9F");
+    cps.assign(bad.codePoints().begin(), bad.codePoints().end());
+    EXPECT_EQ(std::vector<char32_t>({0xFFFD, 'x', 0xFFFD, 0xFFFD}), cps);
+
+    // Compare the vectorized validator with the decoder on random strings.
+    std::mt19937 rng(5);
+    const char* pieces[] = {"a", "z", "\xC3\xA9", "\xE4\xB8\xAD",
+                            "\xF0\x9F\x98\x80", "\xED\x9F\xBF"};
+    for (int iter = 0; iter < 3000; ++iter) {
+        std::string str;
+        size_t len = rng() % 200;
+        while (str.size() < len)
+            str += pieces[rng() % 6];
+        if (iter % 2 && !str.empty())
+            str[rng() % str.size()] = static_cast<char>(rng());
+        if (iter % 5 == 0 && !str.empty())
+            str.resize(rng() % str.size());
+
+        bool expected = true;
+        size_t numCodePoints = 0;
+        StringView view(str);
+        for (auto it = view.codePoints().begin(),
+                  e = view.codePoints().end();
+             it != e; ++it) {
+            ++numCodePoints;
+            if (*it == 0xFFFD && it.getBytes() != "\xEF\xBF\xBD")
+                expected = false;
+        }
+        EXPECT_EQ(expected, view.isValidUTF8()) << iter;
+        if (expected) {
+            EXPECT_EQ(numCodePoints, view.countCodePoints());
+        }
+    }
+}
+
+TEST(StringViewTest, Hash) {
+    std::hash<StringView> hasher;
+    // Equal strings at different addresses and alignments hash equally, and
+    // every prefix of a string hashes differently.
+    std::string buf(300, '\0');
+    for (size_t i = 0; i < buf.size(); ++i)
+        buf[i] = static_cast<char>(i * 7 + 1);
+    std::vector<size_t> hashes;
+    for (size_t len = 0; len <= 256; ++len) {
+        std::string copy = " " + buf.substr(0, len);
+        size_t hash = hasher(StringView(buf.data(), len));
+        EXPECT_EQ(hash, hasher(StringView(copy.data() + 1, len))) << len;
+        hashes.push_back(hash);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    EXPECT_EQ(hashes.end(), std::unique(hashes.begin(), hashes.end()));
+
+    // Flipping any single bit changes the hash, including its low bits.
+    for (size_t len : {1, 3, 4, 8, 15, 16, 17, 48, 49, 100}) {
+        std::string str = buf.substr(0, len);
+        size_t base = hasher(str);
+        for (size_t bit = 0; bit < len * 8; ++bit) {
+            std::string flipped = str;
+            flipped[bit / 8] ^= static_cast<char>(1 << (bit % 8));
+            EXPECT_NE(base & 0xffff, hasher(flipped) & 0xffff) << len;
+        }
+    }
+}
+}
@@ -1,6 +1,8 @@
 #include "DataStructure/UnorderedCollection.h"
 
+#include <cstdint>
 #include <functional>
+#include <limits>
 #include <unordered_set>
 
 #include "gtest/gtest.h"
@@ -13,6 +15,7 @@ TEST(UnorderedCollectionTest, BasicTest) {
     UnorderedCollection<int> c;
     EXPECT_EQ(c.size(), 0u);
     EXPECT_EQ(c.empty(), true);
+    EXPECT_EQ(c.max_size(), std::numeric_limits<uint32_t>::max());
 
     auto& i = c.create(3);
     auto& j = c.create(4);